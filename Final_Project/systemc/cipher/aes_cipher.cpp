@@ -0,0 +1,307 @@
+#include "../include/aes_cipher.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_cross_check.h"
+#include "../include/aes_key_batch.h"
+#include "aes_cipher_handles.h"
+#include <cstring>
+#include <new>
+
+#ifdef AES_KEY_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Blocks in flight per iteration of the AES-NI loops. AESENC has a latency
+// of several cycles but issues every cycle, so independent blocks keep the
+// unit busy.
+constexpr size_t AESNI_INTERLEAVE = 8;
+
+AesKeySchedule::AesKeySchedule() {
+    AesCipher::expand_key(AesKey(), m_round_keys);
+    init(AesKeyKernel::AUTO);
+}
+
+AesKeySchedule::AesKeySchedule(const AesKey& key, AesKeyKernel kernel) {
+    AesCipher::expand_key(key, m_round_keys);
+    init(kernel);
+}
+
+AesKeySchedule::AesKeySchedule(const uint8_t* key, AesKeyKernel kernel) {
+    AesCipher::expand_key(AesKey(key), m_round_keys);
+    init(kernel);
+}
+
+AesKeySchedule::AesKeySchedule(const AesRoundKeys& round_keys, AesKeyKernel kernel) :
+    m_round_keys(round_keys) {
+    init(kernel);
+}
+
+AesKeySchedule::AesKeySchedule(const AesRoundKeys& round_keys, const AesRoundKeys& inv_round_keys,
+                               AesKeyKernel kernel) :
+    m_round_keys(round_keys),
+    m_inv_round_keys(inv_round_keys) {
+    m_kernel = (aes_key_kernel_resolve(kernel) == AesKeyKernel::SCALAR) ? AesKeyKernel::SCALAR : AesKeyKernel::AESNI;
+}
+
+void AesKeySchedule::expand_batch(const AesKey* keys, AesKeySchedule* schedules, size_t count,
+                                  AesKeyKernel kernel) {
+    AesRoundKeys expanded[16];
+    for (size_t i = 0; i < count; i += 16) {
+        size_t n = (count - i < 16) ? count - i : 16;
+        aes_expand_keys(keys + i, expanded, n, kernel);
+        for (size_t j = 0; j < n; j++) {
+            schedules[i + j] = AesKeySchedule(expanded[j], kernel);
+        }
+    }
+}
+
+void AesKeySchedule::init(AesKeyKernel kernel) {
+    // The bulk path has no use for 256-bit lanes, so VAES means AES-NI here
+    m_kernel = (aes_key_kernel_resolve(kernel) == AesKeyKernel::SCALAR) ? AesKeyKernel::SCALAR : AesKeyKernel::AESNI;
+
+    // Equivalent inverse cipher: AESDEC applies InvMixColumns before
+    // AddRoundKey, so the middle round keys are stored transformed
+    m_inv_round_keys = m_round_keys;
+    for (int r = 1; r < AES_NUM_ROUNDS; r++) {
+        m_inv_round_keys.round_keys[r] = AesMixColumns::inv_mix_columns(m_round_keys.round_keys[r]);
+    }
+}
+
+#ifdef AES_KEY_BATCH_X86
+__attribute__((target("aes")))
+static void encrypt_blocks_aesni(const AesRoundKeys& round_keys, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    __m128i rk[AES_NUM_ROUNDS + 1];
+    for (int r = 0; r <= AES_NUM_ROUNDS; r++) {
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys.round_keys[r].data.data()));
+    }
+
+    size_t i = 0;
+    for (; i < num_blocks; i += AESNI_INTERLEAVE) {
+        size_t n = (num_blocks - i < AESNI_INTERLEAVE) ? num_blocks - i : AESNI_INTERLEAVE;
+        __m128i s[AESNI_INTERLEAVE];
+        for (size_t b = 0; b < n; b++) {
+            s[b] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (i + b) * AES_BLOCK_SIZE)), rk[0]);
+        }
+        for (int r = 1; r < AES_NUM_ROUNDS; r++) {
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_aesenc_si128(s[b], rk[r]);
+            }
+        }
+        for (size_t b = 0; b < n; b++) {
+            s[b] = _mm_aesenclast_si128(s[b], rk[AES_NUM_ROUNDS]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i + b) * AES_BLOCK_SIZE), s[b]);
+        }
+    }
+}
+
+__attribute__((target("aes")))
+static void decrypt_blocks_aesni(const AesRoundKeys& inv_round_keys, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    __m128i rk[AES_NUM_ROUNDS + 1];
+    for (int r = 0; r <= AES_NUM_ROUNDS; r++) {
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inv_round_keys.round_keys[r].data.data()));
+    }
+
+    size_t i = 0;
+    for (; i < num_blocks; i += AESNI_INTERLEAVE) {
+        size_t n = (num_blocks - i < AESNI_INTERLEAVE) ? num_blocks - i : AESNI_INTERLEAVE;
+        __m128i s[AESNI_INTERLEAVE];
+        for (size_t b = 0; b < n; b++) {
+            s[b] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (i + b) * AES_BLOCK_SIZE)),
+                                 rk[AES_NUM_ROUNDS]);
+        }
+        for (int r = AES_NUM_ROUNDS - 1; r > 0; r--) {
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_aesdec_si128(s[b], rk[r]);
+            }
+        }
+        for (size_t b = 0; b < n; b++) {
+            s[b] = _mm_aesdeclast_si128(s[b], rk[0]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i + b) * AES_BLOCK_SIZE), s[b]);
+        }
+    }
+}
+#endif
+
+#ifdef AES_KEY_BATCH_X86
+// The AES-NI path with a cross-check installed. The call is cut after each
+// sampled block, whose input is copied before its piece runs, since in and
+// out may be the same buffer; pieces are rate blocks long, so the
+// interleaved loop is only broken up at high sampling rates.
+void AesKeySchedule::encrypt_blocks_checked(AesCrossCheck& check, const uint8_t* in, uint8_t* out,
+                                            size_t num_blocks) const {
+    size_t done = 0;
+    for (size_t sample = check.pick(num_blocks); sample < num_blocks; sample = check.next(sample, num_blocks)) {
+        uint8_t sample_in[AES_BLOCK_SIZE];
+        std::memcpy(sample_in, in + sample * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        encrypt_blocks_aesni(m_round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE,
+                             sample + 1 - done);
+        check.submit(AesCheckedEngine::BLOCKS, AesOperation::ENCRYPT, m_round_keys.round_keys[0].data.data(),
+                     sample_in, out + sample * AES_BLOCK_SIZE);
+        done = sample + 1;
+    }
+    encrypt_blocks_aesni(m_round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE, num_blocks - done);
+}
+
+void AesKeySchedule::decrypt_blocks_checked(AesCrossCheck& check, const uint8_t* in, uint8_t* out,
+                                            size_t num_blocks) const {
+    size_t done = 0;
+    for (size_t sample = check.pick(num_blocks); sample < num_blocks; sample = check.next(sample, num_blocks)) {
+        uint8_t sample_in[AES_BLOCK_SIZE];
+        std::memcpy(sample_in, in + sample * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        decrypt_blocks_aesni(m_inv_round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE,
+                             sample + 1 - done);
+        check.submit(AesCheckedEngine::BLOCKS, AesOperation::DECRYPT, m_round_keys.round_keys[0].data.data(),
+                     sample_in, out + sample * AES_BLOCK_SIZE);
+        done = sample + 1;
+    }
+    decrypt_blocks_aesni(m_inv_round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE,
+                         num_blocks - done);
+}
+#endif
+
+void AesKeySchedule::encrypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks) const {
+#ifdef AES_KEY_BATCH_X86
+    if (m_kernel == AesKeyKernel::AESNI) {
+        AesCrossCheck::Ref check;
+        if (check) {
+            encrypt_blocks_checked(*check, in, out, num_blocks);
+            return;
+        }
+        encrypt_blocks_aesni(m_round_keys, in, out, num_blocks);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < num_blocks; i++) {
+        AesBlock block = AesCipher::encrypt_block(AesBlock(in + i * AES_BLOCK_SIZE), m_round_keys);
+        std::memcpy(out + i * AES_BLOCK_SIZE, block.data.data(), AES_BLOCK_SIZE);
+    }
+}
+
+void AesKeySchedule::decrypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks) const {
+#ifdef AES_KEY_BATCH_X86
+    if (m_kernel == AesKeyKernel::AESNI) {
+        AesCrossCheck::Ref check;
+        if (check) {
+            decrypt_blocks_checked(*check, in, out, num_blocks);
+            return;
+        }
+        decrypt_blocks_aesni(m_inv_round_keys, in, out, num_blocks);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < num_blocks; i++) {
+        AesBlock block = AesCipher::decrypt_block(AesBlock(in + i * AES_BLOCK_SIZE), m_round_keys);
+        std::memcpy(out + i * AES_BLOCK_SIZE, block.data.data(), AES_BLOCK_SIZE);
+    }
+}
+
+void AesKeySchedule::cbc_encrypt(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* iv) const {
+    // Each block needs the previous ciphertext, so this is one block at a time
+    uint8_t block[AES_BLOCK_SIZE];
+    for (size_t i = 0; i < num_blocks; i++) {
+        for (int b = 0; b < AES_BLOCK_SIZE; b++) {
+            block[b] = in[i * AES_BLOCK_SIZE + b] ^ iv[b];
+        }
+        encrypt_blocks(block, iv, 1);
+        std::memcpy(out + i * AES_BLOCK_SIZE, iv, AES_BLOCK_SIZE);
+    }
+}
+
+void AesKeySchedule::cbc_decrypt(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* iv) const {
+    // Decryption is parallel; the ciphertext is kept a group at a time so
+    // in and out may overlap
+    uint8_t cipher[AESNI_INTERLEAVE * AES_BLOCK_SIZE];
+    for (size_t i = 0; i < num_blocks; i += AESNI_INTERLEAVE) {
+        size_t n = (num_blocks - i < AESNI_INTERLEAVE) ? num_blocks - i : AESNI_INTERLEAVE;
+        std::memcpy(cipher, in + i * AES_BLOCK_SIZE, n * AES_BLOCK_SIZE);
+        decrypt_blocks(cipher, out + i * AES_BLOCK_SIZE, n);
+        for (size_t b = 0; b < n; b++) {
+            const uint8_t* chain = (b == 0) ? iv : cipher + (b - 1) * AES_BLOCK_SIZE;
+            for (int j = 0; j < AES_BLOCK_SIZE; j++) {
+                out[(i + b) * AES_BLOCK_SIZE + j] ^= chain[j];
+            }
+        }
+        std::memcpy(iv, cipher + (n - 1) * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    }
+}
+
+void AesKeySchedule::ctr_crypt(const uint8_t* in, uint8_t* out, size_t length, uint8_t* counter) const {
+    uint8_t keystream[AESNI_INTERLEAVE * AES_BLOCK_SIZE];
+    for (size_t offset = 0; offset < length; offset += sizeof(keystream)) {
+        size_t bytes = (length - offset < sizeof(keystream)) ? length - offset : sizeof(keystream);
+        size_t n = (bytes + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+        for (size_t b = 0; b < n; b++) {
+            std::memcpy(keystream + b * AES_BLOCK_SIZE, counter, AES_BLOCK_SIZE);
+            for (int j = AES_BLOCK_SIZE - 1; j >= 0; j--) {
+                if (++counter[j] != 0) {
+                    break;
+                }
+            }
+        }
+        encrypt_blocks(keystream, keystream, n);
+        for (size_t j = 0; j < bytes; j++) {
+            out[offset + j] = in[offset + j] ^ keystream[j];
+        }
+    }
+}
+
+// C interface
+
+extern "C" aes_key_schedule* aes_key_schedule_create(const uint8_t* key) {
+    if (!key) {
+        return nullptr;
+    }
+    return new (std::nothrow) aes_key_schedule{AesKeySchedule(key)};
+}
+
+extern "C" int aes_key_schedule_create_batch(const uint8_t* keys, size_t count, aes_key_schedule** schedules) {
+    if ((!keys || !schedules) && count > 0) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    // Expand in groups of 16 so the batch kernels see full lanes
+    AesKey group_keys[16];
+    AesRoundKeys expanded[16];
+    for (size_t i = 0; i < count; i += 16) {
+        size_t n = (count - i < 16) ? count - i : 16;
+        for (size_t j = 0; j < n; j++) {
+            group_keys[j] = AesKey(keys + (i + j) * AES_KEY_SIZE);
+        }
+        aes_expand_keys(group_keys, expanded, n);
+
+        for (size_t j = 0; j < n; j++) {
+            schedules[i + j] = new (std::nothrow) aes_key_schedule{AesKeySchedule(expanded[j])};
+            if (!schedules[i + j]) {
+                for (size_t k = 0; k < i + j; k++) {
+                    delete schedules[k];
+                    schedules[k] = nullptr;
+                }
+                return AES_CIPHER_ENOMEM;
+            }
+        }
+    }
+    return AES_CIPHER_OK;
+}
+
+extern "C" void aes_key_schedule_destroy(aes_key_schedule* schedule) {
+    delete schedule;
+}
+
+extern "C" int aes_encrypt_blocks(const aes_key_schedule* schedule, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    if (!schedule || ((!in || !out) && num_blocks > 0)) {
+        return AES_CIPHER_EINVAL;
+    }
+    schedule->schedule.encrypt_blocks(in, out, num_blocks);
+    return AES_CIPHER_OK;
+}
+
+extern "C" int aes_decrypt_blocks(const aes_key_schedule* schedule, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    if (!schedule || ((!in || !out) && num_blocks > 0)) {
+        return AES_CIPHER_EINVAL;
+    }
+    schedule->schedule.decrypt_blocks(in, out, num_blocks);
+    return AES_CIPHER_OK;
+}
+
+extern "C" const char* aes_key_schedule_kernel(const aes_key_schedule* schedule) {
+    return schedule ? aes_key_kernel_name(schedule->schedule.kernel()) : "";
+}
@@ -0,0 +1,28 @@
+#ifndef AES_CIPHER_HANDLES_H
+#define AES_CIPHER_HANDLES_H
+
+#include "../include/aes_cipher.h"
+#include "../include/aes_xts.h"
+#include "../include/aes_key_store.h"
+#include "../include/aes_ctr_drbg.h"
+
+// Definitions of the opaque C handles, shared by the library's translation
+// units. Not installed: callers only see the typedefs in aes_cipher_c.h.
+
+struct aes_key_schedule {
+    AesKeySchedule schedule;
+};
+
+struct aes_key_store {
+    AesKeyStore store;
+};
+
+struct aes_ctr_drbg {
+    AesCtrDrbg drbg;
+};
+
+struct aes_xts_key {
+    AesXts xts;
+};
+
+#endif // AES_CIPHER_HANDLES_H
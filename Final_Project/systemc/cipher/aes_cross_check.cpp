@@ -0,0 +1,238 @@
+#include "../include/aes_cross_check.h"
+#include "../include/aes_cipher.h"
+#include "../include/aes_hex.h"
+#include "aes_file_util.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Blocks this thread has left before its next sample. A new thread starts
+// somewhere inside the first interval, so threads spawned per call (as the
+// XTS sector split does) are not all sampled on their first block.
+static thread_local uint64_t t_until_sample = UINT64_MAX;
+
+// Engine calls holding a checker, in two slots by the parity of the epoch.
+// Quiescing moves new callers to the other slot and waits for the old one
+// to empty, twice, so every caller that could still see a checker that is
+// no longer installed has finished; callers keep arriving in the slot that
+// is not being waited for, so neither wait can be starved.
+static std::atomic<uint64_t> s_epoch{0};
+static std::atomic<size_t> s_readers[2];
+static std::mutex s_quiesce_mutex;
+
+// Longest a sample waits for the background thread when the queue is not
+// filling up
+constexpr int AES_CROSS_CHECK_INTERVAL_MS = 10;
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+AesCrossCheck::AesCrossCheck(uint64_t rate, const std::string& repro_path, size_t queue_entries) :
+    m_rate(rate == 0 ? 1 : rate),
+    m_repro(!repro_path.empty()),
+    m_repro_fd(repro_path.empty() ? -1 :
+               ::open(repro_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)),
+    m_queue(round_up_pow2(queue_entries < 2 ? 2 : queue_entries)),
+    m_wake_threshold(round_up_pow2(queue_entries < 2 ? 2 : queue_entries) / 2),
+    m_thread(&AesCrossCheck::run, this) {
+}
+
+AesCrossCheck::~AesCrossCheck() {
+    uninstall();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping.store(true);
+    }
+    m_wakeup.notify_all();
+    m_thread.join();
+    if (m_repro_fd >= 0) {
+        ::close(m_repro_fd);
+    }
+}
+
+void AesCrossCheck::install() {
+    s_installed.store(this, std::memory_order_release);
+}
+
+// Also waits when this checker was already replaced by another, since
+// calls that picked it up before that may still be running
+void AesCrossCheck::uninstall() {
+    AesCrossCheck* self = this;
+    s_installed.compare_exchange_strong(self, nullptr);
+    quiesce();
+}
+
+// Counted in before looking at s_installed again, so either quiesce()
+// sees the count or the caller sees the checker gone
+AesCrossCheck* AesCrossCheck::acquire(unsigned& slot) {
+    slot = static_cast<unsigned>(s_epoch.load() & 1);
+    s_readers[slot].fetch_add(1);
+    AesCrossCheck* check = s_installed.load();
+    if (!check) {
+        s_readers[slot].fetch_sub(1, std::memory_order_release);
+    }
+    return check;
+}
+
+void AesCrossCheck::release(unsigned slot) {
+    s_readers[slot].fetch_sub(1, std::memory_order_release);
+}
+
+void AesCrossCheck::quiesce() {
+    std::lock_guard<std::mutex> lock(s_quiesce_mutex);
+    for (int flip = 0; flip < 2; flip++) {
+        unsigned slot = static_cast<unsigned>(s_epoch.fetch_add(1) & 1);
+        while (s_readers[slot].load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t AesCrossCheck::pick(size_t num_blocks) const {
+    if (t_until_sample >= m_rate) {
+        t_until_sample = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_rate;
+    }
+    if (t_until_sample >= num_blocks) {
+        t_until_sample -= num_blocks;
+        return num_blocks;
+    }
+
+    // The engine samples every rate blocks from here to the end of the
+    // call; the countdown carries on from the last of those
+    size_t index = static_cast<size_t>(t_until_sample);
+    uint64_t rest = num_blocks - 1 - index;
+    t_until_sample = m_rate - 1 - rest % m_rate;
+    return index;
+}
+
+void AesCrossCheck::submit(AesCheckedEngine engine, AesOperation operation, const uint8_t* key, const uint8_t* in,
+                           const uint8_t* out) {
+    Sample sample;
+    sample.engine = engine;
+    sample.operation = operation;
+    std::memcpy(sample.key, key, AES_KEY_SIZE);
+    std::memcpy(sample.in, in, AES_BLOCK_SIZE);
+    std::memcpy(sample.out, out, AES_BLOCK_SIZE);
+
+    size_t queued = m_queued.fetch_add(1);
+    if (!m_queue.try_push(sample)) {
+        // The thread may have emptied the queue meanwhile and be waiting
+        // for this claim to be published, with drain() waiting on it
+        if (m_queued.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_drained.notify_all();
+        }
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_sampled[static_cast<size_t>(engine)].fetch_add(1, std::memory_order_relaxed);
+    if (queued + 1 >= m_wake_threshold && m_sleeping.load()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeup.notify_one();
+    }
+}
+
+void AesCrossCheck::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_draining++;
+    m_wakeup.notify_one();
+    m_drained.wait(lock, [this]() { return m_queued.load() == 0; });
+    m_draining--;
+}
+
+AesCrossCheckStats AesCrossCheck::stats() const {
+    AesCrossCheckStats stats;
+    for (size_t i = 0; i < AES_CHECKED_ENGINES; i++) {
+        stats.sampled[i] = m_sampled[i].load(std::memory_order_relaxed);
+        stats.mismatches[i] = m_mismatches[i].load(std::memory_order_relaxed);
+    }
+    stats.checked = m_checked.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.repro_errors = m_repro_errors.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AesCrossCheck::run() {
+    Sample sample;
+    for (;;) {
+        if (m_queue.try_pop(sample)) {
+            check(sample);
+            if (m_queued.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_drained.notify_all();
+            }
+            continue;
+        }
+        if (m_queued.load() > 0) {
+            // A submitter has claimed a slot but not published it yet
+            std::this_thread::yield();
+            continue;
+        }
+        // Sleep until the queue is half full, someone drains or stops, or
+        // the interval is up, so a trickle of samples costs no wakeups
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.store(true);
+        m_wakeup.wait_for(lock, std::chrono::milliseconds(AES_CROSS_CHECK_INTERVAL_MS), [this]() {
+            return m_queued.load() >= m_wake_threshold || m_draining > 0 || m_stopping.load();
+        });
+        m_sleeping.store(false);
+        if (m_queued.load() == 0 && m_stopping.load()) {
+            return;
+        }
+    }
+}
+
+void AesCrossCheck::check(const Sample& sample) {
+    // Expanded here too, so a bad batch or stored schedule is caught as well
+    AesRoundKeys round_keys;
+    AesCipher::expand_key(AesKey(sample.key), round_keys);
+    AesBlock expected = (sample.operation == AesOperation::ENCRYPT) ?
+                        AesCipher::encrypt_block(AesBlock(sample.in), round_keys) :
+                        AesCipher::decrypt_block(AesBlock(sample.in), round_keys);
+    m_checked.fetch_add(1, std::memory_order_relaxed);
+    if (std::memcmp(expected.data.data(), sample.out, AES_BLOCK_SIZE) != 0) {
+        uint64_t id = m_mismatches[static_cast<size_t>(sample.engine)].fetch_add(1, std::memory_order_relaxed);
+        write_repro(sample, expected, id);
+    }
+}
+
+void AesCrossCheck::write_repro(const Sample& sample, const AesBlock& expected, uint64_t id) {
+    if (m_repro_fd < 0) {
+        if (m_repro) {
+            m_repro_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    auto hex = [](const uint8_t* bytes, size_t length) {
+        std::string text(2 * length, '0');
+        aes_hex_encode(bytes, length, &text[0]);
+        return text;
+    };
+
+    // One self-contained group per record, so the file stays importable
+    // however many records are appended
+    bool encrypt = (sample.operation == AesOperation::ENCRYPT);
+    std::string record = "# Cross-check mismatch in " + std::string(aes_checked_engine_name(sample.engine)) +
+                         ": engine output " + hex(sample.out, AES_BLOCK_SIZE) + "\n";
+    record += encrypt ? "[ENCRYPT]\n\n" : "[DECRYPT]\n\n";
+    record += "MODE = ECB\n\n";
+    record += "COUNT = " + std::to_string(id) + "\n";
+    record += "KEY = " + hex(sample.key, AES_KEY_SIZE) + "\n";
+    if (encrypt) {
+        record += "PLAINTEXT = " + hex(sample.in, AES_BLOCK_SIZE) + "\n";
+        record += "CIPHERTEXT = " + hex(expected.data.data(), AES_BLOCK_SIZE) + "\n\n";
+    } else {
+        record += "CIPHERTEXT = " + hex(sample.in, AES_BLOCK_SIZE) + "\n";
+        record += "PLAINTEXT = " + hex(expected.data.data(), AES_BLOCK_SIZE) + "\n\n";
+    }
+    if (!aes_file_write_all(m_repro_fd, record.data(), record.size())) {
+        m_repro_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,388 @@
+#include "../include/aes_ctr_drbg.h"
+#include "../include/aes_cipher_c.h"
+#include "aes_cipher_handles.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <sys/random.h>
+
+// Bytes a thread's aes_random_bytes buffer is refilled with per generate
+constexpr size_t AES_DRBG_POOL_SIZE = 4096;
+
+// Clear secrets in a way the compiler cannot drop as a dead store
+static void wipe(void* p, size_t length) {
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    for (size_t i = 0; i < length; i++) {
+        v[i] = 0;
+    }
+}
+
+static uint64_t load_be64(const uint8_t* p) {
+    uint64_t x;
+    std::memcpy(&x, p, 8);
+    return __builtin_bswap64(x);
+}
+
+static void store_be64(uint8_t* p, uint64_t x) {
+    x = __builtin_bswap64(x);
+    std::memcpy(p, &x, 8);
+}
+
+static void put_be32(uint8_t* p, uint32_t x) {
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+// Block_Cipher_df (10.3.2) for AES-128, always returning seedlen bytes.
+// BCC is CBC-MAC, so each pass is one cbc_encrypt over IV || S.
+static bool block_cipher_df(const uint8_t* input, size_t input_len, uint8_t* seed) {
+    if (input_len > 0xffffffffu / 8) {
+        return false;
+    }
+
+    // S = L || N || input || 0x80, zero-padded to whole blocks, after a
+    // block-sized slot for the counter IV
+    size_t s_len = (8 + input_len + 1 + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> scratch;
+    try {
+        buffer.assign(AES_BLOCK_SIZE + s_len, 0);
+        scratch.resize(buffer.size());
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    uint8_t* s = buffer.data() + AES_BLOCK_SIZE;
+    put_be32(s, static_cast<uint32_t>(input_len));
+    put_be32(s + 4, AES_DRBG_SEED_LEN);
+    if (input_len > 0) {
+        std::memcpy(s + 8, input, input_len);
+    }
+    s[8 + input_len] = 0x80;
+
+    uint8_t df_key[AES_KEY_SIZE];
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        df_key[i] = static_cast<uint8_t>(i);
+    }
+    AesKeySchedule bcc_key{AesKey(df_key)};
+
+    uint8_t temp[AES_DRBG_SEED_LEN];
+    for (uint32_t i = 0; i < AES_DRBG_SEED_LEN / AES_BLOCK_SIZE; i++) {
+        put_be32(buffer.data(), i);
+        uint8_t chain[AES_BLOCK_SIZE] = {0};
+        bcc_key.cbc_encrypt(buffer.data(), scratch.data(), buffer.size() / AES_BLOCK_SIZE, chain);
+        std::memcpy(temp + i * AES_BLOCK_SIZE, chain, AES_BLOCK_SIZE);
+    }
+
+    // Encrypt X under the derived key until seedlen bytes are out
+    AesKeySchedule out_key{AesKey(temp)};
+    uint8_t* x = temp + AES_KEY_SIZE;
+    for (size_t offset = 0; offset < AES_DRBG_SEED_LEN; offset += AES_BLOCK_SIZE) {
+        out_key.encrypt_blocks(x, seed + offset, 1);
+        x = seed + offset;
+    }
+
+    wipe(buffer.data(), buffer.size());
+    wipe(scratch.data(), scratch.size());
+    wipe(temp, sizeof(temp));
+    return true;
+}
+
+AesCtrDrbg::AesCtrDrbg(bool use_df) :
+    m_use_df(use_df),
+    m_instantiated(false),
+    m_reseed_counter(0),
+    m_reseed_interval(AES_DRBG_RESEED_INTERVAL) {
+    std::memset(m_v, 0, sizeof(m_v));
+}
+
+AesCtrDrbg::~AesCtrDrbg() {
+    uninstantiate();
+}
+
+void AesCtrDrbg::uninstantiate() {
+    m_key = AesKeySchedule();
+    wipe(m_v, sizeof(m_v));
+    m_reseed_counter = 0;
+    m_instantiated = false;
+}
+
+// V+1, V+2, ... encrypted straight into out in one bulk call; V is left at
+// the last counter used, as the standard's loop leaves it
+void AesCtrDrbg::keystream(uint8_t* out, size_t length) {
+    // V as two 64-bit halves, so the counters are written a word at a time
+    uint64_t hi = load_be64(m_v);
+    uint64_t lo = load_be64(m_v + 8);
+    size_t whole = length / AES_BLOCK_SIZE;
+    for (size_t b = 0; b < whole; b++) {
+        hi += (++lo == 0);
+        store_be64(out + b * AES_BLOCK_SIZE, hi);
+        store_be64(out + b * AES_BLOCK_SIZE + 8, lo);
+    }
+    m_key.encrypt_blocks(out, out, whole);
+
+    size_t tail = length - whole * AES_BLOCK_SIZE;
+    if (tail > 0) {
+        uint8_t block[AES_BLOCK_SIZE];
+        hi += (++lo == 0);
+        store_be64(block, hi);
+        store_be64(block + 8, lo);
+        m_key.encrypt_blocks(block, block, 1);
+        std::memcpy(out + whole * AES_BLOCK_SIZE, block, tail);
+        wipe(block, sizeof(block));
+    }
+    store_be64(m_v, hi);
+    store_be64(m_v + 8, lo);
+}
+
+// CTR_DRBG_Update (10.2.1.2): seedlen bytes of keystream, XORed with the
+// provided data, become the new key and V
+void AesCtrDrbg::update(const uint8_t* provided) {
+    uint8_t temp[AES_DRBG_SEED_LEN];
+    keystream(temp, sizeof(temp));
+    for (size_t i = 0; i < sizeof(temp); i++) {
+        temp[i] ^= provided[i];
+    }
+    // A new key per update. The DRBG only encrypts, but the schedule still
+    // gets valid inverse round keys, so it is never a trap for decryption.
+    m_key = AesKeySchedule(temp);
+    std::memcpy(m_v, temp + AES_KEY_SIZE, AES_BLOCK_SIZE);
+    wipe(temp, sizeof(temp));
+}
+
+// Concatenate up to three inputs into seedlen bytes: through the derivation
+// function, or (without it) the first input XORed with the zero-padded second
+bool AesCtrDrbg::seed_material(const uint8_t* a, size_t a_len, const uint8_t* b, size_t b_len,
+                               const uint8_t* c, size_t c_len, uint8_t* seed) const {
+    if (!m_use_df) {
+        if (a_len != AES_DRBG_SEED_LEN || b_len > AES_DRBG_SEED_LEN || c_len != 0) {
+            return false;
+        }
+        std::memcpy(seed, a, AES_DRBG_SEED_LEN);
+        for (size_t i = 0; i < b_len; i++) {
+            seed[i] ^= b[i];
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> input;
+    try {
+        input.reserve(a_len + b_len + c_len);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    input.insert(input.end(), a, a + a_len);
+    input.insert(input.end(), b, b + b_len);
+    input.insert(input.end(), c, c + c_len);
+    bool ok = block_cipher_df(input.data(), input.size(), seed);
+    wipe(input.data(), input.size());
+    return ok;
+}
+
+int AesCtrDrbg::instantiate(const uint8_t* entropy, size_t entropy_len, const uint8_t* nonce, size_t nonce_len,
+                            const uint8_t* personalization, size_t personalization_len) {
+    uninstantiate();
+    if (!entropy || (nonce_len > 0 && !nonce) || (personalization_len > 0 && !personalization)) {
+        return AES_CIPHER_EINVAL;
+    }
+    if (m_use_df && (entropy_len < AES_KEY_SIZE || nonce_len < AES_KEY_SIZE / 2)) {
+        return AES_CIPHER_EINVAL;
+    }
+    if (!m_use_df && nonce_len != 0) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    // Without the derivation function the nonce is absent, so the
+    // personalization string takes the second slot
+    uint8_t seed[AES_DRBG_SEED_LEN];
+    bool ok = m_use_df ? seed_material(entropy, entropy_len, nonce, nonce_len, personalization,
+                                       personalization_len, seed)
+                       : seed_material(entropy, entropy_len, personalization, personalization_len,
+                                       nullptr, 0, seed);
+    if (!ok) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    // Key = 0, V = 0, then one update
+    m_key = AesKeySchedule();
+    std::memset(m_v, 0, sizeof(m_v));
+    update(seed);
+    wipe(seed, sizeof(seed));
+    m_reseed_counter = 1;
+    m_instantiated = true;
+    return AES_CIPHER_OK;
+}
+
+int AesCtrDrbg::reseed(const uint8_t* entropy, size_t entropy_len, const uint8_t* additional, size_t additional_len) {
+    if (!m_instantiated || !entropy || (additional_len > 0 && !additional)) {
+        return AES_CIPHER_EINVAL;
+    }
+    if (m_use_df && entropy_len < AES_KEY_SIZE) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    uint8_t seed[AES_DRBG_SEED_LEN];
+    if (!seed_material(entropy, entropy_len, additional, additional_len, nullptr, 0, seed)) {
+        return AES_CIPHER_EINVAL;
+    }
+    update(seed);
+    wipe(seed, sizeof(seed));
+    m_reseed_counter = 1;
+    return AES_CIPHER_OK;
+}
+
+int AesCtrDrbg::generate(uint8_t* out, size_t length, const uint8_t* additional, size_t additional_len) {
+    if (!m_instantiated || (length > 0 && !out) || length > AES_DRBG_MAX_REQUEST ||
+        (additional_len > 0 && !additional)) {
+        return AES_CIPHER_EINVAL;
+    }
+    if (m_reseed_counter > m_reseed_interval) {
+        return AES_CIPHER_ERESEED;
+    }
+
+    // The processed additional input is used twice: before and after the
+    // output is produced
+    uint8_t extra[AES_DRBG_SEED_LEN] = {0};
+    if (additional_len > 0) {
+        if (m_use_df) {
+            if (!block_cipher_df(additional, additional_len, extra)) {
+                return AES_CIPHER_EINVAL;
+            }
+        } else {
+            if (additional_len > AES_DRBG_SEED_LEN) {
+                return AES_CIPHER_EINVAL;
+            }
+            std::memcpy(extra, additional, additional_len);
+        }
+        update(extra);
+    }
+
+    keystream(out, length);
+    update(extra);
+    wipe(extra, sizeof(extra));
+    m_reseed_counter++;
+    return AES_CIPHER_OK;
+}
+
+// Per-thread generator behind aes_random_bytes
+
+namespace {
+
+struct AesRandomPool {
+    AesCtrDrbg drbg;
+    uint8_t buffer[AES_DRBG_POOL_SIZE];
+    size_t available = 0;     // Unused bytes at the end of buffer
+
+    ~AesRandomPool() { wipe(buffer, sizeof(buffer)); }
+
+    static bool system_entropy(uint8_t* out, size_t length) {
+        while (length > 0) {
+            ssize_t n = getrandom(out, length, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            out += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Instantiate on first use; reseed when the interval runs out
+    int generate(uint8_t* out, size_t length) {
+        if (!drbg.instantiated() || drbg.reseed_counter() > AES_DRBG_RESEED_INTERVAL) {
+            uint8_t seed[AES_DRBG_SEED_LEN + AES_KEY_SIZE / 2];
+            if (!system_entropy(seed, sizeof(seed))) {
+                return AES_CIPHER_EIO;
+            }
+            int status = drbg.instantiated()
+                ? drbg.reseed(seed, AES_DRBG_SEED_LEN)
+                : drbg.instantiate(seed, AES_DRBG_SEED_LEN, seed + AES_DRBG_SEED_LEN, AES_KEY_SIZE / 2,
+                                   nullptr, 0);
+            wipe(seed, sizeof(seed));
+            if (status != AES_CIPHER_OK) {
+                return status;
+            }
+        }
+        return drbg.generate(out, length);
+    }
+};
+
+thread_local AesRandomPool random_pool;
+
+}
+
+extern "C" int aes_random_bytes(uint8_t* out, size_t length) {
+    if (length > 0 && !out) {
+        return AES_CIPHER_EINVAL;
+    }
+    AesRandomPool& pool = random_pool;
+
+    // Large requests bypass the buffer, a maximum-size generate at a time
+    if (length > sizeof(pool.buffer)) {
+        for (size_t offset = 0; offset < length; offset += AES_DRBG_MAX_REQUEST) {
+            size_t n = std::min(AES_DRBG_MAX_REQUEST, length - offset);
+            int status = pool.generate(out + offset, n);
+            if (status != AES_CIPHER_OK) {
+                return status;
+            }
+        }
+        return AES_CIPHER_OK;
+    }
+
+    while (length > 0) {
+        if (pool.available == 0) {
+            int status = pool.generate(pool.buffer, sizeof(pool.buffer));
+            if (status != AES_CIPHER_OK) {
+                return status;
+            }
+            pool.available = sizeof(pool.buffer);
+        }
+        size_t n = std::min(length, pool.available);
+        uint8_t* from = pool.buffer + sizeof(pool.buffer) - pool.available;
+        std::memcpy(out, from, n);
+        wipe(from, n);
+        pool.available -= n;
+        out += n;
+        length -= n;
+    }
+    return AES_CIPHER_OK;
+}
+
+// C interface
+
+extern "C" aes_ctr_drbg* aes_ctr_drbg_create(const uint8_t* entropy, size_t entropy_len, const uint8_t* nonce,
+                                             size_t nonce_len, const uint8_t* personalization,
+                                             size_t personalization_len, int use_df, int* status) {
+    aes_ctr_drbg* drbg = new (std::nothrow) aes_ctr_drbg{AesCtrDrbg(use_df != 0)};
+    int result = drbg ? drbg->drbg.instantiate(entropy, entropy_len, nonce, nonce_len, personalization,
+                                               personalization_len)
+                      : AES_CIPHER_ENOMEM;
+    if (result != AES_CIPHER_OK) {
+        delete drbg;
+        drbg = nullptr;
+    }
+    if (status) {
+        *status = result;
+    }
+    return drbg;
+}
+
+extern "C" void aes_ctr_drbg_destroy(aes_ctr_drbg* drbg) {
+    delete drbg;
+}
+
+extern "C" int aes_ctr_drbg_reseed(aes_ctr_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+                                   const uint8_t* additional, size_t additional_len) {
+    return drbg ? drbg->drbg.reseed(entropy, entropy_len, additional, additional_len) : AES_CIPHER_EINVAL;
+}
+
+extern "C" int aes_ctr_drbg_generate(aes_ctr_drbg* drbg, uint8_t* out, size_t length, const uint8_t* additional,
+                                     size_t additional_len) {
+    return drbg ? drbg->drbg.generate(out, length, additional, additional_len) : AES_CIPHER_EINVAL;
+}
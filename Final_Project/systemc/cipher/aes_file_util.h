@@ -0,0 +1,59 @@
+#ifndef AES_FILE_UTIL_H
+#define AES_FILE_UTIL_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+
+// Helpers shared by the library's on-disk formats (key store, vector
+// corpus, chunk index). Not installed.
+
+constexpr uint64_t AES_FILE_CHECKSUM_INIT = 0xcbf29ce484222325ull;
+
+// FNV-1a over 64-bit words (every section is a multiple of 8 bytes)
+inline uint64_t aes_file_checksum(uint64_t hash, const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline bool aes_file_write_all(int fd, const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+        ssize_t n = ::write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// False on error or end of file before length bytes
+inline bool aes_file_read_all(int fd, void* data, size_t length) {
+    uint8_t* p = static_cast<uint8_t*>(data);
+    while (length > 0) {
+        ssize_t n = ::read(fd, p, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#endif // AES_FILE_UTIL_H
@@ -0,0 +1,431 @@
+#include "../include/aes_incremental.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_ctr_drbg.h"
+#include "aes_file_util.h"
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef AES_KEY_BATCH_X86
+#include <immintrin.h>
+#endif
+
+static const char AES_CHUNK_INDEX_MAGIC[8] = {'A', 'E', 'S', 'C', 'H', 'I', 'D', 'X'};
+static const uint32_t AES_CHUNK_INDEX_BYTE_ORDER = 0x01020304;
+
+// Plaintext block that the digest key is the encryption of
+static const uint8_t AES_CHUNK_DIGEST_LABEL[AES_BLOCK_SIZE] = {'A', 'E', 'S', ' ', 'c', 'h', 'u', 'n',
+                                                               'k', ' ', 'd', 'i', 'g', 'e', 's', 't'};
+
+// x^128 = x^7 + x^2 + x + 1 in the digest's field
+constexpr uint64_t AES_CHUNK_DIGEST_POLY = 0x87;
+
+static bool valid_mode(AesCipherMode mode, size_t chunk_size) {
+    return (mode == AesCipherMode::CTR || mode == AesCipherMode::XTS) && chunk_size > 0 &&
+           chunk_size % AES_BLOCK_SIZE == 0 && chunk_size <= (1u << 31);
+}
+
+// Chunks a file of length bytes is cut into; see the XTS tail rule in the header
+static size_t chunk_count(AesCipherMode mode, size_t chunk_size, uint64_t length) {
+    size_t count = static_cast<size_t>((length + chunk_size - 1) / chunk_size);
+    size_t tail = static_cast<size_t>(length % chunk_size);
+    if (mode == AesCipherMode::XTS && count > 1 && tail > 0 && tail < AES_BLOCK_SIZE) {
+        count--;
+    }
+    return count;
+}
+
+static size_t chunk_length(size_t chunk_size, uint64_t length, size_t count, size_t chunk) {
+    return chunk + 1 < count ? chunk_size : static_cast<size_t>(length - chunk * chunk_size);
+}
+
+static void store_be(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        out[i] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+// Digest field elements are {low, high} 64-bit words, bit i the
+// coefficient of x^i. Shift-and-add, one bit of b per step.
+static void gf128_mul(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+    uint64_t lo = 0, hi = 0;
+    for (int i = 127; i >= 0; i--) {
+        uint64_t carry = hi >> 63;
+        hi = (hi << 1) | (lo >> 63);
+        lo = (lo << 1) ^ (carry * AES_CHUNK_DIGEST_POLY);
+        if ((b[i / 64] >> (i % 64)) & 1) {
+            lo ^= a[0];
+            hi ^= a[1];
+        }
+    }
+    out[0] = lo;
+    out[1] = hi;
+}
+
+static void digest_blocks_scalar(const uint64_t* h, const uint8_t* in, size_t num_blocks, uint64_t* acc) {
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint64_t m[2];
+        std::memcpy(m, in + i * AES_BLOCK_SIZE, sizeof(m));
+        acc[0] ^= m[0];
+        acc[1] ^= m[1];
+        gf128_mul(acc, h, acc);
+    }
+}
+
+#ifdef AES_KEY_BATCH_X86
+// The 256-bit products of four blocks are summed, then reduced once: the
+// high half times x^7 + x^2 + x + 1 is folded into the low half, and the
+// few bits that pushes past x^127 are folded again
+__attribute__((target("pclmul,sse2")))
+static inline __m128i gf128_reduce_clmul(__m128i lo, __m128i hi) {
+    const __m128i poly = _mm_set_epi64x(0, AES_CHUNK_DIGEST_POLY);
+    __m128i t0 = _mm_clmulepi64_si128(hi, poly, 0x00);
+    __m128i t1 = _mm_clmulepi64_si128(hi, poly, 0x01);
+    lo = _mm_xor_si128(lo, _mm_xor_si128(t0, _mm_slli_si128(t1, 8)));
+    return _mm_xor_si128(lo, _mm_clmulepi64_si128(_mm_srli_si128(t1, 8), poly, 0x00));
+}
+
+__attribute__((target("pclmul,sse2")))
+static inline void gf128_mul_add_clmul(__m128i a, __m128i b, __m128i& lo, __m128i& hi) {
+    __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01), _mm_clmulepi64_si128(a, b, 0x10));
+    lo = _mm_xor_si128(lo, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00), _mm_slli_si128(mid, 8)));
+    hi = _mm_xor_si128(hi, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11), _mm_srli_si128(mid, 8)));
+}
+
+// acc = (acc + m0) H^4 + m1 H^3 + m2 H^2 + m3 H, which is four steps of
+// the scalar loop with the multiplies independent of each other
+__attribute__((target("pclmul,sse2")))
+static void digest_blocks_clmul(const uint64_t (*powers)[2], const uint8_t* in, size_t num_blocks, uint64_t* acc) {
+    __m128i h[4];
+    for (int j = 0; j < 4; j++) {
+        h[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(powers[j]));
+    }
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+    size_t i = 0;
+    for (; i + 4 <= num_blocks; i += 4) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (int j = 0; j < 4; j++) {
+            __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (i + j) * AES_BLOCK_SIZE));
+            if (j == 0) {
+                m = _mm_xor_si128(m, x);
+            }
+            gf128_mul_add_clmul(m, h[3 - j], lo, hi);
+        }
+        x = gf128_reduce_clmul(lo, hi);
+    }
+    for (; i < num_blocks; i++) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * AES_BLOCK_SIZE));
+        gf128_mul_add_clmul(_mm_xor_si128(m, x), h[0], lo, hi);
+        x = gf128_reduce_clmul(lo, hi);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), x);
+}
+#endif
+
+AesChunkIndex::AesChunkIndex() :
+    m_mode(AesCipherMode::CTR),
+    m_chunk_size(AES_CHUNK_DEFAULT_SIZE),
+    m_plaintext_size(0),
+    m_nonce(0),
+    m_generation(0) {}
+
+int AesChunkIndex::save(const std::string& path) const {
+    if (path.empty()) {
+        return AES_CIPHER_EIO;
+    }
+
+    AesChunkIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, AES_CHUNK_INDEX_MAGIC, sizeof(header.magic));
+    header.version = AES_CHUNK_INDEX_VERSION;
+    header.byte_order = AES_CHUNK_INDEX_BYTE_ORDER;
+    header.header_size = sizeof(AesChunkIndexHeader);
+    header.entry_size = sizeof(AesChunkEntry);
+    header.mode = static_cast<uint32_t>(m_mode);
+    header.chunk_size = static_cast<uint32_t>(m_chunk_size);
+    header.generation = m_generation;
+    header.count = m_entries.size();
+    header.plaintext_size = m_plaintext_size;
+    header.nonce = m_nonce;
+    size_t entries_size = m_entries.size() * sizeof(AesChunkEntry);
+    header.checksum = aes_file_checksum(AES_FILE_CHECKSUM_INIT, m_entries.data(), entries_size);
+
+    // Written under a temporary name, then renamed over the old index
+    std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    bool ok = aes_file_write_all(fd, &header, sizeof(header)) &&
+              aes_file_write_all(fd, m_entries.data(), entries_size);
+    ok = ok && fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return AES_CIPHER_EIO;
+    }
+    return AES_CIPHER_OK;
+}
+
+int AesChunkIndex::load(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    struct stat st;
+    AesChunkIndexHeader header;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(header)) ||
+        !aes_file_read_all(fd, &header, sizeof(header))) {
+        ::close(fd);
+        return AES_CIPHER_EIO;
+    }
+
+    uint64_t length = static_cast<uint64_t>(st.st_size);
+    AesCipherMode mode = static_cast<AesCipherMode>(header.mode);
+    int status = AES_CIPHER_OK;
+    if (std::memcmp(header.magic, AES_CHUNK_INDEX_MAGIC, sizeof(header.magic)) != 0) {
+        status = AES_CIPHER_EIO;
+    } else if (header.version != AES_CHUNK_INDEX_VERSION) {
+        status = AES_CIPHER_EVERSION;
+    } else if (header.byte_order != AES_CHUNK_INDEX_BYTE_ORDER ||
+               header.header_size != sizeof(AesChunkIndexHeader) ||
+               header.entry_size != sizeof(AesChunkEntry) ||
+               !valid_mode(mode, header.chunk_size) ||
+               header.count > length / sizeof(AesChunkEntry) ||
+               sizeof(header) + header.count * sizeof(AesChunkEntry) != length ||
+               header.count != chunk_count(mode, header.chunk_size, header.plaintext_size)) {
+        status = AES_CIPHER_EIO;
+    }
+
+    std::vector<AesChunkEntry> entries;
+    if (status == AES_CIPHER_OK) {
+        try {
+            entries.resize(header.count);
+        } catch (const std::bad_alloc&) {
+            status = AES_CIPHER_ENOMEM;
+        }
+    }
+    size_t entries_size = entries.size() * sizeof(AesChunkEntry);
+    if (status == AES_CIPHER_OK &&
+        (!aes_file_read_all(fd, entries.data(), entries_size) ||
+         aes_file_checksum(AES_FILE_CHECKSUM_INIT, entries.data(), entries_size) != header.checksum)) {
+        status = AES_CIPHER_EIO;
+    }
+    ::close(fd);
+
+    // Every chunk must have the length the layout gives it
+    for (size_t i = 0; status == AES_CIPHER_OK && i < entries.size(); i++) {
+        if (entries[i].length != chunk_length(header.chunk_size, header.plaintext_size, entries.size(), i)) {
+            status = AES_CIPHER_EIO;
+        }
+    }
+    if (status != AES_CIPHER_OK) {
+        return status;
+    }
+
+    m_mode = mode;
+    m_chunk_size = header.chunk_size;
+    m_plaintext_size = header.plaintext_size;
+    m_nonce = header.nonce;
+    m_generation = header.generation;
+    m_entries.swap(entries);
+    return AES_CIPHER_OK;
+}
+
+AesIncrementalCipher::AesIncrementalCipher(AesCipherMode mode, const AesKey& data_key, const AesKey& tweak_key,
+                                           size_t chunk_size, AesKeyKernel kernel) :
+    m_mode(mode),
+    m_chunk_size(chunk_size),
+    m_data(data_key, kernel),
+    m_xts(data_key, tweak_key, kernel) {
+
+    uint8_t digest_key[AES_KEY_SIZE];
+    m_data.encrypt_blocks(AES_CHUNK_DIGEST_LABEL, digest_key, 1);
+    m_digest = AesKeySchedule(digest_key, kernel);
+    std::memset(digest_key, 0, sizeof(digest_key));
+
+    // H is the encryption of the zero block, as in GCM
+    uint8_t zero[AES_BLOCK_SIZE] = {0};
+    uint8_t h[AES_BLOCK_SIZE];
+    m_digest.encrypt_blocks(zero, h, 1);
+    std::memcpy(m_hash_powers[0], h, sizeof(h));
+    for (int j = 1; j < 4; j++) {
+        gf128_mul(m_hash_powers[j - 1], m_hash_powers[0], m_hash_powers[j]);
+    }
+    std::memset(h, 0, sizeof(h));
+
+#ifdef AES_KEY_BATCH_X86
+    m_clmul = aes_key_kernel_resolve(kernel) != AesKeyKernel::SCALAR && __builtin_cpu_supports("pclmul");
+#else
+    m_clmul = false;
+#endif
+}
+
+bool AesIncrementalCipher::valid_length(size_t length) const {
+    if (m_mode == AesCipherMode::XTS) {
+        return length == 0 || length >= AES_BLOCK_SIZE;
+    }
+    return length <= AES_INCREMENTAL_CTR_MAX_LENGTH;
+}
+
+size_t AesIncrementalCipher::chunk_count(size_t length) const {
+    return ::chunk_count(m_mode, m_chunk_size, length);
+}
+
+// Whole blocks, then the tail zero-padded, then {length, chunk}; the sum
+// is encrypted so equal digests are all the index gives away
+void AesIncrementalCipher::digest(const uint8_t* in, size_t length, uint64_t chunk, uint8_t* out) const {
+    uint64_t acc[2] = {0, 0};
+    size_t num_blocks = length / AES_BLOCK_SIZE;
+#ifdef AES_KEY_BATCH_X86
+    if (m_clmul) {
+        digest_blocks_clmul(m_hash_powers, in, num_blocks, acc);
+    } else
+#endif
+    {
+        digest_blocks_scalar(m_hash_powers[0], in, num_blocks, acc);
+    }
+
+    uint8_t block[AES_BLOCK_SIZE] = {0};
+    if (length % AES_BLOCK_SIZE) {
+        std::memcpy(block, in + num_blocks * AES_BLOCK_SIZE, length % AES_BLOCK_SIZE);
+        digest_blocks_scalar(m_hash_powers[0], block, 1, acc);
+    }
+    uint64_t final_block[2] = {static_cast<uint64_t>(length), chunk};
+    digest_blocks_scalar(m_hash_powers[0], reinterpret_cast<const uint8_t*>(final_block), 1, acc);
+
+    std::memcpy(block, acc, sizeof(block));
+    m_digest.encrypt_blocks(block, out, 1);
+}
+
+void AesIncrementalCipher::crypt_chunk(const uint8_t* in, uint8_t* out, size_t length, uint64_t chunk,
+                                       uint64_t nonce, uint32_t generation, bool decrypt) const {
+    if (m_mode == AesCipherMode::XTS) {
+        if (decrypt) {
+            m_xts.decrypt_sector(in, out, length, chunk);
+        } else {
+            m_xts.encrypt_sector(in, out, length, chunk);
+        }
+        return;
+    }
+    uint8_t counter[AES_BLOCK_SIZE];
+    store_be(counter, nonce, 8);
+    store_be(counter + 8, generation, 4);
+    store_be(counter + 12, chunk * m_chunk_size / AES_BLOCK_SIZE, 4);
+    m_data.ctr_crypt(in, out, length, counter);
+}
+
+int AesIncrementalCipher::encrypt(const uint8_t* in, uint8_t* out, size_t length, AesChunkIndex& index,
+                                  AesIncrementalStats* stats) const {
+    if (!valid_mode(m_mode, m_chunk_size) || !valid_length(length) || (length > 0 && (!in || !out))) {
+        return AES_CIPHER_EINVAL;
+    }
+    uint64_t nonce = 0;
+    if (m_mode == AesCipherMode::CTR &&
+        aes_random_bytes(reinterpret_cast<uint8_t*>(&nonce), sizeof(nonce)) != AES_CIPHER_OK) {
+        return AES_CIPHER_EIO;
+    }
+
+    size_t count = chunk_count(length);
+    std::vector<AesChunkEntry> entries;
+    try {
+        entries.resize(count);
+    } catch (const std::bad_alloc&) {
+        return AES_CIPHER_ENOMEM;
+    }
+
+    // Digest each chunk before it is encrypted, which may be in place
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * m_chunk_size;
+        size_t chunk_bytes = chunk_length(m_chunk_size, length, count, i);
+        AesChunkEntry& entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.length = static_cast<uint32_t>(chunk_bytes);
+        digest(in + offset, chunk_bytes, i, entry.digest);
+        crypt_chunk(in + offset, out + offset, chunk_bytes, i, nonce, 0, false);
+    }
+
+    index.m_mode = m_mode;
+    index.m_chunk_size = m_chunk_size;
+    index.m_plaintext_size = length;
+    index.m_nonce = nonce;
+    index.m_generation = 0;
+    index.m_entries.swap(entries);
+    if (stats) {
+        stats->chunks = count;
+        stats->encrypted_chunks = count;
+        stats->bytes_hashed = length;
+        stats->bytes_encrypted = length;
+    }
+    return AES_CIPHER_OK;
+}
+
+int AesIncrementalCipher::update(const uint8_t* in, uint8_t* out, size_t length, AesChunkIndex& index,
+                                 AesIncrementalStats* stats) const {
+    if (!valid_mode(m_mode, m_chunk_size) || !valid_length(length) || (length > 0 && (!in || !out)) ||
+        index.m_mode != m_mode || index.m_chunk_size != m_chunk_size || index.m_generation == UINT32_MAX) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    size_t count = chunk_count(length);
+    size_t old_count = index.m_entries.size();
+    try {
+        index.m_entries.resize(count);
+    } catch (const std::bad_alloc&) {
+        return AES_CIPHER_ENOMEM;
+    }
+
+    // Chunks that change are written under the next generation
+    uint32_t generation = index.m_generation + 1;
+    AesIncrementalStats local;
+    local.chunks = count;
+    local.bytes_hashed = length;
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * m_chunk_size;
+        size_t chunk_bytes = chunk_length(m_chunk_size, length, count, i);
+        AesChunkEntry& entry = index.m_entries[i];
+        uint8_t digest_now[AES_BLOCK_SIZE];
+        digest(in + offset, chunk_bytes, i, digest_now);
+        if (i < old_count && entry.length == chunk_bytes &&
+            std::memcmp(entry.digest, digest_now, AES_BLOCK_SIZE) == 0) {
+            continue;
+        }
+
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.digest, digest_now, AES_BLOCK_SIZE);
+        entry.length = static_cast<uint32_t>(chunk_bytes);
+        entry.generation = generation;
+        crypt_chunk(in + offset, out + offset, chunk_bytes, i, index.m_nonce, generation, false);
+        local.encrypted_chunks++;
+        local.bytes_encrypted += chunk_bytes;
+    }
+
+    index.m_plaintext_size = length;
+    if (local.encrypted_chunks > 0) {
+        index.m_generation = generation;
+    }
+    if (stats) {
+        *stats = local;
+    }
+    return AES_CIPHER_OK;
+}
+
+int AesIncrementalCipher::decrypt(const uint8_t* in, uint8_t* out, const AesChunkIndex& index) const {
+    size_t length = static_cast<size_t>(index.m_plaintext_size);
+    if (!valid_mode(m_mode, m_chunk_size) || index.m_mode != m_mode || index.m_chunk_size != m_chunk_size ||
+        index.m_entries.size() != chunk_count(length) || (length > 0 && (!in || !out))) {
+        return AES_CIPHER_EINVAL;
+    }
+    for (size_t i = 0; i < index.m_entries.size(); i++) {
+        size_t offset = i * m_chunk_size;
+        crypt_chunk(in + offset, out + offset, index.m_entries[i].length, i, index.m_nonce,
+                    index.m_entries[i].generation, true);
+    }
+    return AES_CIPHER_OK;
+}
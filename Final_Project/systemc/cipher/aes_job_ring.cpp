@@ -0,0 +1,318 @@
+#include "../include/aes_job_ring.h"
+#include "../include/aes_multi_buffer.h"
+#include "aes_cipher_handles.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+int aes_run_job(const AesJob& job) {
+    if ((!job.in || !job.out) && job.length > 0) {
+        return AES_CIPHER_EINVAL;
+    }
+    bool decrypt = (job.operation == AesOperation::DECRYPT);
+    uint8_t iv[AES_BLOCK_SIZE];
+    std::memcpy(iv, job.iv.data(), AES_BLOCK_SIZE);
+
+    switch (job.mode) {
+    case AesCipherMode::ECB:
+    case AesCipherMode::CBC:
+        if (!job.key || job.length % AES_BLOCK_SIZE != 0) {
+            return AES_CIPHER_EINVAL;
+        }
+        if (job.mode == AesCipherMode::ECB) {
+            decrypt ? job.key->decrypt_blocks(job.in, job.out, job.length / AES_BLOCK_SIZE) :
+                      job.key->encrypt_blocks(job.in, job.out, job.length / AES_BLOCK_SIZE);
+        } else {
+            decrypt ? job.key->cbc_decrypt(job.in, job.out, job.length / AES_BLOCK_SIZE, iv) :
+                      job.key->cbc_encrypt(job.in, job.out, job.length / AES_BLOCK_SIZE, iv);
+        }
+        return AES_CIPHER_OK;
+
+    case AesCipherMode::CTR:
+        if (!job.key) {
+            return AES_CIPHER_EINVAL;
+        }
+        job.key->ctr_crypt(job.in, job.out, job.length, iv);
+        return AES_CIPHER_OK;
+
+    case AesCipherMode::XTS: {
+        if (!job.xts_key || job.length < AES_BLOCK_SIZE) {
+            return AES_CIPHER_EINVAL;
+        }
+        uint64_t sector = 0;
+        for (int i = 0; i < 8; i++) {
+            sector |= static_cast<uint64_t>(iv[i]) << (8 * i);
+        }
+        decrypt ? job.xts_key->decrypt_sector(job.in, job.out, job.length, sector) :
+                  job.xts_key->encrypt_sector(job.in, job.out, job.length, sector);
+        return AES_CIPHER_OK;
+    }
+    }
+    return AES_CIPHER_EINVAL;
+}
+
+AesJobRing::AesJobRing(size_t entries, unsigned num_workers, size_t batch_size) :
+    m_capacity(round_up_pow2(entries < 2 ? 2 : entries)),
+    m_batch_size(batch_size == 0 ? 1 : batch_size),
+    m_event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    m_submissions(m_capacity),
+    m_completions(m_capacity),
+    m_callbacks(m_capacity) {
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+    for (unsigned i = 0; i < num_workers; i++) {
+        m_workers.emplace_back(&AesJobRing::worker, this);
+    }
+}
+
+AesJobRing::~AesJobRing() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping.store(true);
+    }
+    m_wakeup.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    if (m_event_fd >= 0) {
+        close(m_event_fd);
+    }
+}
+
+bool AesJobRing::push(const Entry& entry) {
+    // Reserve a place among the jobs in flight; that reservation is what
+    // guarantees both rings have room
+    size_t count = m_in_flight.load(std::memory_order_relaxed);
+    do {
+        if (count >= m_capacity) {
+            return false;
+        }
+    } while (!m_in_flight.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel));
+
+    m_submissions.try_push(entry);
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeup.notify_one();
+    }
+    return true;
+}
+
+bool AesJobRing::submit(const AesJob& job) {
+    return push(Entry{job, nullptr, nullptr});
+}
+
+bool AesJobRing::submit(const AesJob& job, Callback callback, void* context) {
+    return push(Entry{job, callback, context});
+}
+
+size_t AesJobRing::submit(const AesJob* jobs, size_t count) {
+    size_t accepted = 0;
+    while (accepted < count && submit(jobs[accepted])) {
+        accepted++;
+    }
+    return accepted;
+}
+
+size_t AesJobRing::poll(AesCompletion* completions, size_t max) {
+    size_t handled = 0;
+    return reap(completions, max, handled);
+}
+
+size_t AesJobRing::reap(AesCompletion* completions, size_t max, size_t& handled) {
+    // Clear the eventfd before looking at the rings: a completion posted
+    // after this read writes the eventfd again, so no wakeup is lost
+    uint64_t counter;
+    if (read(m_event_fd, &counter, sizeof(counter)) < 0) {
+        counter = 0;
+    }
+
+    Done done;
+    handled = 0;
+    while (m_callbacks.try_pop(done)) {
+        m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+        done.callback(done.context, done.completion.status);
+        handled++;
+    }
+    size_t count = 0;
+    while (count < max && m_completions.try_pop(done)) {
+        m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+        completions[count++] = done.completion;
+    }
+    handled += count;
+
+    // Completions beyond max stay queued. Their wakeups were cleared above,
+    // so post one for them, or an epoll loop would never come back.
+    if (count == max && !m_completions.empty()) {
+        uint64_t pending = 1;
+        ssize_t written = write(m_event_fd, &pending, sizeof(pending));
+        (void)written;
+    }
+    return count;
+}
+
+size_t AesJobRing::wait(AesCompletion* completions, size_t max, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        size_t handled = 0;
+        size_t count = reap(completions, max, handled);
+        if (handled > 0) {
+            return count;
+        }
+
+        int remaining = -1;
+        if (timeout_ms >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                return 0;
+            }
+            remaining = static_cast<int>(left.count());
+        }
+        struct pollfd pfd;
+        pfd.fd = m_event_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, remaining);
+    }
+}
+
+void AesJobRing::worker() {
+    std::vector<Entry> batch(m_batch_size);
+    std::vector<int> status(m_batch_size);
+    std::vector<AesCbcStream> streams;
+    streams.reserve(m_batch_size);
+    for (;;) {
+        size_t n = 0;
+        while (n < m_batch_size && m_submissions.try_pop(batch[n])) {
+            n++;
+        }
+
+        if (n == 0) {
+            if (m_queued.load() > 0) {
+                // A submitter has claimed a slot but not published it yet
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping.fetch_add(1);
+            m_wakeup.wait(lock, [this]() { return m_queued.load() > 0 || m_stopping.load(); });
+            m_sleeping.fetch_sub(1);
+            if (m_queued.load() == 0 && m_stopping.load()) {
+                return;
+            }
+            continue;
+        }
+        m_queued.fetch_sub(n);
+
+        // CBC encryption is serial within a job, so the batch's CBC-encrypt
+        // jobs share the multi-buffer lanes; everything else runs one by one
+        streams.clear();
+        for (size_t i = 0; i < n; i++) {
+            const AesJob& job = batch[i].job;
+            bool chained = job.mode == AesCipherMode::CBC && job.operation == AesOperation::ENCRYPT;
+            if (chained && job.key && job.in && job.out && job.length % AES_BLOCK_SIZE == 0) {
+                AesCbcStream stream{job.key, job.in, job.out, job.length / AES_BLOCK_SIZE, {}};
+                std::memcpy(stream.iv, job.iv.data(), AES_BLOCK_SIZE);
+                streams.push_back(stream);
+                status[i] = AES_CIPHER_OK;
+            } else {
+                status[i] = aes_run_job(job);
+            }
+        }
+        if (!streams.empty()) {
+            aes_cbc_encrypt_streams(streams.data(), streams.size());
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const Entry& entry = batch[i];
+            Done done{{entry.job.user_data, status[i]}, entry.callback, entry.context};
+            (done.callback ? m_callbacks : m_completions).try_push(done);
+        }
+
+        // One notification per batch rather than per job. A failed write
+        // means the counter is saturated, which is still readable.
+        uint64_t posted = n;
+        ssize_t written = write(m_event_fd, &posted, sizeof(posted));
+        (void)written;
+    }
+}
+
+// C interface
+
+struct aes_job_ring {
+    AesJobRing ring;
+
+    aes_job_ring(size_t entries, unsigned num_workers) : ring(entries, num_workers) {}
+};
+
+extern "C" aes_job_ring* aes_job_ring_create(size_t entries, unsigned num_workers) {
+    aes_job_ring* ring = new (std::nothrow) aes_job_ring(entries, num_workers);
+    if (ring && ring->ring.event_fd() < 0) {
+        delete ring;
+        return nullptr;
+    }
+    return ring;
+}
+
+extern "C" void aes_job_ring_destroy(aes_job_ring* ring) {
+    delete ring;
+}
+
+extern "C" size_t aes_job_ring_submit(aes_job_ring* ring, const aes_job* jobs, size_t count) {
+    if (!ring || !jobs) {
+        return 0;
+    }
+    size_t accepted = 0;
+    for (; accepted < count; accepted++) {
+        const aes_job& c = jobs[accepted];
+        AesJob job;
+        if (c.mode >= AES_CIPHER_MODE_ECB && c.mode <= AES_CIPHER_MODE_XTS) {
+            job.mode = static_cast<AesCipherMode>(c.mode);
+            job.key = c.key ? &c.key->schedule : nullptr;
+            job.xts_key = c.xts_key ? &c.xts_key->xts : nullptr;
+        }
+        // An unknown mode leaves both keys unset, so it completes with
+        // AES_CIPHER_EINVAL
+        job.operation = (c.operation == AES_CIPHER_DECRYPT) ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        job.in = c.in;
+        job.out = c.out;
+        job.length = c.length;
+        std::memcpy(job.iv.data(), c.iv, AES_BLOCK_SIZE);
+        job.user_data = c.user_data;
+        if (!ring->ring.submit(job)) {
+            break;
+        }
+    }
+    return accepted;
+}
+
+extern "C" size_t aes_job_ring_poll(aes_job_ring* ring, aes_completion* completions, size_t max) {
+    if (!ring || (!completions && max > 0)) {
+        return 0;
+    }
+    static_assert(sizeof(aes_completion) == sizeof(AesCompletion), "completion layouts differ");
+    return ring->ring.poll(reinterpret_cast<AesCompletion*>(completions), max);
+}
+
+extern "C" size_t aes_job_ring_wait(aes_job_ring* ring, aes_completion* completions, size_t max, int timeout_ms) {
+    if (!ring || (!completions && max > 0)) {
+        return 0;
+    }
+    return ring->ring.wait(reinterpret_cast<AesCompletion*>(completions), max, timeout_ms);
+}
+
+extern "C" int aes_job_ring_event_fd(const aes_job_ring* ring) {
+    return ring ? ring->ring.event_fd() : -1;
+}
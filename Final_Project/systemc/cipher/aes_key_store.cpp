@@ -0,0 +1,285 @@
+#include "../include/aes_key_store.h"
+#include "../include/aes_cipher_c.h"
+#include "aes_cipher_handles.h"
+#include "aes_file_util.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char AES_KEY_STORE_MAGIC[8] = {'A', 'E', 'S', 'K', 'S', 'T', 'O', 'R'};
+static const uint32_t AES_KEY_STORE_BYTE_ORDER = 0x01020304;
+
+// Keys expanded and written per pass of the builder
+constexpr size_t AES_KEY_STORE_CHUNK = 1024;
+
+static size_t records_offset(size_t count) {
+    size_t end = sizeof(AesKeyStoreHeader) + count * sizeof(uint64_t);
+    return (end + AES_KEY_STORE_PAGE - 1) / AES_KEY_STORE_PAGE * AES_KEY_STORE_PAGE;
+}
+
+AesKeyStore::AesKeyStore() :
+    m_base(nullptr),
+    m_length(0),
+    m_count(0),
+    m_ids(nullptr),
+    m_records(nullptr) {}
+
+AesKeyStore::~AesKeyStore() {
+    close();
+}
+
+int AesKeyStore::write(const std::string& path, const uint64_t* key_ids, const AesKey* keys, size_t count) {
+    if (path.empty() || (count > 0 && (!key_ids || !keys))) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    std::vector<uint64_t> ids;
+    std::vector<size_t> order;
+    std::vector<AesKeySchedule> schedules;
+    std::vector<AesKeyStoreRecord> records;
+    try {
+        order.resize(count);
+        ids.resize(count);
+        schedules.resize(AES_KEY_STORE_CHUNK);
+        records.resize(AES_KEY_STORE_CHUNK);
+    } catch (const std::bad_alloc&) {
+        return AES_CIPHER_ENOMEM;
+    }
+
+    // Index order: ascending key ID, no duplicates
+    for (size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [key_ids](size_t a, size_t b) { return key_ids[a] < key_ids[b]; });
+    for (size_t i = 0; i < count; i++) {
+        ids[i] = key_ids[order[i]];
+        if (i > 0 && ids[i] == ids[i - 1]) {
+            return AES_CIPHER_EINVAL;
+        }
+    }
+
+    // Build under a temporary name, then rename over the old file
+    std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+
+    AesKeyStoreHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, AES_KEY_STORE_MAGIC, sizeof(header.magic));
+    header.version = AES_KEY_STORE_VERSION;
+    header.byte_order = AES_KEY_STORE_BYTE_ORDER;
+    header.header_size = sizeof(AesKeyStoreHeader);
+    header.record_size = sizeof(AesKeyStoreRecord);
+    header.count = count;
+    header.records_offset = records_offset(count);
+    header.file_size = header.records_offset + count * sizeof(AesKeyStoreRecord);
+
+    // The header goes in last, once the checksum is known
+    bool ok = lseek(fd, sizeof(header), SEEK_SET) == static_cast<off_t>(sizeof(header));
+    uint64_t checksum = AES_FILE_CHECKSUM_INIT;
+    if (ok && count > 0) {
+        ok = aes_file_write_all(fd, ids.data(), count * sizeof(uint64_t));
+        checksum = aes_file_checksum(checksum, ids.data(), count * sizeof(uint64_t));
+    }
+    size_t padding = header.records_offset - sizeof(header) - count * sizeof(uint64_t);
+    if (ok && padding > 0) {
+        std::vector<uint8_t> zeros(padding, 0);
+        ok = aes_file_write_all(fd, zeros.data(), padding);
+        checksum = aes_file_checksum(checksum, zeros.data(), padding);
+    }
+
+    AesKey chunk_keys[AES_KEY_STORE_CHUNK];
+    for (size_t i = 0; ok && i < count; i += AES_KEY_STORE_CHUNK) {
+        size_t n = std::min(AES_KEY_STORE_CHUNK, count - i);
+        for (size_t j = 0; j < n; j++) {
+            chunk_keys[j] = keys[order[i + j]];
+        }
+        AesKeySchedule::expand_batch(chunk_keys, schedules.data(), n);
+        for (size_t j = 0; j < n; j++) {
+            AesKeyStoreRecord& record = records[j];
+            std::memset(static_cast<void*>(&record), 0, sizeof(record));  // Padding too, for the checksum
+            record.key_id = ids[i + j];
+            record.round_keys = schedules[j].round_keys();
+            record.inv_round_keys = schedules[j].inv_round_keys();
+        }
+        ok = aes_file_write_all(fd, records.data(), n * sizeof(AesKeyStoreRecord));
+        checksum = aes_file_checksum(checksum, records.data(), n * sizeof(AesKeyStoreRecord));
+    }
+
+    header.checksum = checksum;
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    ok = ok && fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return AES_CIPHER_EIO;
+    }
+    return AES_CIPHER_OK;
+}
+
+int AesKeyStore::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(AesKeyStoreHeader))) {
+        ::close(fd);
+        return AES_CIPHER_EIO;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file open
+    if (base == MAP_FAILED) {
+        return AES_CIPHER_EIO;
+    }
+
+    // Header only: every check below is O(1)
+    const AesKeyStoreHeader* header = static_cast<const AesKeyStoreHeader*>(base);
+    int status = AES_CIPHER_OK;
+    if (std::memcmp(header->magic, AES_KEY_STORE_MAGIC, sizeof(header->magic)) != 0) {
+        status = AES_CIPHER_EIO;
+    } else if (header->version != AES_KEY_STORE_VERSION) {
+        status = AES_CIPHER_EVERSION;
+    } else if (header->byte_order != AES_KEY_STORE_BYTE_ORDER ||
+               header->header_size != sizeof(AesKeyStoreHeader) ||
+               header->record_size != sizeof(AesKeyStoreRecord) ||
+               header->file_size != length ||
+               header->count > length / sizeof(AesKeyStoreRecord) ||
+               header->records_offset != records_offset(header->count) ||
+               header->records_offset + header->count * sizeof(AesKeyStoreRecord) != length) {
+        status = AES_CIPHER_EIO;
+    }
+    if (status != AES_CIPHER_OK) {
+        munmap(base, length);
+        return status;
+    }
+
+    m_base = base;
+    m_length = length;
+    m_count = header->count;
+    m_ids = reinterpret_cast<const uint64_t*>(static_cast<const uint8_t*>(base) + sizeof(AesKeyStoreHeader));
+    m_records = reinterpret_cast<const AesKeyStoreRecord*>(static_cast<const uint8_t*>(base) + header->records_offset);
+
+    // Binary search walks the index; records are hit at random, so
+    // read-ahead would only pull in neighbours nobody asked for
+    madvise(base, header->records_offset, MADV_WILLNEED);
+    if (m_count > 0) {
+        madvise(const_cast<AesKeyStoreRecord*>(m_records), m_count * sizeof(AesKeyStoreRecord), MADV_RANDOM);
+    }
+    return AES_CIPHER_OK;
+}
+
+void AesKeyStore::close() {
+    if (m_base) {
+        munmap(m_base, m_length);
+    }
+    m_base = nullptr;
+    m_length = 0;
+    m_count = 0;
+    m_ids = nullptr;
+    m_records = nullptr;
+}
+
+const AesKeyStoreRecord* AesKeyStore::find(uint64_t key_id) const {
+    const uint64_t* end = m_ids + m_count;
+    const uint64_t* it = std::lower_bound(m_ids, end, key_id);
+    if (it == end || *it != key_id) {
+        return nullptr;
+    }
+    return &m_records[it - m_ids];
+}
+
+bool AesKeyStore::get(uint64_t key_id, AesKeySchedule& schedule, AesKeyKernel kernel) const {
+    const AesKeyStoreRecord* record = find(key_id);
+    if (!record) {
+        return false;
+    }
+    schedule = AesKeySchedule(record->round_keys, record->inv_round_keys, kernel);
+    return true;
+}
+
+bool AesKeyStore::verify() const {
+    if (!m_base) {
+        return false;
+    }
+    const AesKeyStoreHeader* header = static_cast<const AesKeyStoreHeader*>(m_base);
+    const uint8_t* body = static_cast<const uint8_t*>(m_base) + sizeof(AesKeyStoreHeader);
+    if (aes_file_checksum(AES_FILE_CHECKSUM_INIT, body, m_length - sizeof(AesKeyStoreHeader)) != header->checksum) {
+        return false;
+    }
+    for (size_t i = 1; i < m_count; i++) {
+        if (m_ids[i] <= m_ids[i - 1]) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < m_count; i++) {
+        if (m_records[i].key_id != m_ids[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// C interface
+
+extern "C" int aes_key_store_write(const char* path, const uint64_t* key_ids, const uint8_t* keys, size_t count) {
+    if (!path || (count > 0 && !keys)) {
+        return AES_CIPHER_EINVAL;
+    }
+    std::vector<AesKey> key_list;
+    try {
+        key_list.reserve(count);
+    } catch (const std::bad_alloc&) {
+        return AES_CIPHER_ENOMEM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        key_list.emplace_back(keys + i * AES_KEY_SIZE);
+    }
+    return AesKeyStore::write(path, key_ids, key_list.data(), count);
+}
+
+extern "C" aes_key_store* aes_key_store_open(const char* path, int* status) {
+    int result = AES_CIPHER_EINVAL;
+    aes_key_store* store = nullptr;
+    if (path) {
+        store = new (std::nothrow) aes_key_store;
+        result = store ? store->store.open(path) : AES_CIPHER_ENOMEM;
+        if (result != AES_CIPHER_OK) {
+            delete store;
+            store = nullptr;
+        }
+    }
+    if (status) {
+        *status = result;
+    }
+    return store;
+}
+
+extern "C" void aes_key_store_close(aes_key_store* store) {
+    delete store;
+}
+
+extern "C" size_t aes_key_store_count(const aes_key_store* store) {
+    return store ? store->store.size() : 0;
+}
+
+extern "C" aes_key_schedule* aes_key_store_get(const aes_key_store* store, uint64_t key_id) {
+    if (!store) {
+        return nullptr;
+    }
+    const AesKeyStoreRecord* record = store->store.find(key_id);
+    if (!record) {
+        return nullptr;
+    }
+    return new (std::nothrow) aes_key_schedule{AesKeySchedule(record->round_keys, record->inv_round_keys)};
+}
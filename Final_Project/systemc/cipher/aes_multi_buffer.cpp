@@ -0,0 +1,260 @@
+#include "../include/aes_multi_buffer.h"
+#include "../include/aes_key_batch.h"
+#include "../include/aes_cross_check.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef AES_KEY_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Multiply by x in GF(2^128), big-endian as CMAC defines it
+static void cmac_double(const uint8_t* in, uint8_t* out) {
+    uint8_t carry = in[0] >> 7;
+    for (int i = 0; i < AES_BLOCK_SIZE - 1; i++) {
+        out[i] = static_cast<uint8_t>((in[i] << 1) | (in[i + 1] >> 7));
+    }
+    out[AES_BLOCK_SIZE - 1] = static_cast<uint8_t>(in[AES_BLOCK_SIZE - 1] << 1);
+    if (carry) {
+        out[AES_BLOCK_SIZE - 1] ^= 0x87;
+    }
+}
+
+// Final block of a CMAC message: the last full block XOR K1, or the padded
+// partial block XOR K2. Returns the number of blocks (at least one).
+static size_t cmac_last_block(const AesCmacKey& key, const uint8_t* message, size_t length, uint8_t* last) {
+    size_t num_blocks = (length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    bool complete = num_blocks > 0 && length % AES_BLOCK_SIZE == 0;
+    if (num_blocks == 0) {
+        num_blocks = 1;
+    }
+
+    size_t offset = (num_blocks - 1) * AES_BLOCK_SIZE;
+    size_t tail = complete ? AES_BLOCK_SIZE : length % AES_BLOCK_SIZE;
+    std::memset(last, 0, AES_BLOCK_SIZE);
+    if (tail > 0) {
+        std::memcpy(last, message + offset, tail);
+    }
+    if (!complete) {
+        last[tail] = 0x80;
+    }
+    const uint8_t* subkey = complete ? key.k1() : key.k2();
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+        last[i] ^= subkey[i];
+    }
+    return num_blocks;
+}
+
+AesCmacKey::AesCmacKey(const AesKey& key, AesKeyKernel kernel) :
+    m_schedule(key, kernel) {
+    uint8_t l[AES_BLOCK_SIZE] = {0};
+    m_schedule.encrypt_blocks(l, l, 1);
+    cmac_double(l, m_k1);
+    cmac_double(m_k1, m_k2);
+}
+
+void AesCmacKey::compute(const uint8_t* message, size_t length, uint8_t* tag) const {
+    uint8_t last[AES_BLOCK_SIZE];
+    size_t num_blocks = cmac_last_block(*this, message, length, last);
+    std::memset(tag, 0, AES_BLOCK_SIZE);
+    for (size_t i = 0; i < num_blocks; i++) {
+        const uint8_t* block = (i + 1 == num_blocks) ? last : message + i * AES_BLOCK_SIZE;
+        for (int j = 0; j < AES_BLOCK_SIZE; j++) {
+            tag[j] ^= block[j];
+        }
+        m_schedule.encrypt_blocks(tag, tag, 1);
+    }
+}
+
+AesMultiBuffer::AesMultiBuffer(size_t lanes, AesKeyKernel kernel) :
+    m_lanes(std::min(std::max<size_t>(lanes, 1), AES_MULTI_BUFFER_MAX_LANES)),
+    // VAES would need two keys per register; the lanes use 128-bit AES-NI
+    m_kernel(aes_key_kernel_resolve(kernel) == AesKeyKernel::SCALAR ? AesKeyKernel::SCALAR : AesKeyKernel::AESNI) {
+}
+
+void AesMultiBuffer::add(AesCbcStream& stream) {
+    Chain chain;
+    chain.round_keys = &stream.key->round_keys();
+    chain.in = stream.in;
+    chain.out = stream.out;
+    chain.num_blocks = stream.num_blocks;
+    chain.cmac = false;
+    chain.state = stream.iv;
+    m_queue.push_back(chain);
+}
+
+void AesMultiBuffer::add(AesCmacStream& stream) {
+    Chain chain;
+    chain.round_keys = &stream.key->schedule().round_keys();
+    chain.in = stream.message;
+    chain.out = nullptr;
+    chain.num_blocks = cmac_last_block(*stream.key, stream.message, stream.length, chain.last_block);
+    chain.cmac = true;
+    chain.state = stream.tag;
+    std::memset(stream.tag, 0, AES_BLOCK_SIZE);
+    m_queue.push_back(chain);
+}
+
+void AesMultiBuffer::flush() {
+    m_stats = AesMultiBufferStats();
+    m_stats.lanes = m_lanes;
+    m_stats.streams = m_queue.size();
+
+    // Longest first: lanes that run together end at about the same step,
+    // and the shortest streams top up lanes near the end
+    std::stable_sort(m_queue.begin(), m_queue.end(),
+                     [](const Chain& a, const Chain& b) { return a.num_blocks > b.num_blocks; });
+    while (!m_queue.empty() && m_queue.back().num_blocks == 0) {
+        m_queue.pop_back();
+    }
+
+#ifdef AES_KEY_BATCH_X86
+    if (m_kernel == AesKeyKernel::AESNI) {
+        run_aesni(m_queue);
+        m_queue.clear();
+        return;
+    }
+#endif
+    run_scalar(m_queue);
+    m_queue.clear();
+}
+
+void AesMultiBuffer::run_scalar(std::vector<Chain>& chains) {
+    // Same lane schedule as the AES-NI kernel, so the stats agree
+    size_t active[AES_MULTI_BUFFER_MAX_LANES];
+    size_t position[AES_MULTI_BUFFER_MAX_LANES];
+    size_t num_active = 0;
+    size_t next = 0;
+    while (num_active < m_lanes && next < chains.size()) {
+        position[num_active] = 0;
+        active[num_active++] = next++;
+    }
+
+    while (num_active > 0) {
+        m_stats.steps++;
+        m_stats.blocks += num_active;
+        for (size_t b = 0; b < num_active; ) {
+            Chain& chain = chains[active[b]];
+            AesBlock state = AesBlock(chain.state) ^ AesBlock(chain.block(position[b]));
+            state = AesCipher::encrypt_block(state, *chain.round_keys);
+            std::memcpy(chain.state, state.data.data(), AES_BLOCK_SIZE);
+            if (chain.out) {
+                std::memcpy(chain.out + position[b] * AES_BLOCK_SIZE, state.data.data(), AES_BLOCK_SIZE);
+            }
+
+            if (++position[b] < chain.num_blocks) {
+                b++;
+            } else if (next < chains.size()) {
+                position[b] = 0;
+                active[b++] = next++;
+            } else {
+                num_active--;
+                active[b] = active[num_active];
+                position[b] = position[num_active];
+            }
+        }
+    }
+}
+
+#ifdef AES_KEY_BATCH_X86
+__attribute__((target("aes")))
+void AesMultiBuffer::run_aesni(std::vector<Chain>& chains) {
+    size_t active[AES_MULTI_BUFFER_MAX_LANES];
+    size_t position[AES_MULTI_BUFFER_MAX_LANES];
+    __m128i state[AES_MULTI_BUFFER_MAX_LANES];
+    size_t num_active = 0;
+    size_t next = 0;
+
+    auto load = [](const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+    auto start = [&](size_t lane) {
+        Chain& chain = chains[next];
+        active[lane] = next++;
+        position[lane] = 0;
+        state[lane] = load(chain.state);
+    };
+    while (num_active < m_lanes && next < chains.size()) {
+        start(num_active++);
+    }
+    AesCrossCheck::Ref check;
+
+    while (num_active > 0) {
+        m_stats.steps++;
+        m_stats.blocks += num_active;
+
+        // One block of every active stream, the lanes interleaved per round.
+        // Each lane reads its own round keys, so streams may differ in key.
+        __m128i s[AES_MULTI_BUFFER_MAX_LANES];
+        const AesRoundKeys* keys[AES_MULTI_BUFFER_MAX_LANES];
+        for (size_t b = 0; b < num_active; b++) {
+            const Chain& chain = chains[active[b]];
+            keys[b] = chain.round_keys;
+            s[b] = _mm_xor_si128(state[b], load(chain.block(position[b])));
+        }
+        size_t first_sample = check ? check->pick(num_active) : num_active;
+        uint8_t sample_in[AES_MULTI_BUFFER_MAX_LANES][AES_BLOCK_SIZE];
+        for (size_t b = first_sample; b < num_active; b = check->next(b, num_active)) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sample_in[b]), s[b]);
+        }
+        for (size_t b = 0; b < num_active; b++) {
+            s[b] = _mm_xor_si128(s[b], load(keys[b]->round_keys[0].data.data()));
+        }
+        for (int r = 1; r < AES_NUM_ROUNDS; r++) {
+            for (size_t b = 0; b < num_active; b++) {
+                s[b] = _mm_aesenc_si128(s[b], load(keys[b]->round_keys[r].data.data()));
+            }
+        }
+        for (size_t b = 0; b < num_active; b++) {
+            state[b] = _mm_aesenclast_si128(s[b], load(keys[b]->round_keys[AES_NUM_ROUNDS].data.data()));
+        }
+        for (size_t b = first_sample; b < num_active; b = check->next(b, num_active)) {
+            uint8_t sample_out[AES_BLOCK_SIZE];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sample_out), state[b]);
+            check->submit(AesCheckedEngine::MULTI_BUFFER, AesOperation::ENCRYPT,
+                          keys[b]->round_keys[0].data.data(), sample_in[b], sample_out);
+        }
+
+        for (size_t b = 0; b < num_active; ) {
+            Chain& chain = chains[active[b]];
+            if (chain.out) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(chain.out + position[b] * AES_BLOCK_SIZE), state[b]);
+            }
+            if (++position[b] < chain.num_blocks) {
+                b++;
+                continue;
+            }
+
+            // Stream done: hand back the chaining value or tag, then refill
+            // the lane or close it up
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(chain.state), state[b]);
+            if (next < chains.size()) {
+                start(b++);
+            } else {
+                num_active--;
+                active[b] = active[num_active];
+                position[b] = position[num_active];
+                state[b] = state[num_active];
+            }
+        }
+    }
+}
+#else
+void AesMultiBuffer::run_aesni(std::vector<Chain>& chains) {
+    run_scalar(chains);
+}
+#endif
+
+void aes_cbc_encrypt_streams(AesCbcStream* streams, size_t count, size_t lanes) {
+    AesMultiBuffer engine(lanes);
+    for (size_t i = 0; i < count; i++) {
+        engine.add(streams[i]);
+    }
+    engine.flush();
+}
+
+void aes_cmac_streams(AesCmacStream* streams, size_t count, size_t lanes) {
+    AesMultiBuffer engine(lanes);
+    for (size_t i = 0; i < count; i++) {
+        engine.add(streams[i]);
+    }
+    engine.flush();
+}
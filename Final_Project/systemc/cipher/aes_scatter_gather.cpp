@@ -0,0 +1,85 @@
+#include "../include/aes_scatter_gather.h"
+#include "../include/aes_cipher_c.h"
+#include "aes_cipher_handles.h"
+
+// A null segment base is only valid for an empty segment
+static bool iov_whole_blocks(const struct iovec* iov, size_t count) {
+    return aes_iov_valid(iov, count) && aes_iov_length(iov, count) % AES_BLOCK_SIZE == 0;
+}
+
+int aes_iov_encrypt_blocks(const AesKeySchedule& key, const struct iovec* iov, size_t count) {
+    if (!iov_whole_blocks(iov, count)) {
+        return AES_CIPHER_EINVAL;
+    }
+    aes_iov_for_each_block(iov, count,
+        [&key](uint8_t* p, size_t n) { key.encrypt_blocks(p, p, n); },
+        [&key](uint8_t* block, size_t) { key.encrypt_blocks(block, block, 1); });
+    return AES_CIPHER_OK;
+}
+
+int aes_iov_decrypt_blocks(const AesKeySchedule& key, const struct iovec* iov, size_t count) {
+    if (!iov_whole_blocks(iov, count)) {
+        return AES_CIPHER_EINVAL;
+    }
+    aes_iov_for_each_block(iov, count,
+        [&key](uint8_t* p, size_t n) { key.decrypt_blocks(p, p, n); },
+        [&key](uint8_t* block, size_t) { key.decrypt_blocks(block, block, 1); });
+    return AES_CIPHER_OK;
+}
+
+int aes_iov_cbc_encrypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* iv) {
+    if (!iv || !iov_whole_blocks(iov, count)) {
+        return AES_CIPHER_EINVAL;
+    }
+    aes_iov_for_each_block(iov, count,
+        [&key, iv](uint8_t* p, size_t n) { key.cbc_encrypt(p, p, n, iv); },
+        [&key, iv](uint8_t* block, size_t) { key.cbc_encrypt(block, block, 1, iv); });
+    return AES_CIPHER_OK;
+}
+
+int aes_iov_cbc_decrypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* iv) {
+    if (!iv || !iov_whole_blocks(iov, count)) {
+        return AES_CIPHER_EINVAL;
+    }
+    aes_iov_for_each_block(iov, count,
+        [&key, iv](uint8_t* p, size_t n) { key.cbc_decrypt(p, p, n, iv); },
+        [&key, iv](uint8_t* block, size_t) { key.cbc_decrypt(block, block, 1, iv); });
+    return AES_CIPHER_OK;
+}
+
+int aes_iov_ctr_crypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* counter) {
+    if (!counter || !aes_iov_valid(iov, count)) {
+        return AES_CIPHER_EINVAL;
+    }
+    // Only the chain's last block may be partial, so the keystream stays
+    // aligned with the byte offsets across segments
+    aes_iov_for_each_block(iov, count,
+        [&key, counter](uint8_t* p, size_t n) { key.ctr_crypt(p, p, n * AES_BLOCK_SIZE, counter); },
+        [&key, counter](uint8_t* block, size_t length) { key.ctr_crypt(block, block, length, counter); });
+    return AES_CIPHER_OK;
+}
+
+// C interface
+
+extern "C" int aes_iov_encrypt_blocks(const aes_key_schedule* schedule, const struct iovec* iov, size_t count) {
+    return schedule ? aes_iov_encrypt_blocks(schedule->schedule, iov, count) : AES_CIPHER_EINVAL;
+}
+
+extern "C" int aes_iov_decrypt_blocks(const aes_key_schedule* schedule, const struct iovec* iov, size_t count) {
+    return schedule ? aes_iov_decrypt_blocks(schedule->schedule, iov, count) : AES_CIPHER_EINVAL;
+}
+
+extern "C" int aes_iov_cbc_encrypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t count,
+                                   uint8_t* iv) {
+    return schedule ? aes_iov_cbc_encrypt(schedule->schedule, iov, count, iv) : AES_CIPHER_EINVAL;
+}
+
+extern "C" int aes_iov_cbc_decrypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t count,
+                                   uint8_t* iv) {
+    return schedule ? aes_iov_cbc_decrypt(schedule->schedule, iov, count, iv) : AES_CIPHER_EINVAL;
+}
+
+extern "C" int aes_iov_ctr_crypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t count,
+                                 uint8_t* counter) {
+    return schedule ? aes_iov_ctr_crypt(schedule->schedule, iov, count, counter) : AES_CIPHER_EINVAL;
+}
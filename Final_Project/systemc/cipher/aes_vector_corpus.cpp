@@ -0,0 +1,602 @@
+#include "../include/aes_vector_corpus.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_hex.h"
+#include "aes_file_util.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char AES_VECTOR_CORPUS_MAGIC[8] = {'A', 'E', 'S', 'V', 'C', 'O', 'R', 'P'};
+static const uint32_t AES_VECTOR_CORPUS_BYTE_ORDER = 0x01020304;
+constexpr size_t AES_VECTOR_CORPUS_PAGE = 4096;
+
+// Bytes buffered before each write to the index or the data
+constexpr size_t AES_VECTOR_CORPUS_BUFFER = 1 << 20;
+
+// Vectors longer than this are rejected, so one fits in a record
+constexpr size_t AES_VECTOR_MAX_LENGTH = 0xffffffffu;
+
+static uint64_t pad16(uint64_t length) {
+    return (length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+}
+
+static uint64_t data_offset(uint64_t count) {
+    uint64_t end = sizeof(AesVectorCorpusHeader) + count * sizeof(AesVectorRecord);
+    return (end + AES_VECTOR_CORPUS_PAGE - 1) / AES_VECTOR_CORPUS_PAGE * AES_VECTOR_CORPUS_PAGE;
+}
+
+// Writer
+
+AesVectorCorpusWriter::AesVectorCorpusWriter() :
+    m_fd(-1),
+    m_data_fd(-1),
+    m_count(0),
+    m_data_size(0),
+    m_checksum(AES_FILE_CHECKSUM_INIT) {}
+
+AesVectorCorpusWriter::~AesVectorCorpusWriter() {
+    discard();
+}
+
+void AesVectorCorpusWriter::discard() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        unlink(m_temp_path.c_str());
+    }
+    if (m_data_fd >= 0) {
+        ::close(m_data_fd);
+        unlink(m_data_path.c_str());
+    }
+    m_fd = -1;
+    m_data_fd = -1;
+    m_records.clear();
+    m_data.clear();
+}
+
+int AesVectorCorpusWriter::open(const std::string& path) {
+    discard();
+    if (path.empty()) {
+        return AES_CIPHER_EINVAL;
+    }
+    m_path = path;
+    m_temp_path = path + ".tmp." + std::to_string(getpid());
+    m_data_path = path + ".data." + std::to_string(getpid());
+    m_count = 0;
+    m_data_size = 0;
+    m_checksum = AES_FILE_CHECKSUM_INIT;
+    try {
+        m_records.reserve(AES_VECTOR_CORPUS_BUFFER);
+        m_data.reserve(AES_VECTOR_CORPUS_BUFFER);
+    } catch (const std::bad_alloc&) {
+        return AES_CIPHER_ENOMEM;
+    }
+
+    m_fd = ::open(m_temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    m_data_fd = ::open(m_data_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (m_fd < 0 || m_data_fd < 0 ||
+        lseek(m_fd, sizeof(AesVectorCorpusHeader), SEEK_SET) != static_cast<off_t>(sizeof(AesVectorCorpusHeader))) {
+        discard();
+        return AES_CIPHER_EIO;
+    }
+    return AES_CIPHER_OK;
+}
+
+bool AesVectorCorpusWriter::flush() {
+    bool ok = aes_file_write_all(m_fd, m_records.data(), m_records.size()) &&
+              aes_file_write_all(m_data_fd, m_data.data(), m_data.size());
+    m_checksum = aes_file_checksum(m_checksum, m_records.data(), m_records.size());
+    m_records.clear();
+    m_data.clear();
+    return ok;
+}
+
+int AesVectorCorpusWriter::add(const AesTestVector& vector) {
+    if (m_fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    bool whole_blocks = vector.length % AES_BLOCK_SIZE == 0;
+    bool mode_ok = vector.mode == AesCipherMode::CTR ||
+                   ((vector.mode == AesCipherMode::ECB || vector.mode == AesCipherMode::CBC) && whole_blocks);
+    bool operation_ok = vector.operation == AesOperation::ENCRYPT || vector.operation == AesOperation::DECRYPT;
+    if (!mode_ok || !operation_ok || !vector.key || vector.length > AES_VECTOR_MAX_LENGTH ||
+        (vector.mode != AesCipherMode::ECB && !vector.iv) ||
+        (vector.length > 0 && (!vector.plaintext || !vector.ciphertext))) {
+        return AES_CIPHER_EINVAL;
+    }
+
+    AesVectorRecord record;
+    std::memset(&record, 0, sizeof(record));
+    std::memcpy(record.key, vector.key, AES_KEY_SIZE);
+    if (vector.iv) {
+        std::memcpy(record.iv, vector.iv, AES_BLOCK_SIZE);
+    }
+    record.data = m_data_size;
+    record.length = static_cast<uint32_t>(vector.length);
+    record.mode = static_cast<uint8_t>(vector.mode);
+    record.operation = static_cast<uint8_t>(vector.operation);
+    record.id = vector.id;
+
+    const uint8_t* rp = reinterpret_cast<const uint8_t*>(&record);
+    m_records.insert(m_records.end(), rp, rp + sizeof(record));
+    uint64_t padded = pad16(vector.length);
+    size_t at = m_data.size();
+    m_data.resize(at + 2 * padded, 0);
+    if (vector.length > 0) {
+        std::memcpy(&m_data[at], vector.plaintext, vector.length);
+        std::memcpy(&m_data[at + padded], vector.ciphertext, vector.length);
+    }
+    m_data_size += 2 * padded;
+    m_count++;
+
+    if (m_records.size() >= AES_VECTOR_CORPUS_BUFFER || m_data.size() >= AES_VECTOR_CORPUS_BUFFER) {
+        if (!flush()) {
+            discard();
+            return AES_CIPHER_EIO;
+        }
+    }
+    return AES_CIPHER_OK;
+}
+
+int AesVectorCorpusWriter::finish() {
+    if (m_fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    bool ok = flush();
+
+    // Pad the index out to the data section, then append the side file
+    AesVectorCorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, AES_VECTOR_CORPUS_MAGIC, sizeof(header.magic));
+    header.version = AES_VECTOR_CORPUS_VERSION;
+    header.byte_order = AES_VECTOR_CORPUS_BYTE_ORDER;
+    header.header_size = sizeof(AesVectorCorpusHeader);
+    header.record_size = sizeof(AesVectorRecord);
+    header.count = m_count;
+    header.data_offset = data_offset(m_count);
+    header.file_size = header.data_offset + m_data_size;
+
+    uint64_t checksum = m_checksum;
+    size_t padding = header.data_offset - sizeof(header) - m_count * sizeof(AesVectorRecord);
+    if (ok && padding > 0) {
+        std::vector<uint8_t> zeros(padding, 0);
+        ok = aes_file_write_all(m_fd, zeros.data(), padding);
+        checksum = aes_file_checksum(checksum, zeros.data(), padding);
+    }
+
+    std::vector<uint8_t> buffer(AES_VECTOR_CORPUS_BUFFER);
+    ok = ok && lseek(m_data_fd, 0, SEEK_SET) == 0;
+    // Whole buffers (a multiple of 8 bytes) until the last, which ends with
+    // the padded data section: a short read() must not split a checksum word
+    for (uint64_t copied = 0; ok && copied < m_data_size;) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), m_data_size - copied));
+        ok = aes_file_read_all(m_data_fd, buffer.data(), n) &&
+             aes_file_write_all(m_fd, buffer.data(), n);
+        checksum = aes_file_checksum(checksum, buffer.data(), n);
+        copied += n;
+    }
+
+    header.checksum = checksum;
+    ok = ok && pwrite(m_fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    ok = ok && fsync(m_fd) == 0;
+    ok = (::close(m_fd) == 0) && ok;
+    m_fd = -1;
+    ok = ok && rename(m_temp_path.c_str(), m_path.c_str()) == 0;
+    if (!ok) {
+        unlink(m_temp_path.c_str());
+    }
+    discard();
+    return ok ? AES_CIPHER_OK : AES_CIPHER_EIO;
+}
+
+// Reader
+
+AesVectorCorpus::AesVectorCorpus() :
+    m_base(nullptr),
+    m_length(0),
+    m_count(0),
+    m_records(nullptr),
+    m_data(nullptr),
+    m_data_size(0) {}
+
+AesVectorCorpus::~AesVectorCorpus() {
+    close();
+}
+
+int AesVectorCorpus::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(AesVectorCorpusHeader))) {
+        ::close(fd);
+        return AES_CIPHER_EIO;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return AES_CIPHER_EIO;
+    }
+
+    const AesVectorCorpusHeader* header = static_cast<const AesVectorCorpusHeader*>(base);
+    int status = AES_CIPHER_OK;
+    if (std::memcmp(header->magic, AES_VECTOR_CORPUS_MAGIC, sizeof(header->magic)) != 0) {
+        status = AES_CIPHER_EIO;
+    } else if (header->version != AES_VECTOR_CORPUS_VERSION) {
+        status = AES_CIPHER_EVERSION;
+    } else if (header->byte_order != AES_VECTOR_CORPUS_BYTE_ORDER ||
+               header->header_size != sizeof(AesVectorCorpusHeader) ||
+               header->record_size != sizeof(AesVectorRecord) ||
+               header->file_size != length ||
+               header->count > length / sizeof(AesVectorRecord) ||
+               header->data_offset != data_offset(header->count) ||
+               header->data_offset > length) {
+        status = AES_CIPHER_EIO;
+    }
+    if (status != AES_CIPHER_OK) {
+        munmap(base, length);
+        return status;
+    }
+
+    m_base = base;
+    m_length = length;
+    m_count = header->count;
+    m_records = reinterpret_cast<const AesVectorRecord*>(static_cast<const uint8_t*>(base) + sizeof(*header));
+    m_data = static_cast<const uint8_t*>(base) + header->data_offset;
+    m_data_size = length - header->data_offset;
+
+    // A regression run walks the corpus front to back
+    madvise(base, length, MADV_SEQUENTIAL);
+    return AES_CIPHER_OK;
+}
+
+void AesVectorCorpus::close() {
+    if (m_base) {
+        munmap(m_base, m_length);
+    }
+    m_base = nullptr;
+    m_length = 0;
+    m_count = 0;
+    m_records = nullptr;
+    m_data = nullptr;
+    m_data_size = 0;
+}
+
+bool AesVectorCorpus::get(size_t i, AesTestVector& vector) const {
+    if (i >= m_count) {
+        return false;
+    }
+    const AesVectorRecord& record = m_records[i];
+    uint64_t padded = pad16(record.length);
+    if (record.data > m_data_size || 2 * padded > m_data_size - record.data ||
+        record.mode > static_cast<uint8_t>(AesCipherMode::CTR) ||
+        record.operation > static_cast<uint8_t>(AesOperation::DECRYPT)) {
+        return false;
+    }
+    vector.mode = static_cast<AesCipherMode>(record.mode);
+    vector.operation = static_cast<AesOperation>(record.operation);
+    vector.id = record.id;
+    vector.key = record.key;
+    vector.iv = record.iv;
+    vector.plaintext = m_data + record.data;
+    vector.ciphertext = m_data + record.data + padded;
+    vector.length = record.length;
+    return true;
+}
+
+bool AesVectorCorpus::verify() const {
+    if (!m_base) {
+        return false;
+    }
+    const AesVectorCorpusHeader* header = static_cast<const AesVectorCorpusHeader*>(m_base);
+    const uint8_t* body = static_cast<const uint8_t*>(m_base) + sizeof(AesVectorCorpusHeader);
+    if (aes_file_checksum(AES_FILE_CHECKSUM_INIT, body, m_length - sizeof(AesVectorCorpusHeader)) != header->checksum) {
+        return false;
+    }
+    AesTestVector vector;
+    for (size_t i = 0; i < m_count; i++) {
+        if (!get(i, vector)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool aes_vector_check(const AesTestVector& vector, const AesKeySchedule& schedule) {
+    bool decrypt = vector.operation == AesOperation::DECRYPT;
+    AesJob job;
+    job.mode = vector.mode;
+    job.operation = vector.operation;
+    job.key = &schedule;
+    job.in = decrypt ? vector.ciphertext : vector.plaintext;
+    job.length = vector.length;
+    if (vector.iv) {
+        std::memcpy(job.iv.data(), vector.iv, AES_BLOCK_SIZE);
+    }
+
+    // Short vectors, the usual case, stay on the stack
+    uint8_t local[256];
+    std::vector<uint8_t> heap;
+    if (vector.length > sizeof(local)) {
+        heap.resize(vector.length);
+    }
+    job.out = heap.empty() ? local : heap.data();
+    const uint8_t* expected = decrypt ? vector.plaintext : vector.ciphertext;
+    return aes_run_job(job) == AES_CIPHER_OK && std::memcmp(job.out, expected, vector.length) == 0;
+}
+
+// Text conversion
+
+namespace {
+
+// Whole file mapped read-only, for the importer
+struct MappedText {
+    const char* data = nullptr;
+    size_t length = 0;
+
+    ~MappedText() {
+        if (data) {
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        length = ok ? static_cast<size_t>(st.st_size) : 0;
+        if (ok && length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = p != MAP_FAILED;
+            data = ok ? static_cast<const char*>(p) : nullptr;
+            if (ok) {
+                madvise(p, length, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        return ok;
+    }
+};
+
+// One vector's fields as they are collected, line by line
+struct PendingVector {
+    uint64_t id = 0;
+    bool has_key = false;
+    bool has_iv = false;
+    bool has_plaintext = false;
+    bool has_ciphertext = false;
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t iv[AES_BLOCK_SIZE];
+    std::vector<uint8_t> plaintext;
+    std::vector<uint8_t> ciphertext;
+
+    void reset() {
+        has_key = has_iv = has_plaintext = has_ciphertext = false;
+        plaintext.clear();
+        ciphertext.clear();
+    }
+};
+
+const char* mode_name(AesCipherMode mode) {
+    switch (mode) {
+        case AesCipherMode::ECB: return "ECB";
+        case AesCipherMode::CBC: return "CBC";
+        case AesCipherMode::CTR: return "CTR";
+        default:                 return "XTS";
+    }
+}
+
+bool equals(const char* p, size_t n, const char* word) {
+    return std::strlen(word) == n && std::memcmp(p, word, n) == 0;
+}
+
+bool decode_field(const char* value, size_t n, uint8_t* out, size_t expected) {
+    return n == 2 * expected && aes_hex_decode(value, n, out);
+}
+
+bool decode_field(const char* value, size_t n, std::vector<uint8_t>& out) {
+    out.resize(n / 2);
+    return aes_hex_decode(value, n, out.data());
+}
+
+}
+
+int aes_vector_import(const std::string& text_path, AesVectorCorpusWriter& writer, AesCipherMode default_mode,
+                      size_t* error_line) {
+    MappedText text;
+    if (!text.open(text_path)) {
+        return AES_CIPHER_EIO;
+    }
+
+    AesCipherMode mode = default_mode;
+    AesOperation operation = AesOperation::ENCRYPT;
+    PendingVector pending;
+    size_t line_number = 0;
+    auto fail = [&](int status) {
+        if (error_line) {
+            *error_line = line_number;
+        }
+        return status;
+    };
+
+    // A vector is complete once it has a key, both texts and (except for
+    // ECB) an IV; it is written on the line that completes it
+    auto emit = [&]() {
+        AesTestVector vector;
+        vector.mode = mode;
+        vector.operation = operation;
+        vector.id = pending.id;
+        vector.key = pending.key;
+        vector.iv = pending.has_iv ? pending.iv : nullptr;
+        vector.plaintext = pending.plaintext.data();
+        vector.ciphertext = pending.ciphertext.data();
+        vector.length = pending.plaintext.size();
+        int status = pending.plaintext.size() == pending.ciphertext.size() ? writer.add(vector) : AES_CIPHER_EINVAL;
+        pending.reset();
+        return status;
+    };
+
+    const char* p = text.data;
+    const char* end = text.data + text.length;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = eol ? eol : end;
+        const char* next = eol ? eol + 1 : end;
+        line_number++;
+
+        // Trim; skip blanks and comments
+        const char* a = p;
+        const char* b = line_end;
+        while (a < b && (*a == ' ' || *a == '\t')) {
+            a++;
+        }
+        while (b > a && (b[-1] == '\r' || b[-1] == ' ' || b[-1] == '\t')) {
+            b--;
+        }
+        p = next;
+        if (a == b || *a == '#') {
+            continue;
+        }
+
+        if (*a == '[') {
+            if (equals(a, b - a, "[ENCRYPT]")) {
+                operation = AesOperation::ENCRYPT;
+            } else if (equals(a, b - a, "[DECRYPT]")) {
+                operation = AesOperation::DECRYPT;
+            }
+            continue;   // Other sections ([KEY = ...] headers and the like) are ignored
+        }
+
+        const char* eq = static_cast<const char*>(std::memchr(a, '=', b - a));
+        if (!eq) {
+            return fail(AES_CIPHER_EINVAL);
+        }
+        const char* name_end = eq;
+        while (name_end > a && (name_end[-1] == ' ' || name_end[-1] == '\t')) {
+            name_end--;
+        }
+        const char* value = eq + 1;
+        while (value < b && (*value == ' ' || *value == '\t')) {
+            value++;
+        }
+        size_t name_len = name_end - a;
+        size_t value_len = b - value;
+
+        bool ok = true;
+        if (equals(a, name_len, "KEY")) {
+            ok = decode_field(value, value_len, pending.key, AES_KEY_SIZE);
+            pending.has_key = ok;
+        } else if (equals(a, name_len, "IV")) {
+            ok = decode_field(value, value_len, pending.iv, AES_BLOCK_SIZE);
+            pending.has_iv = ok;
+        } else if (equals(a, name_len, "PLAINTEXT")) {
+            ok = decode_field(value, value_len, pending.plaintext);
+            pending.has_plaintext = ok;
+        } else if (equals(a, name_len, "CIPHERTEXT")) {
+            ok = decode_field(value, value_len, pending.ciphertext);
+            pending.has_ciphertext = ok;
+        } else if (equals(a, name_len, "COUNT")) {
+            pending.id = std::strtoull(std::string(value, value_len).c_str(), nullptr, 10);
+        } else if (equals(a, name_len, "MODE")) {
+            if (equals(value, value_len, "ECB")) {
+                mode = AesCipherMode::ECB;
+            } else if (equals(value, value_len, "CBC")) {
+                mode = AesCipherMode::CBC;
+            } else if (equals(value, value_len, "CTR")) {
+                mode = AesCipherMode::CTR;
+            } else {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            return fail(AES_CIPHER_EINVAL);
+        }
+
+        if (pending.has_key && pending.has_plaintext && pending.has_ciphertext &&
+            (pending.has_iv || mode == AesCipherMode::ECB)) {
+            int status = emit();
+            if (status != AES_CIPHER_OK) {
+                return fail(status);
+            }
+        }
+    }
+    return AES_CIPHER_OK;
+}
+
+int aes_vector_export(const AesVectorCorpus& corpus, const std::string& text_path) {
+    std::string temp_path = text_path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return AES_CIPHER_EIO;
+    }
+
+    std::string out;
+    out.reserve(AES_VECTOR_CORPUS_BUFFER + 4096);
+    auto field = [&out](const char* name, const uint8_t* bytes, size_t length) {
+        out += name;
+        size_t at = out.size();
+        out.resize(at + 2 * length);
+        aes_hex_encode(bytes, length, &out[at]);
+        out += '\n';
+    };
+
+    bool ok = true;
+    bool first = true;
+    AesCipherMode mode = AesCipherMode::ECB;
+    AesOperation operation = AesOperation::ENCRYPT;
+    AesTestVector vector;
+    for (size_t i = 0; ok && i < corpus.size(); i++) {
+        if (!corpus.get(i, vector)) {
+            ok = false;
+            break;
+        }
+        if (first || vector.operation != operation) {
+            out += vector.operation == AesOperation::ENCRYPT ? "[ENCRYPT]\n\n" : "[DECRYPT]\n\n";
+        }
+        if (first || vector.mode != mode) {
+            out += "MODE = ";
+            out += mode_name(vector.mode);
+            out += "\n\n";
+        }
+        first = false;
+        mode = vector.mode;
+        operation = vector.operation;
+
+        out += "COUNT = " + std::to_string(vector.id) + "\n";
+        field("KEY = ", vector.key, AES_KEY_SIZE);
+        if (vector.mode != AesCipherMode::ECB) {
+            field("IV = ", vector.iv, AES_BLOCK_SIZE);
+        }
+        // Published order: the input of the tested direction first
+        if (operation == AesOperation::ENCRYPT) {
+            field("PLAINTEXT = ", vector.plaintext, vector.length);
+            field("CIPHERTEXT = ", vector.ciphertext, vector.length);
+        } else {
+            field("CIPHERTEXT = ", vector.ciphertext, vector.length);
+            field("PLAINTEXT = ", vector.plaintext, vector.length);
+        }
+        out += '\n';
+
+        if (out.size() >= AES_VECTOR_CORPUS_BUFFER) {
+            ok = aes_file_write_all(fd, out.data(), out.size());
+            out.clear();
+        }
+    }
+    ok = ok && aes_file_write_all(fd, out.data(), out.size());
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), text_path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return AES_CIPHER_EIO;
+    }
+    return AES_CIPHER_OK;
+}
@@ -0,0 +1,276 @@
+#include "../include/aes_xts.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_cross_check.h"
+#include "aes_cipher_handles.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef AES_KEY_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Below this much data per thread, starting a thread costs more than it saves
+constexpr size_t XTS_MIN_BYTES_PER_THREAD = 64 * 1024;
+
+// Blocks in flight per iteration of the AES-NI loop
+constexpr size_t XTS_INTERLEAVE = 8;
+
+AesXts::AesXts(const AesKey& data_key, const AesKey& tweak_key, AesKeyKernel kernel) :
+    m_data(data_key, kernel),
+    m_tweak(tweak_key, kernel) {
+}
+
+void AesXts::encrypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector) const {
+    crypt_sector(in, out, length, sector, false);
+}
+
+void AesXts::decrypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector) const {
+    crypt_sector(in, out, length, sector, true);
+}
+
+void AesXts::encrypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                             uint64_t first_sector, unsigned num_threads) const {
+    crypt_sectors(in, out, sector_size, num_sectors, first_sector, num_threads, false);
+}
+
+void AesXts::decrypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                             uint64_t first_sector, unsigned num_threads) const {
+    crypt_sectors(in, out, sector_size, num_sectors, first_sector, num_threads, true);
+}
+
+void AesXts::crypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector, bool decrypt) const {
+    // T = E_K2(sector number as a 16-byte little-endian value)
+    uint8_t tweak[AES_BLOCK_SIZE] = {0};
+    for (int i = 0; i < 8; i++) {
+        tweak[i] = static_cast<uint8_t>(sector >> (8 * i));
+    }
+    m_tweak.encrypt_blocks(tweak, tweak, 1);
+
+    size_t full_blocks = length / AES_BLOCK_SIZE;
+    size_t tail = length % AES_BLOCK_SIZE;
+    if (tail == 0) {
+        crypt_blocks(in, out, full_blocks, tweak, decrypt);
+        return;
+    }
+
+    // Ciphertext stealing: the last full block and the partial block swap
+    // tweaks on decryption and share bytes in both directions
+    crypt_blocks(in, out, full_blocks - 1, tweak, decrypt);
+    size_t last = (full_blocks - 1) * AES_BLOCK_SIZE;
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t stolen[AES_BLOCK_SIZE];
+
+    if (!decrypt) {
+        // CC = E(P[m-1], T[m-1]); C[m] = CC[0..tail); C[m-1] = E(P[m] | CC[tail..], T[m])
+        crypt_blocks(in + last, block, 1, tweak, false);
+        std::memcpy(stolen, in + last + AES_BLOCK_SIZE, tail);
+        std::memcpy(stolen + tail, block + tail, AES_BLOCK_SIZE - tail);
+        std::memcpy(out + last + AES_BLOCK_SIZE, block, tail);
+        crypt_blocks(stolen, out + last, 1, tweak, false);
+    } else {
+        // PP = D(C[m-1], T[m]); P[m] = PP[0..tail); P[m-1] = D(C[m] | PP[tail..], T[m-1])
+        uint8_t next_tweak[AES_BLOCK_SIZE];
+        std::memcpy(next_tweak, tweak, AES_BLOCK_SIZE);
+        mul_alpha(next_tweak);
+        crypt_blocks(in + last, block, 1, next_tweak, true);
+        std::memcpy(stolen, in + last + AES_BLOCK_SIZE, tail);
+        std::memcpy(stolen + tail, block + tail, AES_BLOCK_SIZE - tail);
+        std::memcpy(out + last + AES_BLOCK_SIZE, block, tail);
+        crypt_blocks(stolen, out + last, 1, tweak, true);
+    }
+}
+
+void AesXts::crypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                           uint64_t first_sector, unsigned num_threads, bool decrypt) const {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t useful = std::max<size_t>(1, sector_size * num_sectors / XTS_MIN_BYTES_PER_THREAD);
+    size_t threads = std::min<size_t>({num_threads, useful, num_sectors});
+
+    auto run_range = [this, in, out, sector_size, first_sector, decrypt](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            crypt_sector(in + s * sector_size, out + s * sector_size, sector_size, first_sector + s, decrypt);
+        }
+    };
+
+    if (threads <= 1) {
+        run_range(0, num_sectors);
+        return;
+    }
+
+    // Contiguous sector ranges; the caller's thread takes the first one
+    std::vector<std::thread> workers;
+    size_t per_thread = num_sectors / threads;
+    size_t extra = num_sectors % threads;
+    size_t begin = per_thread + (extra > 0 ? 1 : 0);
+    for (size_t t = 1; t < threads; t++) {
+        size_t count = per_thread + (t < extra ? 1 : 0);
+        workers.emplace_back(run_range, begin, begin + count);
+        begin += count;
+    }
+    run_range(0, per_thread + (extra > 0 ? 1 : 0));
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+#ifdef AES_KEY_BATCH_X86
+// Multiply by alpha on the whole 128-bit tweak in one register: shift each
+// 32-bit lane left, then move every lane's lost top bit into the lane above,
+// with the bit out of lane 3 folded back into lane 0 as 0x87
+__attribute__((target("sse2")))
+static inline __m128i xts_mul_alpha_sse2(__m128i tweak) {
+    const __m128i carry_bits = _mm_set_epi32(1, 1, 1, 0x87);
+    __m128i carries = _mm_shuffle_epi32(_mm_srai_epi32(tweak, 31), 0x93);
+    return _mm_xor_si128(_mm_slli_epi32(tweak, 1), _mm_and_si128(carries, carry_bits));
+}
+
+__attribute__((target("aes")))
+static void xts_blocks_aesni(const AesRoundKeys& round_keys, const uint8_t* in, uint8_t* out, size_t num_blocks,
+                             uint8_t* tweak_bytes, bool decrypt) {
+    __m128i rk[AES_NUM_ROUNDS + 1];
+    for (int r = 0; r <= AES_NUM_ROUNDS; r++) {
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys.round_keys[r].data.data()));
+    }
+    __m128i tweak = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tweak_bytes));
+
+    for (size_t i = 0; i < num_blocks; i += XTS_INTERLEAVE) {
+        size_t n = std::min(num_blocks - i, XTS_INTERLEAVE);
+        __m128i t[XTS_INTERLEAVE];
+        __m128i s[XTS_INTERLEAVE];
+        for (size_t b = 0; b < n; b++) {
+            t[b] = tweak;
+            tweak = xts_mul_alpha_sse2(tweak);
+            s[b] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (i + b) * AES_BLOCK_SIZE)), t[b]);
+        }
+
+        if (!decrypt) {
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_xor_si128(s[b], rk[0]);
+            }
+            for (int r = 1; r < AES_NUM_ROUNDS; r++) {
+                for (size_t b = 0; b < n; b++) {
+                    s[b] = _mm_aesenc_si128(s[b], rk[r]);
+                }
+            }
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_aesenclast_si128(s[b], rk[AES_NUM_ROUNDS]);
+            }
+        } else {
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_xor_si128(s[b], rk[AES_NUM_ROUNDS]);
+            }
+            for (int r = AES_NUM_ROUNDS - 1; r > 0; r--) {
+                for (size_t b = 0; b < n; b++) {
+                    s[b] = _mm_aesdec_si128(s[b], rk[r]);
+                }
+            }
+            for (size_t b = 0; b < n; b++) {
+                s[b] = _mm_aesdeclast_si128(s[b], rk[0]);
+            }
+        }
+
+        for (size_t b = 0; b < n; b++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i + b) * AES_BLOCK_SIZE), _mm_xor_si128(s[b], t[b]));
+        }
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tweak_bytes), tweak);
+}
+#endif
+
+void AesXts::crypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* tweak, bool decrypt) const {
+#ifdef AES_KEY_BATCH_X86
+    if (m_data.kernel() == AesKeyKernel::AESNI) {
+        const AesRoundKeys& round_keys = decrypt ? m_data.inv_round_keys() : m_data.round_keys();
+        AesCrossCheck::Ref check;
+        // The sampled blocks' tweaks are stepped byte-wise from the one the
+        // call starts with, not taken from the kernel, so the alpha chain
+        // is checked across the whole call
+        uint8_t sample_tweak[AES_BLOCK_SIZE];
+        size_t stepped = 0;
+        if (check) {
+            std::memcpy(sample_tweak, tweak, AES_BLOCK_SIZE);
+        }
+        size_t done = 0;
+        for (size_t sample = check ? check->pick(num_blocks) : num_blocks; sample < num_blocks;
+             sample = check->next(sample, num_blocks)) {
+            // Run up to and including the sampled block, with its input
+            // copied first, since in and out may be the same buffer
+            uint8_t sample_in[AES_BLOCK_SIZE];
+            std::memcpy(sample_in, in + sample * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+            xts_blocks_aesni(round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE, sample + 1 - done,
+                             tweak, decrypt);
+            for (; stepped < sample; stepped++) {
+                mul_alpha(sample_tweak);
+            }
+
+            // The block cipher's own input and output
+            uint8_t sample_out[AES_BLOCK_SIZE];
+            for (int b = 0; b < AES_BLOCK_SIZE; b++) {
+                sample_in[b] ^= sample_tweak[b];
+                sample_out[b] = out[sample * AES_BLOCK_SIZE + b] ^ sample_tweak[b];
+            }
+            check->submit(AesCheckedEngine::XTS, decrypt ? AesOperation::DECRYPT : AesOperation::ENCRYPT,
+                          m_data.round_keys().round_keys[0].data.data(), sample_in, sample_out);
+            done = sample + 1;
+        }
+        xts_blocks_aesni(round_keys, in + done * AES_BLOCK_SIZE, out + done * AES_BLOCK_SIZE, num_blocks - done,
+                         tweak, decrypt);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < num_blocks; i++) {
+        AesBlock block(in + i * AES_BLOCK_SIZE);
+        AesBlock t(tweak);
+        block = decrypt ? AesCipher::decrypt_block(block ^ t, m_data.round_keys()) :
+                          AesCipher::encrypt_block(block ^ t, m_data.round_keys());
+        block = block ^ t;
+        std::memcpy(out + i * AES_BLOCK_SIZE, block.data.data(), AES_BLOCK_SIZE);
+        mul_alpha(tweak);
+    }
+}
+
+// C interface
+
+extern "C" aes_xts_key* aes_xts_key_create(const uint8_t* data_key, const uint8_t* tweak_key) {
+    if (!data_key || !tweak_key) {
+        return nullptr;
+    }
+    return new (std::nothrow) aes_xts_key{AesXts(AesKey(data_key), AesKey(tweak_key))};
+}
+
+extern "C" void aes_xts_key_destroy(aes_xts_key* key) {
+    delete key;
+}
+
+static int xts_check_args(const aes_xts_key* key, const uint8_t* in, uint8_t* out,
+                          size_t sector_size, size_t num_sectors) {
+    if (!key || sector_size < AES_CIPHER_BLOCK_SIZE || ((!in || !out) && num_sectors > 0)) {
+        return AES_CIPHER_EINVAL;
+    }
+    return AES_CIPHER_OK;
+}
+
+extern "C" int aes_xts_encrypt_sectors(const aes_xts_key* key, const uint8_t* in, uint8_t* out,
+                                       size_t sector_size, size_t num_sectors, uint64_t first_sector,
+                                       unsigned num_threads) {
+    int status = xts_check_args(key, in, out, sector_size, num_sectors);
+    if (status == AES_CIPHER_OK) {
+        key->xts.encrypt_sectors(in, out, sector_size, num_sectors, first_sector, num_threads);
+    }
+    return status;
+}
+
+extern "C" int aes_xts_decrypt_sectors(const aes_xts_key* key, const uint8_t* in, uint8_t* out,
+                                       size_t sector_size, size_t num_sectors, uint64_t first_sector,
+                                       unsigned num_threads) {
+    int status = xts_check_args(key, in, out, sector_size, num_sectors);
+    if (status == AES_CIPHER_OK) {
+        key->xts.decrypt_sectors(in, out, sector_size, num_sectors, first_sector, num_threads);
+    }
+    return status;
+}
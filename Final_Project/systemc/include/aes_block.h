@@ -0,0 +1,109 @@
+#ifndef AES_BLOCK_H
+#define AES_BLOCK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Plain AES data types shared by the SystemC model and the standalone
+// cipher library. Nothing here depends on SystemC.
+
+// Define AES constants
+constexpr int AES_BLOCK_SIZE = 16;  // 128 bits = 16 bytes
+constexpr int AES_KEY_SIZE = 16;    // 128 bits = 16 bytes
+constexpr int AES_NUM_ROUNDS = 10;  // For AES-128
+
+// Define operation modes
+enum class AesOperation {
+    ENCRYPT,
+    DECRYPT
+};
+
+// Define processing modes
+enum class AesMode {
+    PIPELINED,
+    NON_PIPELINED
+};
+
+// Lowercase hex of a few bytes, for printing. Bulk conversion is in
+// aes_hex.h, which this header does not pull in.
+inline std::string aes_block_hex(const uint8_t* bytes, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * length, '0');
+    for (size_t i = 0; i < length; i++) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+// Define a structure for AES data blocks
+struct AesBlock {
+    std::array<uint8_t, AES_BLOCK_SIZE> data;
+    
+    // Default constructor initializes to zero
+    AesBlock() {
+        data.fill(0);
+    }
+    
+    // Constructor from raw data
+    AesBlock(const uint8_t* raw_data) {
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            data[i] = raw_data[i];
+        }
+    }
+    
+    // XOR operator for AddRoundKey
+    AesBlock operator^(const AesBlock& other) const {
+        AesBlock result;
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            result.data[i] = data[i] ^ other.data[i];
+        }
+        return result;
+    }
+    
+    // Equality operator for testing
+    bool operator==(const AesBlock& other) const {
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            if (data[i] != other.data[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Print the block as a hex string
+    std::string to_string() const {
+        return aes_block_hex(data.data(), AES_BLOCK_SIZE);
+    }
+};
+
+// Define a structure for AES key
+struct AesKey {
+    std::array<uint8_t, AES_KEY_SIZE> key;
+    
+    // Default constructor initializes to zero
+    AesKey() {
+        key.fill(0);
+    }
+    
+    // Constructor from raw data
+    AesKey(const uint8_t* raw_key) {
+        for (int i = 0; i < AES_KEY_SIZE; i++) {
+            key[i] = raw_key[i];
+        }
+    }
+    
+    // Print the key as a hex string
+    std::string to_string() const {
+        return aes_block_hex(key.data(), AES_KEY_SIZE);
+    }
+};
+
+// Define a structure for AES round keys
+struct AesRoundKeys {
+    std::array<AesBlock, AES_NUM_ROUNDS + 1> round_keys;
+};
+
+#endif // AES_BLOCK_H
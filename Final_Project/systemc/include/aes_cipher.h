@@ -0,0 +1,192 @@
+#ifndef AES_CIPHER_H
+#define AES_CIPHER_H
+
+#include "aes_block.h"
+#include "aes_sbox.h"
+#include "aes_shift_rows.h"
+#include "aes_mix_columns.h"
+#include "aes_key_batch.h"
+#include <cstddef>
+
+class AesCrossCheck;
+
+// The AES-128 algorithm without any SystemC dependency. AesKeyExpansion,
+// AesRound and AesTop wrap these functions in TLM modules; services that
+// only need the cipher use them directly, or link libaes_cipher for the
+// batch API below.
+class AesCipher {
+public:
+    // Expand a key into the 11 round keys
+    static void expand_key(const AesKey& key, AesRoundKeys& round_keys) {
+        // The first round key is the key itself
+        for (int i = 0; i < AES_KEY_SIZE; i++) {
+            round_keys.round_keys[0].data[i] = key.key[i];
+        }
+        
+        // Rcon values used in key expansion
+        static const uint8_t rcon[10] = {
+            0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36
+        };
+        
+        // Generate the remaining round keys
+        for (int i = 1; i <= AES_NUM_ROUNDS; i++) {
+            // Copy the previous round key
+            AesBlock& prev_key = round_keys.round_keys[i-1];
+            AesBlock& curr_key = round_keys.round_keys[i];
+            
+            // Perform the core key schedule transformation
+            // 1. Rotate the last word
+            uint8_t temp[4];
+            temp[0] = prev_key.data[13]; // Rotate: take from 1,3
+            temp[1] = prev_key.data[14]; // Rotate: take from 2,3
+            temp[2] = prev_key.data[15]; // Rotate: take from 3,3
+            temp[3] = prev_key.data[12]; // Rotate: take from 0,3
+            
+            // 2. Apply S-box to all bytes in the rotated word
+            for (int j = 0; j < 4; j++) {
+                temp[j] = AesSBox::substitute(temp[j]);
+            }
+            
+            // 3. XOR with Rcon in the first byte
+            temp[0] ^= rcon[i-1];
+            
+            // 4. Generate the first word of the new round key
+            curr_key.data[0] = prev_key.data[0] ^ temp[0];
+            curr_key.data[1] = prev_key.data[1] ^ temp[1];
+            curr_key.data[2] = prev_key.data[2] ^ temp[2];
+            curr_key.data[3] = prev_key.data[3] ^ temp[3];
+            
+            // 5. Generate the remaining words
+            for (int j = 1; j < 4; j++) {
+                curr_key.data[j*4 + 0] = prev_key.data[j*4 + 0] ^ curr_key.data[(j-1)*4 + 0];
+                curr_key.data[j*4 + 1] = prev_key.data[j*4 + 1] ^ curr_key.data[(j-1)*4 + 1];
+                curr_key.data[j*4 + 2] = prev_key.data[j*4 + 2] ^ curr_key.data[(j-1)*4 + 2];
+                curr_key.data[j*4 + 3] = prev_key.data[j*4 + 3] ^ curr_key.data[(j-1)*4 + 3];
+            }
+        }
+    }
+    
+    // One round of encryption
+    static AesBlock encrypt_round(const AesBlock& block, const AesBlock& round_key, bool is_final_round) {
+        // 1. SubBytes
+        AesBlock after_sub_bytes = AesSBox::sub_bytes(block);
+        
+        // 2. ShiftRows
+        AesBlock after_shift_rows = AesShiftRows::shift_rows(after_sub_bytes);
+        
+        // 3. MixColumns (skipped in final round)
+        AesBlock after_mix_columns;
+        if (is_final_round) {
+            after_mix_columns = after_shift_rows;
+        } else {
+            after_mix_columns = AesMixColumns::mix_columns(after_shift_rows);
+        }
+        
+        // 4. AddRoundKey
+        return after_mix_columns ^ round_key;
+    }
+    
+    // One round of decryption
+    static AesBlock decrypt_round(const AesBlock& block, const AesBlock& round_key, bool is_first_round) {
+        // 1. InvShiftRows
+        AesBlock after_inv_shift_rows = AesShiftRows::inv_shift_rows(block);
+        
+        // 2. InvSubBytes
+        AesBlock after_inv_sub_bytes = AesSBox::inv_sub_bytes(after_inv_shift_rows);
+        
+        // 3. AddRoundKey
+        AesBlock after_add_round_key = after_inv_sub_bytes ^ round_key;
+        
+        // 4. InvMixColumns (skipped in first round)
+        if (is_first_round) {
+            return after_add_round_key;
+        } else {
+            return AesMixColumns::inv_mix_columns(after_add_round_key);
+        }
+    }
+    
+    // Encrypt one block with an expanded key
+    static AesBlock encrypt_block(const AesBlock& block, const AesRoundKeys& round_keys) {
+        AesBlock state = block ^ round_keys.round_keys[0];
+        for (int i = 1; i < AES_NUM_ROUNDS; i++) {
+            state = encrypt_round(state, round_keys.round_keys[i], false);
+        }
+        return encrypt_round(state, round_keys.round_keys[AES_NUM_ROUNDS], true);
+    }
+    
+    // Decrypt one block with an expanded key
+    static AesBlock decrypt_block(const AesBlock& block, const AesRoundKeys& round_keys) {
+        AesBlock state = block ^ round_keys.round_keys[AES_NUM_ROUNDS];
+        for (int i = AES_NUM_ROUNDS - 1; i > 0; i--) {
+            state = decrypt_round(state, round_keys.round_keys[i], false);
+        }
+        return decrypt_round(state, round_keys.round_keys[0], true);
+    }
+};
+
+// Expanded schedule of one AES-128 key, built once and then only read. All
+// methods are const and touch no shared state, so one schedule can be used
+// by any number of threads at the same time.
+//
+// Defined in cipher/aes_cipher.cpp (libaes_cipher).
+class AesKeySchedule {
+public:
+    // Schedule of the all-zero key
+    AesKeySchedule();
+    
+    // Expand a key. The kernel picks the bulk block path; AUTO uses AES-NI
+    // when the CPU has it.
+    explicit AesKeySchedule(const AesKey& key, AesKeyKernel kernel = AesKeyKernel::AUTO);
+    explicit AesKeySchedule(const uint8_t* key, AesKeyKernel kernel = AesKeyKernel::AUTO);
+    
+    // Wrap round keys that were already expanded (e.g. by AesKeyBatch)
+    explicit AesKeySchedule(const AesRoundKeys& round_keys, AesKeyKernel kernel = AesKeyKernel::AUTO);
+    
+    // Wrap both halves of a stored schedule (e.g. from AesKeyStore), so
+    // not even the inverse round keys are recomputed
+    AesKeySchedule(const AesRoundKeys& round_keys, const AesRoundKeys& inv_round_keys,
+                   AesKeyKernel kernel = AesKeyKernel::AUTO);
+    
+    // Expand count keys at once with AesKeyBatch
+    static void expand_batch(const AesKey* keys, AesKeySchedule* schedules, size_t count,
+                             AesKeyKernel kernel = AesKeyKernel::AUTO);
+    
+    const AesRoundKeys& round_keys() const { return m_round_keys; }
+    const AesRoundKeys& inv_round_keys() const { return m_inv_round_keys; }
+    AesKeyKernel kernel() const { return m_kernel; }
+    
+    // Encrypt or decrypt num_blocks independent 16-byte blocks (ECB).
+    // in and out may be the same buffer.
+    void encrypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks) const;
+    void decrypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks) const;
+
+    // CBC over num_blocks blocks. iv is updated to the last ciphertext
+    // block, so a stream can be continued with another call.
+    void cbc_encrypt(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* iv) const;
+    void cbc_decrypt(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* iv) const;
+
+    // CTR (SP 800-38A) over length bytes; the 16-byte counter block is
+    // incremented as one big-endian number and left at the next unused value.
+    // Encryption and decryption are the same operation.
+    void ctr_crypt(const uint8_t* in, uint8_t* out, size_t length, uint8_t* counter) const;
+
+private:
+    AesRoundKeys m_round_keys;      // Encryption order
+    AesRoundKeys m_inv_round_keys;  // InvMixColumns of rounds 1-9, for AESDEC
+    AesKeyKernel m_kernel;
+    
+    void init(AesKeyKernel kernel);
+    void encrypt_blocks_checked(AesCrossCheck& check, const uint8_t* in, uint8_t* out, size_t num_blocks) const;
+    void decrypt_blocks_checked(AesCrossCheck& check, const uint8_t* in, uint8_t* out, size_t num_blocks) const;
+};
+
+// Batch API, equivalent to the AesKeySchedule methods
+inline void aes_encrypt_blocks(const AesKeySchedule& schedule, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    schedule.encrypt_blocks(in, out, num_blocks);
+}
+
+inline void aes_decrypt_blocks(const AesKeySchedule& schedule, const uint8_t* in, uint8_t* out, size_t num_blocks) {
+    schedule.decrypt_blocks(in, out, num_blocks);
+}
+
+#endif // AES_CIPHER_H
@@ -0,0 +1,188 @@
+#ifndef AES_CIPHER_C_H
+#define AES_CIPHER_C_H
+
+/*
+ * C interface of libaes_cipher, the AES-128 cipher without SystemC.
+ *
+ * A key schedule is created once per key and is read-only afterwards, so any
+ * number of threads may encrypt and decrypt with the same schedule at the
+ * same time.
+ *
+ * The one piece of global state is the cross-check (aes_cross_check.h):
+ * while an AesCrossCheck is installed, it is process-wide and intercepts the
+ * AES-NI block, XTS and multi-buffer calls of every thread, and each thread
+ * keeps a countdown to its next sampled block.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_CIPHER_BLOCK_SIZE 16
+#define AES_CIPHER_KEY_SIZE 16
+
+/* Return codes */
+#define AES_CIPHER_OK 0
+#define AES_CIPHER_EINVAL (-1) /* NULL schedule or buffer, or bad size */
+#define AES_CIPHER_ENOMEM (-2) /* Allocation failed */
+#define AES_CIPHER_EBUSY (-3)  /* Job ring full */
+#define AES_CIPHER_EIO (-4)    /* Key store missing, unreadable or malformed */
+#define AES_CIPHER_EVERSION (-5) /* Key store written by another format version */
+#define AES_CIPHER_ERESEED (-6)  /* DRBG reseed interval used up */
+
+/* Opaque expanded key */
+typedef struct aes_key_schedule aes_key_schedule;
+
+/* Expand a 16-byte key. Returns NULL if key is NULL or memory runs out. */
+aes_key_schedule* aes_key_schedule_create(const uint8_t* key);
+
+/* Expand count keys at once (count * 16 bytes) into schedules[0..count-1].
+ * On error no schedules are left allocated. */
+int aes_key_schedule_create_batch(const uint8_t* keys, size_t count, aes_key_schedule** schedules);
+
+/* Free a schedule; NULL is ignored */
+void aes_key_schedule_destroy(aes_key_schedule* schedule);
+
+/* Encrypt or decrypt num_blocks independent 16-byte blocks (ECB). in and out
+ * may point to the same buffer. */
+int aes_encrypt_blocks(const aes_key_schedule* schedule, const uint8_t* in, uint8_t* out, size_t num_blocks);
+int aes_decrypt_blocks(const aes_key_schedule* schedule, const uint8_t* in, uint8_t* out, size_t num_blocks);
+
+/* Name of the block kernel the schedule uses ("scalar" or "aesni") */
+const char* aes_key_schedule_kernel(const aes_key_schedule* schedule);
+
+/* In-place encryption of a buffer given as iovcnt segments (struct iovec
+ * from <sys/uio.h>). Blocks may straddle segments, and segments may be
+ * empty. ECB and CBC need a multiple of 16 bytes in total; CTR takes any
+ * length. iv and counter are updated so the stream can continue. */
+struct iovec;
+int aes_iov_encrypt_blocks(const aes_key_schedule* schedule, const struct iovec* iov, size_t iovcnt);
+int aes_iov_decrypt_blocks(const aes_key_schedule* schedule, const struct iovec* iov, size_t iovcnt);
+int aes_iov_cbc_encrypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t iovcnt, uint8_t* iv);
+int aes_iov_cbc_decrypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t iovcnt, uint8_t* iv);
+int aes_iov_ctr_crypt(const aes_key_schedule* schedule, const struct iovec* iov, size_t iovcnt, uint8_t* counter);
+
+/* Persistent key store: schedules expanded once and written to a file,
+ * which processes then map read-only and share through the page cache.
+ * Key IDs must be unique; keys holds count * 16 bytes. The file is replaced
+ * atomically. */
+typedef struct aes_key_store aes_key_store;
+
+int aes_key_store_write(const char* path, const uint64_t* key_ids, const uint8_t* keys, size_t count);
+
+/* Map a store. Returns NULL on failure; status (if not NULL) receives
+ * AES_CIPHER_OK, AES_CIPHER_EIO, AES_CIPHER_EVERSION or AES_CIPHER_ENOMEM. */
+aes_key_store* aes_key_store_open(const char* path, int* status);
+
+/* Unmap a store; NULL is ignored. Schedules already taken from it stay valid. */
+void aes_key_store_close(aes_key_store* store);
+
+size_t aes_key_store_count(const aes_key_store* store);
+
+/* New schedule for a stored key, without expansion; free it with
+ * aes_key_schedule_destroy. Returns NULL if the ID is not in the store. */
+aes_key_schedule* aes_key_store_get(const aes_key_store* store, uint64_t key_id);
+
+/* CTR_DRBG (SP 800-90A) over AES-128. An instance is not locked: use one
+ * per thread. use_df selects the derivation function; with it, entropy is
+ * at least 16 bytes and the nonce at least 8, without it entropy is exactly
+ * 32 bytes and there is no nonce. Returns NULL on failure; status (if not
+ * NULL) receives AES_CIPHER_OK, AES_CIPHER_EINVAL or AES_CIPHER_ENOMEM. */
+typedef struct aes_ctr_drbg aes_ctr_drbg;
+
+aes_ctr_drbg* aes_ctr_drbg_create(const uint8_t* entropy, size_t entropy_len, const uint8_t* nonce,
+                                  size_t nonce_len, const uint8_t* personalization, size_t personalization_len,
+                                  int use_df, int* status);
+
+/* Wipe and free a DRBG; NULL is ignored */
+void aes_ctr_drbg_destroy(aes_ctr_drbg* drbg);
+
+int aes_ctr_drbg_reseed(aes_ctr_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+                        const uint8_t* additional, size_t additional_len);
+
+/* At most 65536 bytes per call. Returns AES_CIPHER_ERESEED when the
+ * instance must be reseeded first. */
+int aes_ctr_drbg_generate(aes_ctr_drbg* drbg, uint8_t* out, size_t length, const uint8_t* additional,
+                          size_t additional_len);
+
+/* Random bytes from a per-thread DRBG seeded from the operating system,
+ * with small requests served from a buffer. Any length. */
+int aes_random_bytes(uint8_t* out, size_t length);
+
+/* Opaque XTS key pair (IEEE 1619, XTS-AES-128) */
+typedef struct aes_xts_key aes_xts_key;
+
+/* Expand a 16-byte data key and a 16-byte tweak key. Returns NULL if either
+ * key is NULL or memory runs out. */
+aes_xts_key* aes_xts_key_create(const uint8_t* data_key, const uint8_t* tweak_key);
+
+/* Free an XTS key; NULL is ignored */
+void aes_xts_key_destroy(aes_xts_key* key);
+
+/* Encrypt or decrypt num_sectors consecutive sectors of sector_size bytes,
+ * the first one numbered first_sector. sector_size must be at least 16 and
+ * need not be a multiple of 16 (ciphertext stealing). Sectors are spread
+ * over up to num_threads threads; 0 uses every hardware thread. in and out
+ * may point to the same buffer. */
+int aes_xts_encrypt_sectors(const aes_xts_key* key, const uint8_t* in, uint8_t* out, size_t sector_size,
+                            size_t num_sectors, uint64_t first_sector, unsigned num_threads);
+int aes_xts_decrypt_sectors(const aes_xts_key* key, const uint8_t* in, uint8_t* out, size_t sector_size,
+                            size_t num_sectors, uint64_t first_sector, unsigned num_threads);
+
+/* Asynchronous job ring: jobs are posted without blocking, run by worker
+ * threads, and reaped from a completion ring. Buffers and keys must stay
+ * valid until the job's completion has been reaped. */
+typedef struct aes_job_ring aes_job_ring;
+
+#define AES_CIPHER_MODE_ECB 0
+#define AES_CIPHER_MODE_CBC 1
+#define AES_CIPHER_MODE_CTR 2
+#define AES_CIPHER_MODE_XTS 3
+
+#define AES_CIPHER_ENCRYPT 0
+#define AES_CIPHER_DECRYPT 1
+
+typedef struct aes_job {
+    int mode;                      /* AES_CIPHER_MODE_* */
+    int operation;                 /* AES_CIPHER_ENCRYPT or AES_CIPHER_DECRYPT */
+    const aes_key_schedule* key;   /* ECB, CBC and CTR */
+    const aes_xts_key* xts_key;    /* XTS */
+    const uint8_t* in;
+    uint8_t* out;                  /* May equal in */
+    size_t length;                 /* Multiple of 16 for ECB and CBC, >= 16 for XTS */
+    uint8_t iv[AES_CIPHER_BLOCK_SIZE]; /* CBC IV, CTR counter, XTS sector (little-endian) */
+    uint64_t user_data;            /* Returned in the completion */
+} aes_job;
+
+typedef struct aes_completion {
+    uint64_t user_data;
+    int status;                    /* AES_CIPHER_OK or AES_CIPHER_EINVAL */
+} aes_completion;
+
+/* Create a ring with room for entries jobs in flight (rounded up to a power
+ * of two) and num_workers worker threads. Returns NULL on failure. */
+aes_job_ring* aes_job_ring_create(size_t entries, unsigned num_workers);
+
+/* Run the jobs already submitted, stop the workers and free the ring */
+void aes_job_ring_destroy(aes_job_ring* ring);
+
+/* Post up to count jobs without blocking. Returns how many were accepted;
+ * fewer than count means the ring is full. */
+size_t aes_job_ring_submit(aes_job_ring* ring, const aes_job* jobs, size_t count);
+
+/* Reap up to max completions. poll never blocks; wait blocks until at least
+ * one completion arrives or timeout_ms passes (-1 waits forever). */
+size_t aes_job_ring_poll(aes_job_ring* ring, aes_completion* completions, size_t max);
+size_t aes_job_ring_wait(aes_job_ring* ring, aes_completion* completions, size_t max, int timeout_ms);
+
+/* eventfd that becomes readable when completions are pending */
+int aes_job_ring_event_fd(const aes_job_ring* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AES_CIPHER_C_H */
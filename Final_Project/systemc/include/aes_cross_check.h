@@ -0,0 +1,192 @@
+#ifndef AES_CROSS_CHECK_H
+#define AES_CROSS_CHECK_H
+
+#include "aes_block.h"
+#include "aes_job_ring.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Sampled verification of the fast engines against the reference cipher.
+// While a checker is installed, the AES-NI engines hand one block in every
+// rate blocks they process (per thread) to it: the key, the block that went
+// into the cipher and the block that came out. A background thread runs the
+// block again through AesCipher::encrypt_block or decrypt_block, the
+// byte-wise rounds AesRound and AesTop::process_non_pipelined are built on,
+// with a key schedule expanded by AesCipher::expand_key, and compares.
+//
+// The engines and what they hand over:
+//   BLOCKS        AesKeySchedule::encrypt_blocks / decrypt_blocks, and with
+//                 them ECB, CBC, CTR and everything built on those
+//   XTS           AesXts sectors: data block XOR tweak in and out, with the
+//                 tweak recomputed byte-wise, so the alpha chain is checked
+//   MULTI_BUFFER  The interleaved CBC and CMAC lanes of AesMultiBuffer
+// The scalar kernels are the reference itself and are never sampled.
+//
+// The engines only pay for an acquire load when no checker is installed.
+// When one is, they hold an AesCrossCheck::Ref for the length of the call,
+// which counts them in one of two reader slots, and keep a per-thread
+// countdown. uninstall() and the destructor flip the slots twice and wait
+// for each to empty, as SRCU does, so a checker is never freed under an
+// engine that is still sampling into it. Samples go through a bounded
+// lock-free queue that the background thread empties in batches, and one
+// that finds it full is dropped and counted rather than making the engine
+// wait. Every mismatch is counted per engine and
+// appended to the repro file as an ECB vector in the CAVP layout, with the
+// reference output as the expected text and the engine's output in a
+// comment, so aes_vector_import and aes_vector_check replay it.
+//
+// Defined in cipher/aes_cross_check.cpp (libaes_cipher).
+
+enum class AesCheckedEngine {
+    BLOCKS,
+    XTS,
+    MULTI_BUFFER
+};
+
+constexpr size_t AES_CHECKED_ENGINES = 3;
+
+inline const char* aes_checked_engine_name(AesCheckedEngine engine) {
+    switch (engine) {
+        case AesCheckedEngine::BLOCKS:       return "blocks-aesni";
+        case AesCheckedEngine::XTS:          return "xts-aesni";
+        case AesCheckedEngine::MULTI_BUFFER: return "multi-buffer-aesni";
+        default:                             return "unknown";
+    }
+}
+
+struct AesCrossCheckStats {
+    std::array<uint64_t, AES_CHECKED_ENGINES> sampled{};      // Queued for checking
+    std::array<uint64_t, AES_CHECKED_ENGINES> mismatches{};
+    uint64_t checked = 0;
+    uint64_t dropped = 0;           // Queue full
+    uint64_t repro_errors = 0;      // Mismatches the repro file could not take
+
+    uint64_t total_sampled() const { return sampled[0] + sampled[1] + sampled[2]; }
+    uint64_t total_mismatches() const { return mismatches[0] + mismatches[1] + mismatches[2]; }
+};
+
+class AesCrossCheck {
+public:
+    // Check one block in every rate (at least 1). Mismatches are appended to
+    // repro_path unless it is empty. queue_entries is rounded up to a power
+    // of two and bounds the samples waiting for the background thread.
+    explicit AesCrossCheck(uint64_t rate = 1000000, const std::string& repro_path = "",
+                           size_t queue_entries = 1024);
+
+    // Uninstalls the checker if it is installed and waits out the engine
+    // calls still holding it, checks every queued sample, then stops the
+    // thread
+    ~AesCrossCheck();
+
+    AesCrossCheck(const AesCrossCheck&) = delete;
+    AesCrossCheck& operator=(const AesCrossCheck&) = delete;
+
+    // Make this the checker the engines report to, replacing any other, or
+    // stop them reporting to it. uninstall returns once no engine call that
+    // picked this checker up is still running, so it must not be called
+    // from inside one.
+    void install();
+    void uninstall();
+
+    // The installed checker, or null. For inspection only: a checker may be
+    // uninstalled and freed once this returns, so engines take a Ref.
+    static AesCrossCheck* installed() { return s_installed.load(std::memory_order_acquire); }
+
+    // The installed checker, kept alive until the Ref goes out of scope.
+    // Taken once per engine call; converts to false when none is installed.
+    class Ref {
+    public:
+        Ref() : m_check(nullptr), m_slot(0) {
+            if (s_installed.load(std::memory_order_acquire)) {
+                m_check = acquire(m_slot);
+            }
+        }
+        ~Ref() {
+            if (m_check) {
+                release(m_slot);
+            }
+        }
+
+        Ref(const Ref&) = delete;
+        Ref& operator=(const Ref&) = delete;
+
+        explicit operator bool() const { return m_check != nullptr; }
+        AesCrossCheck& operator*() const { return *m_check; }
+        AesCrossCheck* operator->() const { return m_check; }
+
+    private:
+        AesCrossCheck* m_check;
+        unsigned m_slot;
+    };
+
+    uint64_t rate() const { return m_rate; }
+
+    // Called by an engine before a call of num_blocks blocks: the index of
+    // the first block to check, or num_blocks for none. Every rate()-th
+    // block after it is checked too; next gives them in turn, then
+    // num_blocks.
+    size_t pick(size_t num_blocks) const;
+    size_t next(size_t sample, size_t num_blocks) const {
+        return (num_blocks - sample > m_rate) ? static_cast<size_t>(sample + m_rate) : num_blocks;
+    }
+
+    // Queue one block-cipher computation for checking. Never blocks.
+    void submit(AesCheckedEngine engine, AesOperation operation, const uint8_t* key, const uint8_t* in,
+                const uint8_t* out);
+
+    // Wait until every sample submitted so far has been checked
+    void drain();
+
+    AesCrossCheckStats stats() const;
+
+private:
+    struct Sample {
+        AesCheckedEngine engine;
+        AesOperation operation;
+        uint8_t key[AES_KEY_SIZE];
+        uint8_t in[AES_BLOCK_SIZE];
+        uint8_t out[AES_BLOCK_SIZE];
+    };
+
+    static inline std::atomic<AesCrossCheck*> s_installed{nullptr};
+
+    static AesCrossCheck* acquire(unsigned& slot);
+    static void release(unsigned slot);
+    static void quiesce();
+
+    uint64_t m_rate;
+    bool m_repro;                   // A repro path was given
+    int m_repro_fd;
+    AesMpmcRing<Sample> m_queue;
+    std::array<std::atomic<uint64_t>, AES_CHECKED_ENGINES> m_sampled{};
+    std::array<std::atomic<uint64_t>, AES_CHECKED_ENGINES> m_mismatches{};
+    std::atomic<uint64_t> m_checked{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_repro_errors{0};
+
+    // Sleep and wakeup as in AesJobRing: m_queued counts samples claimed by
+    // submitters, which only take the mutex to wake the thread once the
+    // queue is half full. Otherwise it checks what has gathered every few
+    // milliseconds, or when drain() asks.
+    std::atomic<size_t> m_queued{0};
+    size_t m_wake_threshold;
+    std::atomic<bool> m_sleeping{false};
+    std::atomic<bool> m_stopping{false};
+    unsigned m_draining = 0;        // Under m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_drained;
+    std::thread m_thread;
+
+    void run();
+    void check(const Sample& sample);
+    void write_repro(const Sample& sample, const AesBlock& expected, uint64_t id);
+};
+
+#endif // AES_CROSS_CHECK_H
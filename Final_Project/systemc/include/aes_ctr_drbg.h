@@ -0,0 +1,91 @@
+#ifndef AES_CTR_DRBG_H
+#define AES_CTR_DRBG_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <cstddef>
+#include <cstdint>
+
+// CTR_DRBG (NIST SP 800-90A Rev. 1, section 10.2) over AES-128, with or
+// without the derivation function. The library only has AES-128, so the
+// security strength is 128 bits; prediction resistance is not offered, so
+// fresh entropy comes in only through reseed.
+//
+// generate() produces the whole request as one CTR keystream run through
+// the bulk kernel, so a large request costs about as much as encrypting the
+// same number of bytes. The key changes after every request, which is one
+// key expansion per call: ask for many bytes at a time, or use
+// aes_random_bytes, which refills a per-thread buffer in large requests.
+//
+// An AesCtrDrbg holds state that every call changes and has no lock; give
+// each thread its own instance. Defined in cipher/aes_ctr_drbg.cpp
+// (libaes_cipher).
+
+constexpr size_t AES_DRBG_SEED_LEN = 32;                // seedlen: key + V
+constexpr size_t AES_DRBG_MAX_REQUEST = 65536;          // 2^19 bits per generate
+constexpr uint64_t AES_DRBG_RESEED_INTERVAL = 1ull << 48;
+
+class AesCtrDrbg {
+public:
+    // Uninstantiated: generate and reseed fail until instantiate succeeds
+    explicit AesCtrDrbg(bool use_df = true);
+    ~AesCtrDrbg();
+
+    AesCtrDrbg(const AesCtrDrbg&) = delete;
+    AesCtrDrbg& operator=(const AesCtrDrbg&) = delete;
+
+    // Instantiate from entropy, a nonce and an optional personalization
+    // string. With the derivation function: entropy at least 16 bytes and
+    // the nonce at least 8. Without it: entropy exactly 32 bytes, no nonce,
+    // personalization at most 32 bytes. Returns AES_CIPHER_OK or
+    // AES_CIPHER_EINVAL (the state is then left uninstantiated).
+    int instantiate(const uint8_t* entropy, size_t entropy_len, const uint8_t* nonce, size_t nonce_len,
+                    const uint8_t* personalization, size_t personalization_len);
+
+    // Mix in fresh entropy and reset the reseed counter. Length rules as
+    // for instantiate; additional input is at most 32 bytes without the
+    // derivation function.
+    int reseed(const uint8_t* entropy, size_t entropy_len, const uint8_t* additional = nullptr,
+               size_t additional_len = 0);
+
+    // Fill out with length bytes (at most AES_DRBG_MAX_REQUEST). Returns
+    // AES_CIPHER_OK, AES_CIPHER_EINVAL or AES_CIPHER_ERESEED once the
+    // reseed interval is used up.
+    int generate(uint8_t* out, size_t length, const uint8_t* additional = nullptr, size_t additional_len = 0);
+
+    // Wipe the state back to uninstantiated
+    void uninstantiate();
+
+    bool instantiated() const { return m_instantiated; }
+    bool use_df() const { return m_use_df; }
+    uint64_t reseed_counter() const { return m_reseed_counter; }
+
+    // Lower the reseed interval below the standard's 2^48 (tests, or a
+    // policy of reseeding more often)
+    void set_reseed_interval(uint64_t interval) { m_reseed_interval = interval; }
+
+private:
+    bool m_use_df;
+    bool m_instantiated;
+    AesKeySchedule m_key;
+    uint8_t m_v[AES_BLOCK_SIZE];
+    uint64_t m_reseed_counter;
+    uint64_t m_reseed_interval;
+
+    void update(const uint8_t* provided);
+    void keystream(uint8_t* out, size_t length);
+    bool seed_material(const uint8_t* a, size_t a_len, const uint8_t* b, size_t b_len,
+                       const uint8_t* c, size_t c_len, uint8_t* seed) const;
+};
+
+// Fill out from the calling thread's own DRBG, seeded from getrandom(2)
+// on first use and reseeded from it when the interval runs out. Small
+// requests (IVs, nonces) are served from a buffer that is refilled with
+// one large generate and wiped as it is handed out; requests larger than
+// the buffer go straight to generate. A child process after fork shares
+// the parent's buffer and state, so it must not call this before exec.
+// Returns AES_CIPHER_OK, or AES_CIPHER_EIO if the system entropy source
+// fails. Also part of the C interface.
+extern "C" int aes_random_bytes(uint8_t* out, size_t length);
+
+#endif // AES_CTR_DRBG_H
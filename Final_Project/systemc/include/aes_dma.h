@@ -0,0 +1,533 @@
+#ifndef AES_DMA_H
+#define AES_DMA_H
+
+#include "aes_types.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Descriptor-ring DMA engine in front of AesTop. Software fills a ring of
+// descriptors in memory, loads keys into key slots and writes the ring's
+// head index to a doorbell register. The engine then runs three stages
+// as separate threads joined by bounded FIFOs, so they overlap:
+//
+//   fetch      reads each descriptor, then its source data in bursts
+//   encrypt    passes every burst through AesTop
+//   write-back writes the result in bursts, then the descriptor status
+//
+// Completions raise the irq line once per coalesce_count descriptors, or
+// coalesce_timeout after the first unreported one, whichever is first.
+// With no timeout, the line is raised whenever the ring drains instead.
+
+// Register map (32-bit registers)
+constexpr uint64_t AES_DMA_RING_BASE_LO = 0x00;
+constexpr uint64_t AES_DMA_RING_BASE_HI = 0x04;
+constexpr uint64_t AES_DMA_RING_SIZE = 0x08;      // Entries
+constexpr uint64_t AES_DMA_HEAD = 0x0C;           // Doorbell: index after the last posted descriptor
+constexpr uint64_t AES_DMA_TAIL = 0x10;           // Read-only: index after the last completed one
+constexpr uint64_t AES_DMA_IRQ_STATUS = 0x14;     // Bit 0: completions pending, write 1 to clear
+constexpr uint64_t AES_DMA_COALESCE_COUNT = 0x18; // Descriptors per interrupt
+constexpr uint64_t AES_DMA_COALESCE_TIMEOUT = 0x1C; // Clock cycles, 0: raise when the ring drains
+constexpr uint64_t AES_DMA_KEY_SELECT = 0x20;     // Key slot that KEY_DATA writes go to
+constexpr uint64_t AES_DMA_KEY_DATA = 0x24;       // 4 registers, key bytes 0-15 in order; a slot
+                                                  // is loaded once all four have been written
+
+constexpr unsigned AES_DMA_KEY_SLOTS = 16;
+constexpr uint32_t AES_DMA_IRQ_COMPLETION = 0x01;
+
+// Descriptor status, written back by the engine
+constexpr uint32_t AES_DMA_STATUS_PENDING = 0;
+constexpr uint32_t AES_DMA_STATUS_DONE = 1;
+constexpr uint32_t AES_DMA_STATUS_ERROR = 2;  // Length not a multiple of 16, or bad key slot
+
+// One 32-byte ring entry, little-endian in memory:
+// 0 source, 8 destination, 16 length, 20 key slot, 22 operation, 24 status
+struct AesDmaDescriptor {
+    static constexpr unsigned SIZE = 32;
+    static constexpr unsigned STATUS_OFFSET = 24;
+
+    uint64_t source = 0;
+    uint64_t destination = 0;
+    uint32_t length = 0;
+    uint16_t key_slot = 0;
+    AesOperation operation = AesOperation::ENCRYPT;
+    uint32_t status = AES_DMA_STATUS_PENDING;
+
+    void encode(uint8_t* p) const {
+        std::memset(p, 0, SIZE);
+        put(p, source, 8);
+        put(p + 8, destination, 8);
+        put(p + 16, length, 4);
+        put(p + 20, key_slot, 2);
+        p[22] = (operation == AesOperation::DECRYPT) ? 1 : 0;
+        put(p + STATUS_OFFSET, status, 4);
+    }
+
+    static AesDmaDescriptor decode(const uint8_t* p) {
+        AesDmaDescriptor d;
+        d.source = get(p, 8);
+        d.destination = get(p + 8, 8);
+        d.length = static_cast<uint32_t>(get(p + 16, 4));
+        d.key_slot = static_cast<uint16_t>(get(p + 20, 2));
+        d.operation = p[22] ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        d.status = static_cast<uint32_t>(get(p + STATUS_OFFSET, 4));
+        return d;
+    }
+
+    static void put(uint8_t* p, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            p[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    static uint64_t get(const uint8_t* p, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+};
+
+// Memory port timing: one beat per clock once a burst has started, plus a
+// fixed access latency that overlaps other bursts
+struct AesMemoryTiming {
+    sc_core::sc_time clock_period = sc_core::sc_time(10, sc_core::SC_NS);
+    unsigned bus_bytes = 8;
+    unsigned latency_cycles = 20;
+};
+
+// Flat memory with one shared port; reads and writes queue for it in the
+// order they are issued
+class AesMemory : public sc_core::sc_module {
+public:
+    tlm_utils::simple_target_socket<AesMemory> socket;
+
+    SC_HAS_PROCESS(AesMemory);
+    AesMemory(sc_core::sc_module_name name, size_t size, const AesMemoryTiming& timing = AesMemoryTiming()) :
+        sc_core::sc_module(name),
+        socket("socket"),
+        m_data(size, 0),
+        m_timing(timing),
+        m_free(sc_core::SC_ZERO_TIME),
+        m_busy(sc_core::SC_ZERO_TIME) {
+        socket.register_b_transport(this, &AesMemory::b_transport);
+    }
+
+    // Backdoor for software running outside the bus model
+    uint8_t* data(uint64_t address) { return m_data.data() + address; }
+    size_t size() const { return m_data.size(); }
+
+    // Time the port spent moving beats
+    const sc_core::sc_time& busy() const { return m_busy; }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        uint64_t address = trans.get_address();
+        unsigned length = trans.get_data_length();
+        if (address > m_data.size() || length > m_data.size() - address) {
+            trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.is_read()) {
+            std::memcpy(trans.get_data_ptr(), m_data.data() + address, length);
+        } else {
+            std::memcpy(m_data.data() + address, trans.get_data_ptr(), length);
+        }
+
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        sc_core::sc_time ready = now + delay;
+        sc_core::sc_time start = ready < m_free ? m_free : ready;
+        unsigned beats = (length + m_timing.bus_bytes - 1) / m_timing.bus_bytes;
+        sc_core::sc_time transfer = m_timing.clock_period * static_cast<double>(beats);
+        m_free = start + transfer;
+        m_busy += transfer;
+        delay = m_free + m_timing.clock_period * static_cast<double>(m_timing.latency_cycles) - now;
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+private:
+    std::vector<uint8_t> m_data;
+    AesMemoryTiming m_timing;
+    sc_core::sc_time m_free;
+    sc_core::sc_time m_busy;
+};
+
+// Engine and core timing. The defaults are aes_pipelined.v at 100 MHz:
+// one block per clock after an 11-cycle fill.
+struct AesDmaTiming {
+    sc_core::sc_time clock_period = sc_core::sc_time(10, sc_core::SC_NS);
+    unsigned burst_bytes = 256;                         // Multiple of 16
+    unsigned fifo_depth = 4;                            // Bursts buffered between stages
+    unsigned cycles_per_block = 1;                      // 11 for the iterative aes_top.v
+    unsigned core_latency_cycles = AES_NUM_ROUNDS + 1;
+    unsigned key_load_cycles = AES_NUM_ROUNDS;          // Key expansion on a key change
+};
+
+// Time each stage spent working, and what it moved
+struct AesDmaStats {
+    uint64_t descriptors = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t bursts = 0;
+    uint64_t interrupts = 0;
+    sc_core::sc_time fetch_busy = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time encrypt_busy = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time write_back_busy = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time first_doorbell = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time last_completion = sc_core::SC_ZERO_TIME;
+
+    sc_core::sc_time elapsed() const { return last_completion - first_doorbell; }
+};
+
+class AesDmaEngine : public sc_core::sc_module {
+public:
+    // Register bus from the CPU
+    tlm_utils::simple_target_socket<AesDmaEngine> reg_socket;
+
+    // Memory master, and the cipher core (AesTop)
+    tlm_utils::simple_initiator_socket<AesDmaEngine> mem_socket;
+    tlm_utils::simple_initiator_socket<AesDmaEngine> core_socket;
+
+    // Level interrupt, high while IRQ_STATUS has a bit set
+    sc_core::sc_out<bool> irq;
+
+    SC_HAS_PROCESS(AesDmaEngine);
+    AesDmaEngine(sc_core::sc_module_name name, const AesDmaTiming& timing = AesDmaTiming()) :
+        sc_core::sc_module(name),
+        reg_socket("reg_socket"),
+        mem_socket("mem_socket"),
+        core_socket("core_socket"),
+        irq("irq"),
+        m_timing(timing),
+        m_to_core("to_core", timing.fifo_depth),
+        m_to_write_back("to_write_back", timing.fifo_depth),
+        m_ring_base(0),
+        m_ring_size(0),
+        m_head(0),
+        m_fetch(0),
+        m_tail(0),
+        m_irq_status(0),
+        m_coalesce_count(1),
+        m_coalesce_timeout(0),
+        m_key_select(0),
+        m_unreported(0),
+        m_started(false) {
+
+        if (timing.burst_bytes == 0 || timing.burst_bytes % AES_BLOCK_SIZE != 0) {
+            SC_REPORT_ERROR("AesDmaEngine", "Burst size must be a multiple of 16 bytes");
+        }
+        m_key_words.fill(0);
+        m_key_generation.fill(0);
+
+        reg_socket.register_b_transport(this, &AesDmaEngine::reg_transport);
+
+        SC_THREAD(fetch_stage);
+        SC_THREAD(encrypt_stage);
+        SC_THREAD(write_back_stage);
+        SC_THREAD(coalesce_timer);
+    }
+
+    const AesDmaStats& stats() const { return m_stats; }
+    const AesDmaTiming& timing() const { return m_timing; }
+
+    // Register access, 32 bits at a time
+    void reg_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        uint64_t address = trans.get_address();
+        if (trans.get_data_length() != 4 || address % 4 != 0) {
+            trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
+            return;
+        }
+        uint8_t* data = trans.get_data_ptr();
+        if (trans.is_read()) {
+            AesDmaDescriptor::put(data, read_register(address), 4);
+        } else if (!write_register(address, static_cast<uint32_t>(AesDmaDescriptor::get(data, 4)))) {
+            trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+            return;
+        }
+        delay += m_timing.clock_period;
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+private:
+    // One burst on its way through the stages
+    struct Burst {
+        uint32_t index;               // Ring entry
+        AesDmaDescriptor descriptor;
+        uint32_t offset;
+        std::vector<uint8_t> data;
+        bool last;                    // Final burst of its descriptor
+    };
+    using BurstPtr = std::shared_ptr<Burst>;
+
+    AesDmaTiming m_timing;
+    sc_core::sc_fifo<BurstPtr> m_to_core;
+    sc_core::sc_fifo<BurstPtr> m_to_write_back;
+    sc_core::sc_event m_doorbell;
+    sc_core::sc_event m_first_unreported;
+    sc_core::sc_event m_irq_raised;
+
+    uint64_t m_ring_base;
+    uint32_t m_ring_size;
+    uint32_t m_head;
+    uint32_t m_fetch;
+    uint32_t m_tail;
+    uint32_t m_irq_status;
+    uint32_t m_coalesce_count;
+    uint32_t m_coalesce_timeout;
+    uint32_t m_key_select;
+    std::array<AesKey, AES_DMA_KEY_SLOTS> m_keys;
+    std::array<uint8_t, AES_DMA_KEY_SLOTS> m_key_words;         // KEY_DATA registers written, one bit each
+    std::array<uint32_t, AES_DMA_KEY_SLOTS> m_key_generation;   // Bumped on every KEY_DATA write
+    uint32_t m_unreported;
+    bool m_started;
+    AesDmaStats m_stats;
+
+    uint32_t read_register(uint64_t address) const {
+        switch (address) {
+        case AES_DMA_RING_BASE_LO: return static_cast<uint32_t>(m_ring_base);
+        case AES_DMA_RING_BASE_HI: return static_cast<uint32_t>(m_ring_base >> 32);
+        case AES_DMA_RING_SIZE: return m_ring_size;
+        case AES_DMA_HEAD: return m_head;
+        case AES_DMA_TAIL: return m_tail;
+        case AES_DMA_IRQ_STATUS: return m_irq_status;
+        case AES_DMA_COALESCE_COUNT: return m_coalesce_count;
+        case AES_DMA_COALESCE_TIMEOUT: return m_coalesce_timeout;
+        case AES_DMA_KEY_SELECT: return m_key_select;
+        default: return 0;  // Key data is write-only
+        }
+    }
+
+    bool write_register(uint64_t address, uint32_t value) {
+        switch (address) {
+        case AES_DMA_RING_BASE_LO:
+            m_ring_base = (m_ring_base & ~0xFFFFFFFFull) | value;
+            return true;
+        case AES_DMA_RING_BASE_HI:
+            m_ring_base = (m_ring_base & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
+            return true;
+        case AES_DMA_RING_SIZE:
+            m_ring_size = value;
+            m_head = m_fetch = m_tail = 0;
+            return true;
+        case AES_DMA_HEAD:
+            if (m_ring_size == 0 || value >= m_ring_size) {
+                return false;
+            }
+            if (!m_started) {
+                m_stats.first_doorbell = sc_core::sc_time_stamp();
+                m_started = true;
+            }
+            m_head = value;
+            m_doorbell.notify(sc_core::SC_ZERO_TIME);
+            return true;
+        case AES_DMA_IRQ_STATUS:
+            m_irq_status &= ~value;
+            irq.write(m_irq_status != 0);
+            return true;
+        case AES_DMA_COALESCE_COUNT:
+            m_coalesce_count = value ? value : 1;
+            return true;
+        case AES_DMA_COALESCE_TIMEOUT:
+            m_coalesce_timeout = value;
+            return true;
+        case AES_DMA_KEY_SELECT:
+            if (value >= AES_DMA_KEY_SLOTS) {
+                return false;
+            }
+            m_key_select = value;
+            return true;
+        default:
+            if (address >= AES_DMA_KEY_DATA && address < AES_DMA_KEY_DATA + AES_KEY_SIZE) {
+                unsigned word = static_cast<unsigned>(address - AES_DMA_KEY_DATA) / 4;
+                AesDmaDescriptor::put(&m_keys[m_key_select].key[4 * word], value, 4);
+                m_key_words[m_key_select] |= 1u << word;
+                m_key_generation[m_key_select]++;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    // One memory access; the thread waits it out, so the stage is busy
+    // for the whole time including queueing for the memory port
+    void memory_access(tlm::tlm_command command, uint64_t address, uint8_t* data, unsigned length,
+                       sc_core::sc_time& busy) {
+        tlm::tlm_generic_payload trans;
+        trans.set_command(command);
+        trans.set_address(address);
+        trans.set_data_ptr(data);
+        trans.set_data_length(length);
+        trans.set_streaming_width(length);
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        mem_socket->b_transport(trans, delay);
+        if (trans.is_response_error()) {
+            SC_REPORT_ERROR("AesDmaEngine", "Memory access failed");
+        }
+        busy += delay;
+        wait(delay);
+    }
+
+    void fetch_stage() {
+        for (;;) {
+            while (m_fetch == m_head) {
+                wait(m_doorbell);
+            }
+            uint32_t index = m_fetch;
+            m_fetch = (m_fetch + 1) % m_ring_size;
+
+            uint8_t raw[AesDmaDescriptor::SIZE];
+            memory_access(tlm::TLM_READ_COMMAND, m_ring_base + index * AesDmaDescriptor::SIZE, raw,
+                          AesDmaDescriptor::SIZE, m_stats.fetch_busy);
+            AesDmaDescriptor descriptor = AesDmaDescriptor::decode(raw);
+
+            // A bad descriptor still flows through, so completions stay in order
+            bool valid = descriptor.length > 0 && descriptor.length % AES_BLOCK_SIZE == 0 &&
+                         descriptor.key_slot < AES_DMA_KEY_SLOTS && key_loaded(descriptor.key_slot);
+            if (!valid) {
+                descriptor.status = AES_DMA_STATUS_ERROR;
+                m_to_core.write(BurstPtr(new Burst{index, descriptor, 0, {}, true}));
+                continue;
+            }
+
+            for (uint32_t offset = 0; offset < descriptor.length; offset += m_timing.burst_bytes) {
+                uint32_t bytes = std::min(m_timing.burst_bytes, descriptor.length - offset);
+                BurstPtr burst(new Burst{index, descriptor, offset, std::vector<uint8_t>(bytes),
+                                         offset + bytes == descriptor.length});
+                memory_access(tlm::TLM_READ_COMMAND, descriptor.source + offset, burst->data.data(), bytes,
+                              m_stats.fetch_busy);
+                m_to_core.write(burst);
+            }
+        }
+    }
+
+    bool key_loaded(unsigned slot) const { return m_key_words[slot] == 0xF; }
+
+    void encrypt_stage() {
+        // The core holds the schedule of one key. Rewriting the slot it came
+        // from changes the key as much as switching slots does.
+        int current_key = -1;
+        uint32_t current_generation = 0;
+        for (;;) {
+            BurstPtr burst = m_to_core.read();
+            if (burst->descriptor.status == AES_DMA_STATUS_ERROR) {
+                m_to_write_back.write(burst);
+                continue;
+            }
+
+            // The burst goes to AesTop as a one-segment scatter-gather chain
+            struct iovec segment = {burst->data.data(), burst->data.size()};
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_data_ptr(burst->data.data());
+            trans.set_data_length(burst->data.size());
+            trans.set_streaming_width(burst->data.size());
+            trans.set_byte_enable_ptr(nullptr);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            AesExtension* ext = new AesExtension();
+            ext->operation = burst->descriptor.operation;
+            ext->mode = (m_timing.cycles_per_block == 1) ? AesMode::PIPELINED : AesMode::NON_PIPELINED;
+            ext->key = m_keys[burst->descriptor.key_slot];
+            trans.set_extension(ext);
+            AesScatterGatherExtension* sg = new AesScatterGatherExtension(&segment, 1);
+            trans.set_extension(sg);
+
+            // The core's own delay annotation is replaced by the timing model
+            sc_core::sc_time core_delay = sc_core::SC_ZERO_TIME;
+            core_socket->b_transport(trans, core_delay);
+            trans.release_extension(ext);
+            trans.release_extension(sg);
+            if (trans.is_response_error()) {
+                SC_REPORT_ERROR("AesDmaEngine", "Cipher core rejected a burst");
+            }
+
+            uint64_t blocks = burst->data.size() / AES_BLOCK_SIZE;
+            uint64_t cycles = (blocks - 1) * m_timing.cycles_per_block + m_timing.core_latency_cycles;
+            uint32_t generation = m_key_generation[burst->descriptor.key_slot];
+            if (current_key != burst->descriptor.key_slot || current_generation != generation) {
+                cycles += m_timing.key_load_cycles;
+                current_key = burst->descriptor.key_slot;
+                current_generation = generation;
+            }
+            sc_core::sc_time service = m_timing.clock_period * static_cast<double>(cycles);
+            m_stats.encrypt_busy += service;
+            wait(service);
+            m_to_write_back.write(burst);
+        }
+    }
+
+    void write_back_stage() {
+        for (;;) {
+            BurstPtr burst = m_to_write_back.read();
+            const AesDmaDescriptor& descriptor = burst->descriptor;
+            if (!burst->data.empty()) {
+                memory_access(tlm::TLM_WRITE_COMMAND, descriptor.destination + burst->offset, burst->data.data(),
+                              burst->data.size(), m_stats.write_back_busy);
+                m_stats.bytes += burst->data.size();
+                m_stats.bursts++;
+            }
+            if (!burst->last) {
+                continue;
+            }
+
+            // Status word, then the descriptor counts as complete
+            uint8_t status[4];
+            uint32_t value = (descriptor.status == AES_DMA_STATUS_ERROR) ? AES_DMA_STATUS_ERROR : AES_DMA_STATUS_DONE;
+            AesDmaDescriptor::put(status, value, 4);
+            memory_access(tlm::TLM_WRITE_COMMAND,
+                          m_ring_base + burst->index * AesDmaDescriptor::SIZE + AesDmaDescriptor::STATUS_OFFSET,
+                          status, 4, m_stats.write_back_busy);
+            m_tail = (burst->index + 1) % m_ring_size;
+            m_stats.descriptors++;
+            if (value == AES_DMA_STATUS_ERROR) {
+                m_stats.errors++;
+            }
+            m_stats.last_completion = sc_core::sc_time_stamp();
+
+            // Without a timeout nothing else would report a partial batch,
+            // so it goes out as soon as no descriptor is left
+            if (++m_unreported >= m_coalesce_count || (m_coalesce_timeout == 0 && m_tail == m_head)) {
+                raise_irq();
+            } else if (m_unreported == 1) {
+                m_first_unreported.notify(sc_core::SC_ZERO_TIME);
+            }
+        }
+    }
+
+    // Raises the interrupt for completions left waiting past the timeout
+    void coalesce_timer() {
+        for (;;) {
+            wait(m_first_unreported);
+            if (m_coalesce_timeout == 0) {
+                continue;
+            }
+            wait(m_timing.clock_period * static_cast<double>(m_coalesce_timeout), m_irq_raised);
+            if (m_unreported > 0) {
+                raise_irq();
+            }
+        }
+    }
+
+    void raise_irq() {
+        m_unreported = 0;
+        if (!(m_irq_status & AES_DMA_IRQ_COMPLETION)) {
+            m_stats.interrupts++;
+        }
+        m_irq_status |= AES_DMA_IRQ_COMPLETION;
+        irq.write(true);
+        m_irq_raised.notify(sc_core::SC_ZERO_TIME);
+    }
+};
+
+#endif // AES_DMA_H
@@ -0,0 +1,245 @@
+#ifndef AES_HEX_H
+#define AES_HEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AES_HEX_X86 1
+#endif
+
+// Hex conversion for test vectors, without SystemC and without streams.
+// The SIMD kernels turn 16 (SSSE3) or 32 (AVX2) bytes into hex digits per
+// step, by table lookup with PSHUFB; decoding validates a whole register of
+// digits at once and combines the nibble pairs with PMADDUBSW. Encoding is
+// lowercase; decoding accepts either case.
+
+enum class AesHexKernel {
+    AUTO,    // Widest kernel the CPU supports
+    SCALAR,
+    SSSE3,   // 16 bytes per step
+    AVX2     // 32 bytes per step
+};
+
+inline const char* aes_hex_kernel_name(AesHexKernel kernel) {
+    switch (kernel) {
+        case AesHexKernel::SCALAR: return "scalar";
+        case AesHexKernel::SSSE3:  return "ssse3";
+        case AesHexKernel::AVX2:   return "avx2";
+        default:                   return "auto";
+    }
+}
+
+inline bool aes_hex_kernel_supported(AesHexKernel kernel) {
+    switch (kernel) {
+        case AesHexKernel::SCALAR:
+        case AesHexKernel::AUTO:
+            return true;
+#ifdef AES_HEX_X86
+        case AesHexKernel::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case AesHexKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+inline AesHexKernel aes_hex_kernel_resolve(AesHexKernel kernel) {
+    if (kernel != AesHexKernel::AUTO && aes_hex_kernel_supported(kernel)) {
+        return kernel;
+    }
+    return aes_hex_kernel_supported(AesHexKernel::AVX2) ? AesHexKernel::AVX2 :
+           aes_hex_kernel_supported(AesHexKernel::SSSE3) ? AesHexKernel::SSSE3 : AesHexKernel::SCALAR;
+}
+
+namespace aes_hex_detail {
+
+constexpr char DIGITS[] = "0123456789abcdef";
+
+// Value of one hex digit, or -1
+inline int digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    char lower = static_cast<char>(c | 0x20);
+    if (lower >= 'a' && lower <= 'f') {
+        return lower - 'a' + 10;
+    }
+    return -1;
+}
+
+inline void encode_scalar(const uint8_t* in, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = DIGITS[in[i] >> 4];
+        out[2 * i + 1] = DIGITS[in[i] & 0x0f];
+    }
+}
+
+inline bool decode_scalar(const char* in, size_t num_bytes, uint8_t* out) {
+    for (size_t i = 0; i < num_bytes; i++) {
+        int hi = digit_value(in[2 * i]);
+        int lo = digit_value(in[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+#ifdef AES_HEX_X86
+__attribute__((target("ssse3")))
+inline size_t encode_ssse3(const uint8_t* in, size_t length, char* out) {
+    const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t encode_avx2(const uint8_t* in, size_t length, char* out) {
+    const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+        // Unpack works within 128-bit lanes; put the halves back in order
+        __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+
+// Nibble values of 16 digits, with valid set to 0xff where the digit is one
+__attribute__((target("ssse3")))
+inline __m128i nibbles_ssse3(__m128i c, __m128i& valid) {
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i digit_ok = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i letter_ok = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_or_si128(digit_ok, letter_ok);
+    return _mm_or_si128(_mm_and_si128(digit, digit_ok),
+                        _mm_and_si128(_mm_add_epi8(letter, _mm_set1_epi8(10)), letter_ok));
+}
+
+__attribute__((target("ssse3")))
+inline size_t decode_ssse3(const char* in, size_t num_bytes, uint8_t* out, bool& ok) {
+    const __m128i weights = _mm_set1_epi16(0x0110);   // High nibble x16, low x1
+    size_t i = 0;
+    for (; i + 16 <= num_bytes; i += 16) {
+        __m128i valid0;
+        __m128i valid1;
+        __m128i n0 = nibbles_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), valid0);
+        __m128i n1 = nibbles_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 16)), valid1);
+        if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff) {
+            ok = false;
+            return i;
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights), _mm_maddubs_epi16(n1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline __m256i nibbles_avx2(__m256i c, __m256i& valid) {
+    __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i digit_ok = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i letter_ok = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    valid = _mm256_or_si256(digit_ok, letter_ok);
+    return _mm256_or_si256(_mm256_and_si256(digit, digit_ok),
+                           _mm256_and_si256(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), letter_ok));
+}
+
+__attribute__((target("avx2")))
+inline size_t decode_avx2(const char* in, size_t num_bytes, uint8_t* out, bool& ok) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 32 <= num_bytes; i += 32) {
+        __m256i valid0;
+        __m256i valid1;
+        __m256i n0 = nibbles_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i)), valid0);
+        __m256i n1 = nibbles_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i + 32)), valid1);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) {
+            ok = false;
+            return i;
+        }
+        // Pack works within 128-bit lanes: quadwords come out as 0, 2, 1, 3
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights), _mm256_maddubs_epi16(n1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(bytes, 0xd8));
+    }
+    return i;
+}
+#endif
+
+}
+
+// Write 2 * length hex digits to out (no terminator)
+inline void aes_hex_encode(const uint8_t* in, size_t length, char* out, AesHexKernel kernel = AesHexKernel::AUTO) {
+    size_t done = 0;
+#ifdef AES_HEX_X86
+    switch (aes_hex_kernel_resolve(kernel)) {
+        case AesHexKernel::AVX2:
+            done = aes_hex_detail::encode_avx2(in, length, out);
+            done += aes_hex_detail::encode_ssse3(in + done, length - done, out + 2 * done);
+            break;
+        case AesHexKernel::SSSE3:
+            done = aes_hex_detail::encode_ssse3(in, length, out);
+            break;
+        default:
+            break;
+    }
+#else
+    (void)kernel;
+#endif
+    aes_hex_detail::encode_scalar(in + done, length - done, out + 2 * done);
+}
+
+// Decode hex_length digits into hex_length / 2 bytes. Returns false if the
+// length is odd or any character is not a hex digit; out is then partly
+// written.
+inline bool aes_hex_decode(const char* in, size_t hex_length, uint8_t* out,
+                           AesHexKernel kernel = AesHexKernel::AUTO) {
+    if (hex_length % 2 != 0) {
+        return false;
+    }
+    size_t num_bytes = hex_length / 2;
+    size_t done = 0;
+    bool ok = true;
+#ifdef AES_HEX_X86
+    switch (aes_hex_kernel_resolve(kernel)) {
+        case AesHexKernel::AVX2:
+            done = aes_hex_detail::decode_avx2(in, num_bytes, out, ok);
+            if (ok) {
+                done += aes_hex_detail::decode_ssse3(in + 2 * done, num_bytes - done, out + done, ok);
+            }
+            break;
+        case AesHexKernel::SSSE3:
+            done = aes_hex_detail::decode_ssse3(in, num_bytes, out, ok);
+            break;
+        default:
+            break;
+    }
+#else
+    (void)kernel;
+#endif
+    return ok && aes_hex_detail::decode_scalar(in + 2 * done, num_bytes - done, out + done);
+}
+
+#endif // AES_HEX_H
@@ -0,0 +1,170 @@
+#ifndef AES_INCREMENTAL_H
+#define AES_INCREMENTAL_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include "aes_job_ring.h"
+#include "aes_xts.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Incremental encryption of large files and images. The plaintext is cut
+// into fixed-size chunks and each chunk is encrypted on its own, with a
+// counter block (CTR) or tweak (XTS) derived from its offset. A chunk
+// index kept next to the ciphertext holds a keyed digest of every chunk's
+// plaintext, so when a new version comes in only the chunks whose digest
+// changed are encrypted again. Every chunk is still read to compute its
+// digest, but that is several times cheaper than encrypting it.
+//
+// CTR: chunk i starting at byte offset o uses the counter block
+//   nonce (8 bytes) | generation (4 bytes) | o / 16 (4 bytes), big-endian
+// The nonce is random per full encryption and the generation is the
+// number of the update that last wrote the chunk. Every re-encryption
+// therefore gets a keystream that was never used before, and stale
+// ciphertext of a chunk gives nothing away about its new contents. A
+// freshly encrypted file is exactly one CTR stream from nonce | 0 | 0.
+//
+// XTS: chunk i is data unit i, as AesXts numbers sectors, so a freshly
+// encrypted file matches AesXts::encrypt_sectors with sector_size equal to
+// the chunk size. As on a disk, rewriting a chunk reuses its tweak, which
+// shows which 16-byte blocks of it changed; use CTR where that matters.
+// XTS cannot encrypt less than a block, so a final chunk shorter than 16
+// bytes is merged into the one before it.
+//
+// The digest is a polynomial hash over GF(2^128), as GHASH computes one:
+// the chunk's 16-byte blocks and a final block of its length and number
+// are the coefficients, evaluated at a secret point H. H and the key that
+// encrypts the result are derived from the data key. Two different chunks
+// of n blocks collide only if H is one of the n + 1 roots of their
+// difference, so no pattern of changed bits can cancel out, and the index
+// shows no more than the ciphertext does. With PCLMULQDQ four blocks are
+// multiplied by H^4..H at once and reduced together. Defined in
+// cipher/aes_incremental.cpp (libaes_cipher).
+
+// Version 1 indexes hold unkeyed FNV-1a digests and are refused
+constexpr uint32_t AES_CHUNK_INDEX_VERSION = 2;
+constexpr size_t AES_CHUNK_DEFAULT_SIZE = 4096;
+
+// CTR block offsets are 32 bits, so a file is at most 64 GiB
+constexpr uint64_t AES_INCREMENTAL_CTR_MAX_LENGTH = 1ull << 36;
+
+struct AesChunkIndexHeader {
+    char magic[8];              // "AESCHIDX"
+    uint32_t version;           // AES_CHUNK_INDEX_VERSION
+    uint32_t byte_order;        // 0x01020304 as written
+    uint16_t header_size;       // sizeof(AesChunkIndexHeader)
+    uint16_t entry_size;        // sizeof(AesChunkEntry)
+    uint32_t mode;              // AesCipherMode: CTR or XTS
+    uint32_t chunk_size;
+    uint32_t generation;        // Updates applied since the full encryption
+    uint64_t count;
+    uint64_t plaintext_size;
+    uint64_t nonce;             // CTR counter block prefix
+    uint64_t checksum;          // FNV-1a over the entries
+};
+
+struct AesChunkEntry {
+    uint8_t digest[AES_BLOCK_SIZE];     // Keyed digest of the chunk's plaintext
+    uint32_t generation;                // Update that last encrypted the chunk
+    uint32_t length;                    // Bytes of plaintext in the chunk
+    uint64_t reserved;
+};
+
+static_assert(sizeof(AesChunkIndexHeader) == 64, "Chunk index header must be 64 bytes");
+static_assert(sizeof(AesChunkEntry) == 32, "Chunk index entry must be 32 bytes");
+
+// Index of one encrypted file: 32 bytes per chunk, 0.8% of the data with
+// 4 KiB chunks. Filled in by AesIncrementalCipher; save and load keep it
+// on disk, with the versioning and atomic replacement of AesKeyStore.
+class AesChunkIndex {
+public:
+    AesChunkIndex();
+
+    // Returns AES_CIPHER_OK or AES_CIPHER_EIO
+    int save(const std::string& path) const;
+
+    // Returns AES_CIPHER_OK, AES_CIPHER_EIO (missing, truncated, corrupt or
+    // not an index) or AES_CIPHER_EVERSION. The index is unchanged on error.
+    int load(const std::string& path);
+
+    AesCipherMode mode() const { return m_mode; }
+    size_t chunk_size() const { return m_chunk_size; }
+    uint64_t plaintext_size() const { return m_plaintext_size; }
+    uint64_t nonce() const { return m_nonce; }
+    uint32_t generation() const { return m_generation; }
+    size_t size() const { return m_entries.size(); }
+    const AesChunkEntry& entry(size_t i) const { return m_entries[i]; }
+
+private:
+    friend class AesIncrementalCipher;
+
+    AesCipherMode m_mode;
+    size_t m_chunk_size;
+    uint64_t m_plaintext_size;
+    uint64_t m_nonce;
+    uint32_t m_generation;
+    std::vector<AesChunkEntry> m_entries;
+};
+
+// Work done by one encrypt or update call
+struct AesIncrementalStats {
+    size_t chunks = 0;
+    size_t encrypted_chunks = 0;    // Changed or new
+    uint64_t bytes_hashed = 0;
+    uint64_t bytes_encrypted = 0;
+};
+
+// Read-only after construction, like AesXts, so one instance can serve any
+// number of threads working on different files
+class AesIncrementalCipher {
+public:
+    // mode is CTR or XTS; CTR ignores tweak_key. chunk_size must be a
+    // non-zero multiple of 16. AesKeyKernel::SCALAR also keeps the digest
+    // off PCLMULQDQ; the digests are the same either way.
+    AesIncrementalCipher(AesCipherMode mode, const AesKey& data_key, const AesKey& tweak_key,
+                         size_t chunk_size = AES_CHUNK_DEFAULT_SIZE, AesKeyKernel kernel = AesKeyKernel::AUTO);
+
+    AesCipherMode mode() const { return m_mode; }
+    size_t chunk_size() const { return m_chunk_size; }
+
+    // Encrypt all of in and start a new index (CTR draws a new nonce).
+    // in and out may be the same buffer. Returns AES_CIPHER_OK,
+    // AES_CIPHER_EINVAL (bad mode or chunk size, null buffer, XTS input
+    // shorter than a block, CTR input over 64 GiB) or AES_CIPHER_EIO (no
+    // entropy for the nonce).
+    int encrypt(const uint8_t* in, uint8_t* out, size_t length, AesChunkIndex& index,
+                AesIncrementalStats* stats = nullptr) const;
+
+    // Bring out, which holds the ciphertext index describes, up to date
+    // with a new version of the plaintext: only chunks whose digest changed
+    // or that did not exist are encrypted, and the rest of out is left
+    // alone. out must have room for length bytes; the file may grow or
+    // shrink. Returns AES_CIPHER_OK, or AES_CIPHER_EINVAL as for encrypt,
+    // for an index made with another mode or chunk size, or when the
+    // generation counter is exhausted (encrypt again to get a new nonce).
+    int update(const uint8_t* in, uint8_t* out, size_t length, AesChunkIndex& index,
+               AesIncrementalStats* stats = nullptr) const;
+
+    // Decrypt index.plaintext_size() bytes. in and out may be the same
+    // buffer. Returns AES_CIPHER_OK or AES_CIPHER_EINVAL.
+    int decrypt(const uint8_t* in, uint8_t* out, const AesChunkIndex& index) const;
+
+private:
+    AesCipherMode m_mode;
+    size_t m_chunk_size;
+    AesKeySchedule m_data;          // CTR
+    AesXts m_xts;                   // XTS
+    AesKeySchedule m_digest;
+    uint64_t m_hash_powers[4][2];   // H, H^2, H^3, H^4 as {low, high} words
+    bool m_clmul;
+
+    bool valid_length(size_t length) const;
+    size_t chunk_count(size_t length) const;
+    void digest(const uint8_t* in, size_t length, uint64_t chunk, uint8_t* out) const;
+    void crypt_chunk(const uint8_t* in, uint8_t* out, size_t length, uint64_t chunk, uint64_t nonce,
+                     uint32_t generation, bool decrypt) const;
+};
+
+#endif // AES_INCREMENTAL_H
@@ -0,0 +1,243 @@
+#ifndef AES_JOB_RING_H
+#define AES_JOB_RING_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include "aes_cipher_c.h"
+#include "aes_xts.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define AES_JOB_RING_COROUTINES 1
+#endif
+
+// Asynchronous front end to libaes_cipher in the style of io_uring: callers
+// post jobs to a submission ring without blocking, worker threads take them
+// in batches, and results come back through a completion ring that is
+// polled, or waited on through an eventfd. Defined in cipher/aes_job_ring.cpp.
+
+enum class AesCipherMode {
+    ECB,
+    CBC,
+    CTR,
+    XTS
+};
+
+// One encryption or decryption request. The buffers and keys are only
+// borrowed, and must stay valid until the job's completion is reaped.
+struct AesJob {
+    AesCipherMode mode = AesCipherMode::ECB;
+    AesOperation operation = AesOperation::ENCRYPT;
+    const AesKeySchedule* key = nullptr;  // ECB, CBC and CTR
+    const AesXts* xts_key = nullptr;      // XTS
+    const uint8_t* in = nullptr;
+    uint8_t* out = nullptr;               // May equal in
+    size_t length = 0;                    // Multiple of 16 for ECB and CBC, >= 16 for XTS
+    // CBC: initialization vector. CTR: initial counter block. XTS: sector
+    // number, little-endian in bytes 0-7 (the IEEE 1619 tweak input).
+    std::array<uint8_t, AES_BLOCK_SIZE> iv{};
+    uint64_t user_data = 0;               // Returned unchanged in the completion
+};
+
+struct AesCompletion {
+    uint64_t user_data;
+    int status;  // AES_CIPHER_OK, or AES_CIPHER_EINVAL for a malformed job
+};
+
+// Run one job on the calling thread; the workers use the same function
+int aes_run_job(const AesJob& job);
+
+// Bounded lock-free multi-producer multi-consumer ring (Vyukov). Every slot
+// carries a sequence number that tells producers and consumers whether it
+// is free or filled for their lap, so neither side takes a lock.
+template <typename T>
+class AesMpmcRing {
+public:
+    // capacity must be a power of two
+    explicit AesMpmcRing(size_t capacity) :
+        m_slots(new Slot[capacity]),
+        m_mask(capacity - 1) {
+        for (size_t i = 0; i < capacity; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const T& value) {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[pos & m_mask];
+            intptr_t diff = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire)) -
+                            static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[pos & m_mask];
+            intptr_t diff = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire)) -
+                            static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = slot.value;
+                    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True if nothing was ready to pop at the time of the call
+    bool empty() const {
+        size_t pos = m_head.load(std::memory_order_acquire);
+        return m_slots[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_tail{0};  // Producers
+    alignas(64) std::atomic<size_t> m_head{0};  // Consumers
+};
+
+class AesJobRing {
+public:
+    // entries is rounded up to a power of two and bounds the jobs in flight
+    // (submitted but not yet reaped), so the completion ring cannot overflow.
+    // Each worker takes up to batch_size jobs per wakeup.
+    explicit AesJobRing(size_t entries = 256, unsigned num_workers = 1, size_t batch_size = 16);
+
+    // Runs every job already submitted, then stops the workers
+    ~AesJobRing();
+
+    AesJobRing(const AesJobRing&) = delete;
+    AesJobRing& operator=(const AesJobRing&) = delete;
+
+    size_t capacity() const { return m_capacity; }
+    size_t in_flight() const { return m_in_flight.load(std::memory_order_acquire); }
+
+    // Never blocks. Returns false (or the number accepted) once capacity()
+    // jobs are in flight.
+    bool submit(const AesJob& job);
+    size_t submit(const AesJob* jobs, size_t count);
+
+    // Reap up to max completions without blocking. Coroutines waiting on
+    // jobs that finished are resumed here, on the calling thread, and are not
+    // counted or stored.
+    size_t poll(AesCompletion* completions, size_t max);
+
+    // Like poll, but blocks until at least one completion is stored or one
+    // callback has run, or until timeout_ms passes (-1 waits forever)
+    size_t wait(AesCompletion* completions, size_t max, int timeout_ms = -1);
+
+    // Becomes readable when completions are pending, for epoll loops. poll()
+    // resets it, and sets it again if it leaves completions behind.
+    int event_fd() const { return m_event_fd; }
+
+    // Submit a job that reports to a callback instead of the completion
+    // ring. The callback runs inside poll() or wait().
+    using Callback = void (*)(void* context, int status);
+    bool submit(const AesJob& job, Callback callback, void* context);
+
+#ifdef AES_JOB_RING_COROUTINES
+    // co_await ring.run(job) suspends until poll() or wait() on some thread
+    // reaps the job, and yields its status. A full ring gives
+    // AES_CIPHER_EBUSY without suspending.
+    class Awaiter {
+    public:
+        Awaiter(AesJobRing& ring, const AesJob& job) : m_ring(ring), m_job(job) {}
+
+        bool await_ready() const { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            m_handle = handle;
+            if (!m_ring.submit(m_job, &Awaiter::complete, this)) {
+                m_status = AES_CIPHER_EBUSY;
+                return false;
+            }
+            return true;
+        }
+
+        int await_resume() const { return m_status; }
+
+    private:
+        AesJobRing& m_ring;
+        AesJob m_job;
+        std::coroutine_handle<> m_handle;
+        int m_status = AES_CIPHER_OK;
+
+        static void complete(void* context, int status) {
+            Awaiter* awaiter = static_cast<Awaiter*>(context);
+            awaiter->m_status = status;
+            awaiter->m_handle.resume();
+        }
+    };
+
+    Awaiter run(const AesJob& job) { return Awaiter(*this, job); }
+#endif
+
+private:
+    struct Entry {
+        AesJob job;
+        Callback callback;
+        void* context;
+    };
+
+    struct Done {
+        AesCompletion completion;
+        Callback callback;
+        void* context;
+    };
+
+    size_t m_capacity;
+    size_t m_batch_size;
+    int m_event_fd;
+    AesMpmcRing<Entry> m_submissions;
+    AesMpmcRing<Done> m_completions;  // Jobs without a callback
+    AesMpmcRing<Done> m_callbacks;    // Jobs with one, run by the reaper
+    std::atomic<size_t> m_in_flight{0};
+
+    // Worker sleep and wakeup: m_queued counts published submissions, and
+    // submitters only take the mutex when a worker is asleep
+    std::atomic<size_t> m_queued{0};
+    std::atomic<unsigned> m_sleeping{0};
+    std::atomic<bool> m_stopping{false};
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::vector<std::thread> m_workers;
+
+    bool push(const Entry& entry);
+    size_t reap(AesCompletion* completions, size_t max, size_t& handled);
+    void worker();
+};
+
+#endif // AES_JOB_RING_H
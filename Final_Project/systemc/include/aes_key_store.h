@@ -0,0 +1,101 @@
+#ifndef AES_KEY_STORE_H
+#define AES_KEY_STORE_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Persistent store of expanded key schedules, looked up by a 64-bit key ID.
+// The file is built once with AesKeyStore::write, then opened by any number
+// of processes with a read-only shared mmap, so the schedules are in the
+// page cache once and no process expands a key at startup. Opening checks
+// only the header, so it costs the same for ten keys or a million; pages
+// are read in as lookups touch them.
+//
+// File layout (little-endian, all offsets from the start of the file):
+//   0     header, 64 bytes (AesKeyStoreHeader)
+//   64    index: count key IDs, ascending, 8 bytes each
+//   page  records: count AesKeyStoreRecord, in index order, 384 bytes each
+// The records start on a 4096-byte boundary and every record is 64-byte
+// aligned, so a schedule never straddles a cache line more than it must.
+//
+// A file written by a different format version is rejected with
+// AES_CIPHER_EVERSION, and should be rebuilt from the keys. Files are
+// replaced by rename, so processes that have the old one mapped keep a
+// consistent view until they reopen. Defined in cipher/aes_key_store.cpp
+// (libaes_cipher).
+
+constexpr uint32_t AES_KEY_STORE_VERSION = 1;
+constexpr size_t AES_KEY_STORE_PAGE = 4096;
+
+struct AesKeyStoreHeader {
+    char magic[8];              // "AESKSTOR"
+    uint32_t version;           // AES_KEY_STORE_VERSION
+    uint32_t byte_order;        // 0x01020304 as written by the builder
+    uint32_t header_size;       // sizeof(AesKeyStoreHeader)
+    uint32_t record_size;       // sizeof(AesKeyStoreRecord)
+    uint64_t count;
+    uint64_t records_offset;
+    uint64_t file_size;
+    uint64_t checksum;          // FNV-1a over index and records
+    uint64_t reserved;
+};
+
+// Both halves of an AesKeySchedule, as stored: the encryption round keys
+// and the InvMixColumns form used by the AES-NI decryption path
+struct alignas(64) AesKeyStoreRecord {
+    uint64_t key_id;
+    uint64_t reserved;
+    AesRoundKeys round_keys;
+    AesRoundKeys inv_round_keys;
+};
+
+static_assert(sizeof(AesKeyStoreHeader) == 64, "Key store header must be 64 bytes");
+static_assert(sizeof(AesKeyStoreRecord) == 384, "Key store record must be 384 bytes");
+
+class AesKeyStore {
+public:
+    AesKeyStore();
+    ~AesKeyStore();
+
+    AesKeyStore(const AesKeyStore&) = delete;
+    AesKeyStore& operator=(const AesKeyStore&) = delete;
+
+    // Expand count keys and write them to path, replacing any existing
+    // file atomically. Key IDs may come in any order but must be unique.
+    // Returns AES_CIPHER_OK, AES_CIPHER_EINVAL (duplicate ID, null
+    // pointer), AES_CIPHER_ENOMEM or AES_CIPHER_EIO.
+    static int write(const std::string& path, const uint64_t* key_ids, const AesKey* keys, size_t count);
+
+    // Map a store read-only. Returns AES_CIPHER_OK, AES_CIPHER_EIO (missing,
+    // unreadable, truncated or not a key store) or AES_CIPHER_EVERSION.
+    // A store that is already open is closed first.
+    int open(const std::string& path);
+    void close();
+
+    bool is_open() const { return m_base != nullptr; }
+    size_t size() const { return m_count; }
+
+    // Record for a key ID, or nullptr; points into the mapping, so it is
+    // valid until close
+    const AesKeyStoreRecord* find(uint64_t key_id) const;
+
+    // Load a stored schedule into an AesKeySchedule, without expanding.
+    // Returns false if the ID is not in the store.
+    bool get(uint64_t key_id, AesKeySchedule& schedule, AesKeyKernel kernel = AesKeyKernel::AUTO) const;
+
+    // Recompute the checksum over the whole file. This reads every page, so
+    // it is a separate step rather than part of open.
+    bool verify() const;
+
+private:
+    void* m_base;
+    size_t m_length;
+    size_t m_count;
+    const uint64_t* m_ids;
+    const AesKeyStoreRecord* m_records;
+};
+
+#endif // AES_KEY_STORE_H
@@ -0,0 +1,283 @@
+#ifndef AES_LANE_ROUTER_H
+#define AES_LANE_ROUTER_H
+
+#include "aes_types.h"
+#include "timeline_trace.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// How the router picks a lane for each transaction
+enum class AesLanePolicy {
+    ROUND_ROBIN,
+    LEAST_LOADED,   // Lane that frees up first
+    KEY_AFFINITY    // Same key, same lane, so its round keys stay loaded
+};
+
+inline const char* aes_lane_policy_name(AesLanePolicy policy) {
+    switch (policy) {
+    case AesLanePolicy::ROUND_ROBIN: return "round-robin";
+    case AesLanePolicy::LEAST_LOADED: return "least-loaded";
+    case AesLanePolicy::KEY_AFFINITY: return "key-affinity";
+    default: return "unknown";
+    }
+}
+
+// Timing of the shared interconnect and of one lane. The defaults are the
+// iterative core of aes_top.v at 100 MHz behind a 128-bit bus.
+struct AesLaneTiming {
+    sc_core::sc_time clock_period = sc_core::sc_time(10, sc_core::SC_NS);
+    unsigned bus_bytes = 16;                            // Beat width of the shared bus
+    unsigned bus_overhead_cycles = 1;                   // Address phase per direction
+    unsigned cycles_per_block = AES_NUM_ROUNDS + 1;     // Lane service time per block
+    unsigned key_load_cycles = AES_NUM_ROUNDS;          // Key expansion on a key change
+};
+
+// Per-lane counters
+struct AesLaneStats {
+    uint64_t transactions = 0;
+    uint64_t blocks = 0;
+    uint64_t key_loads = 0;
+    size_t max_queue = 0;                               // Transactions waiting or in service
+    sc_core::sc_time busy = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time queue_wait = sc_core::SC_ZERO_TIME;
+};
+
+// Shared bus counters
+struct AesInterconnectStats {
+    uint64_t beats = 0;
+    sc_core::sc_time busy = sc_core::SC_ZERO_TIME;
+    sc_core::sc_time wait = sc_core::SC_ZERO_TIME;      // Transfers held up by other transfers
+};
+
+// Router in front of N AES lanes (AesTop instances), behind one shared bus.
+// Requests cross the bus to the chosen lane, wait there behind the lane's
+// earlier work, are processed, and the results cross the bus back. Lanes
+// work in parallel; the bus carries one beat per clock for all of them.
+//
+// The model is loosely timed: every transaction reserves its lane in call
+// order and its two bus transfers in the first free gaps, and the returned
+// delay is the time until its result is back. Initiators that issue concurrently (several threads, or
+// temporally decoupled ones) are what fill the lanes. Each transaction is
+// functionally forwarded to its lane's AesTop unchanged, so single-block
+// and scatter-gather payloads both work.
+//
+// With timeline tracing on, the bus and every lane get a track, and each
+// transfer and each piece of lane work is recorded at the simulated time
+// the model worked out for it, so queueing shows as gaps on a lane and bus
+// contention as back-to-back transfers.
+class AesLaneRouter : public sc_core::sc_module {
+public:
+    // TLM socket for incoming requests
+    tlm_utils::simple_target_socket<AesLaneRouter> bus_socket;
+
+    // One initiator socket per lane, bound to each lane's AesTop
+    std::vector<std::unique_ptr<tlm_utils::simple_initiator_socket<AesLaneRouter>>> lane_sockets;
+
+    SC_HAS_PROCESS(AesLaneRouter);
+    AesLaneRouter(sc_core::sc_module_name name, unsigned num_lanes,
+                  AesLanePolicy policy = AesLanePolicy::ROUND_ROBIN,
+                  const AesLaneTiming& timing = AesLaneTiming()) :
+        sc_core::sc_module(name),
+        bus_socket("bus_socket"),
+        m_policy(policy),
+        m_timing(timing),
+        m_lanes(num_lanes),
+        m_next_lane(0),
+        m_first_arrival(sc_core::SC_ZERO_TIME),
+        m_last_done(sc_core::SC_ZERO_TIME),
+        m_started(false),
+        m_bus_trace(std::string(this->name()) + ".bus") {
+
+        if (num_lanes == 0) {
+            SC_REPORT_ERROR("AesLaneRouter", "At least one lane is required");
+        }
+        if (timing.bus_bytes == 0 || AES_BLOCK_SIZE % timing.bus_bytes != 0) {
+            SC_REPORT_ERROR("AesLaneRouter", "Bus width must divide the block size");
+        }
+        for (unsigned i = 0; i < num_lanes; i++) {
+            std::string socket_name = "lane_socket_" + std::to_string(i);
+            lane_sockets.emplace_back(new tlm_utils::simple_initiator_socket<AesLaneRouter>(socket_name.c_str()));
+            m_lane_traces.emplace_back(std::string(this->name()) + ".lane" + std::to_string(i));
+        }
+
+        // Register callback for incoming transactions
+        bus_socket.register_b_transport(this, &AesLaneRouter::b_transport);
+    }
+
+    unsigned num_lanes() const { return static_cast<unsigned>(m_lanes.size()); }
+    AesLanePolicy policy() const { return m_policy; }
+    const AesLaneStats& lane_stats(unsigned lane) const { return m_lanes[lane].stats; }
+    const AesInterconnectStats& interconnect_stats() const { return m_bus; }
+
+    // From the first request to the last result
+    sc_core::sc_time elapsed() const { return m_last_done - m_first_arrival; }
+
+    uint64_t total_blocks() const {
+        uint64_t blocks = 0;
+        for (const Lane& lane : m_lanes) {
+            blocks += lane.stats.blocks;
+        }
+        return blocks;
+    }
+
+    // TLM blocking transport method
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        AesExtension* ext = trans.get_extension<AesExtension>();
+        unsigned length = trans.get_data_length();
+        if (!ext || length == 0 || length % AES_BLOCK_SIZE != 0) {
+            trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
+            return;
+        }
+
+        const sc_core::sc_time now = sc_core::sc_time_stamp();
+        const sc_core::sc_time arrival = now + delay;
+        if (!m_started || arrival < m_first_arrival) {
+            m_first_arrival = arrival;
+            m_started = true;
+        }
+
+        unsigned index = pick_lane(ext->key, arrival);
+        Lane& lane = m_lanes[index];
+
+        // Request: address phase, key and data beats
+        sc_core::sc_time at_lane = transfer(now, arrival, AES_KEY_SIZE + length, "request");
+
+        // Wait behind the lane's earlier work
+        while (!lane.pending.empty() && lane.pending.front() <= at_lane) {
+            lane.pending.pop_front();
+        }
+        sc_core::sc_time start = at_lane < lane.free ? lane.free : at_lane;
+        uint64_t cycles = static_cast<uint64_t>(length / AES_BLOCK_SIZE) * m_timing.cycles_per_block;
+        sc_core::sc_time work_start = start;
+        if (!lane.key_loaded || !(lane.key.key == ext->key.key)) {
+            work_start += m_timing.clock_period * static_cast<double>(m_timing.key_load_cycles);
+            TimelineTrace::span(m_lane_traces[index].id(), "key load", start, work_start);
+            cycles += m_timing.key_load_cycles;
+            lane.key = ext->key;
+            lane.key_loaded = true;
+            lane.stats.key_loads++;
+        }
+        sc_core::sc_time service = m_timing.clock_period * static_cast<double>(cycles);
+        lane.free = start + service;
+        TimelineTrace::span(m_lane_traces[index].id(),
+                            ext->operation == AesOperation::ENCRYPT ? "encrypt" : "decrypt", work_start, lane.free);
+        lane.pending.push_back(lane.free);
+        lane.stats.transactions++;
+        lane.stats.blocks += length / AES_BLOCK_SIZE;
+        lane.stats.busy += service;
+        lane.stats.queue_wait += start - at_lane;
+        if (lane.pending.size() > lane.stats.max_queue) {
+            lane.stats.max_queue = lane.pending.size();
+        }
+
+        // Functional result from the lane; its own delay annotation is
+        // replaced by the lane timing above
+        sc_core::sc_time lane_delay = sc_core::SC_ZERO_TIME;
+        (*lane_sockets[index])->b_transport(trans, lane_delay);
+        if (trans.is_response_error()) {
+            return;
+        }
+
+        // Response: address phase and data beats
+        sc_core::sc_time done = transfer(now, lane.free, length, "response");
+        if (m_last_done < done) {
+            m_last_done = done;
+        }
+        delay = done - now;
+    }
+
+private:
+    struct Lane {
+        sc_core::sc_time free = sc_core::SC_ZERO_TIME;
+        std::deque<sc_core::sc_time> pending;  // Finish times of queued work
+        AesKey key;
+        bool key_loaded = false;
+        AesLaneStats stats;
+    };
+
+    AesLanePolicy m_policy;
+    AesLaneTiming m_timing;
+    std::vector<Lane> m_lanes;
+    unsigned m_next_lane;
+    std::deque<std::pair<sc_core::sc_time, sc_core::sc_time>> m_bus_slots;  // Reserved, by start time
+    AesInterconnectStats m_bus;
+    sc_core::sc_time m_first_arrival;
+    sc_core::sc_time m_last_done;
+    bool m_started;
+    TimelineTrack m_bus_trace;
+    std::vector<TimelineTrack> m_lane_traces;
+
+    unsigned pick_lane(const AesKey& key, const sc_core::sc_time& arrival) {
+        unsigned n = num_lanes();
+        switch (m_policy) {
+        case AesLanePolicy::LEAST_LOADED: {
+            // Earliest free lane; ties rotate so idle lanes share the work
+            unsigned best = m_next_lane;
+            for (unsigned i = 1; i < n; i++) {
+                unsigned lane = (m_next_lane + i) % n;
+                sc_core::sc_time lane_free = m_lanes[lane].free < arrival ? arrival : m_lanes[lane].free;
+                sc_core::sc_time best_free = m_lanes[best].free < arrival ? arrival : m_lanes[best].free;
+                if (lane_free < best_free) {
+                    best = lane;
+                }
+            }
+            m_next_lane = (best + 1) % n;
+            return best;
+        }
+        case AesLanePolicy::KEY_AFFINITY: {
+            // FNV-1a over the key bytes
+            uint32_t hash = 2166136261u;
+            for (uint8_t b : key.key) {
+                hash = (hash ^ b) * 16777619u;
+            }
+            return hash % n;
+        }
+        default: {
+            unsigned lane = m_next_lane;
+            m_next_lane = (m_next_lane + 1) % n;
+            return lane;
+        }
+        }
+    }
+
+    // Move bytes over the shared bus no earlier than ready, in the first
+    // gap long enough among the transfers already reserved (results are
+    // reserved ahead of time, so gaps open up before them); returns the time
+    // the last beat lands
+    sc_core::sc_time transfer(const sc_core::sc_time& now, const sc_core::sc_time& ready, unsigned bytes,
+                              const char* what) {
+        unsigned beats = (bytes + m_timing.bus_bytes - 1) / m_timing.bus_bytes;
+        sc_core::sc_time duration = m_timing.clock_period * static_cast<double>(m_timing.bus_overhead_cycles + beats);
+
+        // Nothing arrives before now, so older reservations can go
+        while (!m_bus_slots.empty() && m_bus_slots.front().second <= now) {
+            m_bus_slots.pop_front();
+        }
+        sc_core::sc_time start = ready;
+        auto it = m_bus_slots.begin();
+        for (; it != m_bus_slots.end(); ++it) {
+            if (start + duration <= it->first) {
+                break;
+            }
+            if (start < it->second) {
+                start = it->second;
+            }
+        }
+        m_bus_slots.insert(it, std::make_pair(start, start + duration));
+        TimelineTrace::span(m_bus_trace.id(), what, start, start + duration);
+
+        m_bus.wait += start - ready;
+        m_bus.busy += duration;
+        m_bus.beats += beats;
+        return start + duration;
+    }
+};
+
+#endif // AES_LANE_ROUTER_H
@@ -0,0 +1,44 @@
+#ifndef AES_LANE_SYSTEM_H
+#define AES_LANE_SYSTEM_H
+
+#include "aes_key_expansion.h"
+#include "aes_round.h"
+#include "aes_top.h"
+#include "aes_lane_router.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// One AES core: AesTop with its key expansion and round modules
+struct AesCore {
+    std::unique_ptr<AesTop> top;
+    std::unique_ptr<AesKeyExpansion> key_expansion;
+    std::unique_ptr<AesRound> round;
+
+    explicit AesCore(const std::string& suffix) :
+        top(new AesTop(("aes_top_" + suffix).c_str())),
+        key_expansion(new AesKeyExpansion(("key_expansion_" + suffix).c_str())),
+        round(new AesRound(("aes_round_" + suffix).c_str())) {
+        top->key_expansion_socket.bind(key_expansion->key_socket);
+        top->round_socket.bind(round->round_socket);
+    }
+};
+
+// An AesLaneRouter with one AesCore behind each lane. Initiators bind to
+// router->bus_socket.
+struct AesLaneSystem {
+    std::unique_ptr<AesLaneRouter> router;
+    std::vector<std::unique_ptr<AesCore>> cores;
+
+    AesLaneSystem(const std::string& suffix, unsigned lanes,
+                  AesLanePolicy policy = AesLanePolicy::LEAST_LOADED,
+                  const AesLaneTiming& timing = AesLaneTiming()) :
+        router(new AesLaneRouter(("router_" + suffix).c_str(), lanes, policy, timing)) {
+        for (unsigned i = 0; i < lanes; i++) {
+            cores.emplace_back(new AesCore(suffix + "_" + std::to_string(i)));
+            router->lane_sockets[i]->bind(cores.back()->top->top_socket);
+        }
+    }
+};
+
+#endif // AES_LANE_SYSTEM_H
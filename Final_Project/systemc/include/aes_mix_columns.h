@@ -1,8 +1,7 @@
 #ifndef AES_MIX_COLUMNS_H
 #define AES_MIX_COLUMNS_H
 
-#include "aes_types.h"
-#include <systemc>
+#include "aes_block.h"
 
 // MixColumns transformation for AES
 class AesMixColumns {
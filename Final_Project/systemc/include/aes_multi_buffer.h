@@ -0,0 +1,114 @@
+#ifndef AES_MULTI_BUFFER_H
+#define AES_MULTI_BUFFER_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Multi-buffer CBC encryption and CMAC. Both chain every block through the
+// previous one, so a single stream waits out the full latency of each AES
+// round. This engine keeps up to AES_MULTI_BUFFER_MAX_LANES independent
+// streams in flight, one block of each per step, so the rounds of different
+// streams overlap. A lane that finishes its stream is refilled from the
+// queue at once. Defined in cipher/aes_multi_buffer.cpp (libaes_cipher).
+
+constexpr size_t AES_MULTI_BUFFER_MAX_LANES = 8;
+
+// One CBC encryption stream; iv is updated to the last ciphertext block
+struct AesCbcStream {
+    const AesKeySchedule* key;
+    const uint8_t* in;
+    uint8_t* out;        // May equal in
+    size_t num_blocks;
+    uint8_t iv[AES_BLOCK_SIZE];
+};
+
+// CMAC (SP 800-38B) key: the cipher key and its two derived subkeys
+class AesCmacKey {
+public:
+    explicit AesCmacKey(const AesKey& key, AesKeyKernel kernel = AesKeyKernel::AUTO);
+
+    const AesKeySchedule& schedule() const { return m_schedule; }
+    const uint8_t* k1() const { return m_k1; }
+    const uint8_t* k2() const { return m_k2; }
+
+    // Tag of one message, one block at a time
+    void compute(const uint8_t* message, size_t length, uint8_t* tag) const;
+
+private:
+    AesKeySchedule m_schedule;
+    uint8_t m_k1[AES_BLOCK_SIZE];
+    uint8_t m_k2[AES_BLOCK_SIZE];
+};
+
+// One CMAC stream; tag receives the full 16-byte MAC
+struct AesCmacStream {
+    const AesCmacKey* key;
+    const uint8_t* message;
+    size_t length;       // Bytes, may be 0
+    uint8_t tag[AES_BLOCK_SIZE];
+};
+
+// Lane occupancy of the last run: blocks processed over lanes * steps
+struct AesMultiBufferStats {
+    size_t streams = 0;
+    size_t blocks = 0;
+    size_t steps = 0;
+    size_t lanes = 0;
+
+    double occupancy() const { return steps ? static_cast<double>(blocks) / (steps * lanes) : 0.0; }
+};
+
+// Queues streams and runs them through the lanes. flush() orders the queue
+// longest first, so the streams that share lanes at any moment have similar
+// lengths, and the short ones at the end fill the gaps left as the long
+// ones finish. Streams may use different keys.
+class AesMultiBuffer {
+public:
+    explicit AesMultiBuffer(size_t lanes = AES_MULTI_BUFFER_MAX_LANES, AesKeyKernel kernel = AesKeyKernel::AUTO);
+
+    size_t lanes() const { return m_lanes; }
+    AesKeyKernel kernel() const { return m_kernel; }
+
+    // Streams are only referenced; results are written when flush() runs
+    void add(AesCbcStream& stream);
+    void add(AesCmacStream& stream);
+
+    // Process every queued stream
+    void flush();
+
+    const AesMultiBufferStats& stats() const { return m_stats; }
+
+private:
+    // Common form of both modes: state = E(state ^ block) over the blocks,
+    // with the ciphertext stored (CBC) or only the final state kept (CMAC)
+    struct Chain {
+        const AesRoundKeys* round_keys;
+        const uint8_t* in;
+        uint8_t* out;             // nullptr for CMAC
+        size_t num_blocks;
+        bool cmac;                // Final block is last_block, not in[]
+        uint8_t last_block[AES_BLOCK_SIZE];
+        uint8_t* state;           // IV in, chaining value or tag out
+
+        const uint8_t* block(size_t i) const {
+            return (cmac && i + 1 == num_blocks) ? last_block : in + i * AES_BLOCK_SIZE;
+        }
+    };
+
+    size_t m_lanes;
+    AesKeyKernel m_kernel;
+    std::vector<Chain> m_queue;
+    AesMultiBufferStats m_stats;
+
+    void run_scalar(std::vector<Chain>& chains);
+    void run_aesni(std::vector<Chain>& chains);
+};
+
+// One-call forms
+void aes_cbc_encrypt_streams(AesCbcStream* streams, size_t count, size_t lanes = AES_MULTI_BUFFER_MAX_LANES);
+void aes_cmac_streams(AesCmacStream* streams, size_t count, size_t lanes = AES_MULTI_BUFFER_MAX_LANES);
+
+#endif // AES_MULTI_BUFFER_H
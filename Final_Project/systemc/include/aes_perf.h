@@ -0,0 +1,313 @@
+#ifndef AES_PERF_H
+#define AES_PERF_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Optional hardware counter instrumentation for the AES benchmarks. Each
+// region accumulates wall time and, where perf_event_open is allowed,
+// cycles, instructions, L1D and LLC misses and branch misses for the code
+// inside its scopes. The report divides them by the blocks and bytes the
+// region processed, so a region should wrap a whole loop, not one block:
+// reading the counters costs a system call.
+//
+// Disabled by default, so scopes cost one branch. When the counters cannot
+// be opened (no PMU in a VM, perf_event_paranoid, non-Linux), regions still
+// report wall time and the counter columns read "n/a". No SystemC.
+
+enum class AesPerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    COUNT
+};
+
+constexpr int AES_PERF_EVENTS = static_cast<int>(AesPerfEvent::COUNT);
+
+inline const char* aes_perf_event_name(AesPerfEvent event) {
+    switch (event) {
+    case AesPerfEvent::CYCLES: return "cycles";
+    case AesPerfEvent::INSTRUCTIONS: return "instructions";
+    case AesPerfEvent::L1D_MISSES: return "L1D read misses";
+    case AesPerfEvent::LLC_MISSES: return "LLC misses";
+    case AesPerfEvent::BRANCH_MISSES: return "branch misses";
+    default: return "unknown";
+    }
+}
+
+// One snapshot of the counters
+struct AesPerfSample {
+    std::chrono::steady_clock::time_point wall;
+    uint64_t counts[AES_PERF_EVENTS] = {0};
+};
+
+// Counter group of the calling thread, user space only
+class AesPerfCounters {
+public:
+    AesPerfCounters() {
+        for (int& fd : m_fds) {
+            fd = -1;
+        }
+        for (bool& open : m_open) {
+            open = false;
+        }
+        open_group();
+    }
+
+    ~AesPerfCounters() {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                close_fd(fd);
+            }
+        }
+    }
+
+    AesPerfCounters(const AesPerfCounters&) = delete;
+    AesPerfCounters& operator=(const AesPerfCounters&) = delete;
+
+    // At least the cycle counter is running
+    bool available() const { return m_open[0]; }
+    bool has(AesPerfEvent event) const { return m_open[static_cast<int>(event)]; }
+
+    // Why the counters are missing, for the report
+    const std::string& status() const { return m_status; }
+
+    AesPerfSample sample() const {
+        AesPerfSample s;
+        s.wall = std::chrono::steady_clock::now();
+#ifdef __linux__
+        if (!available()) {
+            return s;
+        }
+        // PERF_FORMAT_GROUP: nr, time_enabled, time_running, then one value
+        // per member in the order they were added
+        uint64_t buffer[3 + AES_PERF_EVENTS];
+        ssize_t bytes = read(m_fds[0], buffer, sizeof(buffer));
+        if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            return s;
+        }
+        // Scale up if the kernel had to multiplex the PMU
+        double scale = (buffer[2] > 0 && buffer[2] < buffer[1]) ? static_cast<double>(buffer[1]) / buffer[2] : 1.0;
+        uint64_t index = 0;
+        for (int e = 0; e < AES_PERF_EVENTS && index < buffer[0]; e++) {
+            if (m_open[e]) {
+                s.counts[e] = static_cast<uint64_t>(buffer[3 + index++] * scale);
+            }
+        }
+#endif
+        return s;
+    }
+
+private:
+    int m_fds[AES_PERF_EVENTS];
+    bool m_open[AES_PERF_EVENTS];
+    std::string m_status;
+
+    static void close_fd(int fd) {
+#ifdef __linux__
+        close(fd);
+#else
+        (void)fd;
+#endif
+    }
+
+    void open_group() {
+#ifdef __linux__
+        static const struct {
+            uint32_t type;
+            uint64_t config;
+        } events[AES_PERF_EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+
+        for (int e = 0; e < AES_PERF_EVENTS; e++) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[e].type;
+            attr.config = events[e].config;
+            attr.exclude_kernel = 1;  // Allowed at perf_event_paranoid 2
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.disabled = (e == 0);
+
+            int group = (e == 0) ? -1 : m_fds[0];
+            int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+            if (fd < 0) {
+                if (e == 0) {
+                    m_status = std::string("perf_event_open: ") + std::strerror(errno);
+                    return;
+                }
+                // A missing event (e.g. no LLC counter in a VM) only drops
+                // that column
+                continue;
+            }
+            m_fds[e] = fd;
+            m_open[e] = true;
+        }
+        ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        m_status = "ok";
+#else
+        m_status = "perf_event_open needs Linux";
+#endif
+    }
+};
+
+// Totals for one named region
+struct AesPerfRegion {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    uint64_t counts[AES_PERF_EVENTS] = {0};
+};
+
+// The regions of one benchmark run and their report
+class AesPerf {
+public:
+    // Enabled by --perf on the command line or AES_PERF=1 in the environment
+    explicit AesPerf(bool enabled) : m_enabled(enabled || env_enabled()) {
+        if (m_enabled) {
+            m_counters.reset(new AesPerfCounters());
+        }
+    }
+
+    AesPerf(int argc, char* argv[]) : AesPerf(has_flag(argc, argv, "--perf")) {}
+
+    bool enabled() const { return m_enabled; }
+    const AesPerfCounters* counters() const { return m_counters.get(); }
+
+    AesPerfRegion& region(const std::string& name) {
+        for (AesPerfRegion& r : m_regions) {
+            if (r.name == name) {
+                return r;
+            }
+        }
+        m_regions.push_back(AesPerfRegion());
+        m_regions.back().name = name;
+        return m_regions.back();
+    }
+
+    const std::vector<AesPerfRegion>& regions() const { return m_regions; }
+
+    // Measures everything between construction and destruction into a
+    // region; blocks and bytes are what that code processed
+    class Scope {
+    public:
+        Scope(AesPerf& perf, const char* name, uint64_t blocks, uint64_t bytes) :
+            m_perf(perf.m_enabled ? &perf : nullptr),
+            m_name(name),
+            m_blocks(blocks),
+            m_bytes(bytes) {
+            if (m_perf) {
+                m_start = m_perf->m_counters->sample();
+            }
+        }
+
+        ~Scope() {
+            if (!m_perf) {
+                return;
+            }
+            AesPerfSample end = m_perf->m_counters->sample();
+            AesPerfRegion& r = m_perf->region(m_name);
+            r.calls++;
+            r.blocks += m_blocks;
+            r.bytes += m_bytes;
+            r.seconds += std::chrono::duration<double>(end.wall - m_start.wall).count();
+            for (int e = 0; e < AES_PERF_EVENTS; e++) {
+                r.counts[e] += end.counts[e] - m_start.counts[e];
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        AesPerf* m_perf;
+        const char* m_name;
+        uint64_t m_blocks;
+        uint64_t m_bytes;
+        AesPerfSample m_start;
+    };
+
+    void print_report(std::ostream& os) const {
+        if (!m_enabled) {
+            return;
+        }
+        os << "=== Hardware Counters (per block unless noted) ===" << std::endl;
+        os << "Counters: " << m_counters->status() << std::endl;
+        os << std::left << std::setw(22) << "Region" << std::right << std::setw(9) << "Blocks"
+           << std::setw(11) << "Wall us" << std::setw(10) << "ns/blk" << std::setw(10) << "cyc/byte"
+           << std::setw(7) << "IPC" << std::setw(10) << "L1D miss" << std::setw(10) << "LLC miss"
+           << std::setw(10) << "Br miss" << std::endl;
+
+        for (const AesPerfRegion& r : m_regions) {
+            double blocks = r.blocks ? static_cast<double>(r.blocks) : 1.0;
+            os << std::left << std::setw(22) << r.name << std::right << std::setw(9) << r.blocks
+               << std::fixed << std::setprecision(1) << std::setw(11) << r.seconds * 1e6
+               << std::setw(10) << r.seconds * 1e9 / blocks
+               << cell(AesPerfEvent::CYCLES, r.bytes ? static_cast<double>(r.counts[0]) / r.bytes : 0.0, 10, 1)
+               << cell(AesPerfEvent::INSTRUCTIONS, r.counts[0] ? static_cast<double>(r.counts[1]) / r.counts[0] : 0.0, 7, 2)
+               << cell(AesPerfEvent::L1D_MISSES, r.counts[2] / blocks, 10, 2)
+               << cell(AesPerfEvent::LLC_MISSES, r.counts[3] / blocks, 10, 3)
+               << cell(AesPerfEvent::BRANCH_MISSES, r.counts[4] / blocks, 10, 3) << std::endl;
+        }
+    }
+
+private:
+    bool m_enabled;
+    std::unique_ptr<AesPerfCounters> m_counters;
+    std::vector<AesPerfRegion> m_regions;
+
+    static bool env_enabled() {
+        const char* value = std::getenv("AES_PERF");
+        return value && value[0] && std::strcmp(value, "0") != 0;
+    }
+
+    static bool has_flag(int argc, char* argv[], const char* flag) {
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], flag) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string cell(AesPerfEvent event, double value, int width, int precision) const {
+        std::ostringstream ss;
+        ss << std::setw(width);
+        if (m_counters->has(event)) {
+            ss << std::fixed << std::setprecision(precision) << value;
+        } else {
+            ss << "n/a";
+        }
+        return ss.str();
+    }
+};
+
+#endif // AES_PERF_H
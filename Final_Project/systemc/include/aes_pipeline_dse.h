@@ -0,0 +1,271 @@
+#ifndef AES_PIPELINE_DSE_H
+#define AES_PIPELINE_DSE_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <systemc>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Design-space exploration of the encryption datapath between the two RTL
+// designs: aes_top.v runs one round of logic per clock and loops over it
+// ten times, aes_pipelined.v unrolls all ten rounds with a register after
+// each. A configuration here places `stages` register stages of
+// `rounds_per_stage` rounds each in a loop that a block goes around until
+// it has had all ten rounds, and may cut every stage once more (sub-round
+// pipelining: for one round per stage, between SubBytes/ShiftRows and
+// MixColumns/AddRoundKey).
+//
+// AesPipelineModel simulates a configuration clock by clock on real data.
+// aes_pipeline_estimate() adds a first-order clock and resource estimate,
+// calibrated so that 1x1 runs at the 100 MHz of aes_top.v and 1x10 lands on
+// the ~3-4k LUTs and ~2-3k registers reported for aes_pipelined.v. Use it
+// to rank configurations, not in place of synthesis.
+
+// Register stage cuts inside one stage of round logic
+constexpr unsigned AES_DSE_MAX_SUB_STAGES = 2;
+
+struct AesPipelineConfig {
+    unsigned rounds_per_stage = 1;  // Rounds of logic between registers: 1, 2, 5 or 10
+    unsigned stages = 1;            // Stages in the loop; rounds_per_stage * stages divides 10
+    unsigned sub_stages = 1;        // 2 adds a register in the middle of every stage
+
+    unsigned round_units() const { return rounds_per_stage * stages; }
+    unsigned passes() const { return AES_NUM_ROUNDS / round_units(); }
+    unsigned depth() const { return stages * sub_stages; }
+
+    // Half rounds done by one register stage: SubBytes+ShiftRows is the
+    // first half of a round, MixColumns+AddRoundKey the second
+    unsigned half_rounds_per_register() const { return 2 * rounds_per_stage / sub_stages; }
+
+    bool valid() const {
+        return (rounds_per_stage == 1 || rounds_per_stage == 2 || rounds_per_stage == 5 ||
+                rounds_per_stage == 10) &&
+               stages > 0 && AES_NUM_ROUNDS % round_units() == 0 &&
+               sub_stages > 0 && sub_stages <= AES_DSE_MAX_SUB_STAGES;
+    }
+
+    // "1x10" = one round per stage, ten stages; "/2" when sub-staged
+    std::string name() const {
+        std::string n = std::to_string(rounds_per_stage) + "x" + std::to_string(stages);
+        if (sub_stages > 1) {
+            n += "/" + std::to_string(sub_stages);
+        }
+        return n;
+    }
+
+    // Every valid configuration, iterative designs first
+    static std::vector<AesPipelineConfig> sweep() {
+        std::vector<AesPipelineConfig> configs;
+        for (unsigned units : {1u, 2u, 5u, 10u}) {
+            for (unsigned rounds : {1u, 2u, 5u, 10u}) {
+                for (unsigned sub = 1; sub <= AES_DSE_MAX_SUB_STAGES; sub++) {
+                    AesPipelineConfig c;
+                    c.rounds_per_stage = rounds;
+                    c.stages = units / rounds;
+                    c.sub_stages = sub;
+                    if (units % rounds == 0 && c.valid()) {
+                        configs.push_back(c);
+                    }
+                }
+            }
+        }
+        return configs;
+    }
+};
+
+// Relative logic delays, in units of one full round
+constexpr double AES_DSE_SUB_SHIFT_DELAY = 0.6;   // SubBytes + ShiftRows
+constexpr double AES_DSE_MIX_ADD_DELAY = 0.4;     // MixColumns + AddRoundKey
+constexpr double AES_DSE_REGISTER_DELAY = 0.25;   // Clock-to-out, setup and routing
+constexpr double AES_DSE_LOOP_MUX_DELAY = 0.1;    // Input/feedback mux of a loop
+constexpr double AES_DSE_BASELINE_MHZ = 100.0;    // aes_top.v (1x1)
+
+// Xilinx 7-series cost model: a round unit is 16 LUT S-boxes plus
+// MixColumns and AddRoundKey; all 11 round keys sit in registers, as in
+// key_expansion.v; a slice holds 4 LUTs and 8 flip-flops
+constexpr unsigned AES_DSE_LUTS_PER_ROUND = 320;
+constexpr unsigned AES_DSE_CONTROL_LUTS = 32;
+constexpr unsigned AES_DSE_KEY_FFS = (AES_NUM_ROUNDS + 1) * 128;
+
+struct AesPipelineEstimate {
+    double stage_delay;  // Critical path, in rounds
+    double clock_mhz;
+    unsigned luts;
+    unsigned ffs;
+    unsigned slices;
+};
+
+inline AesPipelineEstimate aes_pipeline_estimate(const AesPipelineConfig& config) {
+    AesPipelineEstimate e;
+    bool loops = config.passes() > 1;
+
+    // Slowest register stage: the half rounds it covers start at an offset
+    // that alternates between first and second halves when the count is odd
+    unsigned h = config.half_rounds_per_register();
+    double worst = 0.0;
+    for (unsigned r = 0; r < config.depth(); r++) {
+        double delay = 0.0;
+        for (unsigned k = r * h; k < (r + 1) * h; k++) {
+            delay += (k % 2 == 0) ? AES_DSE_SUB_SHIFT_DELAY : AES_DSE_MIX_ADD_DELAY;
+        }
+        worst = std::max(worst, delay);
+    }
+    e.stage_delay = worst + AES_DSE_REGISTER_DELAY + (loops ? AES_DSE_LOOP_MUX_DELAY : 0.0);
+
+    const double baseline_delay = AES_DSE_SUB_SHIFT_DELAY + AES_DSE_MIX_ADD_DELAY +
+                                  AES_DSE_REGISTER_DELAY + AES_DSE_LOOP_MUX_DELAY;
+    e.clock_mhz = AES_DSE_BASELINE_MHZ * baseline_delay / e.stage_delay;
+
+    // A loop adds the 128-bit feedback mux, and each round unit selects
+    // among `passes` round keys (a LUT6 mux covers four inputs)
+    e.luts = config.round_units() * AES_DSE_LUTS_PER_ROUND + AES_DSE_CONTROL_LUTS;
+    if (loops) {
+        e.luts += 128 + config.round_units() * 128 * ((config.passes() + 3) / 4);
+    }
+
+    // Input register (initial AddRoundKey), loop registers with a valid
+    // bit each, and a round counter per register in a loop
+    e.ffs = AES_DSE_KEY_FFS + 128 + config.depth() * (128 + 1 + (loops ? 4 : 0));
+    e.slices = std::max((e.luts + 3) / 4, (e.ffs + 7) / 8);
+    return e;
+}
+
+// Measured over one workload
+struct AesPipelineStats {
+    uint64_t blocks = 0;
+    uint64_t mismatches = 0;         // Outputs that differ from AesCipher
+    uint64_t first_latency = 0;      // Cycles, input register to output, unloaded
+    uint64_t total_latency = 0;      // Sum over all blocks, including queueing in the loop
+    uint64_t first_in_cycle = 0;
+    uint64_t last_out_cycle = 0;
+
+    double blocks_per_clock() const {
+        return blocks ? static_cast<double>(blocks) / (last_out_cycle - first_in_cycle + 1) : 0.0;
+    }
+    double mean_latency() const { return blocks ? static_cast<double>(total_latency) / blocks : 0.0; }
+};
+
+// Clocked model of one configuration. The workload is queued before the
+// simulation starts; the model loads a block into the input register
+// whenever it is free, one per clock, and checks every ciphertext.
+class AesPipelineModel : public sc_core::sc_module {
+public:
+    sc_core::sc_in<bool> clk;
+
+    SC_HAS_PROCESS(AesPipelineModel);
+    AesPipelineModel(sc_core::sc_module_name name, const AesPipelineConfig& config) :
+        sc_core::sc_module(name),
+        clk("clk"),
+        m_config(config),
+        m_regs(config.depth()),
+        m_next(0),
+        m_cycle(0) {
+
+        if (!config.valid()) {
+            SC_REPORT_ERROR("AesPipelineModel", "Unsupported datapath configuration");
+        }
+
+        SC_METHOD(clock_edge);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void load(const AesKey& key, const std::vector<AesBlock>& plaintexts) {
+        AesCipher::expand_key(key, m_round_keys);
+        m_plaintexts = plaintexts;
+        m_next = 0;
+    }
+
+    const AesPipelineConfig& config() const { return m_config; }
+    const AesPipelineStats& stats() const { return m_stats; }
+    bool done() const { return m_stats.blocks == m_plaintexts.size(); }
+
+private:
+    struct Slot {
+        bool valid = false;
+        AesBlock state;
+        unsigned half = 0;        // Half rounds done, 0 to 2 * AES_NUM_ROUNDS
+        size_t index = 0;         // Workload position
+        uint64_t in_cycle = 0;    // Clock that loaded the input register
+    };
+
+    AesPipelineConfig m_config;
+    AesRoundKeys m_round_keys;
+    std::vector<AesBlock> m_plaintexts;
+    Slot m_input;
+    std::vector<Slot> m_regs;
+    size_t m_next;
+    uint64_t m_cycle;
+    AesPipelineStats m_stats;
+
+    // Combinational logic of one register stage
+    Slot advance(Slot slot) const {
+        for (unsigned k = 0; k < m_config.half_rounds_per_register(); k++) {
+            unsigned round = slot.half / 2 + 1;
+            if (slot.half % 2 == 0) {
+                slot.state = AesShiftRows::shift_rows(AesSBox::sub_bytes(slot.state));
+            } else {
+                if (round < AES_NUM_ROUNDS) {
+                    slot.state = AesMixColumns::mix_columns(slot.state);
+                }
+                slot.state = slot.state ^ m_round_keys.round_keys[round];
+            }
+            slot.half++;
+        }
+        return slot;
+    }
+
+    void clock_edge() {
+        m_cycle++;
+        const unsigned finished = 2 * AES_NUM_ROUNDS;
+        Slot& last = m_regs.back();
+
+        // Output register: a block with all rounds done leaves the loop
+        if (last.valid && last.half == finished) {
+            if (!(last.state == AesCipher::encrypt_block(m_plaintexts[last.index], m_round_keys))) {
+                m_stats.mismatches++;
+            }
+            // Latched on the previous edge; the input register cycle counts
+            uint64_t latency = m_cycle - last.in_cycle;
+            if (m_stats.blocks == 0) {
+                m_stats.first_latency = latency;
+            }
+            m_stats.total_latency += latency;
+            m_stats.last_out_cycle = m_cycle - 1;
+            m_stats.blocks++;
+            last.valid = false;
+        }
+
+        // Shift the loop; the feedback path has priority over new input
+        Slot wrap = last;
+        for (size_t r = m_regs.size() - 1; r > 0; r--) {
+            m_regs[r] = m_regs[r - 1].valid ? advance(m_regs[r - 1]) : Slot();
+        }
+        if (wrap.valid) {
+            m_regs[0] = advance(wrap);
+        } else if (m_input.valid) {
+            m_regs[0] = advance(m_input);
+            m_input.valid = false;
+        } else {
+            m_regs[0] = Slot();
+        }
+
+        // Input register: initial AddRoundKey of the next block
+        if (!m_input.valid && m_next < m_plaintexts.size()) {
+            m_input.valid = true;
+            m_input.state = m_plaintexts[m_next] ^ m_round_keys.round_keys[0];
+            m_input.half = 0;
+            m_input.index = m_next;
+            m_input.in_cycle = m_cycle;
+            if (m_next == 0) {
+                m_stats.first_in_cycle = m_cycle;
+            }
+            m_next++;
+        }
+    }
+};
+
+#endif // AES_PIPELINE_DSE_H
@@ -2,9 +2,8 @@
 #define AES_ROUND_H
 
 #include "aes_types.h"
-#include "aes_sbox.h"
-#include "aes_shift_rows.h"
-#include "aes_mix_columns.h"
+#include "aes_cipher.h"
+#include "timeline_trace.h"
 #include <systemc>
 
 // AES Round module for encryption and decryption
@@ -15,13 +14,16 @@ public:
     
     // Constructor
     SC_HAS_PROCESS(AesRound);
-    AesRound(sc_core::sc_module_name name) : sc_core::sc_module(name), round_socket("round_socket") {
+    AesRound(sc_core::sc_module_name name) : sc_core::sc_module(name), round_socket("round_socket"), m_trace(this->name()),
+        m_have_round_keys(false) {
         // Register callback for incoming transactions
         round_socket.register_b_transport(this, &AesRound::b_transport);
     }
     
     // TLM blocking transport method
     void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        TimelineScope scope(m_trace, "round", &delay);
+        
         // Extract data from the transaction
         AesBlock* block_ptr = reinterpret_cast<AesBlock*>(trans.get_data_ptr());
         
@@ -33,7 +35,11 @@ public:
         }
         
         // Get the round key and flags from the extension
-        AesBlock round_key = ext->key.round_keys[ext->round_index];
+        if (ext->round_index < 0 || ext->round_index > AES_NUM_ROUNDS) {
+            trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
+            return;
+        }
+        const AesBlock& round_key = round_keys_for(ext->key).round_keys[ext->round_index];
         bool is_final_round = (ext->round_index == AES_NUM_ROUNDS);
         bool is_first_round = (ext->round_index == 0);
         
@@ -50,41 +56,30 @@ public:
     
     // Static method to perform one round of encryption
     static AesBlock encrypt_round(const AesBlock& block, const AesBlock& round_key, bool is_final_round) {
-        // 1. SubBytes
-        AesBlock after_sub_bytes = AesSBox::sub_bytes(block);
-        
-        // 2. ShiftRows
-        AesBlock after_shift_rows = AesShiftRows::shift_rows(after_sub_bytes);
-        
-        // 3. MixColumns (skipped in final round)
-        AesBlock after_mix_columns;
-        if (is_final_round) {
-            after_mix_columns = after_shift_rows;
-        } else {
-            after_mix_columns = AesMixColumns::mix_columns(after_shift_rows);
-        }
-        
-        // 4. AddRoundKey
-        return after_mix_columns ^ round_key;
+        return AesCipher::encrypt_round(block, round_key, is_final_round);
     }
     
     // Static method to perform one round of decryption
     static AesBlock decrypt_round(const AesBlock& block, const AesBlock& round_key, bool is_first_round) {
-        // 1. InvShiftRows
-        AesBlock after_inv_shift_rows = AesShiftRows::inv_shift_rows(block);
-        
-        // 2. InvSubBytes
-        AesBlock after_inv_sub_bytes = AesSBox::inv_sub_bytes(after_inv_shift_rows);
-        
-        // 3. AddRoundKey
-        AesBlock after_add_round_key = after_inv_sub_bytes ^ round_key;
-        
-        // 4. InvMixColumns (skipped in first round)
-        if (is_first_round) {
-            return after_add_round_key;
-        } else {
-            return AesMixColumns::inv_mix_columns(after_add_round_key);
+        return AesCipher::decrypt_round(block, round_key, is_first_round);
+    }
+    
+private:
+    TimelineTrack m_trace;
+    
+    // Schedule of the last key seen. A block's rounds arrive back to back
+    // under one key, so one entry saves the expansion on all but the first.
+    bool m_have_round_keys;
+    AesKey m_cached_key;
+    AesRoundKeys m_round_keys;
+    
+    const AesRoundKeys& round_keys_for(const AesKey& key) {
+        if (!m_have_round_keys || key.key != m_cached_key.key) {
+            AesCipher::expand_key(key, m_round_keys);
+            m_cached_key = key;
+            m_have_round_keys = true;
         }
+        return m_round_keys;
     }
 };
 
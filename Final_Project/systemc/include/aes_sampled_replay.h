@@ -0,0 +1,373 @@
+#ifndef AES_SAMPLED_REPLAY_H
+#define AES_SAMPLED_REPLAY_H
+
+#include "aes_types.h"
+#include "aes_cipher.h"
+#include "aes_workload.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Sampled replay, after SMARTS (Wunderlich et al., ISCA 2003), for
+// workloads too long to run through the timed model in full. The trace is
+// replayed repeats times and cut into units of unit_requests requests. One
+// unit per period, at a random offset in each period, goes through the
+// timed model behind warmup_requests of warm-up; every other request takes
+// the functional fast path (AesKeySchedule, no transaction and no wait).
+// The measured units give a ratio estimate of the total simulated time and
+// mean latency with a confidence interval; measuring every unit gives the
+// exact total. few_units() and overloaded() flag estimates not to trust.
+//
+// Links libaes_cipher for AesKeySchedule.
+
+// Measured units below which the interval is only a rough guide
+constexpr uint64_t AES_SAMPLING_MIN_UNITS = 30;
+
+struct AesSamplingConfig {
+    uint64_t unit_requests = 200;
+    uint64_t warmup_requests = 400;     // Detailed but not measured, before each unit
+    uint64_t period = 100;              // One unit measured in every period
+    double z = 3.0;                     // Standard errors per interval half: 3 is 99.7%
+    unsigned seed = 460;                // Picks the measured unit in each period, and the data
+
+    // Every request timed and measured: the reference a sample is checked
+    // against
+    static AesSamplingConfig full(uint64_t unit_requests = 200) {
+        AesSamplingConfig config;
+        config.unit_requests = unit_requests;
+        config.warmup_requests = 0;
+        config.period = 1;
+        return config;
+    }
+};
+
+struct AesSamplingEstimate {
+    uint64_t requests = 0;
+    uint64_t blocks = 0;
+    uint64_t detailed_requests = 0;     // Through the timed model, warm-up included
+    uint64_t units = 0;                 // Measured
+    double z = 3.0;
+    double total_ns = 0.0;              // Simulated time, first arrival to last result
+    double total_ci_ns = 0.0;           // Half width of its interval
+    double arrival_span_ns = 0.0;       // First arrival to last
+    double unit_cv = 0.0;               // Spread of unit times around the ratio estimate
+    double mean_latency_ns = 0.0;
+    double latency_ci_ns = 0.0;
+    double wall_seconds = 0.0;
+
+    double gbps() const { return total_ns > 0.0 ? blocks * 128.0 / total_ns : 0.0; }
+    double gbps_low() const { return blocks * 128.0 / (total_ns + total_ci_ns); }
+    double gbps_high() const {
+        return total_ns > total_ci_ns ? blocks * 128.0 / (total_ns - total_ci_ns) : INFINITY;
+    }
+    double relative_ci() const { return total_ns > 0.0 ? total_ci_ns / total_ns : 0.0; }
+
+    // Results came back well after the last request arrived, so the queue
+    // grew over the run
+    bool overloaded() const { return total_ns - total_ci_ns > 1.05 * arrival_span_ns + 1e5; }
+
+    // Too few units for the normal interval, unless every unit was measured
+    bool few_units() const { return units < AES_SAMPLING_MIN_UNITS && detailed_requests < requests; }
+
+    // Measured units for an interval of +-error (relative) at the same z
+    uint64_t units_for(double error) const {
+        double n = std::ceil(z * unit_cv / error * z * unit_cv / error);
+        return static_cast<uint64_t>(std::max(2.0, n));
+    }
+};
+
+class AesSampledReplayer : public sc_core::sc_module {
+public:
+    tlm_utils::simple_initiator_socket<AesSampledReplayer> init_socket;
+
+    SC_HAS_PROCESS(AesSampledReplayer);
+    AesSampledReplayer(sc_core::sc_module_name name, const AesWorkloadTrace& trace, uint64_t repeats = 1,
+                       double rate_scale = 1.0, const AesSamplingConfig& config = AesSamplingConfig()) :
+        sc_core::sc_module(name),
+        init_socket("init_socket"),
+        m_trace(trace),
+        m_repeats(std::max<uint64_t>(1, repeats)),
+        m_rate_scale(rate_scale > 0.0 ? rate_scale : 1.0),
+        m_config(config),
+        m_rng(config.seed),
+        m_after(nullptr),
+        m_done(false),
+        m_mismatches(0),
+        m_errors(0) {
+        m_config.unit_requests = std::max<uint64_t>(1, m_config.unit_requests);
+        m_config.period = std::max<uint64_t>(1, m_config.period);
+        m_trace.sort_by_arrival();
+        SC_THREAD(run);
+    }
+
+    // Start only once event has been notified, so two replayers in one
+    // simulation run one after the other and their wall times stay apart
+    void start_after(const sc_core::sc_event& event) { m_after = &event; }
+    const sc_core::sc_event& finished() const { return m_finished; }
+
+    bool passed() const { return m_done && m_mismatches == 0 && m_errors == 0; }
+    uint64_t mismatches() const { return m_mismatches; }
+    uint64_t errors() const { return m_errors; }
+
+    AesSamplingEstimate estimate() const {
+        AesSamplingEstimate e = m_estimate;
+        size_t n = m_units.size();
+        e.units = n;
+        e.z = m_config.z;
+        if (n == 0) {
+            return e;
+        }
+
+        // Ratio estimate of the total over each size, and the spread of the
+        // units around it
+        double time = 0.0;
+        double requests = 0.0;
+        double arrival = 0.0;
+        double blocks = 0.0;
+        double latency = 0.0;
+        for (const Unit& u : m_units) {
+            time += u.ns;
+            requests += u.requests;
+            arrival += u.arrival_ns;
+            blocks += u.blocks;
+            latency += u.mean_latency_ns;
+        }
+        auto residual_sq = [this, time](double measured, double Unit::*size) {
+            double ratio = time / measured;
+            double sum = 0.0;
+            for (const Unit& u : m_units) {
+                double residual = u.ns - ratio * (u.*size);
+                sum += residual * residual;
+            }
+            return sum;
+        };
+        double spread = residual_sq(blocks, &Unit::blocks);
+        e.total_ns = time / blocks * e.blocks;
+        if (arrival > 0.0 && m_arrival_span_ns > 0.0) {
+            double arrival_spread = residual_sq(arrival, &Unit::arrival_ns);
+            if (arrival_spread < spread) {
+                spread = arrival_spread;
+                e.total_ns = time / arrival * m_arrival_span_ns;
+            }
+        }
+        e.arrival_span_ns = m_arrival_span_ns;
+        e.mean_latency_ns = latency / n;
+        if (n < 2) {
+            e.total_ci_ns = e.total_ns;
+            e.latency_ci_ns = e.mean_latency_ns;
+            return e;
+        }
+        double latency_sq = 0.0;
+        for (const Unit& u : m_units) {
+            latency_sq += (u.mean_latency_ns - e.mean_latency_ns) * (u.mean_latency_ns - e.mean_latency_ns);
+        }
+        double s = std::sqrt(spread / (n - 1));
+        double s_latency = std::sqrt(latency_sq / (n - 1));
+        double unmeasured = std::max(0.0, 1.0 - requests / e.requests);
+        double population_units = e.requests / (requests / n);
+        e.total_ci_ns = m_config.z * population_units * s * std::sqrt(unmeasured / n);
+        e.latency_ci_ns = m_config.z * s_latency * std::sqrt(unmeasured / n);
+        e.unit_cv = time > 0.0 ? s / (time / n) : 0.0;
+        return e;
+    }
+
+    void run() {
+        if (m_after) {
+            wait(*m_after);
+        }
+        auto host_start = std::chrono::steady_clock::now();
+        const sc_core::sc_time start = sc_core::sc_time_stamp();
+        const std::vector<AesWorkloadRecord>& records = m_trace.records;
+        const uint64_t n = records.size();
+        const uint64_t total = n * m_repeats;
+        const uint64_t unit_requests = m_config.unit_requests;
+        const uint64_t period = m_config.period;
+        const uint64_t first = n ? records[0].arrival_ps : 0;
+        const uint64_t span = n ? records[n - 1].arrival_ps - first : 0;
+        const uint64_t pass_ps = span + std::max<uint64_t>(1, n > 1 ? span / (n - 1) : 1);
+
+        // Keys resolved once per trace record, not once per request
+        std::vector<const KeyEntry*> record_keys;
+        for (const AesWorkloadRecord& r : records) {
+            record_keys.push_back(&key_entry(r.key_id));
+        }
+
+        // The measured unit of the current period and of the next, which
+        // the warm-up may have to start in this one
+        std::mt19937 unit_rng(m_config.seed);
+        uint64_t stratum = 0;
+        uint64_t offset = unit_rng() % period;
+        uint64_t next_offset = unit_rng() % period;
+
+        std::vector<uint8_t> fast_buffer;
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> expected;
+        sc_core::sc_time last_done = start;     // Latest result of a timed request
+        sc_core::sc_time unit_base = start;
+        uint64_t previous_arrival = 0;
+        uint64_t unit_first_arrival = 0;       // Arrival of the request before the unit
+        double unit_latency_ps = 0.0;
+        uint64_t unit_blocks = 0;
+
+        for (uint64_t i = 0; i < total; i++) {
+            const AesWorkloadRecord& r = records[i % n];
+            const uint64_t arrival = (i / n) * pass_ps + (r.arrival_ps - first);
+            const uint64_t unit = i / unit_requests;
+            const uint64_t position = i % unit_requests;
+            if (unit / period != stratum) {
+                stratum = unit / period;
+                offset = next_offset;
+                next_offset = unit_rng() % period;
+            }
+            const bool measured = unit % period == offset;
+            const uint64_t next_measured =
+                (unit % period <= offset ? stratum * period + offset : (stratum + 1) * period + next_offset) *
+                unit_requests;
+            const bool detailed = measured || (next_measured < total && next_measured - i <= m_config.warmup_requests);
+            const KeyEntry& key = *record_keys[i % n];
+            const size_t bytes = static_cast<size_t>(r.blocks) * AES_BLOCK_SIZE;
+            m_estimate.requests++;
+            m_estimate.blocks += r.blocks;
+
+            if (!detailed) {
+                // Functional fast path: the result and nothing else
+                if (fast_buffer.size() < bytes) {
+                    fast_buffer.resize(bytes, 0x46);
+                }
+                if (r.operation == AesOperation::ENCRYPT) {
+                    key.schedule->encrypt_blocks(fast_buffer.data(), fast_buffer.data(), r.blocks);
+                } else {
+                    key.schedule->decrypt_blocks(fast_buffer.data(), fast_buffer.data(), r.blocks);
+                }
+                previous_arrival = arrival;
+                continue;
+            }
+
+            sc_core::sc_time at = start + sc_core::sc_time(arrival / m_rate_scale, sc_core::SC_PS);
+            if (sc_core::sc_time_stamp() < at) {
+                wait(at - sc_core::sc_time_stamp());
+            }
+            if (measured && position == 0) {
+                sc_core::sc_time previous = start + sc_core::sc_time(previous_arrival / m_rate_scale, sc_core::SC_PS);
+                unit_base = (i > 0 && last_done < previous) ? previous : last_done;
+                unit_first_arrival = previous_arrival;
+                unit_latency_ps = 0.0;
+                unit_blocks = 0;
+            }
+
+            buffer.resize(bytes);
+            for (uint8_t& b : buffer) {
+                b = static_cast<uint8_t>(m_rng());
+            }
+            expected.resize(bytes);
+            if (r.operation == AesOperation::ENCRYPT) {
+                key.schedule->encrypt_blocks(buffer.data(), expected.data(), r.blocks);
+            } else {
+                key.schedule->decrypt_blocks(buffer.data(), expected.data(), r.blocks);
+            }
+
+            struct iovec segment = {buffer.data(), buffer.size()};
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_data_ptr(buffer.data());
+            trans.set_data_length(buffer.size());
+            trans.set_streaming_width(buffer.size());
+            trans.set_byte_enable_ptr(nullptr);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            AesExtension* ext = new AesExtension();
+            ext->operation = r.operation;
+            ext->mode = r.mode;
+            ext->key = key.key;
+            trans.set_extension(ext);
+            AesScatterGatherExtension* sg = new AesScatterGatherExtension(&segment, 1);
+            trans.set_extension(sg);
+
+            sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+            init_socket->b_transport(trans, delay);
+            trans.release_extension(ext);
+            trans.release_extension(sg);
+            m_estimate.detailed_requests++;
+            if (trans.is_response_error()) {
+                m_errors++;
+            } else if (buffer != expected) {
+                m_mismatches++;
+            }
+
+            sc_core::sc_time done = sc_core::sc_time_stamp() + delay;
+            if (last_done < done) {
+                last_done = done;
+            }
+            previous_arrival = arrival;
+            if (measured) {
+                unit_latency_ps += aes_workload_ps(delay);
+                unit_blocks += r.blocks;
+                if (position == unit_requests - 1 || i == total - 1) {
+                    Unit u;
+                    u.requests = position + 1;
+                    u.ns = (last_done - unit_base).to_seconds() * 1e9;
+                    u.blocks = static_cast<double>(unit_blocks);
+                    u.arrival_ns = (arrival - unit_first_arrival) * 1e-3 / m_rate_scale;
+                    u.mean_latency_ns = unit_latency_ps * 1e-3 / u.requests;
+                    m_units.push_back(u);
+                }
+            }
+        }
+
+        m_arrival_span_ns = previous_arrival * 1e-3 / m_rate_scale;
+        m_estimate.wall_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - host_start).count();
+        m_done = true;
+        m_finished.notify();
+    }
+
+private:
+    struct KeyEntry {
+        AesKey key;
+        std::unique_ptr<AesKeySchedule> schedule;
+    };
+
+    struct Unit {
+        uint64_t requests;
+        double ns;
+        double blocks;
+        double arrival_ns;              // From the arrival before the unit to its last
+        double mean_latency_ns;
+    };
+
+    AesWorkloadTrace m_trace;
+    uint64_t m_repeats;
+    double m_rate_scale;
+    AesSamplingConfig m_config;
+    std::mt19937 m_rng;
+    const sc_core::sc_event* m_after;
+    sc_core::sc_event m_finished;
+    bool m_done;
+    std::map<uint32_t, KeyEntry> m_keys;
+    std::vector<Unit> m_units;
+    AesSamplingEstimate m_estimate;
+    double m_arrival_span_ns = 0.0;     // First arrival to last, whole workload
+    uint64_t m_mismatches;
+    uint64_t m_errors;
+
+    const KeyEntry& key_entry(uint32_t key_id) {
+        auto found = m_keys.find(key_id);
+        if (found == m_keys.end()) {
+            KeyEntry entry;
+            entry.key = aes_workload_key(key_id);
+            entry.schedule.reset(new AesKeySchedule(entry.key));
+            found = m_keys.emplace(key_id, std::move(entry)).first;
+        }
+        return found->second;
+    }
+};
+
+#endif // AES_SAMPLED_REPLAY_H
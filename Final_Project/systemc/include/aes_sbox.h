@@ -1,8 +1,7 @@
 #ifndef AES_SBOX_H
 #define AES_SBOX_H
 
-#include "aes_types.h"
-#include <systemc>
+#include "aes_block.h"
 
 // S-box lookup table for AES
 class AesSBox {
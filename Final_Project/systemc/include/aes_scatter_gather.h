@@ -0,0 +1,121 @@
+#ifndef AES_SCATTER_GATHER_H
+#define AES_SCATTER_GATHER_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// In-place encryption of buffers that arrive as chains of segments (packet
+// fragments, pages), described by the same struct iovec arrays that readv
+// and recvmsg use. Whole blocks inside a segment are processed where they
+// lie by the bulk kernels; only a block that straddles a segment boundary
+// is gathered into a 16-byte local and scattered back afterwards, so no
+// segment is ever copied into a bounce buffer. Empty segments are allowed.
+//
+// The walker is header-only and also drives AesTop's scatter-gather
+// transactions; the cipher functions are defined in
+// cipher/aes_scatter_gather.cpp (libaes_cipher).
+
+// Total bytes in a chain
+inline size_t aes_iov_length(const struct iovec* iov, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+// A chain is usable if the array is there whenever count is non-zero and
+// every non-empty segment has a base
+inline bool aes_iov_valid(const struct iovec* iov, size_t count) {
+    if (!iov && count > 0) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!iov[i].iov_base && iov[i].iov_len > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Visit a chain 16 bytes at a time, in order. run(p, n) gets each stretch
+// of n whole blocks that lies inside one segment. straddle(block, length)
+// gets a block gathered from several segments, or the final partial block
+// of the chain (length < 16), and whatever it leaves in block[0..length) is
+// written back to the segments.
+template <typename Run, typename Straddle>
+void aes_iov_for_each_block(const struct iovec* iov, size_t count, Run run, Straddle straddle) {
+    size_t seg = 0;
+    size_t offset = 0;
+    for (;;) {
+        while (seg < count && offset == iov[seg].iov_len) {
+            seg++;
+            offset = 0;
+        }
+        if (seg == count) {
+            return;
+        }
+
+        uint8_t* base = static_cast<uint8_t*>(iov[seg].iov_base) + offset;
+        size_t whole = (iov[seg].iov_len - offset) / AES_BLOCK_SIZE;
+        if (whole > 0) {
+            run(base, whole);
+            offset += whole * AES_BLOCK_SIZE;
+            continue;
+        }
+
+        // Fewer than 16 bytes left in this segment: gather the block from
+        // as many segments as it spans
+        uint8_t block[AES_BLOCK_SIZE];
+        size_t length = 0;
+        size_t end_seg = seg;
+        size_t end_offset = offset;
+        while (length < AES_BLOCK_SIZE && end_seg < count) {
+            size_t take = iov[end_seg].iov_len - end_offset;
+            if (take > AES_BLOCK_SIZE - length) {
+                take = AES_BLOCK_SIZE - length;
+            }
+            std::memcpy(block + length, static_cast<uint8_t*>(iov[end_seg].iov_base) + end_offset, take);
+            length += take;
+            end_offset += take;
+            if (end_offset == iov[end_seg].iov_len) {
+                end_seg++;
+                end_offset = 0;
+            }
+        }
+
+        straddle(block, length);
+
+        // Scatter it back over the same bytes
+        size_t done = 0;
+        while (done < length) {
+            size_t take = iov[seg].iov_len - offset;
+            if (take > length - done) {
+                take = length - done;
+            }
+            std::memcpy(static_cast<uint8_t*>(iov[seg].iov_base) + offset, block + done, take);
+            done += take;
+            offset += take;
+            if (offset == iov[seg].iov_len) {
+                seg++;
+                offset = 0;
+            }
+        }
+    }
+}
+
+// ECB and CBC need the chain to hold a multiple of 16 bytes; CTR takes any
+// length. Each returns AES_CIPHER_OK or AES_CIPHER_EINVAL, and leaves the
+// chain untouched on error. iv and counter are updated as in AesKeySchedule,
+// so a stream can continue over several chains.
+int aes_iov_encrypt_blocks(const AesKeySchedule& key, const struct iovec* iov, size_t count);
+int aes_iov_decrypt_blocks(const AesKeySchedule& key, const struct iovec* iov, size_t count);
+int aes_iov_cbc_encrypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* iv);
+int aes_iov_cbc_decrypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* iv);
+int aes_iov_ctr_crypt(const AesKeySchedule& key, const struct iovec* iov, size_t count, uint8_t* counter);
+
+#endif // AES_SCATTER_GATHER_H
@@ -0,0 +1,291 @@
+#ifndef AES_SERIAL_INTERFACE_H
+#define AES_SERIAL_INTERFACE_H
+
+#include "aes_types.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <algorithm>
+
+// Register map of the serial interface (mirrors aes_serial_interface.v)
+// 0x00-0x0F : data_in / data_out bytes (byte 0 is the most significant byte)
+// 0x10-0x1F : key bytes
+// 0x20      : control register (the start and decrypt pins)
+// 0x21      : status register (the busy, valid and done pins)
+constexpr uint64_t AES_SERIAL_DATA_BASE = 0x00;
+constexpr uint64_t AES_SERIAL_KEY_BASE = 0x10;
+constexpr uint64_t AES_SERIAL_CTRL_ADDR = 0x20;
+constexpr uint64_t AES_SERIAL_STATUS_ADDR = 0x21;
+
+// Control register bits
+constexpr uint8_t AES_SERIAL_CTRL_START = 0x01;
+constexpr uint8_t AES_SERIAL_CTRL_DECRYPT = 0x02;
+
+// Status register bits
+constexpr uint8_t AES_SERIAL_STATUS_BUSY = 0x01;
+constexpr uint8_t AES_SERIAL_STATUS_VALID = 0x02;
+constexpr uint8_t AES_SERIAL_STATUS_DONE = 0x04;
+
+// Cycle counters collected by the serial interface model
+struct AesSerialStats {
+    uint64_t blocks = 0;
+    uint64_t load_cycles = 0;     // Data and key beats written in IDLE
+    uint64_t control_cycles = 0;  // Control writes and status polls
+    uint64_t process_cycles = 0;  // Cycles spent waiting on the AES core
+    uint64_t read_cycles = 0;     // Output beats read in READ_DATA/COMPLETE
+    uint64_t stall_cycles = 0;    // Cycles waiting for READ_DATA to reach COMPLETE
+
+    uint64_t total_cycles() const {
+        return load_cycles + control_cycles + process_cycles + read_cycles + stall_cycles;
+    }
+};
+
+// Register-level model of the byte-serial wrapper around the AES core.
+// Every bus access is one beat of bus_width_bits and costs one clock cycle,
+// so the cost of moving a block through the interface scales with the width.
+// The 8-bit configuration matches the RTL; 32 and 128 bits model what a
+// wider bus would buy in front of the same core.
+class AesSerialInterface : public sc_core::sc_module {
+public:
+    // TLM socket for the register bus
+    tlm_utils::simple_target_socket<AesSerialInterface> bus_socket;
+
+    // TLM initiator socket towards the AES core (AesTop)
+    tlm_utils::simple_initiator_socket<AesSerialInterface> core_socket;
+
+    // Constructor
+    SC_HAS_PROCESS(AesSerialInterface);
+    AesSerialInterface(sc_core::sc_module_name name,
+                       unsigned bus_width_bits = 8,
+                       sc_core::sc_time clock_period = sc_core::sc_time(8, sc_core::SC_NS),
+                       unsigned core_latency_cycles = AES_NUM_ROUNDS + 1) :
+        sc_core::sc_module(name),
+        bus_socket("bus_socket"),
+        core_socket("core_socket"),
+        m_bus_bytes(bus_width_bits / 8),
+        m_clock_period(clock_period),
+        m_core_latency_cycles(core_latency_cycles),
+        m_state(State::IDLE),
+        m_decrypt(false),
+        m_result_time(sc_core::SC_ZERO_TIME) {
+
+        if (bus_width_bits != 8 && bus_width_bits != 32 && bus_width_bits != 128) {
+            SC_REPORT_ERROR("AesSerialInterface", "Bus width must be 8, 32 or 128 bits");
+        }
+
+        // Register callback for incoming transactions
+        bus_socket.register_b_transport(this, &AesSerialInterface::b_transport);
+    }
+
+    // TLM blocking transport method (one bus beat per transaction)
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        uint64_t addr = trans.get_address();
+        unsigned len = trans.get_data_length();
+        unsigned char* ptr = trans.get_data_ptr();
+
+        // A beat cannot be wider than the bus or cross a register bank
+        if (len == 0 || len > m_bus_bytes || !within_bank(addr, len)) {
+            trans.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+            return;
+        }
+
+        if (addr == AES_SERIAL_CTRL_ADDR) {
+            if (trans.is_write()) {
+                write_control(ptr[0], delay);
+            } else {
+                ptr[0] = (m_decrypt ? AES_SERIAL_CTRL_DECRYPT : 0) |
+                         (m_state != State::IDLE ? AES_SERIAL_CTRL_START : 0);
+                charge(m_stats.control_cycles, 1, delay);
+            }
+        } else if (addr == AES_SERIAL_STATUS_ADDR) {
+            if (trans.is_write()) {
+                trans.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+                return;
+            }
+            // Polls issued while the core is still running count as core time
+            ptr[0] = read_status(delay);
+            charge(m_state == State::PROCESS ? m_stats.process_cycles : m_stats.control_cycles, 1, delay);
+        } else if (trans.is_write()) {
+            // Data and key registers are only writable while the FSM is idle
+            if (m_state != State::IDLE) {
+                trans.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+                return;
+            }
+            uint8_t* dest = (addr < AES_SERIAL_KEY_BASE) ?
+                &m_data_in.data[addr - AES_SERIAL_DATA_BASE] : &m_key.key[addr - AES_SERIAL_KEY_BASE];
+            std::copy(ptr, ptr + len, dest);
+            charge(m_stats.load_cycles, 1, delay);
+        } else {
+            // Output bytes can only be read back once the core has finished
+            if (addr >= AES_SERIAL_KEY_BASE || m_state == State::IDLE) {
+                trans.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+                return;
+            }
+            wait_for_result(delay);
+            std::copy(&m_data_out.data[addr], &m_data_out.data[addr] + len, ptr);
+            charge(m_stats.read_cycles, 1, delay);
+        }
+
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+    // Accessors
+    unsigned bus_width_bits() const { return m_bus_bytes * 8; }
+    const sc_core::sc_time& clock_period() const { return m_clock_period; }
+    const AesSerialStats& stats() const { return m_stats; }
+
+private:
+    // States of the control FSM in aes_serial_interface.v
+    enum class State {
+        IDLE,
+        PROCESS,
+        READ_DATA,
+        COMPLETE
+    };
+
+    unsigned m_bus_bytes;
+    sc_core::sc_time m_clock_period;
+    unsigned m_core_latency_cycles;
+
+    State m_state;
+    bool m_decrypt;
+    AesBlock m_data_in;
+    AesBlock m_data_out;
+    AesKey m_key;
+
+    // Absolute time at which the core result lands in full_data_out
+    sc_core::sc_time m_result_time;
+
+    AesSerialStats m_stats;
+
+    bool within_bank(uint64_t addr, unsigned len) const {
+        if (addr == AES_SERIAL_CTRL_ADDR || addr == AES_SERIAL_STATUS_ADDR) {
+            return len == 1;
+        }
+        if (addr < AES_SERIAL_KEY_BASE) {
+            return addr + len <= AES_SERIAL_KEY_BASE;
+        }
+        return addr < AES_SERIAL_CTRL_ADDR && addr + len <= AES_SERIAL_CTRL_ADDR;
+    }
+
+    // Advance the annotated delay by a number of clock cycles
+    void charge(uint64_t& counter, uint64_t cycles, sc_core::sc_time& delay) {
+        counter += cycles;
+        delay += m_clock_period * static_cast<double>(cycles);
+    }
+
+    // Cycles the FSM spends in READ_DATA walking byte_counter over the block
+    uint64_t read_window_cycles() const {
+        return AES_BLOCK_SIZE / m_bus_bytes;
+    }
+
+    // Handle a write to the control register
+    void write_control(uint8_t value, sc_core::sc_time& delay) {
+        bool start = value & AES_SERIAL_CTRL_START;
+        m_decrypt = value & AES_SERIAL_CTRL_DECRYPT;
+
+        if (start && m_state == State::IDLE) {
+            // IDLE -> PROCESS takes one cycle, then the core runs
+            charge(m_stats.control_cycles, 1, delay);
+            run_core(delay);
+        } else if (!start && m_state != State::IDLE) {
+            // The FSM only returns to IDLE from COMPLETE, after READ_DATA has
+            // walked through every output byte
+            sc_core::sc_time complete_time = m_result_time +
+                m_clock_period * static_cast<double>(read_window_cycles());
+            stall_until(complete_time, m_stats.stall_cycles, delay);
+            charge(m_stats.control_cycles, 1, delay);
+            m_state = State::IDLE;
+            m_stats.blocks++;
+        } else {
+            charge(m_stats.control_cycles, 1, delay);
+        }
+    }
+
+    // Forward the assembled block to the AES core
+    void run_core(sc_core::sc_time& delay) {
+        AesBlock block = m_data_in;
+
+        tlm::tlm_generic_payload trans;
+        trans.set_command(tlm::TLM_WRITE_COMMAND);
+        trans.set_data_ptr(reinterpret_cast<unsigned char*>(&block));
+        trans.set_data_length(sizeof(AesBlock));
+        trans.set_streaming_width(sizeof(AesBlock));
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+        // The wrapper hands the core one block at a time, so the pipeline
+        // never holds more than one block in flight
+        AesExtension* ext = new AesExtension();
+        ext->operation = m_decrypt ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        ext->mode = AesMode::NON_PIPELINED;
+        ext->key = m_key;
+        trans.set_extension(ext);
+
+        sc_core::sc_time core_delay = sc_core::SC_ZERO_TIME;
+        core_socket->b_transport(trans, core_delay);
+
+        if (trans.is_response_error()) {
+            SC_REPORT_ERROR("AesSerialInterface", "AES core transaction failed");
+        }
+
+        trans.release_extension(ext);
+
+        // The core takes at least its configured latency to raise valid_out
+        sc_core::sc_time latency = m_clock_period * static_cast<double>(m_core_latency_cycles);
+        if (core_delay > latency) {
+            latency = core_delay;
+        }
+
+        m_data_out = block;
+        m_result_time = sc_core::sc_time_stamp() + delay + latency;
+        m_state = State::PROCESS;
+    }
+
+    // Current FSM state as seen at the annotated local time
+    State state_at(const sc_core::sc_time& delay) {
+        if (m_state == State::PROCESS || m_state == State::READ_DATA) {
+            sc_core::sc_time now = sc_core::sc_time_stamp() + delay;
+            sc_core::sc_time complete_time = m_result_time +
+                m_clock_period * static_cast<double>(read_window_cycles());
+            if (now >= complete_time) {
+                m_state = State::COMPLETE;
+            } else if (now >= m_result_time) {
+                m_state = State::READ_DATA;
+            }
+        }
+        return m_state;
+    }
+
+    uint8_t read_status(const sc_core::sc_time& delay) {
+        switch (state_at(delay)) {
+            case State::PROCESS:
+                return AES_SERIAL_STATUS_BUSY;
+            case State::READ_DATA:
+                return AES_SERIAL_STATUS_BUSY | AES_SERIAL_STATUS_VALID;
+            case State::COMPLETE:
+                return AES_SERIAL_STATUS_BUSY | AES_SERIAL_STATUS_VALID | AES_SERIAL_STATUS_DONE;
+            default:
+                return 0;
+        }
+    }
+
+    // Reads issued before valid is raised stall the host until it is
+    void wait_for_result(sc_core::sc_time& delay) {
+        stall_until(m_result_time, m_stats.process_cycles, delay);
+        state_at(delay);
+    }
+
+    void stall_until(const sc_core::sc_time& target, uint64_t& counter, sc_core::sc_time& delay) {
+        sc_core::sc_time now = sc_core::sc_time_stamp() + delay;
+        if (now < target) {
+            sc_core::sc_time gap = target - now;
+            counter += static_cast<uint64_t>(gap / m_clock_period + 0.5);
+            delay += gap;
+        }
+    }
+};
+
+#endif // AES_SERIAL_INTERFACE_H
@@ -1,8 +1,7 @@
 #ifndef AES_SHIFT_ROWS_H
 #define AES_SHIFT_ROWS_H
 
-#include "aes_types.h"
-#include <systemc>
+#include "aes_block.h"
 
 // ShiftRows transformation for AES
 class AesShiftRows {
@@ -4,6 +4,8 @@
 #include "aes_types.h"
 #include "aes_key_expansion.h"
 #include "aes_round.h"
+#include "aes_scatter_gather.h"
+#include "timeline_trace.h"
 #include <systemc>
 #include <tlm>
 #include <tlm_utils/simple_initiator_socket.h>
@@ -25,7 +27,8 @@ public:
         sc_core::sc_module(name), 
         top_socket("top_socket"),
         key_expansion_socket("key_expansion_socket"),
-        round_socket("round_socket") {
+        round_socket("round_socket"),
+        m_trace(this->name()) {
         
         // Register callback for incoming transactions
         top_socket.register_b_transport(this, &AesTop::b_transport);
@@ -42,10 +45,36 @@ public:
             trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
             return;
         }
+        TimelineScope scope(m_trace, ext->operation == AesOperation::ENCRYPT ? "encrypt" : "decrypt", &delay);
+        
+        // A scatter-gather chain must be whole blocks and match data_length
+        AesScatterGatherExtension* sg = trans.get_extension<AesScatterGatherExtension>();
+        if (sg) {
+            if (!aes_iov_valid(sg->segments, sg->count)) {
+                trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
+                return;
+            }
+            size_t total = aes_iov_length(sg->segments, sg->count);
+            if (total != trans.get_data_length() || total % AES_BLOCK_SIZE != 0 ||
+                trans.get_streaming_width() != trans.get_data_length()) {
+                trans.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+                return;
+            }
+        }
         
         // Generate round keys
         AesRoundKeys round_keys;
-        generate_round_keys(ext->key, round_keys, delay);
+        {
+            TimelineScope key_scope(m_trace, "key expansion", &delay);
+            generate_round_keys(ext->key, round_keys, delay);
+        }
+        TimelineScope rounds_scope(m_trace, "rounds", &delay);
+        
+        if (sg) {
+            process_segments(*sg, round_keys, ext->operation, ext->mode, delay);
+            trans.set_response_status(tlm::TLM_OK_RESPONSE);
+            return;
+        }
         
         // Process the block based on operation and mode
         if (ext->mode == AesMode::PIPELINED) {
@@ -59,14 +88,43 @@ public:
     }
     
 private:
+    TimelineTrack m_trace;
+    
+    // Process every block of a chain in place with one key schedule. Blocks
+    // inside a segment are worked on where they lie; a block split across
+    // segments is gathered into a local block and scattered back.
+    void process_segments(const AesScatterGatherExtension& sg, const AesRoundKeys& round_keys,
+                          AesOperation operation, AesMode mode, sc_core::sc_time& delay) {
+        auto process = [&](AesBlock& block) {
+            if (mode == AesMode::PIPELINED) {
+                process_pipelined(block, round_keys, operation, delay);
+            } else {
+                process_non_pipelined(block, round_keys, operation, delay);
+            }
+        };
+        aes_iov_for_each_block(sg.segments, sg.count,
+            [&](uint8_t* p, size_t n) {
+                for (size_t i = 0; i < n; i++) {
+                    process(*reinterpret_cast<AesBlock*>(p + i * AES_BLOCK_SIZE));
+                }
+            },
+            [&](uint8_t* bytes, size_t) {
+                AesBlock block(bytes);
+                process(block);
+                std::memcpy(bytes, block.data.data(), AES_BLOCK_SIZE);
+            });
+    }
+    
     // Generate round keys using the key expansion module
     void generate_round_keys(const AesKey& key, AesRoundKeys& round_keys, sc_core::sc_time& delay) {
-        // Create a transaction for key expansion
+        // Create a transaction for key expansion. The module reads the key
+        // from the start of the buffer and writes the round keys over it.
+        round_keys.round_keys[0] = AesBlock(key.key.data());
         tlm::tlm_generic_payload trans;
         trans.set_command(tlm::TLM_WRITE_COMMAND);
-        trans.set_data_ptr(reinterpret_cast<unsigned char*>(&key));
-        trans.set_data_length(sizeof(AesKey));
-        trans.set_streaming_width(sizeof(AesKey));
+        trans.set_data_ptr(reinterpret_cast<unsigned char*>(&round_keys));
+        trans.set_data_length(sizeof(AesRoundKeys));
+        trans.set_streaming_width(sizeof(AesRoundKeys));
         trans.set_byte_enable_ptr(nullptr);
         trans.set_dmi_allowed(false);
         trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
@@ -0,0 +1,158 @@
+#ifndef AES_VECTOR_CORPUS_H
+#define AES_VECTOR_CORPUS_H
+
+#include "aes_block.h"
+#include "aes_job_ring.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary corpus of known-answer test vectors: (key, IV, plaintext,
+// ciphertext, mode) records that are mapped read-only and used in place,
+// so a regression run does no parsing at all. Text vector files in the
+// CAVP .rsp layout are converted to and from it with the SIMD hex codec.
+//
+// File layout (little-endian, all offsets from the start of the file):
+//   0     header, 64 bytes (AesVectorCorpusHeader)
+//   64    index: count AesVectorRecord, 64 bytes each
+//   page  data: plaintext then ciphertext of every vector, each pair padded
+//         to a multiple of 16 bytes, at the offset its record gives
+//
+// Versioning, atomic replacement and the header checks on open work as in
+// AesKeyStore. Defined in cipher/aes_vector_corpus.cpp (libaes_cipher).
+
+constexpr uint32_t AES_VECTOR_CORPUS_VERSION = 1;
+
+struct AesVectorCorpusHeader {
+    char magic[8];              // "AESVCORP"
+    uint32_t version;           // AES_VECTOR_CORPUS_VERSION
+    uint32_t byte_order;        // 0x01020304 as written
+    uint32_t header_size;       // sizeof(AesVectorCorpusHeader)
+    uint32_t record_size;       // sizeof(AesVectorRecord)
+    uint64_t count;
+    uint64_t data_offset;
+    uint64_t file_size;
+    uint64_t checksum;          // FNV-1a over index, padding and data
+    uint64_t reserved;
+};
+
+struct AesVectorRecord {
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t iv[AES_BLOCK_SIZE];     // CBC IV or CTR counter block; zero for ECB
+    uint64_t data;                  // Plaintext offset within the data section
+    uint32_t length;                // Bytes of plaintext (and of ciphertext)
+    uint8_t mode;                   // AesCipherMode: ECB, CBC or CTR
+    uint8_t operation;              // AesOperation the vector was published for
+    uint16_t reserved0;
+    uint64_t id;                    // COUNT in the text file
+    uint64_t reserved1;
+};
+
+static_assert(sizeof(AesVectorCorpusHeader) == 64, "Corpus header must be 64 bytes");
+static_assert(sizeof(AesVectorRecord) == 64, "Corpus record must be 64 bytes");
+
+// One vector, pointing into a mapped corpus or into the caller's buffers
+struct AesTestVector {
+    AesCipherMode mode = AesCipherMode::ECB;
+    AesOperation operation = AesOperation::ENCRYPT;
+    uint64_t id = 0;
+    const uint8_t* key = nullptr;
+    const uint8_t* iv = nullptr;          // May be null for ECB
+    const uint8_t* plaintext = nullptr;
+    const uint8_t* ciphertext = nullptr;
+    size_t length = 0;
+};
+
+// Streams vectors into a new corpus. The index goes straight to the file
+// and the data to a side file that is appended on finish, so memory use
+// does not grow with the corpus.
+class AesVectorCorpusWriter {
+public:
+    AesVectorCorpusWriter();
+    ~AesVectorCorpusWriter();   // Discards an unfinished corpus
+
+    AesVectorCorpusWriter(const AesVectorCorpusWriter&) = delete;
+    AesVectorCorpusWriter& operator=(const AesVectorCorpusWriter&) = delete;
+
+    // Returns AES_CIPHER_OK, AES_CIPHER_EINVAL (empty path), AES_CIPHER_ENOMEM
+    // (no room for the write buffers) or AES_CIPHER_EIO (the temporary files
+    // cannot be created)
+    int open(const std::string& path);
+
+    // Returns AES_CIPHER_OK, AES_CIPHER_EINVAL (XTS, an unknown operation, a
+    // length that is not whole blocks for ECB or CBC, or a missing buffer) or
+    // AES_CIPHER_EIO
+    int add(const AesTestVector& vector);
+
+    // Write the header and rename the corpus into place
+    int finish();
+
+    size_t size() const { return m_count; }
+
+private:
+    std::string m_path;
+    std::string m_temp_path;
+    std::string m_data_path;
+    int m_fd;
+    int m_data_fd;
+    size_t m_count;
+    uint64_t m_data_size;
+    uint64_t m_checksum;            // Over the records written so far
+    std::vector<uint8_t> m_records;  // Write buffers
+    std::vector<uint8_t> m_data;
+
+    bool flush();
+    void discard();
+};
+
+class AesVectorCorpus {
+public:
+    AesVectorCorpus();
+    ~AesVectorCorpus();
+
+    AesVectorCorpus(const AesVectorCorpus&) = delete;
+    AesVectorCorpus& operator=(const AesVectorCorpus&) = delete;
+
+    // Returns AES_CIPHER_OK, AES_CIPHER_EIO or AES_CIPHER_EVERSION
+    int open(const std::string& path);
+    void close();
+
+    bool is_open() const { return m_base != nullptr; }
+    size_t size() const { return m_count; }
+
+    // Vector i, pointing into the mapping (valid until close). Returns
+    // false if i is out of range, the record points outside the data, or its
+    // mode or operation is not one a writer stores.
+    bool get(size_t i, AesTestVector& vector) const;
+
+    // Recompute the checksum over the whole file
+    bool verify() const;
+
+private:
+    void* m_base;
+    size_t m_length;
+    size_t m_count;
+    const AesVectorRecord* m_records;
+    const uint8_t* m_data;
+    uint64_t m_data_size;
+};
+
+// Run a vector through the library in its published direction and compare
+// the output with the expected text. Returns true on a match.
+bool aes_vector_check(const AesTestVector& vector, const AesKeySchedule& schedule);
+
+// Convert a text vector file to a corpus. The text is CAVP .rsp style:
+// [ENCRYPT] / [DECRYPT] sections and COUNT, KEY, IV, PLAINTEXT and
+// CIPHERTEXT lines, one blank-line-separated group per vector; '#' starts a
+// comment. A MODE = ECB|CBC|CTR line sets the mode for the vectors after
+// it, default_mode applies before any. Returns AES_CIPHER_OK,
+// AES_CIPHER_EIO, or AES_CIPHER_EINVAL with the offending line number in
+// *error_line (if not null).
+int aes_vector_import(const std::string& text_path, AesVectorCorpusWriter& writer, AesCipherMode default_mode,
+                      size_t* error_line = nullptr);
+
+// Write a corpus back out in the same text form
+int aes_vector_export(const AesVectorCorpus& corpus, const std::string& text_path);
+
+#endif // AES_VECTOR_CORPUS_H
@@ -0,0 +1,415 @@
+#ifndef AES_WORKLOAD_H
+#define AES_WORKLOAD_H
+
+#include "aes_types.h"
+#include "aes_cipher.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Workload capture and replay. AesWorkloadRecorder sits between any
+// initiator and the engine behind it and writes down every request: when
+// it arrived, how many blocks it carried, which key, which operation and
+// mode, and how long the engine took. AesWorkloadReplayer drives such a
+// trace back into AesTop, an AesLaneRouter or any other AES target, at the
+// recorded arrival times or at a multiple of the recorded rate, and keeps
+// the same fields for the replay so the two can be compared.
+//
+// Trace files are text, one request per line after a version line:
+//
+//   AESWORKLOAD 1
+//   # arrival_ps latency_ps blocks key_id op mode
+//   0 240000 4 3 E N
+//
+// Arrival times are from the first request. Keys are identified by a
+// number, never stored; the replayer derives a key from each ID. op is E
+// or D, mode is N (non-pipelined) or P (pipelined). '#' lines are comments.
+
+constexpr int AES_WORKLOAD_VERSION = 1;
+
+struct AesWorkloadRecord {
+    uint64_t arrival_ps = 0;    // From the first request
+    uint64_t latency_ps = 0;    // Request to result
+    uint32_t blocks = 0;
+    uint32_t key_id = 0;
+    AesOperation operation = AesOperation::ENCRYPT;
+    AesMode mode = AesMode::NON_PIPELINED;
+};
+
+struct AesWorkloadTrace {
+    std::vector<AesWorkloadRecord> records;
+
+    bool save(const std::string& path, const std::string& comment = "") const {
+        std::ofstream out(path);
+        out << "AESWORKLOAD " << AES_WORKLOAD_VERSION << "\n";
+        if (!comment.empty()) {
+            out << "# " << comment << "\n";
+        }
+        out << "# arrival_ps latency_ps blocks key_id op mode\n";
+        for (const AesWorkloadRecord& r : records) {
+            out << r.arrival_ps << ' ' << r.latency_ps << ' ' << r.blocks << ' ' << r.key_id << ' '
+                << (r.operation == AesOperation::ENCRYPT ? 'E' : 'D') << ' '
+                << (r.mode == AesMode::PIPELINED ? 'P' : 'N') << "\n";
+        }
+        out.flush();
+        return static_cast<bool>(out);
+    }
+
+    // Returns false on a missing file, another version or a malformed line,
+    // with the line number in *error_line (if not null)
+    bool load(const std::string& path, size_t* error_line = nullptr) {
+        records.clear();
+        std::ifstream in(path);
+        std::string line;
+        size_t line_number = 0;
+        bool have_version = false;
+        auto fail = [&]() {
+            if (error_line) {
+                *error_line = line_number;
+            }
+            records.clear();
+            return false;
+        };
+        if (!in) {
+            return fail();
+        }
+        while (std::getline(in, line)) {
+            line_number++;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            if (!have_version) {
+                std::string magic;
+                int version = 0;
+                if (!(fields >> magic >> version) || magic != "AESWORKLOAD" || version != AES_WORKLOAD_VERSION) {
+                    return fail();
+                }
+                have_version = true;
+                continue;
+            }
+            AesWorkloadRecord r;
+            char op = 0;
+            char mode = 0;
+            std::string rest;
+            if (!(fields >> r.arrival_ps >> r.latency_ps >> r.blocks >> r.key_id >> op >> mode) || (fields >> rest) ||
+                r.blocks == 0 || (op != 'E' && op != 'D') || (mode != 'N' && mode != 'P')) {
+                return fail();
+            }
+            r.operation = op == 'E' ? AesOperation::ENCRYPT : AesOperation::DECRYPT;
+            r.mode = mode == 'P' ? AesMode::PIPELINED : AesMode::NON_PIPELINED;
+            records.push_back(r);
+        }
+        if (!have_version) {
+            return fail();
+        }
+        return true;
+    }
+
+    // Order by arrival, keeping call order for requests that arrive together
+    void sort_by_arrival() {
+        std::stable_sort(records.begin(), records.end(),
+                         [](const AesWorkloadRecord& a, const AesWorkloadRecord& b) {
+                             return a.arrival_ps < b.arrival_ps;
+                         });
+    }
+};
+
+// What a trace looks like as a workload
+struct AesWorkloadProfile {
+    static constexpr int SIZE_BUCKETS = 5;  // Blocks: 1, 2-4, 5-16, 17-64, 65+
+
+    size_t requests = 0;
+    uint64_t blocks = 0;
+    size_t encrypts = 0;
+    size_t distinct_keys = 0;
+    size_t key_changes = 0;                 // Requests whose key differs from the one before
+    size_t size_histogram[SIZE_BUCKETS] = {0, 0, 0, 0, 0};
+    uint64_t arrival_span_ps = 0;           // First to last arrival
+    uint64_t completion_span_ps = 0;        // First arrival to last result
+    double mean_gap_ns = 0.0;               // Inter-arrival time
+    double gap_cv = 0.0;                    // Its coefficient of variation; 1 for Poisson arrivals
+    double mean_latency_ns = 0.0;
+    double p50_latency_ns = 0.0;
+    double p99_latency_ns = 0.0;
+    double max_latency_ns = 0.0;
+
+    static const char* size_bucket_name(int bucket) {
+        static const char* const names[SIZE_BUCKETS] = {"1", "2-4", "5-16", "17-64", "65+"};
+        return names[bucket];
+    }
+
+    // Rate requests were offered at, and rate results came back at
+    double offered_gbps() const { return arrival_span_ps ? blocks * 128.0 / (arrival_span_ps * 1e-3) : 0.0; }
+    double achieved_gbps() const { return completion_span_ps ? blocks * 128.0 / (completion_span_ps * 1e-3) : 0.0; }
+
+    static AesWorkloadProfile of(const AesWorkloadTrace& trace) {
+        AesWorkloadProfile p;
+        const std::vector<AesWorkloadRecord>& records = trace.records;
+        p.requests = records.size();
+        if (records.empty()) {
+            return p;
+        }
+        std::vector<uint32_t> keys;
+        std::vector<uint64_t> latencies;
+        uint64_t first = records[0].arrival_ps;
+        uint64_t last = records[0].arrival_ps;
+        uint64_t last_done = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            const AesWorkloadRecord& r = records[i];
+            p.blocks += r.blocks;
+            p.encrypts += r.operation == AesOperation::ENCRYPT;
+            p.key_changes += i > 0 && r.key_id != records[i - 1].key_id;
+            p.size_histogram[r.blocks == 1 ? 0 : r.blocks <= 4 ? 1 : r.blocks <= 16 ? 2 : r.blocks <= 64 ? 3 : 4]++;
+            first = std::min(first, r.arrival_ps);
+            last = std::max(last, r.arrival_ps);
+            last_done = std::max(last_done, r.arrival_ps + r.latency_ps);
+            keys.push_back(r.key_id);
+            latencies.push_back(r.latency_ps);
+        }
+        std::sort(keys.begin(), keys.end());
+        p.distinct_keys = std::unique(keys.begin(), keys.end()) - keys.begin();
+        p.arrival_span_ps = last - first;
+        p.completion_span_ps = last_done - first;
+
+        // Gaps in arrival order
+        if (records.size() > 1) {
+            std::vector<uint64_t> arrivals;
+            for (const AesWorkloadRecord& r : records) {
+                arrivals.push_back(r.arrival_ps);
+            }
+            std::sort(arrivals.begin(), arrivals.end());
+            double sum = 0.0;
+            double sum_sq = 0.0;
+            for (size_t i = 1; i < arrivals.size(); i++) {
+                double gap = (arrivals[i] - arrivals[i - 1]) * 1e-3;
+                sum += gap;
+                sum_sq += gap * gap;
+            }
+            double n = static_cast<double>(arrivals.size() - 1);
+            p.mean_gap_ns = sum / n;
+            double variance = std::max(0.0, sum_sq / n - p.mean_gap_ns * p.mean_gap_ns);
+            p.gap_cv = p.mean_gap_ns > 0.0 ? std::sqrt(variance) / p.mean_gap_ns : 0.0;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0.0;
+        for (uint64_t l : latencies) {
+            sum += l * 1e-3;
+        }
+        p.mean_latency_ns = sum / latencies.size();
+        p.p50_latency_ns = latencies[(latencies.size() - 1) / 2] * 1e-3;
+        p.p99_latency_ns = latencies[(latencies.size() - 1) * 99 / 100] * 1e-3;
+        p.max_latency_ns = latencies.back() * 1e-3;
+        return p;
+    }
+};
+
+// Key a replay uses for a key ID: the same ID always gives the same key
+inline AesKey aes_workload_key(uint32_t key_id) {
+    std::mt19937 rng(0x460u + key_id);
+    AesKey key;
+    for (uint8_t& b : key.key) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return key;
+}
+
+inline uint64_t aes_workload_ps(const sc_core::sc_time& t) {
+    return static_cast<uint64_t>(std::llround(t.to_seconds() * 1e12));
+}
+
+// Pass-through that records every request on its way to the engine. Keys
+// get IDs in order of first use. The latency recorded is the delay the
+// engine adds to the request's annotation.
+class AesWorkloadRecorder : public sc_core::sc_module {
+public:
+    tlm_utils::simple_target_socket<AesWorkloadRecorder> in_socket;
+    tlm_utils::simple_initiator_socket<AesWorkloadRecorder> out_socket;
+
+    SC_HAS_PROCESS(AesWorkloadRecorder);
+    AesWorkloadRecorder(sc_core::sc_module_name name) :
+        sc_core::sc_module(name),
+        in_socket("in_socket"),
+        out_socket("out_socket") {
+        in_socket.register_b_transport(this, &AesWorkloadRecorder::b_transport);
+    }
+
+    // The requests seen so far, in arrival order, timed from the first
+    AesWorkloadTrace trace() const {
+        AesWorkloadTrace trace;
+        trace.records = m_records;
+        uint64_t first = UINT64_MAX;
+        for (const AesWorkloadRecord& r : trace.records) {
+            first = std::min(first, r.arrival_ps);
+        }
+        for (AesWorkloadRecord& r : trace.records) {
+            r.arrival_ps -= first;
+        }
+        trace.sort_by_arrival();
+        return trace;
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        AesExtension* ext = trans.get_extension<AesExtension>();
+        sc_core::sc_time arrival = sc_core::sc_time_stamp() + delay;
+        sc_core::sc_time sent = delay;
+        out_socket->b_transport(trans, delay);
+        if (!ext || trans.is_response_error()) {
+            return;
+        }
+
+        AesWorkloadRecord r;
+        r.arrival_ps = aes_workload_ps(arrival);
+        r.latency_ps = aes_workload_ps(delay - sent);
+        r.blocks = std::max(1u, trans.get_data_length() / AES_BLOCK_SIZE);
+        auto found = m_key_ids.find(ext->key.key);
+        if (found == m_key_ids.end()) {
+            found = m_key_ids.emplace(ext->key.key, static_cast<uint32_t>(m_key_ids.size())).first;
+        }
+        r.key_id = found->second;
+        r.operation = ext->operation;
+        r.mode = ext->mode;
+        m_records.push_back(r);
+    }
+
+private:
+    std::vector<AesWorkloadRecord> m_records;
+    std::map<std::array<uint8_t, AES_KEY_SIZE>, uint32_t> m_key_ids;
+};
+
+// Open-loop replay: each request is issued at its recorded arrival time
+// divided by rate_scale, whether or not earlier ones have finished, and
+// the returned delay is taken as its latency. Requests carry random data
+// in one scatter-gather segment and every result is checked against
+// AesCipher.
+class AesWorkloadReplayer : public sc_core::sc_module {
+public:
+    tlm_utils::simple_initiator_socket<AesWorkloadReplayer> init_socket;
+
+    SC_HAS_PROCESS(AesWorkloadReplayer);
+    AesWorkloadReplayer(sc_core::sc_module_name name, const AesWorkloadTrace& trace, double rate_scale = 1.0,
+                        unsigned seed = 460) :
+        sc_core::sc_module(name),
+        init_socket("init_socket"),
+        m_trace(trace),
+        m_rate_scale(rate_scale > 0.0 ? rate_scale : 1.0),
+        m_rng(seed),
+        m_errors(0),
+        m_mismatches(0) {
+        m_trace.sort_by_arrival();
+        SC_THREAD(run);
+    }
+
+    double rate_scale() const { return m_rate_scale; }
+    bool passed() const {
+        return m_errors == 0 && m_mismatches == 0 && m_replayed.records.size() == m_trace.records.size();
+    }
+    uint64_t errors() const { return m_errors; }
+    uint64_t mismatches() const { return m_mismatches; }
+
+    // The replay in trace form: issue times and measured latencies
+    const AesWorkloadTrace& replayed() const { return m_replayed; }
+
+    void run() {
+        const sc_core::sc_time start = sc_core::sc_time_stamp();
+        const uint64_t first = m_trace.records.empty() ? 0 : m_trace.records[0].arrival_ps;
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> input;
+        for (const AesWorkloadRecord& r : m_trace.records) {
+            sc_core::sc_time at = start + sc_core::sc_time((r.arrival_ps - first) / m_rate_scale, sc_core::SC_PS);
+            if (sc_core::sc_time_stamp() < at) {
+                wait(at - sc_core::sc_time_stamp());
+            }
+
+            input.resize(static_cast<size_t>(r.blocks) * AES_BLOCK_SIZE);
+            for (uint8_t& b : input) {
+                b = static_cast<uint8_t>(m_rng());
+            }
+            buffer = input;
+            const KeyEntry& key = key_entry(r.key_id);
+
+            struct iovec segment = {buffer.data(), buffer.size()};
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_data_ptr(buffer.data());
+            trans.set_data_length(buffer.size());
+            trans.set_streaming_width(buffer.size());
+            trans.set_byte_enable_ptr(nullptr);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            AesExtension* ext = new AesExtension();
+            ext->operation = r.operation;
+            ext->mode = r.mode;
+            ext->key = key.key;
+            trans.set_extension(ext);
+            AesScatterGatherExtension* sg = new AesScatterGatherExtension(&segment, 1);
+            trans.set_extension(sg);
+
+            sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+            init_socket->b_transport(trans, delay);
+            trans.release_extension(ext);
+            trans.release_extension(sg);
+            if (trans.is_response_error()) {
+                m_errors++;
+                continue;
+            }
+
+            for (uint32_t b = 0; b < r.blocks; b++) {
+                AesBlock in(&input[b * AES_BLOCK_SIZE]);
+                AesBlock expected = r.operation == AesOperation::ENCRYPT ?
+                                    AesCipher::encrypt_block(in, key.round_keys) :
+                                    AesCipher::decrypt_block(in, key.round_keys);
+                if (!(AesBlock(&buffer[b * AES_BLOCK_SIZE]) == expected)) {
+                    m_mismatches++;
+                    break;
+                }
+            }
+
+            AesWorkloadRecord replayed = r;
+            replayed.arrival_ps = aes_workload_ps(sc_core::sc_time_stamp() - start);
+            replayed.latency_ps = aes_workload_ps(delay);
+            m_replayed.records.push_back(replayed);
+        }
+    }
+
+private:
+    struct KeyEntry {
+        AesKey key;
+        AesRoundKeys round_keys;
+    };
+
+    AesWorkloadTrace m_trace;
+    double m_rate_scale;
+    std::mt19937 m_rng;
+    std::map<uint32_t, KeyEntry> m_keys;
+    AesWorkloadTrace m_replayed;
+    uint64_t m_errors;
+    uint64_t m_mismatches;
+
+    const KeyEntry& key_entry(uint32_t key_id) {
+        auto found = m_keys.find(key_id);
+        if (found == m_keys.end()) {
+            KeyEntry entry;
+            entry.key = aes_workload_key(key_id);
+            AesCipher::expand_key(entry.key, entry.round_keys);
+            found = m_keys.emplace(key_id, entry).first;
+        }
+        return found->second;
+    }
+};
+
+#endif // AES_WORKLOAD_H
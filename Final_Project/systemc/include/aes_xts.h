@@ -0,0 +1,64 @@
+#ifndef AES_XTS_H
+#define AES_XTS_H
+
+#include "aes_block.h"
+#include "aes_cipher.h"
+#include <cstddef>
+#include <cstdint>
+
+// AES-XTS (IEEE 1619) with two AES-128 keys, for sector and storage
+// encryption. Each sector (data unit) is encrypted independently: its tweak
+// is the sector number, little-endian, encrypted under the tweak key, and
+// block j of the sector uses that tweak multiplied by alpha^j in GF(2^128).
+// A sector whose length is not a multiple of 16 bytes is handled with
+// ciphertext stealing, so the output is always the same length as the
+// input. Sectors must be at least one block long.
+//
+// Like AesKeySchedule, an AesXts is read-only after construction and can be
+// shared between threads. Defined in cipher/aes_xts.cpp (libaes_cipher).
+class AesXts {
+public:
+    AesXts(const AesKey& data_key, const AesKey& tweak_key, AesKeyKernel kernel = AesKeyKernel::AUTO);
+
+    AesKeyKernel kernel() const { return m_data.kernel(); }
+
+    // One sector of length bytes (length >= 16)
+    void encrypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector) const;
+    void decrypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector) const;
+
+    // num_sectors consecutive sectors of sector_size bytes, numbered from
+    // first_sector. The sectors are split into contiguous ranges across up
+    // to num_threads threads (0 means one per hardware thread); calls too
+    // small to pay for a thread run on the caller's thread only. in and out
+    // may be the same buffer.
+    void encrypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                         uint64_t first_sector, unsigned num_threads = 1) const;
+    void decrypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                         uint64_t first_sector, unsigned num_threads = 1) const;
+
+    // Multiply a tweak by alpha (x) in GF(2^128), the IEEE 1619 byte order
+    static void mul_alpha(uint8_t* tweak) {
+        uint8_t carry = 0;
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            uint8_t next_carry = tweak[i] >> 7;
+            tweak[i] = static_cast<uint8_t>((tweak[i] << 1) | carry);
+            carry = next_carry;
+        }
+        if (carry) {
+            tweak[0] ^= 0x87;  // x^128 = x^7 + x^2 + x + 1
+        }
+    }
+
+private:
+    AesKeySchedule m_data;
+    AesKeySchedule m_tweak;
+
+    void crypt_sector(const uint8_t* in, uint8_t* out, size_t length, uint64_t sector, bool decrypt) const;
+    void crypt_sectors(const uint8_t* in, uint8_t* out, size_t sector_size, size_t num_sectors,
+                       uint64_t first_sector, unsigned num_threads, bool decrypt) const;
+
+    // Full blocks with consecutive tweaks; tweak is advanced past them
+    void crypt_blocks(const uint8_t* in, uint8_t* out, size_t num_blocks, uint8_t* tweak, bool decrypt) const;
+};
+
+#endif // AES_XTS_H
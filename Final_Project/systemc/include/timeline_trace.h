@@ -0,0 +1,339 @@
+#ifndef TIMELINE_TRACE_H
+#define TIMELINE_TRACE_H
+
+#include <systemc>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline tracing for the SystemC models, written as Chrome trace JSON
+// that ui.perfetto.dev and chrome://tracing open. Each traced module owns a
+// TimelineTrack. A TimelineScope around a piece of work records a slice on
+// it from its begin to its end, both stamped with the simulated time
+// (sc_time_stamp() plus the annotated delay, for loosely timed code) and
+// the host time. Models that work out their timing rather than waiting for
+// it record the intervals they computed with TimelineTrace::span. Slices
+// are written as complete events, begin and duration in one, so slices
+// that touch or overlap on a track need no matching of ends.
+//
+// The file shows every event twice: in a "Simulated time" process, where
+// overlap, stalls and ordering between modules can be seen, and in a "Host
+// time" process, which shows where the simulator spent its time. Each
+// track is one thread in both.
+//
+// Events go into a buffer owned by the recording thread, so recording
+// takes no lock; each thread keeps at most TIMELINE_TRACE_MAX_EVENTS and
+// counts the rest as dropped. Tracing is off until start(), or configure()
+// finding --trace <file> or TIMELINE_TRACE=<file>. Until then a scope
+// costs one branch on a relaxed load. The file is written by stop(), or at
+// exit.
+//
+// Header-only C++11, shared by Final_Project/systemc and
+// individual_project_3 (which adds this directory to its include path).
+
+constexpr size_t TIMELINE_TRACE_MAX_EVENTS = 1 << 22;
+
+struct TimelineEvent {
+    const char* name;       // Must outlive the trace: use string literals
+    uint32_t track;
+    char phase;             // 'X' (slice) or 'i' (instant)
+    double sim_us;
+    double sim_dur_us;
+    double host_us;
+    double host_dur_us;
+};
+
+// Shared state; a class template so the header can define its statics
+template <typename Unused = void>
+struct TimelineTraceState {
+    static std::atomic<bool> enabled;
+    static std::mutex mutex;
+    static std::vector<std::string> tracks;
+    static std::map<std::string, uint32_t> track_ids;
+    static std::vector<std::unique_ptr<std::vector<TimelineEvent>>> buffers;  // Never freed
+    static std::atomic<uint64_t> dropped;
+    static std::chrono::steady_clock::time_point origin;
+    static std::string path;
+    static bool exit_hook;
+};
+
+template <typename Unused> std::atomic<bool> TimelineTraceState<Unused>::enabled(false);
+template <typename Unused> std::mutex TimelineTraceState<Unused>::mutex;
+template <typename Unused> std::vector<std::string> TimelineTraceState<Unused>::tracks;
+template <typename Unused> std::map<std::string, uint32_t> TimelineTraceState<Unused>::track_ids;
+template <typename Unused>
+std::vector<std::unique_ptr<std::vector<TimelineEvent>>> TimelineTraceState<Unused>::buffers;
+template <typename Unused> std::atomic<uint64_t> TimelineTraceState<Unused>::dropped(0);
+template <typename Unused> std::chrono::steady_clock::time_point TimelineTraceState<Unused>::origin;
+template <typename Unused> std::string TimelineTraceState<Unused>::path;
+template <typename Unused> bool TimelineTraceState<Unused>::exit_hook = false;
+
+class TimelineTrace {
+public:
+    typedef TimelineTraceState<> State;
+
+    static bool enabled() { return State::enabled.load(std::memory_order_relaxed); }
+
+    // Start recording, discarding earlier events; path is written by stop()
+    // or at exit
+    static void start(const std::string& path) {
+        std::lock_guard<std::mutex> lock(State::mutex);
+        for (size_t i = 0; i < State::buffers.size(); i++) {
+            State::buffers[i]->clear();
+        }
+        State::dropped.store(0);
+        State::path = path;
+        State::origin = std::chrono::steady_clock::now();
+        if (!State::exit_hook) {
+            State::exit_hook = true;
+            std::atexit(&TimelineTrace::write_at_exit);
+        }
+        State::enabled.store(true);
+    }
+
+    // Start if the command line has --trace <file> or --trace=<file>, or
+    // the environment has TIMELINE_TRACE=<file>. Returns enabled().
+    static bool configure(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+                start(argv[i + 1]);
+            } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+                start(argv[i] + 8);
+            }
+        }
+        const char* env = std::getenv("TIMELINE_TRACE");
+        if (!enabled() && env && *env) {
+            start(env);
+        }
+        return enabled();
+    }
+
+    // Stop recording and write the file. Nothing may be recording on
+    // another thread. Returns false if the file could not be written.
+    static bool stop() {
+        if (!State::enabled.exchange(false)) {
+            return true;
+        }
+        return write(State::path);
+    }
+
+    // Track id for a name; modules with the same name share a track
+    static uint32_t add_track(const std::string& name) {
+        std::lock_guard<std::mutex> lock(State::mutex);
+        std::map<std::string, uint32_t>::const_iterator it = State::track_ids.find(name);
+        if (it != State::track_ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(State::tracks.size());
+        State::tracks.push_back(name);
+        State::track_ids[name] = id;
+        return id;
+    }
+
+    // sc_time_stamp() plus delay (if given), and the host time, in us
+    static double sim_now_us(const sc_core::sc_time* delay) {
+        sc_core::sc_time sim = sc_core::sc_time_stamp();
+        if (delay) {
+            sim += *delay;
+        }
+        return sim.to_seconds() * 1e6;
+    }
+
+    static double host_us() {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - State::origin).count();
+    }
+
+    static void slice(uint32_t track, const char* name, double sim_begin, double sim_end, double host_begin,
+                      double host_end) {
+        TimelineEvent event = {name, track, 'X', sim_begin, sim_end - sim_begin, host_begin, host_end - host_begin};
+        append(event);
+    }
+
+    // An interval the model worked out rather than waited for
+    static void span(uint32_t track, const char* name, const sc_core::sc_time& begin, const sc_core::sc_time& end) {
+        if (!enabled()) {
+            return;
+        }
+        double host = host_us();
+        slice(track, name, begin.to_seconds() * 1e6, end.to_seconds() * 1e6, host, host);
+    }
+
+    static void instant(uint32_t track, const char* name, const sc_core::sc_time* delay = nullptr) {
+        if (!enabled()) {
+            return;
+        }
+        TimelineEvent event = {name, track, 'i', sim_now_us(delay), 0, host_us(), 0};
+        append(event);
+    }
+
+    // Write everything recorded so far as Chrome trace JSON
+    static bool write(const std::string& path) {
+        std::lock_guard<std::mutex> lock(State::mutex);
+        struct Entry {
+            const TimelineEvent* event;
+            size_t order;
+        };
+        std::vector<Entry> entries;
+        for (size_t b = 0; b < State::buffers.size(); b++) {
+            const std::vector<TimelineEvent>& buffer = *State::buffers[b];
+            for (size_t i = 0; i < buffer.size(); i++) {
+                Entry entry = {&buffer[i], entries.size()};
+                entries.push_back(entry);
+            }
+        }
+
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            std::cout << "Timeline trace: cannot write " << path << std::endl;
+            return false;
+        }
+        std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        std::fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Simulated time\"}},\n");
+        std::fprintf(file, "{\"ph\":\"M\",\"pid\":2,\"name\":\"process_name\",\"args\":{\"name\":\"Host time\"}}");
+        for (size_t t = 0; t < State::tracks.size(); t++) {
+            std::string name = escape(State::tracks[t]);
+            for (int pid = 1; pid <= 2; pid++) {
+                std::fprintf(file, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                             pid, static_cast<unsigned>(t + 1), name.c_str());
+                std::fprintf(file, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%u}}",
+                             pid, static_cast<unsigned>(t + 1), static_cast<unsigned>(t));
+            }
+        }
+
+        // Each timeline in time order per track. At the same start the
+        // longer slice comes first, and among equal ones the later recorded,
+        // since a scope is recorded when it ends, after the scopes in it.
+        for (int pid = 1; pid <= 2; pid++) {
+            bool sim = (pid == 1);
+            std::sort(entries.begin(), entries.end(), [sim](const Entry& a, const Entry& b) {
+                if (a.event->track != b.event->track) {
+                    return a.event->track < b.event->track;
+                }
+                double ta = sim ? a.event->sim_us : a.event->host_us;
+                double tb = sim ? b.event->sim_us : b.event->host_us;
+                if (ta != tb) {
+                    return ta < tb;
+                }
+                double da = sim ? a.event->sim_dur_us : a.event->host_dur_us;
+                double db = sim ? b.event->sim_dur_us : b.event->host_dur_us;
+                return da > db || (da == db && a.order > b.order);
+            });
+            for (size_t i = 0; i < entries.size(); i++) {
+                const TimelineEvent& e = *entries[i].event;
+                std::fprintf(file, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%.6f,\"name\":\"%s\"", e.phase, pid,
+                             e.track + 1, sim ? e.sim_us : e.host_us, escape(e.name).c_str());
+                if (e.phase == 'X') {
+                    std::fprintf(file, ",\"dur\":%.6f}", sim ? e.sim_dur_us : e.host_dur_us);
+                } else {
+                    std::fprintf(file, ",\"s\":\"t\"}");
+                }
+            }
+        }
+        std::fprintf(file, "\n]}\n");
+        bool ok = (std::fclose(file) == 0);
+
+        std::cout << "Timeline trace: " << entries.size() << " events on " << State::tracks.size() << " tracks written to "
+                  << path;
+        if (State::dropped.load() > 0) {
+            std::cout << " (" << State::dropped.load() << " dropped)";
+        }
+        std::cout << std::endl;
+        return ok;
+    }
+
+private:
+    static void append(const TimelineEvent& event) {
+        std::vector<TimelineEvent>* buffer = thread_buffer();
+        if (buffer->size() >= TIMELINE_TRACE_MAX_EVENTS) {
+            State::dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->push_back(event);
+    }
+
+    // This thread's buffer, registered on first use
+    static std::vector<TimelineEvent>* thread_buffer() {
+        static thread_local std::vector<TimelineEvent>* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(State::mutex);
+            State::buffers.push_back(std::unique_ptr<std::vector<TimelineEvent>>(new std::vector<TimelineEvent>()));
+            buffer = State::buffers.back().get();
+        }
+        return buffer;
+    }
+
+    static std::string escape(const std::string& text) {
+        std::string out;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '"' || text[i] == '\\') {
+                out += '\\';
+            }
+            out += text[i];
+        }
+        return out;
+    }
+
+    static void write_at_exit() {
+        stop();
+    }
+};
+
+// A track per module instance, named after it
+class TimelineTrack {
+public:
+    explicit TimelineTrack(const std::string& name) : m_id(TimelineTrace::add_track(name)) {}
+
+    uint32_t id() const { return m_id; }
+
+private:
+    uint32_t m_id;
+};
+
+// A slice from construction to destruction. With a delay, both ends are
+// stamped at sc_time_stamp() plus the delay at that moment, so a
+// b_transport scope covers the time it annotated.
+class TimelineScope {
+public:
+    TimelineScope(const TimelineTrack& track, const char* name, const sc_core::sc_time* delay = nullptr) :
+        m_active(TimelineTrace::enabled()),
+        m_track(track.id()),
+        m_name(name),
+        m_delay(delay),
+        m_sim_begin(0),
+        m_host_begin(0) {
+        if (m_active) {
+            m_sim_begin = TimelineTrace::sim_now_us(m_delay);
+            m_host_begin = TimelineTrace::host_us();
+        }
+    }
+
+    ~TimelineScope() {
+        if (m_active) {
+            TimelineTrace::slice(m_track, m_name, m_sim_begin, TimelineTrace::sim_now_us(m_delay), m_host_begin,
+                                 TimelineTrace::host_us());
+        }
+    }
+
+private:
+    bool m_active;
+    uint32_t m_track;
+    const char* m_name;
+    const sc_core::sc_time* m_delay;
+    double m_sim_begin;
+    double m_host_begin;
+
+    TimelineScope(const TimelineScope&);
+    TimelineScope& operator=(const TimelineScope&);
+};
+
+#endif // TIMELINE_TRACE_H
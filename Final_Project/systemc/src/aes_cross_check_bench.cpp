@@ -0,0 +1,121 @@
+#include "../include/aes_cipher.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_cross_check.h"
+#include "../include/aes_multi_buffer.h"
+#include "../include/aes_xts.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Standalone like the cipher library: no SystemC, links libaes_cipher
+
+template <typename Fn>
+static double time_seconds(Fn fn) {
+    auto start_time = chrono::high_resolution_clock::now();
+    fn();
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+// Best of three, so one descheduled run does not pass for overhead
+static double best_seconds(const function<void()>& run) {
+    double best = time_seconds(run);
+    for (int i = 0; i < 2; i++) {
+        best = min(best, time_seconds(run));
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    // Optional argument: megabytes processed per measurement
+    size_t total_bytes = 64u << 20;
+    if (argc > 1) {
+        total_bytes = max<size_t>(1, strtoul(argv[1], nullptr, 10)) << 20;
+    }
+
+    const size_t request = 4096;
+    vector<uint8_t> buffer(request * 8, 0x46);
+    AesKey key;
+    AesKey tweak_key;
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        key.key[i] = static_cast<uint8_t>(i);
+        tweak_key.key[i] = static_cast<uint8_t>(0x80 + i);
+    }
+    AesKeySchedule schedule(key);
+    AesXts xts(key, tweak_key);
+
+    // Each engine as production drives it: 4 KiB calls, 4 KiB sectors, and
+    // eight 4 KiB CBC streams sharing the lanes
+    struct Engine {
+        const char* name;
+        function<void()> run;
+    };
+    vector<Engine> engines = {
+        {"ecb encrypt", [&]() {
+            for (size_t done = 0; done < total_bytes; done += request) {
+                schedule.encrypt_blocks(buffer.data(), buffer.data(), request / AES_BLOCK_SIZE);
+            }
+        }},
+        {"xts encrypt", [&]() {
+            for (size_t done = 0; done < total_bytes; done += buffer.size()) {
+                xts.encrypt_sectors(buffer.data(), buffer.data(), request, buffer.size() / request, done / request);
+            }
+        }},
+        {"multi-buffer cbc", [&]() {
+            AesCbcStream streams[8];
+            for (size_t done = 0; done < total_bytes; done += buffer.size()) {
+                for (size_t i = 0; i < 8; i++) {
+                    streams[i] = {&schedule, buffer.data() + i * request, buffer.data() + i * request,
+                                  request / AES_BLOCK_SIZE, {}};
+                }
+                aes_cbc_encrypt_streams(streams, 8);
+            }
+        }},
+    };
+
+    cout << "=== Sampled Cross-Check Overhead ===" << endl;
+    cout << (total_bytes >> 20) << " MB per row, kernel " << aes_key_kernel_name(schedule.kernel()) << ", "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+    cout << "Rate: one block in N checked against AesCipher on the background thread" << endl;
+    if (schedule.kernel() != AesKeyKernel::AESNI) {
+        cout << "No AES-NI: the scalar kernels are the reference and are not sampled" << endl;
+    }
+
+    bool all_ok = true;
+    for (const Engine& engine : engines) {
+        cout << endl << "--- " << engine.name << " ---" << endl;
+        cout << right << setw(10) << "Rate" << setw(10) << "MB/sec" << setw(11) << "Overhead" << setw(10)
+             << "Sampled" << setw(10) << "Dropped" << setw(12) << "Mismatches" << endl;
+
+        double baseline = best_seconds(engine.run);
+        cout << setw(10) << "off" << fixed << setprecision(0) << setw(10) << total_bytes / baseline / 1e6
+             << setw(11) << "-" << setw(10) << 0 << setw(10) << 0 << setw(12) << 0 << endl;
+
+        // At one in one every call is checked, which is what running the
+        // reference beside the engine would cost
+        for (uint64_t rate : {1000000ull, 10000ull, 100ull, 1ull}) {
+            AesCrossCheck checker(rate);
+            checker.install();
+            double seconds = best_seconds(engine.run);
+            checker.uninstall();
+            checker.drain();
+            AesCrossCheckStats stats = checker.stats();
+            all_ok = all_ok && stats.total_mismatches() == 0 && stats.checked == stats.total_sampled();
+            cout << setw(10) << rate << setprecision(0) << setw(10) << total_bytes / seconds / 1e6
+                 << setprecision(1) << setw(10) << (seconds / baseline - 1) * 100 << "%" << setw(10)
+                 << stats.total_sampled() << setw(10) << stats.dropped << setw(12) << stats.total_mismatches()
+                 << endl;
+        }
+    }
+
+    cout << endl << "Functional check: " << (all_ok ? "SUCCESS" : "FAILED") << endl;
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#include "../include/aes_types.h"
+#include "../include/aes_cipher.h"
+#include "../include/aes_key_expansion.h"
+#include "../include/aes_round.h"
+#include "../include/aes_top.h"
+#include "../include/aes_dma.h"
+#include <systemc>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Memory layout: descriptor ring, then one source and one destination
+// buffer per ring entry
+const uint64_t RING_ADDRESS = 0x0;
+const uint64_t BUFFER_ADDRESS = 0x10000;
+const unsigned NUM_KEYS = 4;
+
+// Driver software: loads the keys, keeps the ring full, and on every
+// interrupt reaps completed descriptors and checks their results
+class DmaHost : public sc_module {
+public:
+    tlm_utils::simple_initiator_socket<DmaHost> reg_socket;
+    sc_in<bool> irq;
+
+    SC_HAS_PROCESS(DmaHost);
+    DmaHost(sc_module_name name, AesMemory& memory, unsigned ring_size, unsigned num_descriptors,
+            unsigned descriptor_bytes, unsigned coalesce_count, unsigned coalesce_timeout, unsigned seed) :
+        sc_module(name),
+        reg_socket("reg_socket"),
+        irq("irq"),
+        m_memory(memory),
+        m_ring_size(ring_size),
+        m_num_descriptors(num_descriptors),
+        m_descriptor_bytes(descriptor_bytes),
+        m_coalesce_count(coalesce_count),
+        m_coalesce_timeout(coalesce_timeout),
+        m_rng(seed),
+        m_passed(true) {
+        for (unsigned k = 0; k < NUM_KEYS; k++) {
+            AesKey key;
+            for (uint8_t& b : key.key) {
+                b = static_cast<uint8_t>(m_rng());
+            }
+            m_keys.push_back(key);
+            m_round_keys.emplace_back();
+            AesCipher::expand_key(key, m_round_keys.back());
+        }
+        SC_THREAD(run);
+    }
+
+    bool passed() const { return m_passed; }
+
+    // Enough memory for the ring and its buffers
+    static size_t memory_size(unsigned ring_size, unsigned descriptor_bytes) {
+        return BUFFER_ADDRESS + 2 * static_cast<size_t>(ring_size) * descriptor_bytes;
+    }
+
+    void run() {
+        for (unsigned k = 0; k < NUM_KEYS; k++) {
+            write_register(AES_DMA_KEY_SELECT, k);
+            for (unsigned w = 0; w < AES_KEY_SIZE / 4; w++) {
+                write_register(AES_DMA_KEY_DATA + 4 * w,
+                               static_cast<uint32_t>(AesDmaDescriptor::get(&m_keys[k].key[4 * w], 4)));
+            }
+        }
+        write_register(AES_DMA_RING_BASE_LO, static_cast<uint32_t>(RING_ADDRESS));
+        write_register(AES_DMA_RING_BASE_HI, static_cast<uint32_t>(RING_ADDRESS >> 32));
+        write_register(AES_DMA_RING_SIZE, m_ring_size);
+        write_register(AES_DMA_COALESCE_COUNT, m_coalesce_count);
+        write_register(AES_DMA_COALESCE_TIMEOUT, m_coalesce_timeout);
+
+        // One entry stays empty, so a full ring is distinguishable from an
+        // empty one
+        unsigned posted = 0;
+        unsigned reaped = 0;
+        while (reaped < m_num_descriptors) {
+            unsigned before = posted;
+            while (posted < m_num_descriptors && posted - reaped < m_ring_size - 1) {
+                post(posted++);
+            }
+            if (posted != before) {
+                write_register(AES_DMA_HEAD, posted % m_ring_size);
+            }
+
+            while (!irq.read()) {
+                wait(irq.posedge_event());
+            }
+            // Clear first, so completions after the TAIL read raise it again
+            write_register(AES_DMA_IRQ_STATUS, AES_DMA_IRQ_COMPLETION);
+            uint32_t tail = read_register(AES_DMA_TAIL);
+            while (reaped % m_ring_size != tail) {
+                check(reaped++);
+            }
+        }
+    }
+
+private:
+    AesMemory& m_memory;
+    unsigned m_ring_size;
+    unsigned m_num_descriptors;
+    unsigned m_descriptor_bytes;
+    unsigned m_coalesce_count;
+    unsigned m_coalesce_timeout;
+    mt19937 m_rng;
+    vector<AesKey> m_keys;
+    vector<AesRoundKeys> m_round_keys;
+    bool m_passed;
+
+    uint64_t source(unsigned slot) const { return BUFFER_ADDRESS + 2ull * slot * m_descriptor_bytes; }
+    uint64_t destination(unsigned slot) const { return source(slot) + m_descriptor_bytes; }
+
+    // Every fourth descriptor decrypts, and the key changes every 8
+    AesDmaDescriptor descriptor(unsigned n) const {
+        unsigned slot = n % m_ring_size;
+        AesDmaDescriptor d;
+        d.source = source(slot);
+        d.destination = destination(slot);
+        d.length = m_descriptor_bytes;
+        d.key_slot = static_cast<uint16_t>((n / 8) % NUM_KEYS);
+        d.operation = (n % 4 == 3) ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        return d;
+    }
+
+    // Software writes the buffer and descriptor directly; only the engine's
+    // traffic is timed
+    void post(unsigned n) {
+        AesDmaDescriptor d = descriptor(n);
+        uint8_t* data = m_memory.data(d.source);
+        for (unsigned i = 0; i < d.length; i++) {
+            data[i] = static_cast<uint8_t>(m_rng());
+        }
+        d.encode(m_memory.data(RING_ADDRESS + (n % m_ring_size) * AesDmaDescriptor::SIZE));
+    }
+
+    void check(unsigned n) {
+        AesDmaDescriptor expected = descriptor(n);
+        AesDmaDescriptor d = AesDmaDescriptor::decode(
+            m_memory.data(RING_ADDRESS + (n % m_ring_size) * AesDmaDescriptor::SIZE));
+        if (d.status != AES_DMA_STATUS_DONE) {
+            m_passed = false;
+            return;
+        }
+        const uint8_t* in = m_memory.data(expected.source);
+        const uint8_t* out = m_memory.data(expected.destination);
+        const AesRoundKeys& round_keys = m_round_keys[expected.key_slot];
+        for (unsigned b = 0; b < expected.length; b += AES_BLOCK_SIZE) {
+            AesBlock block(&in[b]);
+            AesBlock result = (expected.operation == AesOperation::DECRYPT)
+                                  ? AesCipher::decrypt_block(block, round_keys)
+                                  : AesCipher::encrypt_block(block, round_keys);
+            if (!(AesBlock(&out[b]) == result)) {
+                m_passed = false;
+            }
+        }
+    }
+
+    void register_access(tlm::tlm_command command, uint64_t address, uint8_t* data) {
+        tlm::tlm_generic_payload trans;
+        trans.set_command(command);
+        trans.set_address(address);
+        trans.set_data_ptr(data);
+        trans.set_data_length(4);
+        trans.set_streaming_width(4);
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+        sc_time delay = SC_ZERO_TIME;
+        reg_socket->b_transport(trans, delay);
+        if (trans.is_response_error()) {
+            m_passed = false;
+        }
+        wait(delay);
+    }
+
+    void write_register(uint64_t address, uint32_t value) {
+        uint8_t data[4];
+        AesDmaDescriptor::put(data, value, 4);
+        register_access(tlm::TLM_WRITE_COMMAND, address, data);
+    }
+
+    uint32_t read_register(uint64_t address) {
+        uint8_t data[4];
+        register_access(tlm::TLM_READ_COMMAND, address, data);
+        return static_cast<uint32_t>(AesDmaDescriptor::get(data, 4));
+    }
+};
+
+// Core variants: the iterative aes_top.v and the pipelined aes_pipelined.v
+struct DmaCore {
+    const char* name;
+    unsigned cycles_per_block;
+};
+
+// One DMA engine with its memory, AES core and driver
+struct DmaSystem {
+    const char* core;
+    unsigned coalesce_count;
+    unique_ptr<AesMemory> memory;
+    unique_ptr<AesDmaEngine> engine;
+    unique_ptr<AesTop> top;
+    unique_ptr<AesKeyExpansion> key_expansion;
+    unique_ptr<AesRound> round;
+    unique_ptr<DmaHost> host;
+    unique_ptr<sc_signal<bool>> irq;
+};
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    // Optional arguments: descriptors per configuration, bytes per descriptor
+    const unsigned num_descriptors = (argc > 1) ? max(1, atoi(argv[1])) : 256;
+    const unsigned descriptor_bytes = (argc > 2) ? max(1, atoi(argv[2])) * AES_BLOCK_SIZE : 4096;
+    const unsigned ring_size = 64;
+    const unsigned coalesce_timeout = 10000;  // 100 us
+    const DmaCore cores[] = {{"iterative", AES_NUM_ROUNDS + 1}, {"pipelined", 1}};
+    const unsigned burst_sizes[] = {64, 256, 1024};
+    const unsigned coalesce_counts[] = {1, 8};
+    const AesMemoryTiming memory_timing;
+
+    // Every configuration runs side by side in one simulation
+    vector<DmaSystem> systems;
+    for (const DmaCore& core : cores) {
+        for (unsigned burst : burst_sizes) {
+            for (unsigned coalesce : coalesce_counts) {
+                string suffix = string(core.name) + "_" + to_string(burst) + "_" + to_string(coalesce);
+                AesDmaTiming timing;
+                timing.burst_bytes = burst;
+                timing.cycles_per_block = core.cycles_per_block;
+
+                DmaSystem sys;
+                sys.core = core.name;
+                sys.coalesce_count = coalesce;
+                sys.memory.reset(new AesMemory(("memory_" + suffix).c_str(),
+                                               DmaHost::memory_size(ring_size, descriptor_bytes), memory_timing));
+                sys.engine.reset(new AesDmaEngine(("dma_" + suffix).c_str(), timing));
+                sys.top.reset(new AesTop(("aes_top_" + suffix).c_str()));
+                sys.key_expansion.reset(new AesKeyExpansion(("key_expansion_" + suffix).c_str()));
+                sys.round.reset(new AesRound(("aes_round_" + suffix).c_str()));
+                sys.host.reset(new DmaHost(("host_" + suffix).c_str(), *sys.memory, ring_size, num_descriptors,
+                                           descriptor_bytes, coalesce, coalesce_timeout, 460));
+                sys.irq.reset(new sc_signal<bool>(("irq_" + suffix).c_str()));
+
+                sys.engine->mem_socket.bind(sys.memory->socket);
+                sys.engine->core_socket.bind(sys.top->top_socket);
+                sys.top->key_expansion_socket.bind(sys.key_expansion->key_socket);
+                sys.top->round_socket.bind(sys.round->round_socket);
+                sys.host->reg_socket.bind(sys.engine->reg_socket);
+                sys.engine->irq(*sys.irq);
+                sys.host->irq(*sys.irq);
+                systems.push_back(std::move(sys));
+            }
+        }
+    }
+
+    // Start simulation
+    sc_start();
+
+    cout << "=== AES DMA Throughput (" << num_descriptors << " descriptors x " << descriptor_bytes
+         << " bytes, ring of " << ring_size << ", " << memory_timing.bus_bytes * 8 << "-bit memory @ "
+         << 1.0 / memory_timing.clock_period.to_seconds() / 1e6 << " MHz, "
+         << memory_timing.latency_cycles << "-cycle latency) ===" << endl;
+    cout << left << setw(11) << "Core" << right << setw(7) << "Burst" << setw(10) << "Coalesce"
+         << setw(9) << "MB/s" << setw(9) << "Fetch" << setw(9) << "Cipher" << setw(9) << "Write"
+         << setw(9) << "Memory" << setw(7) << "IRQs" << "  Bottleneck" << endl;
+
+    bool all_passed = true;
+    for (const DmaSystem& sys : systems) {
+        const AesDmaStats& stats = sys.engine->stats();
+        double elapsed = stats.elapsed().to_seconds();
+        double fetch = stats.fetch_busy.to_seconds() / elapsed;
+        double cipher = stats.encrypt_busy.to_seconds() / elapsed;
+        double write_back = stats.write_back_busy.to_seconds() / elapsed;
+        double memory = sys.memory->busy().to_seconds() / elapsed;
+        all_passed = all_passed && sys.host->passed() && stats.descriptors == num_descriptors && stats.errors == 0;
+
+        // The stage that was busiest is the one holding the others up; the
+        // data movers are limited by the memory port they share
+        const char* bottleneck = "cipher core";
+        if (max(fetch, write_back) > cipher) {
+            bottleneck = (memory > 0.9) ? "memory bandwidth" : (fetch > write_back ? "fetch" : "write-back");
+        }
+
+        cout << left << setw(11) << sys.core << right << setw(7) << sys.engine->timing().burst_bytes
+             << setw(10) << sys.coalesce_count << fixed << setprecision(1)
+             << setw(9) << stats.bytes / elapsed / 1e6
+             << setw(8) << 100.0 * fetch << "%" << setw(8) << 100.0 * cipher << "%"
+             << setw(8) << 100.0 * write_back << "%" << setw(8) << 100.0 * memory << "%"
+             << setw(7) << stats.interrupts << "  " << bottleneck << endl;
+    }
+
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
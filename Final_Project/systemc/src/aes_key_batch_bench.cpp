@@ -0,0 +1,192 @@
+#include "../include/aes_types.h"
+#include "../include/aes_sbox.h"
+#include "../include/aes_shift_rows.h"
+#include "../include/aes_mix_columns.h"
+#include "../include/aes_key_expansion.h"
+#include "../include/aes_key_batch.h"
+#include <systemc>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Passes over the key set per measurement, to get above timer resolution
+constexpr int REPEATS = 8;
+
+template <typename Fn>
+static double time_seconds(Fn fn) {
+    auto start_time = chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < REPEATS; rep++) {
+        fn();
+    }
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(end_time - start_time).count() / REPEATS;
+}
+
+static bool same_round_keys(const AesRoundKeys& a, const AesRoundKeys& b) {
+    for (int r = 0; r <= AES_NUM_ROUNDS; r++) {
+        if (!(a.round_keys[r] == b.round_keys[r])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Encryption with a materialized schedule, as AesTop runs it
+static AesBlock encrypt_with_round_keys(const AesBlock& block, const AesRoundKeys& round_keys) {
+    AesBlock state = block ^ round_keys.round_keys[0];
+    for (int r = 1; r <= AES_NUM_ROUNDS; r++) {
+        state = AesShiftRows::shift_rows(AesSBox::sub_bytes(state));
+        if (r != AES_NUM_ROUNDS) {
+            state = AesMixColumns::mix_columns(state);
+        }
+        state = state ^ round_keys.round_keys[r];
+    }
+    return state;
+}
+
+template <size_t N>
+static void expand_all(const vector<AesKey>& keys, vector<AesRoundKeys>& round_keys, AesKeyKernel kernel) {
+    for (size_t i = 0; i < keys.size(); i += N) {
+        AesKeyBatch<N>::expand(&keys[i], &round_keys[i], kernel);
+    }
+}
+
+template <size_t N>
+static void encrypt_all(const vector<AesKey>& keys, vector<AesBlock>& blocks, AesKeyKernel kernel) {
+    for (size_t i = 0; i < keys.size(); i += N) {
+        AesKeyBatch<N>::encrypt_on_the_fly(&keys[i], &blocks[i], kernel);
+    }
+}
+
+template <size_t N>
+static void decrypt_all(const vector<AesKey>& keys, vector<AesBlock>& blocks, AesKeyKernel kernel) {
+    for (size_t i = 0; i < keys.size(); i += N) {
+        AesKeyBatch<N>::decrypt_on_the_fly(&keys[i], &blocks[i], kernel);
+    }
+}
+
+// FIPS 197 Appendix C.1 through the on-the-fly path of every kernel
+static bool check_fips_vector(AesKeyKernel kernel) {
+    const AesKey key(reinterpret_cast<const uint8_t*>(
+        "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"));
+    const AesBlock plaintext(reinterpret_cast<const uint8_t*>(
+        "\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99\xaa\xbb\xcc\xdd\xee\xff"));
+    const AesBlock ciphertext(reinterpret_cast<const uint8_t*>(
+        "\x69\xc4\xe0\xd8\x6a\x7b\x04\x30\xd8\xcd\xb7\x80\x70\xb4\xc5\x5a"));
+
+    AesKey keys[4] = {key, key, key, key};
+    AesBlock blocks[4] = {plaintext, plaintext, plaintext, plaintext};
+    AesKeyBatch<4>::encrypt_on_the_fly(keys, blocks, kernel);
+    bool passed = blocks[3] == ciphertext;
+    AesKeyBatch<4>::decrypt_on_the_fly(keys, blocks, kernel);
+    return passed && blocks[0] == plaintext;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    // Optional argument: number of distinct keys (rounded up to 16)
+    size_t num_keys = 1 << 16;
+    if (argc > 1) {
+        num_keys = strtoul(argv[1], nullptr, 10);
+    }
+    num_keys = max<size_t>(16, (num_keys + 15) / 16 * 16);
+
+    // One key per block, as with per-tenant or per-record keys
+    mt19937 rng(460);
+    vector<AesKey> keys(num_keys);
+    vector<AesBlock> plaintext(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+        for (int j = 0; j < AES_KEY_SIZE; j++) {
+            keys[i].key[j] = static_cast<uint8_t>(rng());
+            plaintext[i].data[j] = static_cast<uint8_t>(rng());
+        }
+    }
+
+    // Reference: one expand_key call per key
+    vector<AesRoundKeys> reference(num_keys);
+    double ref_seconds = time_seconds([&]() {
+        for (size_t i = 0; i < num_keys; i++) {
+            AesKeyExpansion::expand_key(keys[i], reference[i]);
+        }
+    });
+    vector<AesBlock> reference_ct(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+        reference_ct[i] = encrypt_with_round_keys(plaintext[i], reference[i]);
+    }
+
+    cout << "=== AES-128 Multi-Key Batch Key Expansion ===" << endl;
+    cout << "Distinct keys: " << num_keys << ", auto kernel: "
+         << aes_key_kernel_name(aes_key_kernel_resolve(AesKeyKernel::AUTO)) << endl << endl;
+    cout << left << setw(10) << "Kernel" << right << setw(7) << "Batch" << setw(13) << "ns/key"
+         << setw(13) << "Mkeys/sec" << setw(10) << "Speedup" << endl;
+    cout << left << setw(10) << "expand_key" << right << setw(7) << 1 << fixed << setprecision(1)
+         << setw(13) << ref_seconds / num_keys * 1e9 << setprecision(2)
+         << setw(13) << num_keys / ref_seconds / 1e6 << setw(9) << 1.0 << "x" << endl;
+
+    bool all_match = true;
+    vector<AesRoundKeys> round_keys(num_keys);
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI, AesKeyKernel::VAES}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            cout << left << setw(10) << aes_key_kernel_name(kernel) << right << setw(20) << "unsupported" << endl;
+            continue;
+        }
+        for (size_t batch : {4, 8, 16}) {
+            double seconds = time_seconds([&]() {
+                if (batch == 4) {
+                    expand_all<4>(keys, round_keys, kernel);
+                } else if (batch == 8) {
+                    expand_all<8>(keys, round_keys, kernel);
+                } else {
+                    expand_all<16>(keys, round_keys, kernel);
+                }
+            });
+            for (size_t i = 0; i < num_keys; i++) {
+                all_match = all_match && same_round_keys(round_keys[i], reference[i]);
+            }
+            cout << left << setw(10) << aes_key_kernel_name(kernel) << right << setw(7) << batch
+                 << setprecision(1) << setw(13) << seconds / num_keys * 1e9 << setprecision(2)
+                 << setw(13) << num_keys / seconds / 1e6 << setw(9) << ref_seconds / seconds << "x" << endl;
+        }
+    }
+
+    // Key-agile encryption: every block under its own key. The materialized
+    // path expands each key to 176 bytes first; on-the-fly keeps one 16-byte
+    // round key per lane and never stores the schedule.
+    cout << endl << "One block per key (batch of 16 on-the-fly):" << endl;
+    cout << left << setw(24) << "Path" << right << setw(13) << "ns/block" << setw(13) << "Key bytes" << endl;
+    vector<AesBlock> blocks(num_keys);
+    double materialized_seconds = time_seconds([&]() {
+        AesRoundKeys schedule;
+        for (size_t i = 0; i < num_keys; i++) {
+            AesKeyExpansion::expand_key(keys[i], schedule);
+            blocks[i] = encrypt_with_round_keys(plaintext[i], schedule);
+        }
+    });
+    cout << left << setw(24) << "expand_key + encrypt" << right << setprecision(1)
+         << setw(13) << materialized_seconds / num_keys * 1e9 << setw(13) << sizeof(AesRoundKeys) << endl;
+
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            continue;
+        }
+        double seconds = time_seconds([&]() {
+            blocks = plaintext;
+            encrypt_all<16>(keys, blocks, kernel);
+        });
+        all_match = all_match && blocks == reference_ct;
+        decrypt_all<16>(keys, blocks, kernel);
+        all_match = all_match && blocks == plaintext && check_fips_vector(kernel);
+
+        cout << left << setw(24) << (string("on-the-fly ") + aes_key_kernel_name(kernel)) << right
+             << setw(13) << seconds / num_keys * 1e9 << setw(13) << sizeof(AesBlock) << endl;
+    }
+
+    cout << endl << "Kernels bit-exact with expand_key: " << (all_match ? "YES" : "NO") << endl;
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include "../include/aes_cipher.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_key_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Standalone like the cipher library: no SystemC, links libaes_cipher
+
+template <typename Fn>
+static double time_seconds(Fn fn) {
+    auto start_time = chrono::high_resolution_clock::now();
+    fn();
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+static void print_row(const string& path, double seconds, size_t keys, double reference) {
+    cout << left << setw(26) << path << right << fixed << setprecision(2) << setw(11) << seconds * 1e3
+         << setprecision(1) << setw(13) << keys / seconds / 1e6 << setprecision(2) << setw(10)
+         << reference / seconds << "x" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Optional arguments: key count, and store path
+    size_t num_keys = 100000;
+    string path = "aes_key_store_bench.bin";
+    if (argc > 1) {
+        num_keys = max<size_t>(1, strtoul(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        path = argv[2];
+    }
+
+    // Sparse 64-bit IDs, as a key-management service would hand out
+    mt19937_64 rng(460);
+    vector<uint64_t> ids(num_keys);
+    vector<AesKey> keys(num_keys);
+    for (size_t k = 0; k < num_keys; k++) {
+        ids[k] = rng();
+        for (int i = 0; i < AES_KEY_SIZE; i++) {
+            keys[k].key[i] = static_cast<uint8_t>(rng());
+        }
+    }
+    vector<size_t> lookup_order(num_keys);
+    for (size_t k = 0; k < num_keys; k++) {
+        lookup_order[k] = k;
+    }
+    shuffle(lookup_order.begin(), lookup_order.end(), rng);
+
+    cout << "=== AES-128 Key Schedule Store Startup ===" << endl;
+    cout << "Keys: " << num_keys << ", store " << path << endl << endl;
+
+    // One-time build, not part of any process's startup
+    int status = AES_CIPHER_OK;
+    double build_seconds = time_seconds([&]() {
+        status = AesKeyStore::write(path, ids.data(), keys.data(), num_keys);
+    });
+    if (status != AES_CIPHER_OK) {
+        cout << "Store build failed: " << status << endl;
+        return 1;
+    }
+
+    cout << left << setw(26) << "Startup" << right << setw(11) << "ms" << setw(13) << "Mkeys/sec"
+         << setw(11) << "Speedup" << endl;
+
+    // What every process does today: expand all of its keys before serving
+    vector<AesKeySchedule> expanded(num_keys);
+    double expand_seconds = time_seconds([&]() {
+        for (size_t k = 0; k < num_keys; k++) {
+            expanded[k] = AesKeySchedule(keys[k]);
+        }
+    });
+    print_row("expand one at a time", expand_seconds, num_keys, expand_seconds);
+
+    vector<AesKeySchedule> batched(num_keys);
+    double batch_seconds = time_seconds([&]() {
+        AesKeySchedule::expand_batch(keys.data(), batched.data(), num_keys);
+    });
+    print_row("expand_batch", batch_seconds, num_keys, expand_seconds);
+
+    // Store: open maps the file and reads the header, so a process can
+    // serve as soon as it returns; lookups then pull in only the pages used
+    AesKeyStore store;
+    double open_seconds = time_seconds([&]() {
+        status = store.open(path);
+    });
+    if (status != AES_CIPHER_OK) {
+        cout << "Store open failed: " << status << endl;
+        return 1;
+    }
+    print_row("store open", open_seconds, num_keys, expand_seconds);
+
+    bool all_match = true;
+    AesKeySchedule loaded;
+    double lookup_seconds = time_seconds([&]() {
+        for (size_t k : lookup_order) {
+            all_match = store.get(ids[k], loaded) && all_match;
+        }
+    });
+    print_row("store open + every get", open_seconds + lookup_seconds, num_keys, expand_seconds);
+
+    for (size_t k : lookup_order) {
+        all_match = all_match && store.get(ids[k], loaded) &&
+                    loaded.round_keys().round_keys == expanded[k].round_keys().round_keys &&
+                    loaded.inv_round_keys().round_keys == expanded[k].inv_round_keys().round_keys;
+    }
+    all_match = all_match && store.verify();
+
+    cout << endl << "Store build: " << fixed << setprecision(2) << build_seconds * 1e3 << " ms, "
+         << num_keys * sizeof(AesKeyStoreRecord) / 1024 << " KiB of schedules shared through the page cache"
+         << endl;
+    cout << "Stored schedules match expansion: " << (all_match ? "YES" : "NO") << endl;
+
+    store.close();
+    remove(path.c_str());
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+#include "../include/aes_types.h"
+#include "../include/aes_lane_system.h"
+#include "../include/timeline_trace.h"
+#include <systemc>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Keys shared by all hosts, e.g. one per tenant, with their expansions for
+// checking results
+struct KeyPool {
+    vector<AesKey> keys;
+    vector<AesRoundKeys> round_keys;
+};
+
+// Closed-loop traffic source: issues a request, waits for its result, checks
+// it and issues the next. Several hosts per router keep requests in flight.
+class LaneHost : public sc_module {
+public:
+    tlm_utils::simple_initiator_socket<LaneHost> bus_socket;
+
+    SC_HAS_PROCESS(LaneHost);
+    LaneHost(sc_module_name name, const KeyPool& pool, int num_requests, int blocks_per_request, unsigned seed) :
+        sc_module(name),
+        bus_socket("bus_socket"),
+        m_pool(pool),
+        m_num_requests(num_requests),
+        m_blocks(blocks_per_request),
+        m_rng(seed),
+        m_passed(true),
+        m_latency(SC_ZERO_TIME) {
+        SC_THREAD(run);
+    }
+
+    bool passed() const { return m_passed; }
+    const sc_time& total_latency() const { return m_latency; }
+
+    void run() {
+        vector<uint8_t> buffer(m_blocks * AES_BLOCK_SIZE);
+        vector<uint8_t> plaintext(buffer.size());
+        for (int i = 0; i < m_num_requests; i++) {
+            size_t k = m_rng() % m_pool.keys.size();
+            for (uint8_t& b : plaintext) {
+                b = static_cast<uint8_t>(m_rng());
+            }
+            buffer = plaintext;
+
+            // One segment: a multi-block request uses the scatter-gather
+            // payload convention
+            struct iovec segment = {buffer.data(), buffer.size()};
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_data_ptr(buffer.data());
+            trans.set_data_length(buffer.size());
+            trans.set_streaming_width(buffer.size());
+            trans.set_byte_enable_ptr(nullptr);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            AesExtension* ext = new AesExtension();
+            ext->operation = AesOperation::ENCRYPT;
+            ext->mode = AesMode::NON_PIPELINED;
+            ext->key = m_pool.keys[k];
+            trans.set_extension(ext);
+            AesScatterGatherExtension* sg = new AesScatterGatherExtension(&segment, 1);
+            trans.set_extension(sg);
+
+            sc_time delay = SC_ZERO_TIME;
+            bus_socket->b_transport(trans, delay);
+            trans.release_extension(ext);
+            trans.release_extension(sg);
+
+            if (trans.is_response_error()) {
+                m_passed = false;
+            }
+            for (int b = 0; b < m_blocks; b++) {
+                AesBlock expected = AesCipher::encrypt_block(AesBlock(&plaintext[b * AES_BLOCK_SIZE]),
+                                                             m_pool.round_keys[k]);
+                if (!(AesBlock(&buffer[b * AES_BLOCK_SIZE]) == expected)) {
+                    m_passed = false;
+                }
+            }
+
+            m_latency += delay;
+            wait(delay);
+        }
+    }
+
+private:
+    const KeyPool& m_pool;
+    int m_num_requests;
+    int m_blocks;
+    mt19937 m_rng;
+    bool m_passed;
+    sc_time m_latency;
+};
+
+// A router with its lanes and hosts
+struct LaneSystem {
+    unique_ptr<AesLaneSystem> lanes;
+    vector<unique_ptr<LaneHost>> hosts;
+};
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    // Optional arguments: requests per configuration, blocks per request
+    const int num_requests = (argc > 1) ? max(1, atoi(argv[1])) : 4096;
+    const int blocks_per_request = (argc > 2) ? max(1, atoi(argv[2])) : 4;
+    // After them, --trace <file> writes a Chrome/Perfetto timeline of every
+    // router, bus and lane
+    TimelineTrace::configure(argc, argv);
+    const unsigned lane_counts[] = {1, 2, 4, 8, 16};
+    const AesLanePolicy policies[] = {AesLanePolicy::ROUND_ROBIN, AesLanePolicy::LEAST_LOADED,
+                                      AesLanePolicy::KEY_AFFINITY};
+    const AesLaneTiming timing;
+
+    KeyPool pool;
+    mt19937 key_rng(460);
+    for (int k = 0; k < 16; k++) {
+        AesKey key;
+        for (uint8_t& b : key.key) {
+            b = static_cast<uint8_t>(key_rng());
+        }
+        pool.keys.push_back(key);
+        pool.round_keys.emplace_back();
+        AesCipher::expand_key(key, pool.round_keys.back());
+    }
+
+    // Every configuration runs side by side in one simulation; two hosts
+    // per lane keep every lane supplied
+    vector<LaneSystem> systems;
+    for (AesLanePolicy policy : policies) {
+        for (unsigned lanes : lane_counts) {
+            string suffix = string(aes_lane_policy_name(policy)) + "_" + to_string(lanes);
+            LaneSystem sys;
+            sys.lanes.reset(new AesLaneSystem(suffix, lanes, policy, timing));
+            unsigned num_hosts = 2 * lanes;
+            for (unsigned h = 0; h < num_hosts; h++) {
+                int share = num_requests / num_hosts + (h < num_requests % num_hosts ? 1 : 0);
+                sys.hosts.emplace_back(new LaneHost(("host_" + suffix + "_" + to_string(h)).c_str(), pool, share,
+                                                    blocks_per_request, 1000 * lanes + h));
+                sys.hosts.back()->bus_socket.bind(sys.lanes->router->bus_socket);
+            }
+            systems.push_back(std::move(sys));
+        }
+    }
+
+    // Start simulation
+    sc_start();
+
+    const double cycle = timing.clock_period.to_seconds();
+    cout << "=== AES Multi-Lane Scaling (" << num_requests << " requests x " << blocks_per_request
+         << " blocks, " << pool.keys.size() << " keys, " << timing.bus_bytes * 8 << "-bit shared bus @ "
+         << 1.0 / cycle / 1e6 << " MHz) ===" << endl;
+    cout << left << setw(14) << "Policy" << right << setw(6) << "Lanes" << setw(10) << "Gbps" << setw(9) << "Speedup"
+         << setw(10) << "Lane avg" << setw(9) << "min" << setw(9) << "max" << setw(11) << "Wait cyc"
+         << setw(8) << "Max Q" << setw(10) << "Key load" << setw(9) << "Bus" << setw(11) << "Lat cyc" << endl;
+
+    bool all_passed = true;
+    for (AesLanePolicy policy : policies) {
+        double single_lane_gbps = 0.0;
+        unsigned saturated_at = 0;
+        double saturated_bus = 0.0;
+        for (const LaneSystem& sys : systems) {
+            const AesLaneRouter& router = *sys.lanes->router;
+            if (router.policy() != policy) {
+                continue;
+            }
+            double elapsed = router.elapsed().to_seconds();
+            double gbps = router.total_blocks() * 128.0 / elapsed / 1e9;
+            if (router.num_lanes() == 1) {
+                single_lane_gbps = gbps;
+            }
+
+            double util_sum = 0.0;
+            double util_min = 1.0;
+            double util_max = 0.0;
+            double wait_cycles = 0.0;
+            size_t max_queue = 0;
+            uint64_t transactions = 0;
+            uint64_t key_loads = 0;
+            for (unsigned i = 0; i < router.num_lanes(); i++) {
+                const AesLaneStats& lane = router.lane_stats(i);
+                double util = lane.busy.to_seconds() / elapsed;
+                util_sum += util;
+                util_min = min(util_min, util);
+                util_max = max(util_max, util);
+                wait_cycles += lane.queue_wait.to_seconds() / cycle;
+                max_queue = max(max_queue, lane.max_queue);
+                transactions += lane.transactions;
+                key_loads += lane.key_loads;
+            }
+            double bus_util = router.interconnect_stats().busy.to_seconds() / elapsed;
+
+            double latency = 0.0;
+            for (const unique_ptr<LaneHost>& host : sys.hosts) {
+                latency += host->total_latency().to_seconds() / cycle;
+                all_passed = all_passed && host->passed();
+            }
+
+            cout << left << setw(14) << aes_lane_policy_name(policy) << right << setw(6) << router.num_lanes()
+                 << fixed << setprecision(2) << setw(10) << gbps << setw(8) << gbps / single_lane_gbps << "x"
+                 << setprecision(1) << setw(9) << 100.0 * util_sum / router.num_lanes() << "%"
+                 << setw(8) << 100.0 * util_min << "%" << setw(8) << 100.0 * util_max << "%"
+                 << setw(11) << wait_cycles / transactions << setw(8) << max_queue
+                 << setw(9) << 100.0 * key_loads / transactions << "%" << setw(8) << 100.0 * bus_util << "%"
+                 << setw(11) << latency / transactions << endl;
+
+            // Scaling has stopped once the speedup falls below 75% of the
+            // lane count
+            if (saturated_at == 0 && gbps / single_lane_gbps < 0.75 * router.num_lanes()) {
+                saturated_at = router.num_lanes();
+                saturated_bus = bus_util;
+            }
+        }
+        if (saturated_at) {
+            cout << "  " << aes_lane_policy_name(policy) << ": scaling stops at " << saturated_at << " lanes, "
+                 << (saturated_bus > 0.75 ? "shared bus saturated (" : "lanes unevenly loaded (bus ")
+                 << setprecision(0) << 100.0 * saturated_bus << "% busy)" << endl;
+        }
+    }
+
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
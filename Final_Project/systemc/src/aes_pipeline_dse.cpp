@@ -0,0 +1,175 @@
+#include "../include/aes_pipeline_dse.h"
+#include <systemc>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// One row of the sweep
+struct DsePoint {
+    AesPipelineConfig config;
+    AesPipelineEstimate estimate;
+    AesPipelineStats stats;
+    double gbps;
+    double latency_ns;
+    bool pareto;
+};
+
+// a is at least as good as b everywhere and better somewhere: throughput
+// up, slices down, latency down
+static bool dominates(const DsePoint& a, const DsePoint& b) {
+    bool no_worse = a.gbps >= b.gbps && a.estimate.slices <= b.estimate.slices && a.latency_ns <= b.latency_ns;
+    bool better = a.gbps > b.gbps || a.estimate.slices < b.estimate.slices || a.latency_ns < b.latency_ns;
+    return no_worse && better;
+}
+
+static string rtl_name(const AesPipelineConfig& config) {
+    if (config.rounds_per_stage == 1 && config.sub_stages == 1) {
+        if (config.stages == 1) {
+            return "aes_top.v";
+        }
+        if (config.stages == AES_NUM_ROUNDS) {
+            return "aes_pipelined.v";
+        }
+    }
+    return "";
+}
+
+static void print_header() {
+    cout << left << setw(8) << "Config" << right << setw(8) << "Rnd/stg" << setw(8) << "Stages"
+         << setw(5) << "Sub" << setw(9) << "Lat clk" << setw(9) << "Blk/clk" << setw(8) << "MHz"
+         << setw(9) << "Gbps" << setw(9) << "Lat ns" << setw(7) << "LUTs" << setw(7) << "FFs"
+         << setw(8) << "Slices" << setw(7) << "Area" << "  " << left << "Notes" << endl;
+}
+
+static void print_row(const DsePoint& p, unsigned baseline_slices) {
+    string notes = rtl_name(p.config);
+    if (p.pareto) {
+        notes = notes.empty() ? "pareto" : "pareto, " + notes;
+    }
+    cout << left << setw(8) << p.config.name() << right << setw(8) << p.config.rounds_per_stage
+         << setw(8) << p.config.stages << setw(5) << p.config.sub_stages
+         << setw(9) << p.stats.first_latency << fixed << setprecision(3) << setw(9) << p.stats.blocks_per_clock()
+         << setprecision(1) << setw(8) << p.estimate.clock_mhz << setprecision(2) << setw(9) << p.gbps
+         << setprecision(1) << setw(9) << p.latency_ns << setw(7) << p.estimate.luts << setw(7) << p.estimate.ffs
+         << setw(8) << p.estimate.slices << setprecision(2) << setw(6)
+         << static_cast<double>(p.estimate.slices) / baseline_slices << "x  " << left << notes << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    // Optional arguments: block count, and --target-gbps to pick the
+    // smallest configuration that reaches a throughput
+    int num_blocks = 1000;
+    double target_gbps = 0.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--target-gbps") == 0 && i + 1 < argc) {
+            target_gbps = atof(argv[++i]);
+        } else {
+            num_blocks = max(1, atoi(argv[i]));
+        }
+    }
+
+    // FIPS 197 key, random plaintexts
+    AesKey key;
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        key.key[i] = static_cast<uint8_t>(i);
+    }
+    mt19937 rng(460);
+    vector<AesBlock> plaintexts(num_blocks);
+    for (AesBlock& block : plaintexts) {
+        for (uint8_t& b : block.data) {
+            b = static_cast<uint8_t>(rng());
+        }
+    }
+
+    // Every configuration runs the same workload off one clock; cycle counts
+    // are converted to time with each configuration's own estimated clock
+    sc_clock clk("clk", 10, SC_NS);
+    vector<AesPipelineConfig> configs = AesPipelineConfig::sweep();
+    vector<unique_ptr<AesPipelineModel>> models;
+    for (const AesPipelineConfig& config : configs) {
+        string name = "datapath_" + to_string(config.rounds_per_stage) + "x" + to_string(config.stages) +
+                      "_" + to_string(config.sub_stages);
+        models.emplace_back(new AesPipelineModel(name.c_str(), config));
+        models.back()->clk(clk);
+        models.back()->load(key, plaintexts);
+    }
+
+    // The slowest configuration needs ten clocks per block
+    sc_start(sc_time(10.0 * (AES_NUM_ROUNDS * num_blocks + 4 * AES_NUM_ROUNDS), SC_NS));
+
+    vector<DsePoint> points;
+    bool all_passed = true;
+    for (const unique_ptr<AesPipelineModel>& model : models) {
+        DsePoint p;
+        p.config = model->config();
+        p.estimate = aes_pipeline_estimate(p.config);
+        p.stats = model->stats();
+        p.gbps = 128.0 * p.stats.blocks_per_clock() * p.estimate.clock_mhz / 1000.0;
+        p.latency_ns = p.stats.first_latency * 1000.0 / p.estimate.clock_mhz;
+        p.pareto = true;
+        points.push_back(p);
+        all_passed = all_passed && model->done() && p.stats.mismatches == 0;
+    }
+    for (DsePoint& p : points) {
+        for (const DsePoint& q : points) {
+            if (dominates(q, p)) {
+                p.pareto = false;
+                break;
+            }
+        }
+    }
+
+    unsigned baseline_slices = aes_pipeline_estimate(AesPipelineConfig()).slices;
+
+    cout << "=== AES Datapath Design Space (" << num_blocks << " blocks, encryption) ===" << endl;
+    cout << "Config RxS/C: R rounds of logic per stage, S stages in the loop, C register cuts per stage" << endl;
+    cout << "Clock and resources are estimates calibrated to aes_top.v and aes_pipelined.v" << endl << endl;
+    print_header();
+    for (const DsePoint& p : points) {
+        print_row(p, baseline_slices);
+    }
+
+    // The frontier, smallest first
+    vector<DsePoint> frontier;
+    for (const DsePoint& p : points) {
+        if (p.pareto) {
+            frontier.push_back(p);
+        }
+    }
+    stable_sort(frontier.begin(), frontier.end(),
+                [](const DsePoint& a, const DsePoint& b) { return a.estimate.slices < b.estimate.slices; });
+
+    cout << endl << "=== Pareto Frontier (throughput, slices, latency) ===" << endl;
+    print_header();
+    for (const DsePoint& p : frontier) {
+        print_row(p, baseline_slices);
+    }
+
+    if (target_gbps > 0.0) {
+        const DsePoint* pick = nullptr;
+        for (const DsePoint& p : frontier) {
+            if (p.gbps >= target_gbps && (!pick || p.estimate.slices < pick->estimate.slices)) {
+                pick = &p;
+            }
+        }
+        cout << endl << "Target " << fixed << setprecision(2) << target_gbps << " Gbps: ";
+        if (pick) {
+            cout << pick->config.name() << " (" << pick->gbps << " Gbps, " << pick->estimate.slices << " slices)" << endl;
+        } else {
+            cout << "no configuration reaches it" << endl;
+        }
+    }
+
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "../include/aes_types.h"
+#include "../include/aes_lane_system.h"
+#include "../include/aes_workload.h"
+#include "../include/aes_sampled_replay.h"
+#include <systemc>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+static void print_header() {
+    cout << left << setw(9) << "Mode" << right << setw(10) << "Detailed" << setw(7) << "Units" << setw(14)
+         << "Sim time" << setw(9) << "+-" << setw(8) << "Gbps" << setw(17) << "Gbps range" << setw(12)
+         << "Latency" << setw(10) << "+-" << setw(9) << "Wall" << setw(9) << "Speedup" << endl;
+    cout << left << setw(9) << "" << right << setw(10) << "requests" << setw(7) << "" << setw(14) << "us"
+         << setw(9) << "" << setw(8) << "" << setw(17) << "" << setw(12) << "ns" << setw(10) << "" << setw(9) << "s"
+         << setw(9) << "" << endl;
+}
+
+static void print_row(const string& mode, const AesSamplingEstimate& e, double full_wall) {
+    ostringstream range;
+    range << fixed << setprecision(2) << e.gbps_low() << "-" << e.gbps_high();
+    cout << left << setw(9) << mode << right << setw(10) << e.detailed_requests << setw(7) << e.units << fixed
+         << setprecision(1) << setw(14) << e.total_ns * 1e-3 << setprecision(2) << setw(8)
+         << 100.0 * e.relative_ci() << "%" << setw(8) << e.gbps() << setw(17) << range.str() << setprecision(1)
+         << setw(12) << e.mean_latency_ns << setw(10) << e.latency_ci_ns << setprecision(2) << setw(9)
+         << e.wall_seconds;
+    if (full_wall > 0.0) {
+        cout << setprecision(1) << setw(8) << full_wall / max(e.wall_seconds, 1e-9) << "x";
+    } else {
+        cout << setw(9) << "-";
+    }
+    cout << endl;
+}
+
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " <trace> [repeats] [lanes] [rate] [--full] [--unit N] [--warmup N] [--period N]"
+         << endl;
+    cout << "  The trace is replayed repeats times back to back. --full also times every" << endl;
+    cout << "  request, after the sample, and compares the estimate with it." << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    vector<string> positional;
+    bool full = false;
+    AesSamplingConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--full") {
+            full = true;
+        } else if ((arg == "--unit" || arg == "--warmup" || arg == "--period") && i + 1 < argc) {
+            uint64_t value = strtoull(argv[++i], nullptr, 10);
+            (arg == "--unit" ? config.unit_requests : arg == "--warmup" ? config.warmup_requests : config.period) =
+                value;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty() || positional.size() > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    const string path = positional[0];
+    const uint64_t repeats = positional.size() > 1 ? max(1ull, strtoull(positional[1].c_str(), nullptr, 10)) : 25;
+    const unsigned lanes = positional.size() > 2 ? static_cast<unsigned>(max(1, atoi(positional[2].c_str()))) : 4;
+    const double rate = positional.size() > 3 ? atof(positional[3].c_str()) : 1.0;
+
+    AesWorkloadTrace trace;
+    size_t error_line = 0;
+    if (!trace.load(path, &error_line)) {
+        cout << "Cannot read " << path;
+        if (error_line > 0) {
+            cout << " (line " << error_line << ")";
+        }
+        cout << endl;
+        return 1;
+    }
+
+    // The sample runs first; the full replay, if asked for, starts when it
+    // finishes, on an engine of its own
+    AesLaneSystem sampled_engine("sampled", lanes);
+    AesSampledReplayer sampled("sampled_replayer", trace, repeats, rate, config);
+    sampled.init_socket.bind(sampled_engine.router->bus_socket);
+    unique_ptr<AesLaneSystem> full_engine;
+    unique_ptr<AesSampledReplayer> reference;
+    if (full) {
+        full_engine.reset(new AesLaneSystem("full", lanes));
+        reference.reset(new AesSampledReplayer("full_replayer", trace, repeats, rate,
+                                               AesSamplingConfig::full(config.unit_requests)));
+        reference->init_socket.bind(full_engine->router->bus_socket);
+        reference->start_after(sampled.finished());
+    }
+
+    sc_start();
+
+    AesSamplingEstimate estimate = sampled.estimate();
+    AesWorkloadProfile profile = AesWorkloadProfile::of(trace);
+    cout << "=== Sampled Workload Replay (" << path << ") ===" << endl;
+    cout << "Workload:  " << trace.records.size() << " requests x " << repeats << " passes = " << estimate.requests
+         << " requests, " << estimate.blocks << " blocks, into " << lanes << " lanes at " << fixed << setprecision(2)
+         << rate << "x (" << profile.offered_gbps() * rate << " Gbps offered)" << endl;
+    cout << "Sampling:  units of " << config.unit_requests << " requests, one in " << config.period
+         << " measured after " << config.warmup_requests << " warm-up requests, " << setprecision(1)
+         << 100.0 * erf(config.z / sqrt(2.0)) << "% intervals" << endl;
+    cout << endl;
+    print_header();
+
+    bool all_passed = sampled.passed() && estimate.units >= 2;
+    double full_wall = 0.0;
+    if (reference) {
+        AesSamplingEstimate exact = reference->estimate();
+        full_wall = exact.wall_seconds;
+        all_passed = all_passed && reference->passed();
+        print_row("full", exact, 0.0);
+        print_row("sampled", estimate, full_wall);
+        double error = (estimate.total_ns - exact.total_ns) / exact.total_ns;
+        cout << endl << "Sampled time is " << showpos << setprecision(2) << 100.0 * error << noshowpos
+             << "% off the full replay, "
+             << (fabs(estimate.total_ns - exact.total_ns) <= estimate.total_ci_ns ? "inside" : "outside")
+             << " its interval" << endl;
+    } else {
+        print_row("sampled", estimate, 0.0);
+    }
+
+    if (estimate.few_units()) {
+        cout << endl << "Only " << estimate.units << " units measured: with skewed request sizes the interval"
+             << endl << "needs at least " << AES_SAMPLING_MIN_UNITS << ". Lower --period or replay more passes." << endl;
+    }
+    if (estimate.overloaded()) {
+        cout << endl << "Offered load exceeds the engine: its queue grows over the whole run, which warm-up"
+             << endl << "cannot rebuild, so latencies are far too low. Time follows the saturated rate." << endl;
+    }
+
+    // What the next run needs, as SMARTS sizes it
+    cout << endl << "Unit time CV " << setprecision(2) << estimate.unit_cv << ": +-1% needs "
+         << estimate.units_for(0.01) << " units, +-3% needs " << estimate.units_for(0.03) << " units" << endl;
+    if (sampled.mismatches() > 0 || sampled.errors() > 0) {
+        cout << "Detailed results differing from the fast path: " << sampled.mismatches() << ", errors "
+             << sampled.errors() << endl;
+    }
+    cout << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
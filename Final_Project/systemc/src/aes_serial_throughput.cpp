@@ -0,0 +1,209 @@
+#include "../include/aes_types.h"
+#include "../include/aes_key_expansion.h"
+#include "../include/aes_round.h"
+#include "../include/aes_top.h"
+#include "../include/aes_serial_interface.h"
+#include <systemc>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
+using namespace sc_core;
+using namespace std;
+
+// Host that drives the serial interface the way the board-level logic does:
+// write the key and data beats, pulse start, poll status, read the result
+// and release start.
+class SerialHost : public sc_module {
+public:
+    // TLM initiator socket for the register bus
+    tlm_utils::simple_initiator_socket<SerialHost> bus_socket;
+
+    SC_HAS_PROCESS(SerialHost);
+    SerialHost(sc_module_name name, unsigned bus_width_bits, int num_blocks, bool reload_key) :
+        sc_module(name),
+        bus_socket("bus_socket"),
+        m_bus_bytes(bus_width_bits / 8),
+        m_num_blocks(num_blocks),
+        m_reload_key(reload_key),
+        m_passed(true) {
+        SC_THREAD(run);
+    }
+
+    // Simulated time taken by the whole workload
+    const sc_time& elapsed() const { return m_elapsed; }
+    bool passed() const { return m_passed; }
+
+    void run() {
+        // FIPS 197 Appendix C.1 vector
+        const uint8_t key[AES_KEY_SIZE] = {
+            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+            0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+        };
+        const uint8_t plaintext[AES_BLOCK_SIZE] = {
+            0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+            0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+        };
+        const AesBlock expected(reinterpret_cast<const uint8_t*>(
+            "\x69\xc4\xe0\xd8\x6a\x7b\x04\x30\xd8\xcd\xb7\x80\x70\xb4\xc5\x5a"));
+
+        sc_time start_time = sc_time_stamp();
+        sc_time delay = SC_ZERO_TIME;
+
+        for (int i = 0; i < m_num_blocks; i++) {
+            // Load the key on the first block, or on every block for key-agile traffic
+            if (i == 0 || m_reload_key) {
+                write_bytes(AES_SERIAL_KEY_BASE, key, AES_KEY_SIZE, delay);
+            }
+            write_bytes(AES_SERIAL_DATA_BASE, plaintext, AES_BLOCK_SIZE, delay);
+
+            // Pulse start and poll until the result is valid
+            uint8_t ctrl = AES_SERIAL_CTRL_START;
+            access(tlm::TLM_WRITE_COMMAND, AES_SERIAL_CTRL_ADDR, &ctrl, 1, delay);
+
+            uint8_t status = 0;
+            do {
+                access(tlm::TLM_READ_COMMAND, AES_SERIAL_STATUS_ADDR, &status, 1, delay);
+            } while (!(status & AES_SERIAL_STATUS_VALID));
+
+            // Read the result back and release start
+            AesBlock result;
+            read_bytes(AES_SERIAL_DATA_BASE, result.data.data(), AES_BLOCK_SIZE, delay);
+
+            ctrl = 0;
+            access(tlm::TLM_WRITE_COMMAND, AES_SERIAL_CTRL_ADDR, &ctrl, 1, delay);
+
+            if (!(result == expected)) {
+                m_passed = false;
+            }
+
+            // Synchronize with the kernel once per block (loosely timed)
+            wait(delay);
+            delay = SC_ZERO_TIME;
+        }
+
+        m_elapsed = sc_time_stamp() - start_time;
+    }
+
+private:
+    unsigned m_bus_bytes;
+    int m_num_blocks;
+    bool m_reload_key;
+    bool m_passed;
+    sc_time m_elapsed;
+
+    void write_bytes(uint64_t base, const uint8_t* src, unsigned len, sc_time& delay) {
+        for (unsigned offset = 0; offset < len; offset += m_bus_bytes) {
+            access(tlm::TLM_WRITE_COMMAND, base + offset, const_cast<uint8_t*>(src + offset),
+                   m_bus_bytes, delay);
+        }
+    }
+
+    void read_bytes(uint64_t base, uint8_t* dest, unsigned len, sc_time& delay) {
+        for (unsigned offset = 0; offset < len; offset += m_bus_bytes) {
+            access(tlm::TLM_READ_COMMAND, base + offset, dest + offset, m_bus_bytes, delay);
+        }
+    }
+
+    // Issue a single bus beat
+    void access(tlm::tlm_command cmd, uint64_t addr, uint8_t* data, unsigned len, sc_time& delay) {
+        tlm::tlm_generic_payload trans;
+        trans.set_command(cmd);
+        trans.set_address(addr);
+        trans.set_data_ptr(reinterpret_cast<unsigned char*>(data));
+        trans.set_data_length(len);
+        trans.set_streaming_width(len);
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+        bus_socket->b_transport(trans, delay);
+
+        if (trans.is_response_error()) {
+            SC_REPORT_ERROR("SerialHost", "Serial interface transaction failed");
+        }
+    }
+};
+
+// One serial interface in front of its own AES core
+struct SerialChannel {
+    unique_ptr<SerialHost> host;
+    unique_ptr<AesSerialInterface> serial;
+    unique_ptr<AesTop> top;
+    unique_ptr<AesKeyExpansion> key_expansion;
+    unique_ptr<AesRound> round;
+    bool reload_key;
+};
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    const int num_blocks = (argc > 1) ? atoi(argv[1]) : 1000;
+    const sc_time clock_period(8, SC_NS); // 125 MHz board clock
+    const unsigned bus_widths[] = {8, 32, 128};
+
+    // Create one channel per bus width, with and without per-block key loads
+    vector<SerialChannel> channels;
+    for (unsigned width : bus_widths) {
+        for (bool reload_key : {false, true}) {
+            string suffix = to_string(width) + (reload_key ? "_rekey" : "_fixed_key");
+            SerialChannel ch;
+            ch.reload_key = reload_key;
+            ch.host.reset(new SerialHost(("host_" + suffix).c_str(), width, num_blocks, reload_key));
+            ch.serial.reset(new AesSerialInterface(("serial_" + suffix).c_str(), width, clock_period));
+            ch.top.reset(new AesTop(("aes_top_" + suffix).c_str()));
+            ch.key_expansion.reset(new AesKeyExpansion(("key_expansion_" + suffix).c_str()));
+            ch.round.reset(new AesRound(("aes_round_" + suffix).c_str()));
+
+            // Connect modules
+            ch.host->bus_socket.bind(ch.serial->bus_socket);
+            ch.serial->core_socket.bind(ch.top->top_socket);
+            ch.top->key_expansion_socket.bind(ch.key_expansion->key_socket);
+            ch.top->round_socket.bind(ch.round->round_socket);
+
+            channels.push_back(std::move(ch));
+        }
+    }
+
+    // Start simulation
+    sc_start();
+
+    // The pipelined core accepts one block per clock once it is full
+    double core_blocks_per_sec = 1.0 / clock_period.to_seconds();
+
+    cout << "=== AES Serial Interface Throughput (" << num_blocks << " blocks @ "
+         << 1.0 / clock_period.to_seconds() / 1e6 << " MHz) ===" << endl;
+    cout << left << setw(8) << "Width" << setw(12) << "Key"
+         << right << setw(12) << "Cycles/blk" << setw(10) << "Load" << setw(10) << "Control"
+         << setw(10) << "Process" << setw(10) << "Read" << setw(10) << "Stall"
+         << setw(16) << "Blocks/sec" << setw(12) << "Core use" << endl;
+
+    bool all_passed = true;
+    for (const SerialChannel& ch : channels) {
+        const AesSerialStats& stats = ch.serial->stats();
+        double blocks = static_cast<double>(stats.blocks);
+        double blocks_per_sec = num_blocks / ch.host->elapsed().to_seconds();
+
+        cout << left << setw(8) << (to_string(ch.serial->bus_width_bits()) + "b")
+             << setw(12) << (ch.reload_key ? "per-block" : "fixed")
+             << right << fixed << setprecision(1)
+             << setw(12) << stats.total_cycles() / blocks
+             << setw(10) << stats.load_cycles / blocks
+             << setw(10) << stats.control_cycles / blocks
+             << setw(10) << stats.process_cycles / blocks
+             << setw(10) << stats.read_cycles / blocks
+             << setw(10) << stats.stall_cycles / blocks
+             << setw(16) << setprecision(0) << blocks_per_sec
+             << setw(11) << setprecision(2) << 100.0 * blocks_per_sec / core_blocks_per_sec << "%" << endl;
+
+        all_passed = all_passed && ch.host->passed();
+    }
+
+    cout << endl;
+    cout << "Pipelined core peak: " << fixed << setprecision(0) << core_blocks_per_sec << " blocks/sec" << endl;
+    cout << "Functional check:    " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+
+    return all_passed ? 0 : 1;
+}
@@ -1,10 +1,13 @@
 #include "../include/aes_types.h"
+#include "../include/aes_hex.h"
 #include "../include/aes_sbox.h"
 #include "../include/aes_shift_rows.h"
 #include "../include/aes_mix_columns.h"
 #include "../include/aes_key_expansion.h"
 #include "../include/aes_round.h"
 #include "../include/aes_top.h"
+#include "../include/aes_perf.h"
+#include "../include/timeline_trace.h"
 #include <systemc>
 #include <iostream>
 #include <iomanip>
@@ -16,25 +19,20 @@
 using namespace sc_core;
 using namespace std;
 
-// Utility function to convert hex string to bytes
+// Utility function to convert hex string to bytes (empty if it is not hex)
 vector<uint8_t> hex_to_bytes(const string& hex) {
-    vector<uint8_t> bytes;
-    for (size_t i = 0; i < hex.length(); i += 2) {
-        string byteString = hex.substr(i, 2);
-        uint8_t byte = static_cast<uint8_t>(strtol(byteString.c_str(), nullptr, 16));
-        bytes.push_back(byte);
+    vector<uint8_t> bytes(hex.length() / 2);
+    if (!aes_hex_decode(hex.data(), hex.length(), bytes.data())) {
+        bytes.clear();
     }
     return bytes;
 }
 
 // Utility function to convert bytes to hex string
 string bytes_to_hex(const vector<uint8_t>& bytes) {
-    stringstream ss;
-    ss << hex << setfill('0');
-    for (uint8_t byte : bytes) {
-        ss << setw(2) << static_cast<int>(byte);
-    }
-    return ss.str();
+    string hex(2 * bytes.size(), '0');
+    aes_hex_encode(bytes.data(), bytes.size(), &hex[0]);
+    return hex;
 }
 
 // AES Simulation module
@@ -43,8 +41,11 @@ public:
     // TLM initiator socket for connecting to the AES top module
     tlm_utils::simple_initiator_socket<AesSimulation> init_socket;
     
+    // Hardware counters around the timed loops (--perf or AES_PERF=1)
+    AesPerf& perf;
+    
     SC_HAS_PROCESS(AesSimulation);
-    AesSimulation(sc_module_name name) : sc_module(name), init_socket("init_socket") {
+    AesSimulation(sc_module_name name, AesPerf& perf) : sc_module(name), init_socket("init_socket"), perf(perf) {
         SC_THREAD(run_simulation);
     }
     
@@ -86,16 +87,22 @@ public:
         
         // Measure time for non-pipelined mode
         auto start_time = chrono::high_resolution_clock::now();
-        for (int i = 0; i < num_blocks; i++) {
-            encrypt(plaintexts[i], key_hex, AesMode::NON_PIPELINED);
+        {
+            AesPerf::Scope scope(perf, "TLM non-pipelined", num_blocks, num_blocks * AES_BLOCK_SIZE);
+            for (int i = 0; i < num_blocks; i++) {
+                encrypt(plaintexts[i], key_hex, AesMode::NON_PIPELINED);
+            }
         }
         auto end_time = chrono::high_resolution_clock::now();
         auto non_pipelined_duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time);
         
         // Measure time for pipelined mode
         start_time = chrono::high_resolution_clock::now();
-        for (int i = 0; i < num_blocks; i++) {
-            encrypt(plaintexts[i], key_hex, AesMode::PIPELINED);
+        {
+            AesPerf::Scope scope(perf, "TLM pipelined", num_blocks, num_blocks * AES_BLOCK_SIZE);
+            for (int i = 0; i < num_blocks; i++) {
+                encrypt(plaintexts[i], key_hex, AesMode::PIPELINED);
+            }
         }
         end_time = chrono::high_resolution_clock::now();
         auto pipelined_duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time);
@@ -106,12 +113,22 @@ public:
         cout << "Speedup Factor:     " << static_cast<double>(non_pipelined_duration.count()) / pipelined_duration.count() << "x" << endl;
         cout << endl;
         
-        // Demonstrate the effect of the AES transformations
-        cout << "=== AES Transformation Steps Demonstration ===" << endl;
-        
         // Convert hex strings to AES blocks
         vector<uint8_t> pt_bytes = hex_to_bytes(plaintext_hex);
         vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
+        if (pt_bytes.size() != AES_BLOCK_SIZE || key_bytes.size() != AES_KEY_SIZE) {
+            SC_REPORT_ERROR("AesSimulation", "Sample plaintext or key is not a 16-byte hex string");
+            return;
+        }
+        
+        if (perf.enabled()) {
+            measure_hot_paths(num_blocks, pt_bytes, key_bytes);
+            perf.print_report(cout);
+            cout << endl;
+        }
+        
+        // Demonstrate the effect of the AES transformations
+        cout << "=== AES Transformation Steps Demonstration ===" << endl;
         
         AesBlock block;
         AesKey aes_key;
@@ -151,10 +168,44 @@ public:
         cout << "Simulation completed successfully!" << endl;
     }
     
+    // The stages of the TLM round trip on their own: key expansion, and the
+    // block cipher with the key already expanded
+    void measure_hot_paths(int num_blocks, const vector<uint8_t>& pt_bytes, const vector<uint8_t>& key_bytes) {
+        AesKey key(key_bytes.data());
+        AesBlock block(pt_bytes.data());
+        AesRoundKeys round_keys;
+        {
+            AesPerf::Scope scope(perf, "key expansion", num_blocks, num_blocks * AES_BLOCK_SIZE);
+            for (int i = 0; i < num_blocks; i++) {
+                AesKeyExpansion::expand_key(key, round_keys);
+                key.key[0] ^= round_keys.round_keys[AES_NUM_ROUNDS].data[0];  // Keep every call live
+            }
+        }
+        {
+            AesPerf::Scope scope(perf, "block encrypt", num_blocks, num_blocks * AES_BLOCK_SIZE);
+            for (int i = 0; i < num_blocks; i++) {
+                block = AesCipher::encrypt_block(block, round_keys);
+            }
+        }
+        {
+            AesPerf::Scope scope(perf, "block decrypt", num_blocks, num_blocks * AES_BLOCK_SIZE);
+            for (int i = 0; i < num_blocks; i++) {
+                block = AesCipher::decrypt_block(block, round_keys);
+            }
+        }
+        if (!(block == AesBlock(pt_bytes.data()))) {
+            SC_REPORT_ERROR("AesSimulation", "Encrypt/decrypt chain did not round-trip");
+        }
+    }
+    
     string encrypt(const string& plaintext_hex, const string& key_hex, AesMode mode) {
         // Convert hex strings to bytes
         vector<uint8_t> plaintext_bytes = hex_to_bytes(plaintext_hex);
         vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
+        if (plaintext_bytes.size() != AES_BLOCK_SIZE || key_bytes.size() != AES_KEY_SIZE) {
+            SC_REPORT_ERROR("AesSimulation", "Encryption input is not a 16-byte hex string");
+            return string();
+        }
         
         // Create AES block and key
         AesBlock plaintext;
@@ -210,6 +261,10 @@ public:
         // Convert hex strings to bytes
         vector<uint8_t> ciphertext_bytes = hex_to_bytes(ciphertext_hex);
         vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
+        if (ciphertext_bytes.size() != AES_BLOCK_SIZE || key_bytes.size() != AES_KEY_SIZE) {
+            SC_REPORT_ERROR("AesSimulation", "Decryption input is not a 16-byte hex string");
+            return string();
+        }
         
         // Create AES block and key
         AesBlock ciphertext;
@@ -264,8 +319,14 @@ public:
 
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // --perf adds hardware counter readings next to the wall times
+    AesPerf perf(argc, argv);
+    
+    // --trace <file> writes a Chrome/Perfetto timeline of the modules
+    TimelineTrace::configure(argc, argv);
+    
     // Create modules
-    AesSimulation simulation("simulation");
+    AesSimulation simulation("simulation", perf);
     AesTop aes_top("aes_top");
     AesKeyExpansion key_expansion("key_expansion");
     AesRound aes_round("aes_round");
@@ -0,0 +1,294 @@
+#include "../include/aes_cipher.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_hex.h"
+#include "../include/aes_vector_corpus.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Standalone like the cipher library: no SystemC, links libaes_cipher
+
+template <typename Fn>
+static double time_seconds(Fn fn) {
+    auto start_time = chrono::high_resolution_clock::now();
+    fn();
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+static bool parse_mode(const string& name, AesCipherMode& mode) {
+    if (name == "ecb") {
+        mode = AesCipherMode::ECB;
+    } else if (name == "cbc") {
+        mode = AesCipherMode::CBC;
+    } else if (name == "ctr") {
+        mode = AesCipherMode::CTR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Run every vector in a corpus. The schedule is only re-expanded when the
+// key changes, though in most published files it changes every vector.
+static bool check_corpus(const AesVectorCorpus& corpus, size_t& failed) {
+    failed = 0;
+    AesKeySchedule schedule;
+    uint8_t current_key[AES_KEY_SIZE] = {0};
+    AesTestVector vector;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (!corpus.get(i, vector)) {
+            failed++;
+            continue;
+        }
+        if (memcmp(current_key, vector.key, AES_KEY_SIZE) != 0) {
+            memcpy(current_key, vector.key, AES_KEY_SIZE);
+            schedule = AesKeySchedule(current_key);
+        }
+        failed += !aes_vector_check(vector, schedule);
+    }
+    return failed == 0;
+}
+
+// The parsing the SystemC programs used to do: substr and strtol per byte
+static vector<uint8_t> legacy_hex_to_bytes(const string& hex) {
+    vector<uint8_t> bytes;
+    for (size_t i = 0; i < hex.length(); i += 2) {
+        string byte_string = hex.substr(i, 2);
+        bytes.push_back(static_cast<uint8_t>(strtol(byte_string.c_str(), nullptr, 16)));
+    }
+    return bytes;
+}
+
+static size_t legacy_load(const string& path) {
+    ifstream in(path);
+    string line;
+    size_t fields = 0;
+    while (getline(in, line)) {
+        size_t eq = line.find(" = ");
+        if (eq == string::npos || line.compare(0, 5, "COUNT") == 0 || line.compare(0, 4, "MODE") == 0) {
+            continue;
+        }
+        fields += !legacy_hex_to_bytes(line.substr(eq + 3)).empty();
+    }
+    return fields;
+}
+
+// Random vectors in all three modes, 16-64 bytes each, written as text and
+// loaded back three ways
+static int run_bench(size_t num_vectors, const string& dir) {
+    string corpus_path = dir + "/aes_vector_bench.bin";
+    string text_path = dir + "/aes_vector_bench.rsp";
+    string import_path = dir + "/aes_vector_bench_import.bin";
+
+    mt19937 rng(460);
+    AesVectorCorpusWriter writer;
+    if (writer.open(corpus_path) != AES_CIPHER_OK) {
+        cout << "Cannot write " << corpus_path << endl;
+        return 1;
+    }
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t iv[AES_BLOCK_SIZE];
+    uint8_t plaintext[64];
+    uint8_t ciphertext[64];
+    size_t expected_fields = 0;   // Hex lines in the text: KEY, texts, and IV outside ECB
+    for (size_t i = 0; i < num_vectors; i++) {
+        for (uint8_t& b : key) {
+            b = static_cast<uint8_t>(rng());
+        }
+        for (uint8_t& b : iv) {
+            b = static_cast<uint8_t>(rng());
+        }
+        size_t length = AES_BLOCK_SIZE * (1 + rng() % 4);
+        for (size_t j = 0; j < length; j++) {
+            plaintext[j] = static_cast<uint8_t>(rng());
+        }
+        AesTestVector vector;
+        vector.mode = static_cast<AesCipherMode>(i * 3 / num_vectors);   // ECB, CBC, CTR in thirds
+        vector.id = i;
+        vector.key = key;
+        vector.iv = iv;
+        vector.plaintext = plaintext;
+        vector.ciphertext = ciphertext;
+        vector.length = length;
+
+        AesKeySchedule schedule(key);
+        AesJob job;
+        job.mode = vector.mode;
+        job.key = &schedule;
+        job.in = plaintext;
+        job.out = ciphertext;
+        job.length = length;
+        memcpy(job.iv.data(), iv, AES_BLOCK_SIZE);
+        aes_run_job(job);
+        writer.add(vector);
+        expected_fields += (vector.mode == AesCipherMode::ECB) ? 3 : 4;
+    }
+    AesVectorCorpus corpus;
+    if (writer.finish() != AES_CIPHER_OK || corpus.open(corpus_path) != AES_CIPHER_OK ||
+        aes_vector_export(corpus, text_path) != AES_CIPHER_OK) {
+        cout << "Cannot build the benchmark files" << endl;
+        return 1;
+    }
+    corpus.close();
+
+    cout << "=== Test Vector Corpus Load Time ===" << endl;
+    cout << num_vectors << " vectors (ECB, CBC, CTR; 16-64 bytes), hex kernel "
+         << aes_hex_kernel_name(aes_hex_kernel_resolve(AesHexKernel::AUTO)) << endl << endl;
+    cout << left << setw(28) << "Load path" << right << setw(11) << "ms" << setw(14) << "Mvectors/s" << endl;
+    auto row = [num_vectors](const string& name, double seconds) {
+        cout << left << setw(28) << name << right << fixed << setprecision(1) << setw(11) << seconds * 1e3
+             << setprecision(2) << setw(14) << num_vectors / seconds / 1e6 << endl;
+    };
+
+    size_t fields = 0;
+    row("text, substr + strtol", time_seconds([&]() { fields = legacy_load(text_path); }));
+
+    AesVectorCorpusWriter import_writer;
+    int status = AES_CIPHER_EIO;
+    row("text, SIMD hex import", time_seconds([&]() {
+        if (import_writer.open(import_path) == AES_CIPHER_OK &&
+            aes_vector_import(text_path, import_writer, AesCipherMode::ECB) == AES_CIPHER_OK) {
+            status = import_writer.finish();
+        }
+    }));
+
+    // Open and touch every byte of every vector
+    uint64_t sum = 0;
+    row("corpus, mmap + walk", time_seconds([&]() {
+        AesVectorCorpus mapped;
+        mapped.open(import_path);
+        AesTestVector vector;
+        for (size_t i = 0; i < mapped.size(); i++) {
+            if (mapped.get(i, vector)) {
+                for (size_t j = 0; j < vector.length; j++) {
+                    sum += vector.plaintext[j] ^ vector.ciphertext[j];
+                }
+                sum += vector.key[0] + vector.iv[0];
+            }
+        }
+    }));
+
+    size_t failed = 0;
+    bool passed = false;
+    row("corpus, mmap + check", time_seconds([&]() {
+        AesVectorCorpus mapped;
+        passed = mapped.open(import_path) == AES_CIPHER_OK && mapped.size() == num_vectors &&
+                 check_corpus(mapped, failed);
+    }));
+
+    // Hex codec on its own: 32 MB of bytes, 64 MB of digits
+    vector<uint8_t> bytes(32 << 20);
+    for (uint8_t& b : bytes) {
+        b = static_cast<uint8_t>(rng());
+    }
+    vector<char> hex(2 * bytes.size());
+    vector<uint8_t> decoded(bytes.size());
+    cout << endl << left << setw(10) << "Hex" << right << setw(14) << "Encode MB/s" << setw(14) << "Decode MB/s"
+         << endl;
+    bool hex_ok = true;
+    for (AesHexKernel kernel : {AesHexKernel::SCALAR, AesHexKernel::SSSE3, AesHexKernel::AVX2}) {
+        if (!aes_hex_kernel_supported(kernel)) {
+            continue;
+        }
+        double enc = time_seconds([&]() { aes_hex_encode(bytes.data(), bytes.size(), hex.data(), kernel); });
+        double dec = time_seconds([&]() {
+            hex_ok = aes_hex_decode(hex.data(), hex.size(), decoded.data(), kernel) && hex_ok;
+        });
+        hex_ok = hex_ok && decoded == bytes;
+        cout << left << setw(10) << aes_hex_kernel_name(kernel) << right << fixed << setprecision(0)
+             << setw(14) << hex.size() / enc / 1e6 << setw(14) << hex.size() / dec / 1e6 << endl;
+    }
+
+    bool all_passed = passed && status == AES_CIPHER_OK && hex_ok && fields == expected_fields && sum != 0;
+    remove(corpus_path.c_str());
+    remove(text_path.c_str());
+    remove(import_path.c_str());
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
+
+static void usage(const char* prog) {
+    cout << "Usage:" << endl;
+    cout << "  " << prog << " import <text.rsp> <corpus.bin> [ecb|cbc|ctr]" << endl;
+    cout << "  " << prog << " export <corpus.bin> <text.rsp>" << endl;
+    cout << "  " << prog << " check <corpus.bin>" << endl;
+    cout << "  " << prog << " bench [vectors] [directory]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string command = argc > 1 ? argv[1] : "";
+
+    if (command == "import" && (argc == 4 || argc == 5)) {
+        AesCipherMode mode = AesCipherMode::ECB;
+        if (argc == 5 && !parse_mode(argv[4], mode)) {
+            usage(argv[0]);
+            return 1;
+        }
+        AesVectorCorpusWriter writer;
+        size_t line = 0;
+        int status = writer.open(argv[3]);
+        if (status == AES_CIPHER_OK) {
+            status = aes_vector_import(argv[2], writer, mode, &line);
+        }
+        size_t count = writer.size();
+        if (status == AES_CIPHER_OK) {
+            status = writer.finish();
+        }
+        if (status != AES_CIPHER_OK) {
+            cout << "Import failed (" << status << ")";
+            if (line > 0) {
+                cout << " at line " << line;
+            }
+            cout << endl;
+            return 1;
+        }
+        cout << "Imported " << count << " vectors" << endl;
+        return 0;
+    }
+
+    if (command == "export" && argc == 4) {
+        AesVectorCorpus corpus;
+        int status = corpus.open(argv[2]);
+        if (status == AES_CIPHER_OK) {
+            status = aes_vector_export(corpus, argv[3]);
+        }
+        if (status != AES_CIPHER_OK) {
+            cout << "Export failed (" << status << ")" << endl;
+            return 1;
+        }
+        cout << "Exported " << corpus.size() << " vectors" << endl;
+        return 0;
+    }
+
+    if (command == "check" && argc == 3) {
+        AesVectorCorpus corpus;
+        int status = corpus.open(argv[2]);
+        if (status != AES_CIPHER_OK) {
+            cout << "Cannot open corpus (" << status << ")" << endl;
+            return 1;
+        }
+        size_t failed = 0;
+        bool passed = corpus.verify() && check_corpus(corpus, failed);
+        cout << corpus.size() << " vectors, " << failed << " failed" << endl;
+        cout << "Functional check: " << (passed ? "SUCCESS" : "FAILED") << endl;
+        return passed ? 0 : 1;
+    }
+
+    if (command == "bench" && argc <= 4) {
+        size_t num_vectors = argc > 2 ? max<size_t>(3, strtoul(argv[2], nullptr, 10)) : 1000000;
+        return run_bench(num_vectors, argc > 3 ? argv[3] : ".");
+    }
+
+    usage(argv[0]);
+    return 1;
+}
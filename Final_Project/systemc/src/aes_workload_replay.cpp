@@ -0,0 +1,274 @@
+#include "../include/aes_types.h"
+#include "../include/aes_lane_system.h"
+#include "../include/aes_workload.h"
+#include <systemc>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Traffic one kind of client generates
+struct HostProfile {
+    const char* name;
+    vector<uint32_t> sizes;         // Blocks per request
+    vector<double> size_weights;
+    uint32_t first_key;
+    uint32_t num_keys;
+    double mean_flow;               // Requests under one key before moving on
+    double decrypt_share;
+    double mean_think_ns;           // Between a result and the next request
+    AesMode mode;
+};
+
+// Packet traffic: small requests, a key per flow, short flows. Storage
+// traffic: sector and page sized requests, few keys, mostly reads.
+static const HostProfile PACKET_PROFILE = {
+    "packet", {1, 2, 4, 6, 12}, {0.3, 0.25, 0.2, 0.15, 0.1}, 0, 64, 6.0, 0.5, 150.0, AesMode::NON_PIPELINED};
+static const HostProfile STORAGE_PROFILE = {
+    "storage", {32, 256}, {0.8, 0.2}, 1000, 2, 200.0, 0.7, 2000.0, AesMode::PIPELINED};
+
+// Closed-loop client: issues a request, waits for its result, thinks for
+// an exponentially distributed time and issues the next
+class WorkloadHost : public sc_module {
+public:
+    tlm_utils::simple_initiator_socket<WorkloadHost> bus_socket;
+
+    SC_HAS_PROCESS(WorkloadHost);
+    WorkloadHost(sc_module_name name, const HostProfile& profile, int num_requests, unsigned seed) :
+        sc_module(name),
+        bus_socket("bus_socket"),
+        m_profile(profile),
+        m_num_requests(num_requests),
+        m_rng(seed) {
+        SC_THREAD(run);
+    }
+
+    void run() {
+        discrete_distribution<size_t> size(m_profile.size_weights.begin(), m_profile.size_weights.end());
+        exponential_distribution<double> think(1.0 / m_profile.mean_think_ns);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        uint32_t key_id = m_profile.first_key + m_rng() % m_profile.num_keys;
+        vector<uint8_t> buffer;
+        for (int i = 0; i < m_num_requests; i++) {
+            if (unit(m_rng) < 1.0 / m_profile.mean_flow) {
+                key_id = m_profile.first_key + m_rng() % m_profile.num_keys;
+            }
+            buffer.assign(m_profile.sizes[size(m_rng)] * AES_BLOCK_SIZE, static_cast<uint8_t>(i));
+
+            struct iovec segment = {buffer.data(), buffer.size()};
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_data_ptr(buffer.data());
+            trans.set_data_length(buffer.size());
+            trans.set_streaming_width(buffer.size());
+            trans.set_byte_enable_ptr(nullptr);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            AesExtension* ext = new AesExtension();
+            ext->operation = unit(m_rng) < m_profile.decrypt_share ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+            ext->mode = m_profile.mode;
+            ext->key = aes_workload_key(key_id);
+            trans.set_extension(ext);
+            AesScatterGatherExtension* sg = new AesScatterGatherExtension(&segment, 1);
+            trans.set_extension(sg);
+
+            sc_time delay = SC_ZERO_TIME;
+            bus_socket->b_transport(trans, delay);
+            trans.release_extension(ext);
+            trans.release_extension(sg);
+            wait(delay + sc_time(think(m_rng), SC_NS));
+        }
+    }
+
+private:
+    const HostProfile& m_profile;
+    int m_num_requests;
+    mt19937 m_rng;
+};
+
+static string engine_name(unsigned lanes) {
+    return to_string(lanes) + (lanes == 1 ? " lane" : " lanes");
+}
+
+static void print_profile(const AesWorkloadProfile& p) {
+    cout << "Requests:        " << p.requests << ", " << p.blocks << " blocks (" << fixed << setprecision(1)
+         << static_cast<double>(p.blocks) / max<size_t>(1, p.requests) << " per request)" << endl;
+    cout << "Blocks/request: ";
+    for (int b = 0; b < AesWorkloadProfile::SIZE_BUCKETS; b++) {
+        cout << " " << AesWorkloadProfile::size_bucket_name(b) << ": " << setprecision(1)
+             << 100.0 * p.size_histogram[b] / max<size_t>(1, p.requests) << "%";
+    }
+    cout << endl;
+    cout << "Encrypt/decrypt: " << setprecision(1) << 100.0 * p.encrypts / max<size_t>(1, p.requests) << "% / "
+         << 100.0 * (p.requests - p.encrypts) / max<size_t>(1, p.requests) << "%" << endl;
+    cout << "Keys:            " << p.distinct_keys << " distinct, key change on "
+         << 100.0 * p.key_changes / max<size_t>(1, p.requests) << "% of requests" << endl;
+    cout << "Inter-arrival:   mean " << setprecision(1) << p.mean_gap_ns << " ns, CV " << setprecision(2) << p.gap_cv
+         << endl;
+    cout << "Offered rate:    " << setprecision(2) << p.offered_gbps() << " Gbps" << endl;
+    cout << "Latency (ns):    mean " << setprecision(1) << p.mean_latency_ns << ", p50 " << p.p50_latency_ns
+         << ", p99 " << p.p99_latency_ns << ", max " << p.max_latency_ns << endl;
+}
+
+static void print_header() {
+    cout << left << setw(10) << "Target" << right << setw(7) << "Rate" << setw(10) << "Offered" << setw(10)
+         << "Achieved" << setw(11) << "Lat mean" << setw(10) << "p50" << setw(10) << "p99" << setw(11) << "max"
+         << setw(11) << "p99/rec" << endl;
+    cout << left << setw(10) << "" << right << setw(7) << "" << setw(10) << "Gbps" << setw(10) << "Gbps"
+         << setw(11) << "ns" << setw(10) << "ns" << setw(10) << "ns" << setw(11) << "ns" << setw(11) << "" << endl;
+}
+
+static void print_row(const string& target, double rate, const AesWorkloadProfile& p, double recorded_p99) {
+    cout << left << setw(10) << target << right << fixed << setprecision(2) << setw(6) << rate << "x"
+         << setw(10) << p.offered_gbps() << setw(10) << p.achieved_gbps() << setprecision(1) << setw(11)
+         << p.mean_latency_ns << setw(10) << p.p50_latency_ns << setw(10) << p.p99_latency_ns << setw(11)
+         << p.max_latency_ns << setprecision(2) << setw(10) << p.p99_latency_ns / max(recorded_p99, 1e-9) << "x"
+         << endl;
+}
+
+// Capture: packet and storage hosts through a recorder into a router
+static int record(const string& path, int num_requests, unsigned lanes) {
+    const int packet_hosts = 6;
+    const int storage_hosts = 2;
+    AesLaneSystem engine("record", lanes);
+    AesWorkloadRecorder recorder("recorder");
+    recorder.out_socket.bind(engine.router->bus_socket);
+    vector<unique_ptr<WorkloadHost>> hosts;
+    for (int h = 0; h < packet_hosts + storage_hosts; h++) {
+        // Storage requests are about 20x larger; give those hosts fewer
+        bool storage = h >= packet_hosts;
+        int share = storage ? num_requests / 16 : (num_requests - storage_hosts * (num_requests / 16)) / packet_hosts;
+        hosts.emplace_back(new WorkloadHost(("host_" + to_string(h)).c_str(),
+                                            storage ? STORAGE_PROFILE : PACKET_PROFILE, share, 460 + h));
+        hosts.back()->bus_socket.bind(recorder.in_socket);
+    }
+
+    sc_start();
+
+    AesWorkloadTrace trace = recorder.trace();
+    string source = to_string(packet_hosts) + " packet + " + to_string(storage_hosts) + " storage hosts into " +
+                    engine_name(lanes) + ", least-loaded";
+    cout << "=== Workload Capture (" << source << ") ===" << endl;
+    print_profile(AesWorkloadProfile::of(trace));
+    if (!trace.save(path, "recorded: " + source)) {
+        cout << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << "Wrote " << trace.records.size() << " requests to " << path << endl;
+    return 0;
+}
+
+// Replay into routers over several lane counts, at each rate, all side by
+// side in one simulation
+static int replay(const string& path, const vector<double>& rates) {
+    AesWorkloadTrace trace;
+    size_t error_line = 0;
+    if (!trace.load(path, &error_line)) {
+        cout << "Cannot read " << path;
+        if (error_line > 0) {
+            cout << " (line " << error_line << ")";
+        }
+        cout << endl;
+        return 1;
+    }
+    // A bare AesTop adds no delay and never queues, so one lane is the baseline
+    const unsigned lane_counts[] = {1, 4, 8};
+
+    struct Run {
+        unsigned lanes;
+        double rate;
+        unique_ptr<AesLaneSystem> engine;
+        unique_ptr<AesWorkloadReplayer> replayer;
+    };
+    vector<Run> runs;
+    for (unsigned lanes : lane_counts) {
+        for (double rate : rates) {
+            string suffix = to_string(lanes) + "_" + to_string(runs.size());
+            Run run;
+            run.lanes = lanes;
+            run.rate = rate;
+            run.engine.reset(new AesLaneSystem(suffix, lanes));
+            run.replayer.reset(new AesWorkloadReplayer(("replayer_" + suffix).c_str(), trace, rate));
+            run.replayer->init_socket.bind(run.engine->router->bus_socket);
+            runs.push_back(std::move(run));
+        }
+    }
+
+    auto start_time = chrono::high_resolution_clock::now();
+    sc_start();
+    double wall = chrono::duration<double>(chrono::high_resolution_clock::now() - start_time).count();
+
+    AesWorkloadProfile recorded = AesWorkloadProfile::of(trace);
+    cout << "=== Workload Replay (" << path << ") ===" << endl;
+    print_profile(recorded);
+    cout << endl;
+    print_header();
+    print_row("recorded", 1.0, recorded, recorded.p99_latency_ns);
+    bool all_passed = !trace.records.empty();
+    size_t replayed_requests = 0;
+    for (const Run& run : runs) {
+        print_row(engine_name(run.lanes), run.rate, AesWorkloadProfile::of(run.replayer->replayed()),
+                  recorded.p99_latency_ns);
+        all_passed = all_passed && run.replayer->passed();
+        replayed_requests += run.replayer->replayed().records.size();
+    }
+    cout << endl << "Replayed " << replayed_requests << " requests in " << fixed << setprecision(2) << wall
+         << " s of host time (" << setprecision(0) << replayed_requests / wall / 1e3 << "k requests/s)" << endl;
+    cout << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
+
+static void usage(const char* prog) {
+    cout << "Usage:" << endl;
+    cout << "  " << prog << " record <trace> [requests] [lanes]" << endl;
+    cout << "  " << prog << " profile <trace>" << endl;
+    cout << "  " << prog << " replay <trace> [rate ...]" << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    string command = argc > 1 ? argv[1] : "";
+
+    if (command == "record" && argc >= 3 && argc <= 5) {
+        int num_requests = argc > 3 ? max(64, atoi(argv[3])) : 4096;
+        unsigned lanes = argc > 4 ? static_cast<unsigned>(max(1, atoi(argv[4]))) : 4;
+        return record(argv[2], num_requests, lanes);
+    }
+
+    if (command == "profile" && argc == 3) {
+        AesWorkloadTrace trace;
+        size_t error_line = 0;
+        if (!trace.load(argv[2], &error_line)) {
+            cout << "Cannot read " << argv[2] << " (line " << error_line << ")" << endl;
+            return 1;
+        }
+        print_profile(AesWorkloadProfile::of(trace));
+        return 0;
+    }
+
+    if (command == "replay" && argc >= 3) {
+        vector<double> rates;
+        for (int i = 3; i < argc; i++) {
+            double rate = atof(argv[i]);
+            if (rate > 0.0) {
+                rates.push_back(rate);
+            }
+        }
+        if (rates.empty()) {
+            rates = {1.0, 2.0, 4.0};
+        }
+        return replay(argv[2], rates);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,1880 @@
+#include "../include/aes_cipher.h"
+#include "../include/aes_cipher_c.h"
+#include "../include/aes_cross_check.h"
+#include "../include/aes_ctr_drbg.h"
+#include "../include/aes_hex.h"
+#include "../include/aes_incremental.h"
+#include "../include/aes_job_ring.h"
+#include "../include/aes_key_store.h"
+#include "../include/aes_multi_buffer.h"
+#include "../include/aes_scatter_gather.h"
+#include "../include/aes_vector_corpus.h"
+#include "../include/aes_xts.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Built without any SystemC include path: this file only sees the
+// standalone cipher headers and links libaes_cipher.
+
+static int failures = 0;
+
+static void check(bool condition, const string& message) {
+    if (!condition) {
+        cout << "FAILED: " << message << endl;
+        failures++;
+    }
+}
+
+struct TestVector {
+    const char* key;
+    const char* plaintext;
+    const char* ciphertext;
+};
+
+// FIPS 197 Appendix B and C.1
+static const TestVector VECTORS[] = {
+    {"\x2b\x7e\x15\x16\x28\xae\xd2\xa6\xab\xf7\x15\x88\x09\xcf\x4f\x3c",
+     "\x32\x43\xf6\xa8\x88\x5a\x30\x8d\x31\x31\x98\xa2\xe0\x37\x07\x34",
+     "\x39\x25\x84\x1d\x02\xdc\x09\xfb\xdc\x11\x85\x97\x19\x6a\x0b\x32"},
+    {"\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f",
+     "\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99\xaa\xbb\xcc\xdd\xee\xff",
+     "\x69\xc4\xe0\xd8\x6a\x7b\x04\x30\xd8\xcd\xb7\x80\x70\xb4\xc5\x5a"}
+};
+
+static const uint8_t* bytes(const char* s) {
+    return reinterpret_cast<const uint8_t*>(s);
+}
+
+static void test_c_api() {
+    for (const TestVector& v : VECTORS) {
+        aes_key_schedule* schedule = aes_key_schedule_create(bytes(v.key));
+        check(schedule != nullptr, "C API: schedule creation");
+        if (!schedule) {
+            continue;
+        }
+
+        uint8_t block[AES_CIPHER_BLOCK_SIZE];
+        check(aes_encrypt_blocks(schedule, bytes(v.plaintext), block, 1) == AES_CIPHER_OK, "C API: encrypt status");
+        check(memcmp(block, v.ciphertext, AES_CIPHER_BLOCK_SIZE) == 0, "C API: FIPS 197 ciphertext");
+        check(aes_decrypt_blocks(schedule, block, block, 1) == AES_CIPHER_OK, "C API: decrypt status");
+        check(memcmp(block, v.plaintext, AES_CIPHER_BLOCK_SIZE) == 0, "C API: in-place decryption");
+        aes_key_schedule_destroy(schedule);
+    }
+
+    // Argument checks
+    uint8_t block[AES_CIPHER_BLOCK_SIZE] = {0};
+    check(aes_key_schedule_create(nullptr) == nullptr, "C API: NULL key accepted");
+    check(aes_encrypt_blocks(nullptr, block, block, 1) == AES_CIPHER_EINVAL, "C API: NULL schedule accepted");
+    aes_key_schedule* schedule = aes_key_schedule_create(bytes(VECTORS[0].key));
+    check(aes_encrypt_blocks(schedule, nullptr, block, 1) == AES_CIPHER_EINVAL, "C API: NULL input accepted");
+    check(aes_decrypt_blocks(schedule, block, nullptr, 1) == AES_CIPHER_EINVAL, "C API: NULL output accepted");
+    check(aes_encrypt_blocks(schedule, nullptr, nullptr, 0) == AES_CIPHER_OK, "C API: empty batch rejected");
+    aes_key_schedule_destroy(schedule);
+    aes_key_schedule_destroy(nullptr);
+}
+
+// Every kernel against the scalar reference, for batch lengths that leave
+// partial interleave groups
+static void test_kernels() {
+    mt19937 rng(460);
+    AesKey key;
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        key.key[i] = static_cast<uint8_t>(rng());
+    }
+    AesRoundKeys round_keys;
+    AesCipher::expand_key(key, round_keys);
+
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            continue;
+        }
+        AesKeySchedule schedule(key, kernel);
+        string name = aes_key_kernel_name(kernel);
+        check(schedule.kernel() == kernel, name + ": kernel not selected");
+
+        for (size_t num_blocks : {1, 7, 8, 9, 100}) {
+            vector<uint8_t> plaintext(num_blocks * AES_BLOCK_SIZE);
+            for (uint8_t& b : plaintext) {
+                b = static_cast<uint8_t>(rng());
+            }
+            vector<uint8_t> ciphertext(plaintext.size());
+            aes_encrypt_blocks(schedule, plaintext.data(), ciphertext.data(), num_blocks);
+
+            bool match = true;
+            for (size_t i = 0; i < num_blocks; i++) {
+                AesBlock expected = AesCipher::encrypt_block(AesBlock(&plaintext[i * AES_BLOCK_SIZE]), round_keys);
+                match = match && memcmp(expected.data.data(), &ciphertext[i * AES_BLOCK_SIZE], AES_BLOCK_SIZE) == 0;
+            }
+            check(match, name + ": " + to_string(num_blocks) + " blocks differ from AesCipher");
+
+            aes_decrypt_blocks(schedule, ciphertext.data(), ciphertext.data(), num_blocks);
+            check(ciphertext == plaintext, name + ": " + to_string(num_blocks) + " blocks do not round-trip");
+        }
+    }
+}
+
+// Batch key creation gives the same schedules as one key at a time
+static void test_batch_schedules() {
+    const size_t count = 37;
+    mt19937 rng(461);
+    vector<uint8_t> keys(count * AES_CIPHER_KEY_SIZE);
+    for (uint8_t& b : keys) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    vector<aes_key_schedule*> schedules(count);
+    check(aes_key_schedule_create_batch(keys.data(), count, schedules.data()) == AES_CIPHER_OK, "batch: status");
+
+    const uint8_t* plaintext = bytes(VECTORS[0].plaintext);
+    for (size_t i = 0; i < count; i++) {
+        aes_key_schedule* single = aes_key_schedule_create(&keys[i * AES_CIPHER_KEY_SIZE]);
+        uint8_t a[AES_CIPHER_BLOCK_SIZE];
+        uint8_t b[AES_CIPHER_BLOCK_SIZE];
+        aes_encrypt_blocks(schedules[i], plaintext, a, 1);
+        aes_encrypt_blocks(single, plaintext, b, 1);
+        check(memcmp(a, b, AES_CIPHER_BLOCK_SIZE) == 0, "batch: schedule " + to_string(i) + " differs");
+        aes_key_schedule_destroy(single);
+        aes_key_schedule_destroy(schedules[i]);
+    }
+}
+
+// Batch key expansion and on-the-fly rounds against AesCipher::expand_key,
+// for every supported kernel and for counts that leave partial batches
+template <size_t N>
+static void check_key_batch(const vector<AesKey>& keys, const vector<AesRoundKeys>& expected,
+                            AesKeyKernel kernel) {
+    string name = string(aes_key_kernel_name(kernel)) + " x" + to_string(N);
+    mt19937 rng(static_cast<unsigned>(N));
+    for (size_t first = 0; first + N <= keys.size(); first += N) {
+        AesRoundKeys round_keys[N];
+        AesKeyBatch<N>::expand(&keys[first], round_keys, kernel);
+        bool match = true;
+        for (size_t i = 0; i < N; i++) {
+            match = match && round_keys[i].round_keys == expected[first + i].round_keys;
+        }
+        check(match, "key batch " + name + ": expansion differs from AesCipher");
+
+        AesBlock plain[N];
+        AesBlock blocks[N];
+        for (size_t i = 0; i < N; i++) {
+            for (uint8_t& b : plain[i].data) {
+                b = static_cast<uint8_t>(rng());
+            }
+            blocks[i] = plain[i];
+        }
+        AesKeyBatch<N>::encrypt_on_the_fly(&keys[first], blocks, kernel);
+        match = true;
+        for (size_t i = 0; i < N; i++) {
+            match = match && blocks[i] == AesCipher::encrypt_block(plain[i], expected[first + i]);
+        }
+        check(match, "key batch " + name + ": on-the-fly encryption differs");
+        AesKeyBatch<N>::decrypt_on_the_fly(&keys[first], blocks, kernel);
+        match = true;
+        for (size_t i = 0; i < N; i++) {
+            match = match && blocks[i] == plain[i];
+        }
+        check(match, "key batch " + name + ": on-the-fly decryption does not round-trip");
+    }
+}
+
+static void test_key_batch() {
+    const size_t count = 37;
+    mt19937 rng(462);
+    vector<AesKey> keys(count);
+    vector<AesRoundKeys> expected(count);
+    for (size_t i = 0; i < count; i++) {
+        for (uint8_t& b : keys[i].key) {
+            b = static_cast<uint8_t>(rng());
+        }
+        AesCipher::expand_key(keys[i], expected[i]);
+    }
+
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI, AesKeyKernel::VAES}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            continue;
+        }
+        check_key_batch<4>(keys, expected, kernel);
+        check_key_batch<8>(keys, expected, kernel);
+        check_key_batch<16>(keys, expected, kernel);
+
+        // 37 = 16 + 16 + 4 + 1 and 3 = three single keys
+        for (size_t n : {count, size_t(3)}) {
+            vector<AesRoundKeys> round_keys(n);
+            aes_expand_keys(keys.data(), round_keys.data(), n, kernel);
+            bool match = true;
+            for (size_t i = 0; i < n; i++) {
+                match = match && round_keys[i].round_keys == expected[i].round_keys;
+            }
+            check(match, string("key batch ") + aes_key_kernel_name(kernel) + ": " + to_string(n) +
+                         " keys differ from AesCipher");
+        }
+    }
+
+    // The stream walks the same schedule in both directions
+    AesKeyStream stream(keys[0]);
+    bool match = true;
+    for (int r = 1; r <= AES_NUM_ROUNDS; r++) {
+        stream.next();
+        match = match && stream.round() == r && stream.round_key() == expected[0].round_keys[r];
+    }
+    for (int r = AES_NUM_ROUNDS - 1; r >= 0; r--) {
+        stream.previous();
+        match = match && stream.round() == r && stream.round_key() == expected[0].round_keys[r];
+    }
+    check(match, "key stream: round keys differ from AesCipher");
+    stream.seek(7);
+    check(stream.round_key() == expected[0].round_keys[7], "key stream: seek forward");
+    stream.seek(2);
+    check(stream.round_key() == expected[0].round_keys[2], "key stream: seek back");
+}
+
+// One schedule shared by several threads, each on its own buffer
+static void test_threads() {
+    const size_t num_threads = 4;
+    const size_t num_blocks = 4096;
+    aes_key_schedule* schedule = aes_key_schedule_create(bytes(VECTORS[1].key));
+
+    vector<uint8_t> plaintext(num_blocks * AES_CIPHER_BLOCK_SIZE);
+    for (size_t i = 0; i < plaintext.size(); i++) {
+        plaintext[i] = static_cast<uint8_t>(i * 7);
+    }
+    vector<uint8_t> expected(plaintext.size());
+    aes_encrypt_blocks(schedule, plaintext.data(), expected.data(), num_blocks);
+
+    vector<vector<uint8_t>> results(num_threads, vector<uint8_t>(plaintext.size()));
+    vector<thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int rep = 0; rep < 50; rep++) {
+                aes_encrypt_blocks(schedule, plaintext.data(), results[t].data(), num_blocks);
+            }
+        });
+    }
+    for (thread& th : threads) {
+        th.join();
+    }
+    for (size_t t = 0; t < num_threads; t++) {
+        check(results[t] == expected, "threads: thread " + to_string(t) + " result differs");
+    }
+    aes_key_schedule_destroy(schedule);
+}
+
+struct XtsVector {
+    const char* data_key;
+    const char* tweak_key;
+    uint64_t sector;
+    size_t length;
+    const char* plaintext;
+    const char* ciphertext;
+};
+
+// IEEE 1619 vector 2, and the vector 15 keys with 17- and 37-byte sectors
+// for ciphertext stealing (checked against OpenSSL's XTS-AES-128)
+static const XtsVector XTS_VECTORS[] = {
+    {"\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11\x11",
+     "\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22\x22",
+     0x3333333333, 32,
+     "\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44"
+     "\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44\x44",
+     "\xc4\x54\x18\x5e\x6a\x16\x93\x6e\x39\x33\x40\x38\xac\xef\x83\x8b"
+     "\xfb\x18\x6f\xff\x74\x80\xad\xc4\x28\x93\x82\xec\xd6\xd3\x94\xf0"},
+    {"\xff\xfe\xfd\xfc\xfb\xfa\xf9\xf8\xf7\xf6\xf5\xf4\xf3\xf2\xf1\xf0",
+     "\xbf\xbe\xbd\xbc\xbb\xba\xb9\xb8\xb7\xb6\xb5\xb4\xb3\xb2\xb1\xb0",
+     0x9a78563412, 17,
+     "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10",
+     "\x64\x16\x10\x67\x9d\xcb\xf9\x2e\x50\x5c\x41\x33\x3f\xb0\x6c\x2a\x95"},
+    {"\xff\xfe\xfd\xfc\xfb\xfa\xf9\xf8\xf7\xf6\xf5\xf4\xf3\xf2\xf1\xf0",
+     "\xbf\xbe\xbd\xbc\xbb\xba\xb9\xb8\xb7\xb6\xb5\xb4\xb3\xb2\xb1\xb0",
+     0x9a78563412, 37,
+     "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+     "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
+     "\x20\x21\x22\x23\x24",
+     "\x95\xc8\x71\xf6\x52\x24\x69\xcc\x73\x71\x09\x59\x4a\xb0\xfe\xda"
+     "\xd4\x40\x80\xcd\xbc\x32\x8c\xdd\xd6\x2e\xa3\x3a\x29\xb0\x46\x36"
+     "\x38\x3a\x90\xc3\x32"}
+};
+
+static void test_xts_vectors() {
+    for (const XtsVector& v : XTS_VECTORS) {
+        aes_xts_key* key = aes_xts_key_create(bytes(v.data_key), bytes(v.tweak_key));
+        check(key != nullptr, "XTS: key creation");
+        if (!key) {
+            continue;
+        }
+        string name = "XTS " + to_string(v.length) + " bytes: ";
+
+        vector<uint8_t> buffer(v.length);
+        check(aes_xts_encrypt_sectors(key, bytes(v.plaintext), buffer.data(), v.length, 1, v.sector, 1) == AES_CIPHER_OK,
+              name + "encrypt status");
+        check(memcmp(buffer.data(), v.ciphertext, v.length) == 0, name + "ciphertext");
+        check(aes_xts_decrypt_sectors(key, buffer.data(), buffer.data(), v.length, 1, v.sector, 1) == AES_CIPHER_OK,
+              name + "decrypt status");
+        check(memcmp(buffer.data(), v.plaintext, v.length) == 0, name + "in-place decryption");
+        aes_xts_key_destroy(key);
+    }
+
+    // Argument checks
+    uint8_t sector[AES_CIPHER_BLOCK_SIZE] = {0};
+    const uint8_t* k = bytes(VECTORS[0].key);
+    check(aes_xts_key_create(k, nullptr) == nullptr, "XTS: NULL tweak key accepted");
+    check(aes_xts_encrypt_sectors(nullptr, sector, sector, 16, 1, 0, 1) == AES_CIPHER_EINVAL, "XTS: NULL key accepted");
+    aes_xts_key* key = aes_xts_key_create(k, k);
+    check(aes_xts_encrypt_sectors(key, sector, sector, 15, 1, 0, 1) == AES_CIPHER_EINVAL, "XTS: short sector accepted");
+    check(aes_xts_decrypt_sectors(key, nullptr, sector, 16, 1, 0, 1) == AES_CIPHER_EINVAL, "XTS: NULL input accepted");
+    check(aes_xts_encrypt_sectors(key, nullptr, nullptr, 16, 0, 0, 1) == AES_CIPHER_OK, "XTS: empty batch rejected");
+    aes_xts_key_destroy(key);
+    aes_xts_key_destroy(nullptr);
+}
+
+// Every kernel matches the scalar one and round-trips, for every stealing
+// length and for sectors that leave partial interleave groups
+static void test_xts_kernels() {
+    mt19937 rng(462);
+    AesKey data_key;
+    AesKey tweak_key;
+    for (int i = 0; i < AES_KEY_SIZE; i++) {
+        data_key.key[i] = static_cast<uint8_t>(rng());
+        tweak_key.key[i] = static_cast<uint8_t>(rng());
+    }
+    AesXts reference(data_key, tweak_key, AesKeyKernel::SCALAR);
+
+    vector<size_t> lengths;
+    for (size_t length = 16; length <= 100; length++) {
+        lengths.push_back(length);
+    }
+    lengths.push_back(512);
+    lengths.push_back(4096);
+    lengths.push_back(4099);
+
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            continue;
+        }
+        AesXts xts(data_key, tweak_key, kernel);
+        string name = string("XTS ") + aes_key_kernel_name(kernel);
+        check(xts.kernel() == kernel, name + ": kernel not selected");
+
+        for (size_t length : lengths) {
+            vector<uint8_t> plaintext(length);
+            for (uint8_t& b : plaintext) {
+                b = static_cast<uint8_t>(rng());
+            }
+            uint64_t sector = rng();
+            vector<uint8_t> expected(length);
+            vector<uint8_t> ciphertext(length);
+            reference.encrypt_sector(plaintext.data(), expected.data(), length, sector);
+            xts.encrypt_sector(plaintext.data(), ciphertext.data(), length, sector);
+            check(ciphertext == expected, name + ": " + to_string(length) + " bytes differ from scalar");
+
+            xts.decrypt_sector(ciphertext.data(), ciphertext.data(), length, sector);
+            check(ciphertext == plaintext, name + ": " + to_string(length) + " bytes do not round-trip");
+        }
+    }
+}
+
+// Many sectors split over threads give the same bytes as one sector at a time
+static void test_xts_parallel() {
+    const size_t sector_size = 4096;
+    const size_t num_sectors = 97;
+    const uint64_t first_sector = 1000;
+    AesXts xts(AesKey(bytes(VECTORS[0].key)), AesKey(bytes(VECTORS[1].key)));
+
+    vector<uint8_t> plaintext(sector_size * num_sectors);
+    for (size_t i = 0; i < plaintext.size(); i++) {
+        plaintext[i] = static_cast<uint8_t>(i * 13 + (i >> 8));
+    }
+    vector<uint8_t> expected(plaintext.size());
+    for (size_t s = 0; s < num_sectors; s++) {
+        xts.encrypt_sector(&plaintext[s * sector_size], &expected[s * sector_size], sector_size, first_sector + s);
+    }
+
+    for (unsigned num_threads : {1u, 3u, 4u, 0u}) {
+        string name = "XTS " + to_string(num_threads) + " threads: ";
+        vector<uint8_t> buffer(plaintext);
+        xts.encrypt_sectors(buffer.data(), buffer.data(), sector_size, num_sectors, first_sector, num_threads);
+        check(buffer == expected, name + "ciphertext differs");
+        xts.decrypt_sectors(buffer.data(), buffer.data(), sector_size, num_sectors, first_sector, num_threads);
+        check(buffer == plaintext, name + "does not round-trip");
+    }
+}
+
+// SP 800-38A F.2.1 and F.5.1, first block
+static const char* const SP800_38A_PLAINTEXT = "\x6b\xc1\xbe\xe2\x2e\x40\x9f\x96\xe9\x3d\x7e\x11\x73\x93\x17\x2a";
+static const char* const CBC_IV = "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f";
+static const char* const CBC_CIPHERTEXT = "\x76\x49\xab\xac\x81\x19\xb2\x46\xce\xe9\x8e\x9b\x12\xe9\x19\x7d";
+static const char* const CTR_COUNTER = "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff";
+static const char* const CTR_CIPHERTEXT = "\x87\x4d\x61\x91\xb6\x20\xe3\x26\x1b\xef\x68\x64\x99\x0d\xb6\xce";
+
+static void test_chaining_modes() {
+    AesKeySchedule schedule(bytes(VECTORS[0].key));
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t iv[AES_BLOCK_SIZE];
+
+    memcpy(iv, CBC_IV, AES_BLOCK_SIZE);
+    schedule.cbc_encrypt(bytes(SP800_38A_PLAINTEXT), block, 1, iv);
+    check(memcmp(block, CBC_CIPHERTEXT, AES_BLOCK_SIZE) == 0, "CBC: SP 800-38A ciphertext");
+    check(memcmp(iv, CBC_CIPHERTEXT, AES_BLOCK_SIZE) == 0, "CBC: IV not chained");
+
+    uint8_t counter[AES_BLOCK_SIZE];
+    memcpy(counter, CTR_COUNTER, AES_BLOCK_SIZE);
+    schedule.ctr_crypt(bytes(SP800_38A_PLAINTEXT), block, AES_BLOCK_SIZE, counter);
+    check(memcmp(block, CTR_CIPHERTEXT, AES_BLOCK_SIZE) == 0, "CTR: SP 800-38A ciphertext");
+    check(counter[15] == 0x00 && counter[14] == 0xff, "CTR: counter not incremented");
+
+    // Longer runs round-trip in place, and CBC/CTR split over two calls
+    // matches one call
+    mt19937 rng(463);
+    vector<uint8_t> plaintext(37 * AES_BLOCK_SIZE + 5);
+    for (uint8_t& b : plaintext) {
+        b = static_cast<uint8_t>(rng());
+    }
+    size_t cbc_blocks = plaintext.size() / AES_BLOCK_SIZE;
+    vector<uint8_t> whole(plaintext);
+    vector<uint8_t> split(plaintext);
+    memcpy(iv, CBC_IV, AES_BLOCK_SIZE);
+    schedule.cbc_encrypt(whole.data(), whole.data(), cbc_blocks, iv);
+    memcpy(iv, CBC_IV, AES_BLOCK_SIZE);
+    schedule.cbc_encrypt(split.data(), split.data(), 10, iv);
+    schedule.cbc_encrypt(&split[10 * AES_BLOCK_SIZE], &split[10 * AES_BLOCK_SIZE], cbc_blocks - 10, iv);
+    check(whole == split, "CBC: split stream differs");
+    memcpy(iv, CBC_IV, AES_BLOCK_SIZE);
+    schedule.cbc_decrypt(whole.data(), whole.data(), cbc_blocks, iv);
+    check(whole == plaintext, "CBC: does not round-trip");
+
+    whole = plaintext;
+    split = plaintext;
+    memcpy(counter, CTR_COUNTER, AES_BLOCK_SIZE);
+    schedule.ctr_crypt(whole.data(), whole.data(), whole.size(), counter);
+    memcpy(counter, CTR_COUNTER, AES_BLOCK_SIZE);
+    schedule.ctr_crypt(split.data(), split.data(), 160, counter);
+    schedule.ctr_crypt(&split[160], &split[160], split.size() - 160, counter);
+    check(whole == split, "CTR: split stream differs");
+    memcpy(counter, CTR_COUNTER, AES_BLOCK_SIZE);
+    schedule.ctr_crypt(whole.data(), whole.data(), whole.size(), counter);
+    check(whole == plaintext, "CTR: does not round-trip");
+}
+
+// Jobs of every mode from several submitting threads, through the C API,
+// give the same bytes as running them directly
+static void test_job_ring() {
+    const size_t num_submitters = 3;
+    const size_t jobs_per_submitter = 200;
+    aes_key_schedule* key = aes_key_schedule_create(bytes(VECTORS[0].key));
+    aes_xts_key* xts_key = aes_xts_key_create(bytes(VECTORS[0].key), bytes(VECTORS[1].key));
+    aes_job_ring* ring = aes_job_ring_create(64, 2);
+    check(ring != nullptr, "ring: creation");
+    if (!ring) {
+        return;
+    }
+
+    size_t total = num_submitters * jobs_per_submitter;
+    vector<aes_job> jobs(total);
+    vector<vector<uint8_t>> inputs(total);
+    vector<vector<uint8_t>> outputs(total);
+    vector<vector<uint8_t>> expected(total);
+    AesKeySchedule schedule(bytes(VECTORS[0].key));
+    AesXts xts(AesKey(bytes(VECTORS[0].key)), AesKey(bytes(VECTORS[1].key)));
+    mt19937 rng(464);
+    for (size_t i = 0; i < total; i++) {
+        aes_job& job = jobs[i];
+        memset(&job, 0, sizeof(job));
+        job.mode = static_cast<int>(i % 4);
+        job.operation = (i / 4) % 2 ? AES_CIPHER_DECRYPT : AES_CIPHER_ENCRYPT;
+        job.key = key;
+        job.xts_key = xts_key;
+        size_t length = (job.mode == AES_CIPHER_MODE_CTR || job.mode == AES_CIPHER_MODE_XTS) ? 16 + rng() % 200 :
+                                                                                              16 * (1 + rng() % 12);
+        inputs[i].resize(length);
+        for (uint8_t& b : inputs[i]) {
+            b = static_cast<uint8_t>(rng());
+        }
+        for (uint8_t& b : job.iv) {
+            b = static_cast<uint8_t>(rng());
+        }
+        outputs[i].resize(length);
+        expected[i].resize(length);
+        job.in = inputs[i].data();
+        job.out = outputs[i].data();
+        job.length = length;
+        job.user_data = i;
+
+        AesJob direct;
+        direct.mode = static_cast<AesCipherMode>(job.mode);
+        direct.operation = job.operation == AES_CIPHER_DECRYPT ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        direct.key = &schedule;
+        direct.xts_key = &xts;
+        direct.in = job.in;
+        direct.out = expected[i].data();
+        direct.length = length;
+        memcpy(direct.iv.data(), job.iv, AES_BLOCK_SIZE);
+        aes_run_job(direct);
+    }
+
+    // Submitters retry while the ring is full; this thread reaps
+    vector<thread> submitters;
+    for (size_t t = 0; t < num_submitters; t++) {
+        submitters.emplace_back([&, t]() {
+            size_t next = t * jobs_per_submitter;
+            size_t end = next + jobs_per_submitter;
+            while (next < end) {
+                next += aes_job_ring_submit(ring, &jobs[next], end - next);
+                this_thread::yield();
+            }
+        });
+    }
+
+    vector<int> status(total, 1);
+    size_t reaped = 0;
+    aes_completion completions[16];
+    while (reaped < total) {
+        size_t n = aes_job_ring_wait(ring, completions, 16, 5000);
+        check(n > 0, "ring: wait timed out");
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            status[completions[i].user_data] = completions[i].status;
+        }
+        reaped += n;
+    }
+    for (thread& th : submitters) {
+        th.join();
+    }
+
+    bool all_ok = true;
+    bool all_match = true;
+    for (size_t i = 0; i < total; i++) {
+        all_ok = all_ok && status[i] == AES_CIPHER_OK;
+        all_match = all_match && outputs[i] == expected[i];
+    }
+    check(reaped == total, "ring: completions missing");
+    check(all_ok, "ring: job failed");
+    check(all_match, "ring: output differs from direct run");
+
+    // Malformed jobs complete with an error instead of being refused
+    aes_job bad;
+    memset(&bad, 0, sizeof(bad));
+    bad.mode = AES_CIPHER_MODE_CBC;
+    bad.key = key;
+    bad.in = inputs[0].data();
+    bad.out = outputs[0].data();
+    bad.length = 15;
+    bad.user_data = 7;
+    check(aes_job_ring_submit(ring, &bad, 1) == 1, "ring: malformed job refused");
+    bad.mode = 9;
+    bad.length = 16;
+    bad.user_data = 8;
+    check(aes_job_ring_submit(ring, &bad, 1) == 1, "ring: unknown mode refused");
+
+    // The eventfd signals pending completions
+    struct pollfd pfd = {aes_job_ring_event_fd(ring), POLLIN, 0};
+    size_t errors = 0;
+    while (errors < 2 && ::poll(&pfd, 1, 5000) > 0) {
+        size_t n = aes_job_ring_poll(ring, completions, 16);
+        for (size_t i = 0; i < n; i++) {
+            check(completions[i].status == AES_CIPHER_EINVAL, "ring: malformed job succeeded");
+            errors++;
+        }
+    }
+    check(errors == 2, "ring: malformed jobs not completed");
+
+    aes_job_ring_destroy(ring);
+    aes_xts_key_destroy(xts_key);
+    aes_key_schedule_destroy(key);
+}
+
+// Submission never blocks: a full ring refuses jobs until completions are reaped
+static void test_job_ring_full() {
+    AesKeySchedule schedule(bytes(VECTORS[0].key));
+    vector<uint8_t> buffer(4096 * AES_BLOCK_SIZE);
+    AesJobRing ring(4, 1);
+    check(ring.capacity() == 4, "ring full: capacity");
+
+    AesJob job;
+    job.key = &schedule;
+    job.in = buffer.data();
+    job.out = buffer.data();
+    job.length = buffer.size();
+    size_t accepted = 0;
+    while (ring.submit(job)) {
+        accepted++;
+    }
+    check(accepted == 4, "ring full: accepted " + to_string(accepted) + " jobs");
+
+    AesCompletion completions[4];
+    size_t reaped = 0;
+    while (reaped < accepted) {
+        reaped += ring.wait(completions, 4, 5000);
+    }
+    check(ring.in_flight() == 0, "ring full: jobs still in flight");
+    check(ring.submit(job), "ring full: no room after reaping");
+    while (ring.wait(completions, 4, 5000) == 0) {
+    }
+}
+
+// Reaping fewer completions than are pending leaves the eventfd readable
+static void test_job_ring_partial_reap() {
+    AesKeySchedule schedule(bytes(VECTORS[0].key));
+    uint8_t block[AES_BLOCK_SIZE] = {0};
+    AesJobRing ring(8, 1);
+
+    AesJob job;
+    job.key = &schedule;
+    job.in = block;
+    job.out = block;
+    job.length = AES_BLOCK_SIZE;
+    const size_t jobs = 5;
+    for (size_t i = 0; i < jobs; i++) {
+        check(ring.submit(job), "partial reap: submit");
+    }
+
+    // Let the worker post every completion before the first reap
+    struct pollfd pfd = {ring.event_fd(), POLLIN, 0};
+    check(::poll(&pfd, 1, 5000) == 1, "partial reap: no completion");
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    AesCompletion completion;
+    size_t reaped = 0;
+    while (reaped < jobs) {
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, 1000) != 1) {
+            break;
+        }
+        reaped += ring.poll(&completion, 1);
+    }
+    check(reaped == jobs, "partial reap: eventfd unreadable with " + to_string(jobs - reaped) + " completions left");
+    pfd.revents = 0;
+    check(::poll(&pfd, 1, 0) == 0, "partial reap: eventfd readable with nothing left");
+}
+
+// The C++20 build of these tests must not silently skip the awaiter
+#if defined(AES_CIPHER_TEST_COROUTINES) && !defined(AES_JOB_RING_COROUTINES)
+#error "AES_CIPHER_TEST_COROUTINES needs a compiler with C++20 coroutines"
+#endif
+
+#ifdef AES_JOB_RING_COROUTINES
+// Minimal fire-and-forget coroutine type for the awaiter test
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static DetachedTask encrypt_twice(AesJobRing& ring, AesJob job, std::atomic<int>& done) {
+    int first = co_await ring.run(job);
+    int second = co_await ring.run(job);
+    check(first == AES_CIPHER_OK && second == AES_CIPHER_OK, "coroutine: job failed");
+    done++;
+}
+
+static void test_job_ring_coroutines() {
+    AesKeySchedule schedule(bytes(VECTORS[1].key));
+    AesJobRing ring(16, 2);
+    vector<vector<uint8_t>> buffers(8, vector<uint8_t>(bytes(VECTORS[1].plaintext), bytes(VECTORS[1].plaintext) + 16));
+    std::atomic<int> done{0};
+    for (vector<uint8_t>& buffer : buffers) {
+        AesJob job;
+        job.key = &schedule;
+        job.in = buffer.data();
+        job.out = buffer.data();
+        job.length = buffer.size();
+        encrypt_twice(ring, job, done);
+    }
+    while (done < 8) {
+        ring.wait(nullptr, 0, 5000);
+    }
+
+    vector<uint8_t> expected(bytes(VECTORS[1].ciphertext), bytes(VECTORS[1].ciphertext) + 16);
+    schedule.encrypt_blocks(expected.data(), expected.data(), 1);
+    for (const vector<uint8_t>& buffer : buffers) {
+        check(buffer == expected, "coroutine: result differs");
+    }
+}
+#endif
+
+// RFC 4493 section 4: the SP 800-38A plaintext truncated to 0, 16, 40 and 64 bytes
+static const char* const CMAC_MESSAGE =
+    "\x6b\xc1\xbe\xe2\x2e\x40\x9f\x96\xe9\x3d\x7e\x11\x73\x93\x17\x2a"
+    "\xae\x2d\x8a\x57\x1e\x03\xac\x9c\x9e\xb7\x6f\xac\x45\xaf\x8e\x51"
+    "\x30\xc8\x1c\x46\xa3\x5c\xe4\x11\xe5\xfb\xc1\x19\x1a\x0a\x52\xef"
+    "\xf6\x9f\x24\x45\xdf\x4f\x9b\x17\xad\x2b\x41\x7b\xe6\x6c\x37\x10";
+
+static const struct {
+    size_t length;
+    const char* tag;
+} CMAC_VECTORS[] = {
+    {0, "\xbb\x1d\x69\x29\xe9\x59\x37\x28\x7f\xa3\x7d\x12\x9b\x75\x67\x46"},
+    {16, "\x07\x0a\x16\xb4\x6b\x4d\x41\x44\xf7\x9b\xdd\x9d\xd0\x4a\x28\x7c"},
+    {40, "\xdf\xa6\x67\x47\xde\x9a\xe6\x30\x30\xca\x32\x61\x14\x97\xc8\x27"},
+    {64, "\x51\xf0\xbe\xbf\x7e\x3b\x9d\x92\xfc\x49\x74\x17\x79\x36\x3c\xfe"}
+};
+
+static void test_cmac_vectors() {
+    AesCmacKey key(AesKey(bytes(VECTORS[0].key)));
+    AesCmacStream streams[4];
+    for (size_t i = 0; i < 4; i++) {
+        uint8_t tag[AES_BLOCK_SIZE];
+        key.compute(bytes(CMAC_MESSAGE), CMAC_VECTORS[i].length, tag);
+        check(memcmp(tag, CMAC_VECTORS[i].tag, AES_BLOCK_SIZE) == 0,
+              "CMAC: RFC 4493 tag for " + to_string(CMAC_VECTORS[i].length) + " bytes");
+        streams[i] = AesCmacStream{&key, bytes(CMAC_MESSAGE), CMAC_VECTORS[i].length, {}};
+    }
+    aes_cmac_streams(streams, 4);
+    for (size_t i = 0; i < 4; i++) {
+        check(memcmp(streams[i].tag, CMAC_VECTORS[i].tag, AES_BLOCK_SIZE) == 0,
+              "CMAC multi-buffer: RFC 4493 tag for " + to_string(CMAC_VECTORS[i].length) + " bytes");
+    }
+}
+
+// Many streams of mixed lengths and keys, through every lane count and
+// kernel, match the single-stream results
+static void test_multi_buffer() {
+    const size_t num_streams = 61;
+    const size_t num_keys = 5;
+    mt19937 rng(465);
+    vector<AesKeySchedule> schedules;
+    vector<AesCmacKey> cmac_keys;
+    for (size_t k = 0; k < num_keys; k++) {
+        AesKey key;
+        for (int i = 0; i < AES_KEY_SIZE; i++) {
+            key.key[i] = static_cast<uint8_t>(rng());
+        }
+        schedules.emplace_back(key);
+        cmac_keys.emplace_back(key);
+    }
+
+    vector<vector<uint8_t>> messages(num_streams);
+    vector<vector<uint8_t>> expected_cbc(num_streams);
+    vector<vector<uint8_t>> expected_tag(num_streams, vector<uint8_t>(AES_BLOCK_SIZE));
+    vector<array<uint8_t, AES_BLOCK_SIZE>> ivs(num_streams);
+    for (size_t i = 0; i < num_streams; i++) {
+        messages[i].resize(rng() % 300);
+        for (uint8_t& b : messages[i]) {
+            b = static_cast<uint8_t>(rng());
+        }
+        for (uint8_t& b : ivs[i]) {
+            b = static_cast<uint8_t>(rng());
+        }
+        size_t blocks = messages[i].size() / AES_BLOCK_SIZE;
+        expected_cbc[i].resize(blocks * AES_BLOCK_SIZE);
+        uint8_t iv[AES_BLOCK_SIZE];
+        memcpy(iv, ivs[i].data(), AES_BLOCK_SIZE);
+        schedules[i % num_keys].cbc_encrypt(messages[i].data(), expected_cbc[i].data(), blocks, iv);
+        cmac_keys[i % num_keys].compute(messages[i].data(), messages[i].size(), expected_tag[i].data());
+    }
+
+    for (AesKeyKernel kernel : {AesKeyKernel::SCALAR, AesKeyKernel::AESNI}) {
+        if (!aes_key_kernel_supported(kernel)) {
+            continue;
+        }
+        for (size_t lanes : {1, 4, 8}) {
+            string name = string("multi-buffer ") + aes_key_kernel_name(kernel) + " x" + to_string(lanes) + ": ";
+            AesMultiBuffer engine(lanes, kernel);
+            vector<AesCbcStream> cbc(num_streams);
+            vector<AesCmacStream> cmac(num_streams);
+            vector<vector<uint8_t>> outputs(num_streams);
+            for (size_t i = 0; i < num_streams; i++) {
+                outputs[i].resize(expected_cbc[i].size());
+                cbc[i] = AesCbcStream{&schedules[i % num_keys], messages[i].data(), outputs[i].data(),
+                                      outputs[i].size() / AES_BLOCK_SIZE, {}};
+                memcpy(cbc[i].iv, ivs[i].data(), AES_BLOCK_SIZE);
+                cmac[i] = AesCmacStream{&cmac_keys[i % num_keys], messages[i].data(), messages[i].size(), {}};
+                engine.add(cbc[i]);
+                engine.add(cmac[i]);
+            }
+            engine.flush();
+
+            bool cbc_match = true;
+            bool iv_match = true;
+            bool tag_match = true;
+            for (size_t i = 0; i < num_streams; i++) {
+                cbc_match = cbc_match && outputs[i] == expected_cbc[i];
+                const uint8_t* last_iv = outputs[i].empty() ? ivs[i].data() : &outputs[i][outputs[i].size() - AES_BLOCK_SIZE];
+                iv_match = iv_match && memcmp(cbc[i].iv, last_iv, AES_BLOCK_SIZE) == 0;
+                tag_match = tag_match && memcmp(cmac[i].tag, expected_tag[i].data(), AES_BLOCK_SIZE) == 0;
+            }
+            check(cbc_match, name + "CBC ciphertext differs");
+            check(iv_match, name + "CBC chaining value differs");
+            check(tag_match, name + "CMAC tag differs");
+            check(engine.stats().streams == 2 * num_streams, name + "stream count");
+            check(engine.stats().occupancy() > 0.0 && engine.stats().occupancy() <= 1.0, name + "occupancy out of range");
+        }
+    }
+}
+
+// Cut buf into segments of random lengths, empty ones and 1-byte ones
+// included, so that blocks straddle two or more segments
+static vector<struct iovec> random_segments(vector<uint8_t>& buf, mt19937& rng) {
+    vector<struct iovec> iov;
+    size_t offset = 0;
+    while (offset < buf.size()) {
+        size_t length = min<size_t>(buf.size() - offset, rng() % 40);
+        iov.push_back({buf.data() + offset, length});
+        offset += length;
+    }
+    iov.push_back({nullptr, 0});
+    return iov;
+}
+
+static void test_scatter_gather() {
+    mt19937 rng(460);
+    AesKeySchedule schedule(AesKey(bytes("\x2b\x7e\x15\x16\x28\xae\xd2\xa6\xab\xf7\x15\x88\x09\xcf\x4f\x3c")));
+
+    for (size_t length : {0, 16, 48, 160, 1024, 4096}) {
+        for (int trial = 0; trial < 8; trial++) {
+            string name = "scatter-gather " + to_string(length) + " bytes: ";
+            vector<uint8_t> plain(length);
+            for (uint8_t& b : plain) {
+                b = static_cast<uint8_t>(rng());
+            }
+            uint8_t iv[AES_BLOCK_SIZE];
+            for (uint8_t& b : iv) {
+                b = static_cast<uint8_t>(rng());
+            }
+
+            // Contiguous references
+            vector<uint8_t> ecb(length);
+            vector<uint8_t> cbc(length);
+            uint8_t cbc_iv[AES_BLOCK_SIZE];
+            memcpy(cbc_iv, iv, AES_BLOCK_SIZE);
+            schedule.encrypt_blocks(plain.data(), ecb.data(), length / AES_BLOCK_SIZE);
+            schedule.cbc_encrypt(plain.data(), cbc.data(), length / AES_BLOCK_SIZE, cbc_iv);
+
+            vector<uint8_t> buf = plain;
+            vector<struct iovec> iov = random_segments(buf, rng);
+            check(aes_iov_length(iov.data(), iov.size()) == length, name + "chain length");
+
+            check(aes_iov_encrypt_blocks(schedule, iov.data(), iov.size()) == AES_CIPHER_OK && buf == ecb,
+                  name + "ECB encryption differs");
+            check(aes_iov_decrypt_blocks(schedule, iov.data(), iov.size()) == AES_CIPHER_OK && buf == plain,
+                  name + "ECB decryption differs");
+
+            uint8_t chain[AES_BLOCK_SIZE];
+            memcpy(chain, iv, AES_BLOCK_SIZE);
+            check(aes_iov_cbc_encrypt(schedule, iov.data(), iov.size(), chain) == AES_CIPHER_OK && buf == cbc,
+                  name + "CBC encryption differs");
+            check(memcmp(chain, cbc_iv, AES_BLOCK_SIZE) == 0, name + "CBC chaining value differs");
+            memcpy(chain, iv, AES_BLOCK_SIZE);
+            check(aes_iov_cbc_decrypt(schedule, iov.data(), iov.size(), chain) == AES_CIPHER_OK && buf == plain,
+                  name + "CBC decryption differs");
+        }
+    }
+
+    // CTR over any length, including a partial last block after a straddle
+    for (size_t length : {1, 15, 17, 100, 1000, 4099}) {
+        for (int trial = 0; trial < 8; trial++) {
+            string name = "scatter-gather CTR " + to_string(length) + " bytes: ";
+            vector<uint8_t> plain(length);
+            for (uint8_t& b : plain) {
+                b = static_cast<uint8_t>(rng());
+            }
+            vector<uint8_t> expected(length);
+            uint8_t counter[AES_BLOCK_SIZE];
+            memcpy(counter, CTR_COUNTER, AES_BLOCK_SIZE);
+            schedule.ctr_crypt(plain.data(), expected.data(), length, counter);
+
+            vector<uint8_t> buf = plain;
+            vector<struct iovec> iov = random_segments(buf, rng);
+            uint8_t iov_counter[AES_BLOCK_SIZE];
+            memcpy(iov_counter, CTR_COUNTER, AES_BLOCK_SIZE);
+            check(aes_iov_ctr_crypt(schedule, iov.data(), iov.size(), iov_counter) == AES_CIPHER_OK && buf == expected,
+                  name + "keystream differs");
+            check(memcmp(iov_counter, counter, AES_BLOCK_SIZE) == 0, name + "counter differs");
+        }
+    }
+
+    // C interface, and chains that are rejected without being touched
+    aes_key_schedule* handle = aes_key_schedule_create(bytes("\x2b\x7e\x15\x16\x28\xae\xd2\xa6\xab\xf7\x15\x88\x09\xcf\x4f\x3c"));
+    vector<uint8_t> buf(48, 0x5a);
+    vector<uint8_t> expected(48);
+    schedule.encrypt_blocks(buf.data(), expected.data(), 3);
+    struct iovec split[] = {{buf.data(), 7}, {buf.data() + 7, 30}, {buf.data() + 37, 11}};
+    check(aes_iov_encrypt_blocks(handle, split, 3) == AES_CIPHER_OK && buf == expected, "scatter-gather C ECB");
+
+    vector<uint8_t> before = buf;
+    struct iovec ragged[] = {{buf.data(), 7}, {buf.data() + 7, 30}};
+    check(aes_iov_encrypt_blocks(handle, ragged, 2) == AES_CIPHER_EINVAL && buf == before,
+          "scatter-gather ECB accepted a partial block");
+    struct iovec null_base[] = {{nullptr, 16}};
+    check(aes_iov_ctr_crypt(handle, null_base, 1, buf.data()) == AES_CIPHER_EINVAL,
+          "scatter-gather accepted a null segment");
+    check(aes_iov_encrypt_blocks(static_cast<const aes_key_schedule*>(nullptr), split, 3) == AES_CIPHER_EINVAL,
+          "scatter-gather accepted a null schedule");
+    aes_key_schedule_destroy(handle);
+}
+
+static void test_key_store() {
+    const size_t count = 1000;
+    const string path = "/tmp/aes_cipher_test_" + to_string(getpid()) + ".keys";
+    mt19937_64 rng(466);
+    vector<uint64_t> ids(count);
+    vector<AesKey> keys(count);
+    for (size_t i = 0; i < count; i++) {
+        ids[i] = rng();
+        for (uint8_t& b : keys[i].key) {
+            b = static_cast<uint8_t>(rng());
+        }
+    }
+
+    check(AesKeyStore::write(path, ids.data(), keys.data(), count) == AES_CIPHER_OK, "key store: write");
+    AesKeyStore store;
+    check(store.open(path) == AES_CIPHER_OK && store.size() == count, "key store: open");
+    check(store.verify(), "key store: checksum");
+
+    // Stored schedules must behave exactly like freshly expanded ones
+    uint8_t block[AES_BLOCK_SIZE];
+    for (size_t i = 0; i < count; i += 37) {
+        AesKeySchedule expected(keys[i]);
+        AesKeySchedule loaded;
+        check(store.get(ids[i], loaded), "key store: stored key not found");
+        const AesKeyStoreRecord* record = store.find(ids[i]);
+        check(record && reinterpret_cast<uintptr_t>(record) % 64 == 0, "key store: record alignment");
+        for (int r = 0; r <= AES_NUM_ROUNDS; r++) {
+            check(loaded.round_keys().round_keys[r] == expected.round_keys().round_keys[r] &&
+                  loaded.inv_round_keys().round_keys[r] == expected.inv_round_keys().round_keys[r],
+                  "key store: round keys differ");
+        }
+        memcpy(block, bytes(VECTORS[0].plaintext), AES_BLOCK_SIZE);
+        loaded.encrypt_blocks(block, block, 1);
+        loaded.decrypt_blocks(block, block, 1);
+        check(memcmp(block, bytes(VECTORS[0].plaintext), AES_BLOCK_SIZE) == 0, "key store: round trip");
+    }
+    uint64_t absent = 0;
+    while (find(ids.begin(), ids.end(), absent) != ids.end()) {
+        absent++;
+    }
+    AesKeySchedule unused;
+    check(!store.get(absent, unused) && !store.find(absent), "key store: found an absent ID");
+
+    // Duplicate IDs and unreadable files are rejected
+    vector<uint64_t> duplicate_ids = {7, 9, 7};
+    check(AesKeyStore::write(path + ".dup", duplicate_ids.data(), keys.data(), 3) == AES_CIPHER_EINVAL,
+          "key store: duplicate IDs accepted");
+    AesKeyStore other;
+    check(other.open(path + ".missing") == AES_CIPHER_EIO, "key store: missing file opened");
+
+    // C interface on the same file, mapped a second time
+    int status = AES_CIPHER_EINVAL;
+    aes_key_store* handle = aes_key_store_open(path.c_str(), &status);
+    check(handle && status == AES_CIPHER_OK && aes_key_store_count(handle) == count, "key store C: open");
+    aes_key_schedule* schedule = aes_key_store_get(handle, ids[5]);
+    check(schedule != nullptr, "key store C: get");
+    if (schedule) {
+        uint8_t expected_block[AES_BLOCK_SIZE];
+        AesKeySchedule(keys[5]).encrypt_blocks(bytes(VECTORS[1].plaintext), expected_block, 1);
+        aes_encrypt_blocks(schedule, bytes(VECTORS[1].plaintext), block, 1);
+        check(memcmp(block, expected_block, AES_BLOCK_SIZE) == 0, "key store C: encryption");
+    }
+    aes_key_schedule_destroy(schedule);
+    aes_key_store_close(handle);
+
+    // A file from another format version, and a truncated one
+    {
+        ifstream in(path, ios::binary);
+        vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream(path + ".short", ios::binary).write(file.data(), file.size() - AES_BLOCK_SIZE);
+        AesKeyStoreHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        header.version = AES_KEY_STORE_VERSION + 1;
+        memcpy(file.data(), &header, sizeof(header));
+        ofstream(path + ".v2", ios::binary).write(file.data(), file.size());
+    }
+    check(other.open(path + ".v2") == AES_CIPHER_EVERSION, "key store: other version opened");
+    check(other.open(path + ".short") == AES_CIPHER_EIO, "key store: truncated file opened");
+    check(!other.is_open(), "key store: failed open left a mapping");
+
+    // Replacing the file leaves an open mapping intact
+    check(AesKeyStore::write(path, ids.data(), keys.data(), 10) == AES_CIPHER_OK, "key store: rewrite");
+    check(store.size() == count && store.find(ids[count - 1]) && store.verify(), "key store: old mapping changed");
+
+    remove(path.c_str());
+    remove((path + ".v2").c_str());
+    remove((path + ".short").c_str());
+}
+
+// CTR_DRBG AES-128 in the CAVP layout (instantiate, optional reseed, two
+// 512-bit generates, second output returned), with and without the
+// derivation function. The first two are COUNT = 0 of the AES-128 use df
+// and no df sections of the NIST CAVP drbgvectors_no_reseed CTR_DRBG.rsp.
+// The rest cover personalization, additional input and reseed; they were
+// generated here and their ReturnedBits cross-checked against OpenSSL 3's
+// validated CTR-DRBG.
+struct DrbgVector {
+    bool use_df;
+    bool reseed;
+    const char* entropy;
+    const char* nonce;
+    const char* personalization;
+    const char* entropy_reseed;
+    const char* additional_reseed;
+    const char* additional1;
+    const char* additional2;
+    const char* returned_bits;
+};
+
+static const DrbgVector DRBG_VECTORS[] = {
+    {true, false,
+     "890eb067acf7382eff80b0c73bc872c6",
+     "aad471ef3ef1d203",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "a5514ed7095f64f3d0d3a5760394ab42062f373a25072a6ea6bcfd8489e94af6"
+     "cf18659fea22ed1ca0a9e33f718b115ee536b12809c31b72b08ddd8be1910fa3"},
+    {false, false,
+     "ce50f33da5d4c1d3d4004eb35244b7f2cd7f2e5076fbf6780a7ff634b249a5fc",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "6545c0529d372443b392ceb3ae3a99a30f963eaf313280f1d1a1e87f9db373d3"
+     "61e75d18018266499cccd64d9bbb8de0185f213383080faddec46bae1f784e5a"},
+    {true, false,
+     "c67e816b4bfbe2fb54f6bddf7c1ce187",
+     "8c21ff72edd718d9",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "b09ff9fa1e4d293e748ddd360187868760889d12e924b08952d4752153dba8a4"
+     "b9cee26db738c8ce2990af0162f127bfc61dd3b920f8dfdba94c82dc317115b4"},
+    {true, false,
+     "32f0f299b401570c2bbda5461f106fb7",
+     "f8936f9f56de8dea",
+     "bf36eda6f7bac2c81ff655ace00d73a0",
+     "",
+     "",
+     "121d66b9db4f62620d4bdd460107f9fe",
+     "d8c0e4c07c2b97400767b57961067c72",
+     "14bf6d3fb1e87354a01d6465fc6eeffad4cf84fae7ccf1dbb1e389e45c089fcf"
+     "4433c6f8a3160f36ddd972d4fcfe5030533917fcbf90ebb83086054a51e05e48"},
+    {true, true,
+     "9e6362c61d08cd1d01848dacc204fee7",
+     "6505dfcdbfe402fb",
+     "",
+     "f14adbda019d6db7efd91546e3ff8444",
+     "",
+     "",
+     "",
+     "7a028b5183222865115b5474ca85b8d902ec8b562a4ac327921fbf371bbfa531"
+     "b5d88e96bab410b70e95090d1d1be6ccf7b0d41d6490e0ab1346462daf311c8a"},
+    {true, true,
+     "0ad5d2f4860e422ed74a751265f88c16",
+     "d17750fa28eb770c",
+     "971acd01c9c7adeacc83257926f490ff",
+     "5dbd4b076aa3e2c8c69ffdac86f21274",
+     "245fc90e0b8017a6c0bcd5dfe7f194e8",
+     "ea024714ad5c4d84bad8ad1247ef165d",
+     "b0a4c41b4e388262b4f48546a8ed98d1",
+     "b1add208b55ed89d6062c6307047a94bb9257fccc999b70f3ee1080fb2898841"
+     "bdc1da7bc640ae21b9f075411b11c297f04f5fb976331606033bf5652f6690ff"},
+    {false, false,
+     "77474221ef15b740ae115d7908eb1a46e576b877070008f31b73d42c812d8663",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "",
+     "f418681df4617d15ccd11da274795cb311b821cc394768b6c055ea738d44539a"
+     "e5c84991b0166860084f4e3ffb9ba9fb4bd1e7616cf4ba9427b30c56746deb96"},
+    {false, false,
+     "e3b9b24e581b2d5184d744dfabdfa975de641a9ef323c71d487667e1361618a6",
+     "",
+     "6fffae5b9bd4970c7810f4456cdbad5e00f1a45f8009b44e54096c3921eb8b02",
+     "",
+     "",
+     "c2e6276f7f6937a667657cdf8ed633bcb4c4f2025361981868e5f53d012a388c",
+     "8989a57520456d8461815412eed4b530450bb7e399d48eb06e2f77e9f79571ba",
+     "da560b109d63eaa4f98579423ef48c80ebd36913e5cfe2374b861f22acc46212"
+     "c1e3bd4058cbdf53f0c5b484a51be8f7703532dfbcb6880a8c4cb31573f7299a"},
+    {false, true,
+     "4f2c227cc121a2625b9e2c454ed337a5d6517cc4df4785487579fa96ecffabe8",
+     "",
+     "",
+     "a2139c8fa5b642fb49f3b4df70cdbd028a25ca67b29f69128855829acc3e5773",
+     "",
+     "",
+     "",
+     "dad5d84bc65214fe8d51a4251b20ef14de28fef9c8d281b334a293e5b8a4537e"
+     "02c804037b8642abb7086e4b4a01f29b6c7ac9ca853d7d4dbf9dad5846426434"},
+    {false, true,
+     "bb9e93a92a281773316414acf2c6c6d4cf3fdeeacc6a4373a17c8d4aa2e83e2b",
+     "",
+     "48e38eb66de0822f259dc412b3c3cabdf2cc67ac585031a4ae0f93a38dbdb187",
+     "0e860cbd0ebdb70d1fba9c4513c14c3283122c8d9fc3273cb558164f8228eab5",
+     "d42889c3af99ecea19d6747873bfcea61459f16ee5351ed5bba298fb779224e3",
+     "9bcb07ca517622c813f24cacd4be501ba6a0b64f2ba8156dc2eb1ba76dfd5d11",
+     "616d85d0f25257a60d0f24df34bcd28f37e67b30711b0b06c8359e536267973f",
+     "108b511ab472953cb309240379f6b792d456778296912fd9557dcd8001a62454"
+     "088903ec09df2637d45a4f2a9e5220877b1fa10264a0723ee388a9b693e54d7d"}
+};
+
+static vector<uint8_t> from_hex(const char* hex) {
+    vector<uint8_t> out;
+    for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+        out.push_back(static_cast<uint8_t>(stoi(string(hex + i, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+static void test_ctr_drbg() {
+    for (const DrbgVector& v : DRBG_VECTORS) {
+        string name = string("CTR_DRBG ") + (v.use_df ? "df" : "no df") + (v.reseed ? " reseed" : "") + ": ";
+        vector<uint8_t> entropy = from_hex(v.entropy);
+        vector<uint8_t> nonce = from_hex(v.nonce);
+        vector<uint8_t> pers = from_hex(v.personalization);
+        vector<uint8_t> add1 = from_hex(v.additional1);
+        vector<uint8_t> add2 = from_hex(v.additional2);
+        vector<uint8_t> expected = from_hex(v.returned_bits);
+
+        AesCtrDrbg drbg(v.use_df);
+        check(drbg.instantiate(entropy.data(), entropy.size(), nonce.data(), nonce.size(), pers.data(), pers.size())
+              == AES_CIPHER_OK, name + "instantiate");
+        if (v.reseed) {
+            vector<uint8_t> entropy_reseed = from_hex(v.entropy_reseed);
+            vector<uint8_t> add_reseed = from_hex(v.additional_reseed);
+            check(drbg.reseed(entropy_reseed.data(), entropy_reseed.size(), add_reseed.data(), add_reseed.size())
+                  == AES_CIPHER_OK, name + "reseed");
+        }
+        vector<uint8_t> out(expected.size());
+        check(drbg.generate(out.data(), out.size(), add1.data(), add1.size()) == AES_CIPHER_OK, name + "generate 1");
+        check(drbg.generate(out.data(), out.size(), add2.data(), add2.size()) == AES_CIPHER_OK, name + "generate 2");
+        check(out == expected, name + "ReturnedBits");
+
+        // The C interface gives the same bits
+        int status = AES_CIPHER_EINVAL;
+        aes_ctr_drbg* c_drbg = aes_ctr_drbg_create(entropy.data(), entropy.size(), nonce.data(), nonce.size(),
+                                                   pers.data(), pers.size(), v.use_df, &status);
+        check(c_drbg != nullptr && status == AES_CIPHER_OK, name + "C create");
+        if (v.reseed) {
+            vector<uint8_t> entropy_reseed = from_hex(v.entropy_reseed);
+            vector<uint8_t> add_reseed = from_hex(v.additional_reseed);
+            aes_ctr_drbg_reseed(c_drbg, entropy_reseed.data(), entropy_reseed.size(), add_reseed.data(),
+                                add_reseed.size());
+        }
+        vector<uint8_t> c_out(expected.size());
+        aes_ctr_drbg_generate(c_drbg, c_out.data(), c_out.size(), add1.data(), add1.size());
+        check(aes_ctr_drbg_generate(c_drbg, c_out.data(), c_out.size(), add2.data(), add2.size()) == AES_CIPHER_OK &&
+              c_out == expected, name + "C ReturnedBits");
+        aes_ctr_drbg_destroy(c_drbg);
+    }
+
+    // A request that ends inside a block uses that whole block, as the
+    // standard's loop does: 37 bytes leave the same state as 48
+    vector<uint8_t> entropy = from_hex(DRBG_VECTORS[0].entropy);
+    vector<uint8_t> nonce = from_hex(DRBG_VECTORS[0].nonce);
+    AesCtrDrbg a(true);
+    AesCtrDrbg b(true);
+    a.instantiate(entropy.data(), entropy.size(), nonce.data(), nonce.size(), nullptr, 0);
+    b.instantiate(entropy.data(), entropy.size(), nonce.data(), nonce.size(), nullptr, 0);
+    vector<uint8_t> whole(64);
+    vector<uint8_t> partial(64);
+    a.generate(whole.data(), 48);
+    b.generate(partial.data(), 37);
+    check(memcmp(whole.data(), partial.data(), 37) == 0, "CTR_DRBG: partial request is not a keystream prefix");
+    a.generate(whole.data(), whole.size());
+    b.generate(partial.data(), partial.size());
+    check(whole == partial, "CTR_DRBG: partial block left a different state");
+
+    // Limits
+    vector<uint8_t> big(AES_DRBG_MAX_REQUEST + 1);
+    check(a.generate(big.data(), AES_DRBG_MAX_REQUEST) == AES_CIPHER_OK, "CTR_DRBG: maximum request rejected");
+    check(a.generate(big.data(), big.size()) == AES_CIPHER_EINVAL, "CTR_DRBG: oversized request accepted");
+    a.set_reseed_interval(a.reseed_counter());
+    check(a.generate(big.data(), 16) == AES_CIPHER_OK, "CTR_DRBG: last request before reseed rejected");
+    check(a.generate(big.data(), 16) == AES_CIPHER_ERESEED, "CTR_DRBG: reseed interval not enforced");
+    check(a.reseed(entropy.data(), entropy.size()) == AES_CIPHER_OK && a.generate(big.data(), 16) == AES_CIPHER_OK,
+          "CTR_DRBG: reseed did not reset the counter");
+
+    AesCtrDrbg no_df(false);
+    check(no_df.generate(big.data(), 16) == AES_CIPHER_EINVAL, "CTR_DRBG: generate before instantiate");
+    check(no_df.instantiate(entropy.data(), 16, nullptr, 0, nullptr, 0) == AES_CIPHER_EINVAL,
+          "CTR_DRBG: short entropy accepted without df");
+    check(no_df.instantiate(big.data(), 32, nonce.data(), nonce.size(), nullptr, 0) == AES_CIPHER_EINVAL,
+          "CTR_DRBG: nonce accepted without df");
+    check(no_df.instantiate(big.data(), 32, nullptr, 0, big.data(), 33) == AES_CIPHER_EINVAL,
+          "CTR_DRBG: long personalization accepted without df");
+    AesCtrDrbg df(true);
+    check(df.instantiate(entropy.data(), entropy.size(), nonce.data(), 4, nullptr, 0) == AES_CIPHER_EINVAL,
+          "CTR_DRBG: short nonce accepted");
+    check(aes_ctr_drbg_create(nullptr, 0, nullptr, 0, nullptr, 0, 1, nullptr) == nullptr,
+          "CTR_DRBG: C create with no entropy");
+    check(aes_ctr_drbg_generate(nullptr, big.data(), 16, nullptr, 0) == AES_CIPHER_EINVAL,
+          "CTR_DRBG: C generate with NULL handle");
+
+    // Per-thread generators: small requests from the buffer, large ones
+    // straight through, and no two threads see the same bytes
+    vector<vector<uint8_t>> samples(4, vector<uint8_t>(3 * 4096 + 100));
+    vector<thread> threads;
+    atomic<int> errors(0);
+    for (vector<uint8_t>& sample : samples) {
+        threads.emplace_back([&sample, &errors]() {
+            size_t offset = 0;
+            for (size_t n : {16, 16, 1, 4000, 100000, 33}) {
+                if (n > sample.size() - offset) {
+                    vector<uint8_t> large(n);
+                    errors += aes_random_bytes(large.data(), n) != AES_CIPHER_OK;
+                    continue;
+                }
+                errors += aes_random_bytes(sample.data() + offset, n) != AES_CIPHER_OK;
+                offset += n;
+            }
+            errors += aes_random_bytes(sample.data() + offset, sample.size() - offset) != AES_CIPHER_OK;
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    check(errors == 0, "aes_random_bytes: request failed");
+    for (size_t i = 0; i < samples.size(); i++) {
+        for (size_t j = i + 1; j < samples.size(); j++) {
+            check(memcmp(samples[i].data(), samples[j].data(), 64) != 0, "aes_random_bytes: threads share a stream");
+        }
+    }
+    check(aes_random_bytes(nullptr, 16) == AES_CIPHER_EINVAL, "aes_random_bytes: NULL buffer accepted");
+}
+
+static void test_hex() {
+    // Every kernel against the scalar one, across the SIMD step boundaries
+    mt19937 rng(464);
+    vector<uint8_t> data(100);
+    for (uint8_t& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    vector<char> expected(2 * data.size());
+    aes_hex_detail::encode_scalar(data.data(), data.size(), expected.data());
+    for (AesHexKernel kernel : {AesHexKernel::SCALAR, AesHexKernel::SSSE3, AesHexKernel::AVX2, AesHexKernel::AUTO}) {
+        if (!aes_hex_kernel_supported(kernel)) {
+            continue;
+        }
+        string name = string("hex ") + aes_hex_kernel_name(kernel) + ": ";
+        for (size_t length = 0; length <= data.size(); length++) {
+            vector<char> hex(2 * length + 1, '!');
+            aes_hex_encode(data.data(), length, hex.data(), kernel);
+            check(memcmp(hex.data(), expected.data(), 2 * length) == 0 && hex[2 * length] == '!',
+                  name + "encode, length " + to_string(length));
+            vector<uint8_t> decoded(length + 1, 0xa5);
+            check(aes_hex_decode(hex.data(), 2 * length, decoded.data(), kernel) &&
+                  memcmp(decoded.data(), data.data(), length) == 0 && decoded[length] == 0xa5,
+                  name + "decode, length " + to_string(length));
+        }
+
+        // Upper case decodes the same; a bad character anywhere is caught
+        string upper(expected.begin(), expected.end());
+        transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        vector<uint8_t> decoded(data.size());
+        check(aes_hex_decode(upper.data(), upper.size(), decoded.data(), kernel) && decoded == data,
+              name + "upper case");
+        for (size_t i = 0; i < upper.size(); i++) {
+            for (char bad : {'g', 'G', ' ', '/', ':', '@', '`', '\0', '\xff'}) {
+                string corrupt = upper;
+                corrupt[i] = bad;
+                check(!aes_hex_decode(corrupt.data(), corrupt.size(), decoded.data(), kernel),
+                      name + "invalid digit at " + to_string(i));
+            }
+        }
+        check(!aes_hex_decode(upper.data(), 31, decoded.data(), kernel), name + "odd length accepted");
+    }
+}
+
+static void test_vector_corpus() {
+    const string path = "/tmp/aes_cipher_test_" + to_string(getpid()) + ".vectors";
+
+    // FIPS 197 in ECB, SP 800-38A F.2.1 and F.5.1 first blocks, and a
+    // 40-byte CTR vector that ends inside a block
+    uint8_t ctr_plaintext[40];
+    uint8_t ctr_ciphertext[40];
+    for (size_t i = 0; i < sizeof(ctr_plaintext); i++) {
+        ctr_plaintext[i] = static_cast<uint8_t>(i * 7);
+    }
+    AesKeySchedule ctr_schedule(bytes(VECTORS[1].key));
+    AesJob job;
+    job.mode = AesCipherMode::CTR;
+    job.key = &ctr_schedule;
+    job.in = ctr_plaintext;
+    job.out = ctr_ciphertext;
+    job.length = sizeof(ctr_plaintext);
+    memcpy(job.iv.data(), CTR_COUNTER, AES_BLOCK_SIZE);
+    aes_run_job(job);
+
+    vector<AesTestVector> vectors(5);
+    for (size_t i = 0; i < 2; i++) {
+        vectors[i].key = bytes(VECTORS[i].key);
+        vectors[i].plaintext = bytes(VECTORS[i].plaintext);
+        vectors[i].ciphertext = bytes(VECTORS[i].ciphertext);
+        vectors[i].length = AES_BLOCK_SIZE;
+    }
+    vectors[1].operation = AesOperation::DECRYPT;
+    vectors[2] = {AesCipherMode::CBC, AesOperation::ENCRYPT, 0, bytes(VECTORS[0].key), bytes(CBC_IV),
+                  bytes(SP800_38A_PLAINTEXT), bytes(CBC_CIPHERTEXT), AES_BLOCK_SIZE};
+    vectors[3] = {AesCipherMode::CTR, AesOperation::DECRYPT, 0, bytes(VECTORS[0].key), bytes(CTR_COUNTER),
+                  bytes(SP800_38A_PLAINTEXT), bytes(CTR_CIPHERTEXT), AES_BLOCK_SIZE};
+    vectors[4] = {AesCipherMode::CTR, AesOperation::ENCRYPT, 0, bytes(VECTORS[1].key), bytes(CTR_COUNTER),
+                  ctr_plaintext, ctr_ciphertext, sizeof(ctr_plaintext)};
+
+    AesVectorCorpusWriter writer;
+    check(writer.open(path) == AES_CIPHER_OK, "vector corpus: open writer");
+    for (size_t i = 0; i < vectors.size(); i++) {
+        vectors[i].id = 100 + i;
+        check(writer.add(vectors[i]) == AES_CIPHER_OK, "vector corpus: add " + to_string(i));
+    }
+    AesTestVector bad = vectors[2];
+    bad.mode = AesCipherMode::XTS;
+    check(writer.add(bad) == AES_CIPHER_EINVAL, "vector corpus: XTS accepted");
+    bad.mode = AesCipherMode::CBC;
+    bad.iv = nullptr;
+    check(writer.add(bad) == AES_CIPHER_EINVAL, "vector corpus: CBC without an IV accepted");
+    bad = vectors[0];
+    bad.length = 15;
+    check(writer.add(bad) == AES_CIPHER_EINVAL, "vector corpus: partial ECB block accepted");
+    bad = vectors[0];
+    bad.operation = static_cast<AesOperation>(2);
+    check(writer.add(bad) == AES_CIPHER_EINVAL, "vector corpus: unknown operation accepted");
+    check(writer.finish() == AES_CIPHER_OK, "vector corpus: finish");
+
+    AesVectorCorpus corpus;
+    check(corpus.open(path) == AES_CIPHER_OK && corpus.size() == vectors.size(), "vector corpus: open");
+    check(corpus.verify(), "vector corpus: checksum");
+    for (size_t i = 0; i < corpus.size(); i++) {
+        AesTestVector loaded;
+        const AesTestVector& v = vectors[i];
+        string name = "vector corpus: vector " + to_string(i) + " ";
+        check(corpus.get(i, loaded), name + "missing");
+        check(loaded.mode == v.mode && loaded.operation == v.operation && loaded.id == v.id &&
+              loaded.length == v.length, name + "fields");
+        check(memcmp(loaded.key, v.key, AES_KEY_SIZE) == 0 && memcmp(loaded.plaintext, v.plaintext, v.length) == 0 &&
+              memcmp(loaded.ciphertext, v.ciphertext, v.length) == 0, name + "data");
+        check(reinterpret_cast<uintptr_t>(loaded.plaintext) % AES_BLOCK_SIZE == 0, name + "alignment");
+        check(aes_vector_check(loaded, AesKeySchedule(loaded.key)), name + "check");
+    }
+    AesTestVector loaded;
+    check(!corpus.get(corpus.size(), loaded), "vector corpus: index out of range");
+
+    // A wrong expected text fails the check
+    uint8_t wrong[AES_BLOCK_SIZE];
+    memcpy(wrong, VECTORS[0].ciphertext, AES_BLOCK_SIZE);
+    wrong[15] ^= 1;
+    AesTestVector wrong_vector = vectors[0];
+    wrong_vector.ciphertext = wrong;
+    check(!aes_vector_check(wrong_vector, AesKeySchedule(bytes(VECTORS[0].key))), "vector corpus: bad vector passed");
+
+    // Text in the CAVP layout: fields in either order, comments, a MODE
+    // line, and CRLF line ends
+    const string text_path = path + ".rsp";
+    ofstream(text_path) << "# CAVS style\r\n[ENCRYPT]\r\n\r\n"
+                           "COUNT = 0\r\nKEY = 2B7E151628AED2A6ABF7158809CF4F3C\r\n"
+                           "PLAINTEXT = 3243f6a8885a308d313198a2e0370734\r\n"
+                           "CIPHERTEXT = 3925841d02dc09fbdc118597196a0b32\r\n\r\n"
+                           "MODE = CBC\n[DECRYPT]\n\nCOUNT = 7\nKEY = 2b7e151628aed2a6abf7158809cf4f3c\n"
+                           "CIPHERTEXT = 7649abac8119b246cee98e9b12e9197d\n"
+                           "IV = 000102030405060708090a0b0c0d0e0f\n"
+                           "PLAINTEXT = 6bc1bee22e409f96e93d7e117393172a\n";
+    AesVectorCorpusWriter import_writer;
+    size_t error_line = 0;
+    check(import_writer.open(path + ".imported") == AES_CIPHER_OK &&
+          aes_vector_import(text_path, import_writer, AesCipherMode::ECB, &error_line) == AES_CIPHER_OK &&
+          import_writer.size() == 2 && import_writer.finish() == AES_CIPHER_OK, "vector corpus: import");
+    AesVectorCorpus imported;
+    check(imported.open(path + ".imported") == AES_CIPHER_OK && imported.size() == 2, "vector corpus: open import");
+    if (imported.size() == 2) {
+        AesTestVector first;
+        AesTestVector second;
+        imported.get(0, first);
+        imported.get(1, second);
+        check(first.mode == AesCipherMode::ECB && first.id == 0 &&
+              memcmp(first.ciphertext, VECTORS[0].ciphertext, AES_BLOCK_SIZE) == 0, "vector corpus: imported ECB");
+        check(second.mode == AesCipherMode::CBC && second.operation == AesOperation::DECRYPT && second.id == 7 &&
+              memcmp(second.iv, CBC_IV, AES_BLOCK_SIZE) == 0 &&
+              aes_vector_check(second, AesKeySchedule(second.key)), "vector corpus: imported CBC");
+    }
+
+    // Export and import again: the same records, byte for byte
+    AesVectorCorpusWriter round_trip;
+    check(aes_vector_export(corpus, text_path) == AES_CIPHER_OK && round_trip.open(path + ".again") == AES_CIPHER_OK &&
+          aes_vector_import(text_path, round_trip, AesCipherMode::ECB) == AES_CIPHER_OK &&
+          round_trip.finish() == AES_CIPHER_OK, "vector corpus: export and import");
+    {
+        ifstream a(path, ios::binary);
+        ifstream b(path + ".again", ios::binary);
+        string original((istreambuf_iterator<char>(a)), istreambuf_iterator<char>());
+        string again((istreambuf_iterator<char>(b)), istreambuf_iterator<char>());
+        check(original == again, "vector corpus: export round trip differs");
+    }
+
+    // Bad hex is reported with its line number
+    ofstream(text_path) << "KEY = 000102030405060708090a0b0c0d0e0f\nPLAINTEXT = 00112233445566778899aabbccddeeff\n"
+                           "\nCIPHERTEXT = 69c4e0d86a7b0430d8cdb78070b4c5zz\n";
+    AesVectorCorpusWriter bad_writer;
+    error_line = 0;
+    check(bad_writer.open(path + ".bad") == AES_CIPHER_OK &&
+          aes_vector_import(text_path, bad_writer, AesCipherMode::ECB, &error_line) == AES_CIPHER_EINVAL &&
+          error_line == 4, "vector corpus: bad hex accepted");
+    check(aes_vector_import(path + ".missing", bad_writer, AesCipherMode::ECB) == AES_CIPHER_EIO,
+          "vector corpus: missing text file imported");
+
+    // A file from another format version, a truncated one, and one whose
+    // first record has an operation that is neither encrypt nor decrypt
+    {
+        ifstream in(path, ios::binary);
+        vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream(path + ".short", ios::binary).write(file.data(), file.size() - 1);
+        vector<char> bad_operation = file;
+        bad_operation[sizeof(AesVectorCorpusHeader) + offsetof(AesVectorRecord, operation)] = 2;
+        ofstream(path + ".badop", ios::binary).write(bad_operation.data(), bad_operation.size());
+        AesVectorCorpusHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        header.version = AES_VECTOR_CORPUS_VERSION + 1;
+        memcpy(file.data(), &header, sizeof(header));
+        ofstream(path + ".v2", ios::binary).write(file.data(), file.size());
+    }
+    AesVectorCorpus other;
+    check(other.open(path + ".v2") == AES_CIPHER_EVERSION, "vector corpus: other version opened");
+    check(other.open(path + ".short") == AES_CIPHER_EIO, "vector corpus: truncated file opened");
+    check(!other.is_open(), "vector corpus: failed open left a mapping");
+    check(other.open(path + ".badop") == AES_CIPHER_OK && !other.get(0, loaded) && other.get(1, loaded) &&
+          !other.verify(), "vector corpus: unknown operation read");
+
+    for (const char* suffix : {"", ".rsp", ".imported", ".again", ".short", ".v2", ".badop"}) {
+        remove((path + suffix).c_str());
+    }
+}
+
+static void test_incremental() {
+    const string path = "/tmp/aes_cipher_test_" + to_string(getpid()) + ".chunks";
+    AesKey data_key(bytes(VECTORS[0].key));
+    AesKey tweak_key(bytes(VECTORS[1].key));
+    mt19937 rng(47);
+    const size_t chunk_size = 4096;
+    vector<uint8_t> plain(100000);
+    for (uint8_t& b : plain) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    // CTR: a fresh encryption is one stream from nonce | 0 | 0
+    AesIncrementalCipher ctr(AesCipherMode::CTR, data_key, tweak_key, chunk_size);
+    AesChunkIndex index;
+    AesIncrementalStats stats;
+    vector<uint8_t> cipher(plain.size());
+    check(ctr.encrypt(plain.data(), cipher.data(), plain.size(), index, &stats) == AES_CIPHER_OK,
+          "incremental: CTR encrypt");
+    check(index.size() == 25 && index.plaintext_size() == plain.size() && stats.encrypted_chunks == 25 &&
+          stats.bytes_encrypted == plain.size(), "incremental: CTR index");
+    uint8_t counter[AES_BLOCK_SIZE] = {0};
+    for (int i = 0; i < 8; i++) {
+        counter[i] = static_cast<uint8_t>(index.nonce() >> (56 - 8 * i));
+    }
+    vector<uint8_t> stream(plain.size());
+    AesKeySchedule(data_key).ctr_crypt(plain.data(), stream.data(), plain.size(), counter);
+    check(stream == cipher, "incremental: CTR encryption is not one stream");
+
+    // Two bytes changed in chunks 3 and 17: only those are encrypted again,
+    // under a new generation
+    vector<uint8_t> old_cipher = cipher;
+    vector<uint8_t> old_plain = plain;
+    plain[3 * chunk_size + 100] ^= 0x01;
+    plain[17 * chunk_size + 4095] ^= 0x80;
+    check(ctr.update(plain.data(), cipher.data(), plain.size(), index, &stats) == AES_CIPHER_OK &&
+          stats.encrypted_chunks == 2 && stats.bytes_encrypted == 2 * chunk_size && stats.bytes_hashed == plain.size(),
+          "incremental: CTR update encrypted " + to_string(stats.encrypted_chunks) + " chunks");
+    check(index.generation() == 1 && index.entry(3).generation == 1 && index.entry(17).generation == 1 &&
+          index.entry(4).generation == 0, "incremental: CTR generations");
+    bool others_kept = true;
+    for (size_t i = 0; i < index.size(); i++) {
+        if (i != 3 && i != 17) {
+            size_t offset = i * chunk_size;
+            size_t n = min(chunk_size, plain.size() - offset);
+            others_kept = others_kept && memcmp(&cipher[offset], &old_cipher[offset], n) == 0;
+        }
+    }
+    check(others_kept, "incremental: unchanged chunks rewritten");
+    size_t keystream_reused = 0;
+    for (size_t j = 3 * chunk_size; j < 4 * chunk_size; j++) {
+        keystream_reused += (cipher[j] ^ plain[j]) == (old_cipher[j] ^ old_plain[j]);
+    }
+    check(keystream_reused < 64, "incremental: CTR re-encryption reused the keystream");
+    vector<uint8_t> decrypted(plain.size());
+    check(ctr.decrypt(cipher.data(), decrypted.data(), index) == AES_CIPHER_OK && decrypted == plain,
+          "incremental: CTR decrypt after update");
+
+    // Nothing changed: nothing encrypted, generation kept
+    check(ctr.update(plain.data(), cipher.data(), plain.size(), index, &stats) == AES_CIPHER_OK &&
+          stats.encrypted_chunks == 0 && index.generation() == 1, "incremental: CTR no-op update");
+
+    // Grow, then shrink: the old tail chunk and the new ones, then only the
+    // new last chunk
+    plain.resize(plain.size() + 5000, 0x5a);
+    cipher.resize(plain.size());
+    check(ctr.update(plain.data(), cipher.data(), plain.size(), index, &stats) == AES_CIPHER_OK &&
+          stats.encrypted_chunks == 2 && index.size() == 26, "incremental: CTR grow");
+    plain.resize(70000);
+    check(ctr.update(plain.data(), cipher.data(), plain.size(), index, &stats) == AES_CIPHER_OK &&
+          stats.encrypted_chunks == 1 && index.size() == 18, "incremental: CTR shrink");
+    decrypted.assign(plain.size(), 0);
+    check(ctr.decrypt(cipher.data(), decrypted.data(), index) == AES_CIPHER_OK && decrypted == plain,
+          "incremental: CTR decrypt after resize");
+
+    // Every single-byte change of a small chunk is caught
+    AesIncrementalCipher small(AesCipherMode::CTR, data_key, tweak_key, 64);
+    vector<uint8_t> small_plain(200, 0);
+    vector<uint8_t> small_cipher(200);
+    AesChunkIndex small_index;
+    small.encrypt(small_plain.data(), small_cipher.data(), small_plain.size(), small_index);
+    size_t missed = 0;
+    for (size_t j = 0; j < small_plain.size(); j++) {
+        small_plain[j] ^= 0x10;
+        small.update(small_plain.data(), small_cipher.data(), small_plain.size(), small_index, &stats);
+        missed += stats.encrypted_chunks != 1;
+    }
+    check(missed == 0, "incremental: " + to_string(missed) + " single-byte changes missed");
+
+    // Changes that cancelled out in an unkeyed lane hash: the top bit of
+    // two words 32 bytes apart, bit pairs in the same word, and whole
+    // words swapped. Each one is caught and decrypts to the new plaintext.
+    vector<uint8_t> page(chunk_size);
+    for (uint8_t& b : page) {
+        b = static_cast<uint8_t>(rng());
+    }
+    vector<vector<size_t>> flips = {{7, 39}, {7, 39, 71, 103}, {0, 32}, {4088, 4095}, {15, 31, 47, 63}};
+    for (size_t f = 0; f < flips.size(); f++) {
+        vector<uint8_t> page_cipher(page.size());
+        AesChunkIndex page_index;
+        ctr.encrypt(page.data(), page_cipher.data(), page.size(), page_index);
+        vector<uint8_t> changed = page;
+        for (size_t offset : flips[f]) {
+            changed[offset] ^= 0x80;
+        }
+        check(ctr.update(changed.data(), page_cipher.data(), changed.size(), page_index, &stats) == AES_CIPHER_OK &&
+              stats.encrypted_chunks == 1, "incremental: MSB flip set " + to_string(f) + " missed");
+        vector<uint8_t> page_plain(page.size());
+        check(ctr.decrypt(page_cipher.data(), page_plain.data(), page_index) == AES_CIPHER_OK && page_plain == changed,
+              "incremental: MSB flip set " + to_string(f) + " decrypted to the old plaintext");
+    }
+    vector<uint8_t> swapped = page;
+    swap_ranges(swapped.begin(), swapped.begin() + 16, swapped.begin() + 64);
+    AesChunkIndex page_index;
+    vector<uint8_t> page_cipher(page.size());
+    ctr.encrypt(page.data(), page_cipher.data(), page.size(), page_index);
+    check(ctr.update(swapped.data(), page_cipher.data(), swapped.size(), page_index, &stats) == AES_CIPHER_OK &&
+          stats.encrypted_chunks == 1, "incremental: swapped blocks missed");
+
+    // The PCLMULQDQ and scalar digests agree, including the tails
+    AesIncrementalCipher scalar(AesCipherMode::CTR, data_key, tweak_key, chunk_size, AesKeyKernel::SCALAR);
+    AesChunkIndex scalar_index;
+    scalar.encrypt(old_plain.data(), stream.data(), old_plain.size(), scalar_index);
+    ctr.encrypt(old_plain.data(), old_cipher.data(), old_plain.size(), page_index);
+    bool digests_match = scalar_index.size() == page_index.size();
+    for (size_t i = 0; digests_match && i < page_index.size(); i++) {
+        digests_match = memcmp(scalar_index.entry(i).digest, page_index.entry(i).digest, AES_BLOCK_SIZE) == 0;
+    }
+    check(digests_match, "incremental: scalar and PCLMULQDQ digests differ");
+
+    // XTS: the chunks are AesXts sectors; a tail under one block joins the
+    // last full chunk
+    AesIncrementalCipher xts(AesCipherMode::XTS, data_key, tweak_key, chunk_size);
+    vector<uint8_t> xts_plain(old_plain.begin(), old_plain.begin() + 8 * chunk_size);
+    vector<uint8_t> xts_cipher(xts_plain.size());
+    vector<uint8_t> sectors(xts_plain.size());
+    AesChunkIndex xts_index;
+    check(xts.encrypt(xts_plain.data(), xts_cipher.data(), xts_plain.size(), xts_index) == AES_CIPHER_OK,
+          "incremental: XTS encrypt");
+    AesXts(data_key, tweak_key).encrypt_sectors(xts_plain.data(), sectors.data(), chunk_size, 8, 0);
+    check(xts_cipher == sectors, "incremental: XTS chunks are not AesXts sectors");
+    xts_plain.resize(xts_plain.size() + 5, 0x33);
+    xts_cipher.resize(xts_plain.size());
+    check(xts.update(xts_plain.data(), xts_cipher.data(), xts_plain.size(), xts_index, &stats) == AES_CIPHER_OK &&
+          xts_index.size() == 8 && xts_index.entry(7).length == chunk_size + 5 && stats.encrypted_chunks == 1,
+          "incremental: XTS short tail");
+    decrypted.assign(xts_plain.size(), 0);
+    check(xts.decrypt(xts_cipher.data(), decrypted.data(), xts_index) == AES_CIPHER_OK && decrypted == xts_plain,
+          "incremental: XTS decrypt");
+    check(xts.encrypt(xts_plain.data(), xts_cipher.data(), 10, xts_index) == AES_CIPHER_EINVAL,
+          "incremental: XTS input under one block accepted");
+
+    // Index from another mode or chunk size
+    check(xts.update(plain.data(), cipher.data(), plain.size(), index) == AES_CIPHER_EINVAL &&
+          small.decrypt(cipher.data(), decrypted.data(), index) == AES_CIPHER_EINVAL,
+          "incremental: mismatched index accepted");
+    AesIncrementalCipher odd(AesCipherMode::CTR, data_key, tweak_key, 1000);
+    check(odd.encrypt(plain.data(), cipher.data(), plain.size(), small_index) == AES_CIPHER_EINVAL,
+          "incremental: chunk size not a multiple of 16 accepted");
+
+    // Saved and loaded, the index still decrypts
+    AesChunkIndex loaded;
+    check(index.save(path) == AES_CIPHER_OK && loaded.load(path) == AES_CIPHER_OK, "incremental: save and load");
+    decrypted.assign(plain.size(), 0);
+    check(loaded.size() == index.size() && loaded.nonce() == index.nonce() &&
+          loaded.generation() == index.generation() &&
+          ctr.decrypt(cipher.data(), decrypted.data(), loaded) == AES_CIPHER_OK && decrypted == plain,
+          "incremental: loaded index");
+
+    // Another format version, a truncated file and a flipped digest bit
+    {
+        ifstream in(path, ios::binary);
+        vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream(path + ".short", ios::binary).write(file.data(), file.size() - 1);
+        file[sizeof(AesChunkIndexHeader) + 5] ^= 1;
+        ofstream(path + ".corrupt", ios::binary).write(file.data(), file.size());
+        file[sizeof(AesChunkIndexHeader) + 5] ^= 1;
+        AesChunkIndexHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        header.version = AES_CHUNK_INDEX_VERSION + 1;
+        memcpy(file.data(), &header, sizeof(header));
+        ofstream(path + ".v2", ios::binary).write(file.data(), file.size());
+    }
+    check(loaded.load(path + ".v2") == AES_CIPHER_EVERSION, "incremental: other version loaded");
+    check(loaded.load(path + ".short") == AES_CIPHER_EIO, "incremental: truncated index loaded");
+    check(loaded.load(path + ".corrupt") == AES_CIPHER_EIO, "incremental: corrupt index loaded");
+    check(loaded.size() == index.size(), "incremental: failed load changed the index");
+
+    for (const char* suffix : {"", ".short", ".corrupt", ".v2"}) {
+        remove((path + suffix).c_str());
+    }
+}
+
+static void test_cross_check() {
+    const string path = "/tmp/aes_cipher_test_" + to_string(getpid()) + ".repro";
+    bool aesni = aes_key_kernel_supported(AesKeyKernel::AESNI);
+    mt19937 rng(48);
+    vector<uint8_t> data(64 * AES_BLOCK_SIZE);
+    for (uint8_t& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    AesKeySchedule schedule(bytes(VECTORS[0].key), AesKeyKernel::AESNI);
+    AesXts xts(AesKey(bytes(VECTORS[0].key)), AesKey(bytes(VECTORS[1].key)), AesKeyKernel::AESNI);
+    vector<uint8_t> out(data.size());
+
+    // Every block of every engine call checked and right, and nothing
+    // sampled once the checker is uninstalled
+    {
+        AesCrossCheck checker(1, path, 1 << 13);
+        checker.install();
+        check(AesCrossCheck::installed() == &checker, "cross-check: not installed");
+        for (int i = 0; i < 8; i++) {
+            schedule.encrypt_blocks(data.data(), out.data(), 64);
+            schedule.decrypt_blocks(out.data(), out.data(), 64);
+            xts.encrypt_sectors(data.data(), out.data(), 512, 2, i);
+            xts.decrypt_sectors(out.data(), out.data(), 512, 2, i);
+        }
+        AesCbcStream streams[4];
+        for (size_t i = 0; i < 4; i++) {
+            streams[i] = {&schedule, data.data() + i * 256, out.data() + i * 256, 16, {}};
+        }
+        aes_cbc_encrypt_streams(streams, 4);
+        checker.drain();
+
+        AesCrossCheckStats stats = checker.stats();
+        if (aesni) {
+            check(stats.sampled[size_t(AesCheckedEngine::BLOCKS)] >= 16, "cross-check: blocks not sampled");
+            check(stats.sampled[size_t(AesCheckedEngine::XTS)] >= 16, "cross-check: XTS not sampled");
+            check(stats.sampled[size_t(AesCheckedEngine::MULTI_BUFFER)] > 0, "cross-check: lanes not sampled");
+        }
+        check(stats.checked == stats.total_sampled() && stats.total_mismatches() == 0 && stats.dropped == 0,
+              "cross-check: engine output mismatched the reference");
+
+        checker.uninstall();
+        check(AesCrossCheck::installed() == nullptr, "cross-check: still installed");
+        schedule.encrypt_blocks(data.data(), out.data(), 64);
+        checker.drain();
+        check(checker.stats().total_sampled() == stats.total_sampled(), "cross-check: sampled after uninstall");
+    }
+    check(ifstream(path).peek() == ifstream::traits_type::eof(), "cross-check: repro written without a mismatch");
+
+    // One block in 64 per thread, in calls shorter and longer than that
+    if (aesni) {
+        AesCrossCheck checker(64);
+        checker.install();
+        thread([&]() {
+            for (size_t done = 0; done < 6400; done += 5) {
+                schedule.encrypt_blocks(data.data(), out.data(), 5);
+            }
+        }).join();
+        checker.drain();
+        check(checker.stats().sampled[size_t(AesCheckedEngine::BLOCKS)] == 100, "cross-check: 1 in 64 sampling");
+        uint64_t before = checker.stats().total_sampled();
+        thread([&]() {
+            for (int i = 0; i < 10; i++) {
+                schedule.encrypt_blocks(data.data(), out.data(), 64);
+            }
+        }).join();
+        checker.drain();
+        check(checker.stats().total_sampled() - before == 10, "cross-check: one sample per 64-block call");
+    }
+
+    // Calls longer than the rate give a sample every rate blocks, and the
+    // XTS tweaks of the later ones still match the reference
+    if (aesni) {
+        AesCrossCheck checker(16);
+        checker.install();
+        thread([&]() {
+            for (int i = 0; i < 10; i++) {
+                schedule.encrypt_blocks(data.data(), out.data(), 64);
+            }
+        }).join();
+        checker.drain();
+        check(checker.stats().sampled[size_t(AesCheckedEngine::BLOCKS)] == 40,
+              "cross-check: 1 in 16 within 64-block calls");
+        thread([&]() { xts.encrypt_sectors(data.data(), out.data(), 512, 2, 7); }).join();
+        checker.drain();
+        AesCrossCheckStats stats = checker.stats();
+        check(stats.sampled[size_t(AesCheckedEngine::XTS)] == 4 && stats.total_mismatches() == 0,
+              "cross-check: XTS samples within a sector");
+    }
+
+    // A queue of two under four threads: every block is sampled or dropped,
+    // and drain returns even when the last claim was a dropped one
+    if (aesni) {
+        AesCrossCheck checker(1, "", 2);
+        checker.install();
+        vector<thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&]() {
+                vector<uint8_t> buffer(data.size());
+                for (int i = 0; i < 200; i++) {
+                    schedule.encrypt_blocks(data.data(), buffer.data(), 64);
+                }
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+        checker.drain();
+        AesCrossCheckStats stats = checker.stats();
+        check(stats.total_sampled() + stats.dropped == 4 * 200 * 64 && stats.checked == stats.total_sampled() &&
+              stats.total_mismatches() == 0, "cross-check: full queue accounting");
+    }
+
+    // Checkers installed and destroyed while other threads are inside the
+    // engines: each destructor waits for the calls holding it
+    {
+        atomic<bool> stop{false};
+        vector<thread> threads;
+        for (int t = 0; t < 2; t++) {
+            threads.emplace_back([&]() {
+                vector<uint8_t> buffer(data.size());
+                while (!stop.load()) {
+                    schedule.encrypt_blocks(data.data(), buffer.data(), 64);
+                    xts.encrypt_sectors(data.data(), buffer.data(), 512, 2, 0);
+                }
+            });
+        }
+        for (int i = 0; i < 50; i++) {
+            AesCrossCheck checker(1 + i % 3);
+            checker.install();
+            this_thread::sleep_for(chrono::microseconds(200));
+            if (i % 2) {
+                AesCrossCheck replacement(1);
+                replacement.install();
+            }
+        }
+        stop.store(true);
+        for (thread& worker : threads) {
+            worker.join();
+        }
+        check(AesCrossCheck::installed() == nullptr, "cross-check: destroyed checker still installed");
+    }
+
+    // A wrong result is counted and written as a vector that replays it
+    {
+        AesCrossCheck checker(1, path);
+        uint8_t wrong[AES_BLOCK_SIZE];
+        memcpy(wrong, VECTORS[1].ciphertext, AES_BLOCK_SIZE);
+        wrong[3] ^= 0x10;
+        checker.submit(AesCheckedEngine::XTS, AesOperation::ENCRYPT, bytes(VECTORS[1].key),
+                       bytes(VECTORS[1].plaintext), wrong);
+        checker.submit(AesCheckedEngine::BLOCKS, AesOperation::DECRYPT, bytes(VECTORS[0].key),
+                       bytes(VECTORS[0].ciphertext), bytes(VECTORS[0].ciphertext));
+        checker.submit(AesCheckedEngine::BLOCKS, AesOperation::ENCRYPT, bytes(VECTORS[0].key),
+                       bytes(VECTORS[0].plaintext), bytes(VECTORS[0].ciphertext));
+        checker.drain();
+        AesCrossCheckStats stats = checker.stats();
+        check(stats.checked == 3 && stats.mismatches[size_t(AesCheckedEngine::XTS)] == 1 &&
+              stats.mismatches[size_t(AesCheckedEngine::BLOCKS)] == 1 && stats.repro_errors == 0,
+              "cross-check: mismatches not counted");
+    }
+    AesVectorCorpusWriter writer;
+    check(writer.open(path + ".vectors") == AES_CIPHER_OK &&
+          aes_vector_import(path, writer, AesCipherMode::ECB) == AES_CIPHER_OK && writer.finish() == AES_CIPHER_OK,
+          "cross-check: repro file does not import");
+    AesVectorCorpus corpus;
+    AesTestVector vector;
+    check(corpus.open(path + ".vectors") == AES_CIPHER_OK && corpus.size() == 2, "cross-check: repro records");
+    for (size_t i = 0; i < corpus.size() && corpus.get(i, vector); i++) {
+        check(aes_vector_check(vector, AesKeySchedule(vector.key)), "cross-check: repro " + to_string(i));
+    }
+    check(corpus.get(0, vector) && memcmp(vector.ciphertext, VECTORS[1].ciphertext, AES_BLOCK_SIZE) == 0,
+          "cross-check: repro holds the reference output");
+
+    // A checker on an unwritable path still counts
+    {
+        AesCrossCheck checker(1, "/nonexistent/aes_cipher_test.repro");
+        checker.submit(AesCheckedEngine::BLOCKS, AesOperation::ENCRYPT, bytes(VECTORS[0].key),
+                       bytes(VECTORS[0].plaintext), bytes(VECTORS[0].plaintext));
+        checker.drain();
+        check(checker.stats().total_mismatches() == 1 && checker.stats().repro_errors == 1,
+              "cross-check: unwritable repro file");
+    }
+
+    corpus.close();
+    remove(path.c_str());
+    remove((path + ".vectors").c_str());
+}
+
+int main() {
+    cout << "Starting AES cipher library tests..." << endl;
+
+    test_c_api();
+    test_kernels();
+    test_batch_schedules();
+    test_key_batch();
+    test_threads();
+    test_xts_vectors();
+    test_xts_kernels();
+    test_xts_parallel();
+    test_chaining_modes();
+    test_cmac_vectors();
+    test_multi_buffer();
+    test_scatter_gather();
+    test_key_store();
+    test_ctr_drbg();
+    test_hex();
+    test_vector_corpus();
+    test_incremental();
+    test_cross_check();
+    test_job_ring();
+    test_job_ring_full();
+    test_job_ring_partial_reap();
+#ifdef AES_JOB_RING_COROUTINES
+    test_job_ring_coroutines();
+#endif
+
+    if (failures == 0) {
+        cout << "All tests completed successfully!" << endl;
+        return 0;
+    }
+    cout << failures << " check(s) failed" << endl;
+    return 1;
+}
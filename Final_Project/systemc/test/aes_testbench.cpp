@@ -1,10 +1,13 @@
 #include "../include/aes_types.h"
+#include "../include/aes_hex.h"
 #include "../include/aes_sbox.h"
 #include "../include/aes_shift_rows.h"
 #include "../include/aes_mix_columns.h"
 #include "../include/aes_key_expansion.h"
 #include "../include/aes_round.h"
 #include "../include/aes_top.h"
+#include "../include/aes_workload.h"
+#include "../include/aes_sampled_replay.h"
 #include <systemc>
 #include <iostream>
 #include <iomanip>
@@ -15,25 +18,20 @@
 using namespace sc_core;
 using namespace std;
 
-// Utility function to convert hex string to bytes
+// Utility function to convert hex string to bytes (empty if it is not hex)
 vector<uint8_t> hex_to_bytes(const string& hex) {
-    vector<uint8_t> bytes;
-    for (size_t i = 0; i < hex.length(); i += 2) {
-        string byteString = hex.substr(i, 2);
-        uint8_t byte = static_cast<uint8_t>(strtol(byteString.c_str(), nullptr, 16));
-        bytes.push_back(byte);
+    vector<uint8_t> bytes(hex.length() / 2);
+    if (!aes_hex_decode(hex.data(), hex.length(), bytes.data())) {
+        bytes.clear();
     }
     return bytes;
 }
 
 // Utility function to convert bytes to hex string
 string bytes_to_hex(const vector<uint8_t>& bytes) {
-    stringstream ss;
-    ss << hex << setfill('0');
-    for (uint8_t byte : bytes) {
-        ss << setw(2) << static_cast<int>(byte);
-    }
-    return ss.str();
+    string hex(2 * bytes.size(), '0');
+    aes_hex_encode(bytes.data(), bytes.size(), &hex[0]);
+    return hex;
 }
 
 // Testbench module
@@ -42,8 +40,11 @@ public:
     // TLM initiator socket for connecting to the AES top module
     tlm_utils::simple_initiator_socket<AesTestbench> init_socket;
     
+    // TLM initiator socket driving a round module directly
+    tlm_utils::simple_initiator_socket<AesTestbench> round_socket;
+    
     SC_HAS_PROCESS(AesTestbench);
-    AesTestbench(sc_module_name name) : sc_module(name), init_socket("init_socket") {
+    AesTestbench(sc_module_name name) : sc_module(name), init_socket("init_socket"), round_socket("round_socket") {
         SC_THREAD(run_tests);
     }
     
@@ -85,7 +86,12 @@ public:
             AesMode::PIPELINED
         );
         
-        cout << "All tests completed successfully!" << endl;
+        // Scatter-gather chains, in place
+        test_scatter_gather("000102030405060708090a0b0c0d0e0f", AesMode::NON_PIPELINED);
+        test_scatter_gather("2b7e151628aed2a6abf7158809cf4f3c", AesMode::PIPELINED);
+        
+        // Round transactions alternating between two keys
+        test_round_module("000102030405060708090a0b0c0d0e0f", "2b7e151628aed2a6abf7158809cf4f3c");
     }
     
     void test_aes_encryption(const string& plaintext_hex, const string& key_hex, 
@@ -94,6 +100,11 @@ public:
         vector<uint8_t> plaintext_bytes = hex_to_bytes(plaintext_hex);
         vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
         vector<uint8_t> expected_ciphertext_bytes = hex_to_bytes(expected_ciphertext_hex);
+        if (plaintext_bytes.size() != AES_BLOCK_SIZE || key_bytes.size() != AES_KEY_SIZE ||
+            expected_ciphertext_bytes.size() != AES_BLOCK_SIZE) {
+            SC_REPORT_ERROR("AesTestbench", "Encryption test vector is not 16-byte hex");
+            return;
+        }
         
         // Create AES block and key
         AesBlock plaintext;
@@ -157,12 +168,159 @@ public:
         trans.release_extension(ext);
     }
     
+    void test_scatter_gather(const string& key_hex, AesMode mode) {
+        vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
+        if (key_bytes.size() != AES_KEY_SIZE) {
+            SC_REPORT_ERROR("AesTestbench", "Scatter-gather key is not 16-byte hex");
+            return;
+        }
+        AesKey key;
+        for (int i = 0; i < AES_KEY_SIZE; i++) {
+            key.key[i] = key_bytes[i];
+        }
+        
+        // Three blocks over four segments: the first block straddles two,
+        // the second spans one whole and the third follows an empty one
+        vector<uint8_t> buffer(3 * AES_BLOCK_SIZE);
+        for (size_t i = 0; i < buffer.size(); i++) {
+            buffer[i] = static_cast<uint8_t>(i * 7);
+        }
+        const vector<uint8_t> plaintext = buffer;
+        struct iovec segments[] = {
+            {buffer.data(), 5}, {buffer.data() + 5, 27}, {buffer.data() + 32, 0}, {buffer.data() + 32, 16}
+        };
+        
+        AesRoundKeys round_keys;
+        AesKeyExpansion::expand_key(key, round_keys);
+        vector<uint8_t> expected(buffer.size());
+        for (size_t b = 0; b < 3; b++) {
+            AesBlock block = AesCipher::encrypt_block(AesBlock(&plaintext[b * AES_BLOCK_SIZE]), round_keys);
+            copy(block.data.begin(), block.data.end(), expected.begin() + b * AES_BLOCK_SIZE);
+        }
+        
+        if (send_segments(segments, 4, buffer.size(), key, AesOperation::ENCRYPT, mode) != tlm::TLM_OK_RESPONSE ||
+            buffer != expected) {
+            SC_REPORT_ERROR("AesTestbench", "Scatter-gather encryption mismatch");
+            return;
+        }
+        if (send_segments(segments, 4, buffer.size(), key, AesOperation::DECRYPT, mode) != tlm::TLM_OK_RESPONSE ||
+            buffer != plaintext) {
+            SC_REPORT_ERROR("AesTestbench", "Scatter-gather decryption mismatch");
+            return;
+        }
+        
+        // A chain that ends in a partial block is refused untouched
+        if (send_segments(segments, 2, 32 - 3, key, AesOperation::ENCRYPT, mode) != tlm::TLM_BURST_ERROR_RESPONSE ||
+            buffer != plaintext) {
+            SC_REPORT_ERROR("AesTestbench", "Scatter-gather accepted a partial block");
+            return;
+        }
+        
+        // So is a missing segment array or a non-empty segment without a base
+        struct iovec null_base[] = {{buffer.data(), 16}, {nullptr, 16}};
+        if (send_segments(nullptr, 2, 32, key, AesOperation::ENCRYPT, mode) != tlm::TLM_GENERIC_ERROR_RESPONSE ||
+            send_segments(null_base, 2, 32, key, AesOperation::ENCRYPT, mode) != tlm::TLM_GENERIC_ERROR_RESPONSE ||
+            buffer != plaintext) {
+            SC_REPORT_ERROR("AesTestbench", "Scatter-gather accepted an invalid chain");
+            return;
+        }
+        
+        cout << "Scatter-gather test passed for mode " << (mode == AesMode::PIPELINED ? "PIPELINED" : "NON_PIPELINED") << endl;
+        cout << endl;
+    }
+    
+    void test_round_module(const string& key_a_hex, const string& key_b_hex) {
+        vector<uint8_t> key_a_bytes = hex_to_bytes(key_a_hex);
+        vector<uint8_t> key_b_bytes = hex_to_bytes(key_b_hex);
+        if (key_a_bytes.size() != AES_KEY_SIZE || key_b_bytes.size() != AES_KEY_SIZE) {
+            SC_REPORT_ERROR("AesTestbench", "Round module key is not 16-byte hex");
+            return;
+        }
+        AesKey keys[2] = {AesKey(key_a_bytes.data()), AesKey(key_b_bytes.data())};
+        AesRoundKeys round_keys[2];
+        AesKeyExpansion::expand_key(keys[0], round_keys[0]);
+        AesKeyExpansion::expand_key(keys[1], round_keys[1]);
+        
+        // Every round under one key, then the other, so the module's key
+        // schedule has to follow each change of key
+        for (AesOperation operation : {AesOperation::ENCRYPT, AesOperation::DECRYPT}) {
+            for (int round = 0; round <= AES_NUM_ROUNDS; round++) {
+                for (int k = 0; k < 2; k++) {
+                    AesBlock block(round_keys[1 - k].round_keys[round].data.data());
+                    AesBlock expected = (operation == AesOperation::ENCRYPT) ?
+                        AesRound::encrypt_round(block, round_keys[k].round_keys[round], round == AES_NUM_ROUNDS) :
+                        AesRound::decrypt_round(block, round_keys[k].round_keys[round], round == 0);
+                    
+                    tlm::tlm_generic_payload trans;
+                    sc_time delay = sc_time(0, SC_NS);
+                    trans.set_command(tlm::TLM_WRITE_COMMAND);
+                    trans.set_data_ptr(reinterpret_cast<unsigned char*>(&block));
+                    trans.set_data_length(sizeof(AesBlock));
+                    trans.set_streaming_width(sizeof(AesBlock));
+                    trans.set_byte_enable_ptr(nullptr);
+                    trans.set_dmi_allowed(false);
+                    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+                    
+                    AesExtension* ext = new AesExtension();
+                    ext->operation = operation;
+                    ext->key = keys[k];
+                    ext->round_index = round;
+                    trans.set_extension(ext);
+                    round_socket->b_transport(trans, delay);
+                    trans.release_extension(ext);
+                    
+                    if (trans.is_response_error() || !(block == expected)) {
+                        cout << "Round " << round << " failed under key " << keys[k].to_string() << endl;
+                        SC_REPORT_ERROR("AesTestbench", "Round result mismatch");
+                        return;
+                    }
+                }
+            }
+        }
+        
+        cout << "Round module test passed with alternating keys" << endl;
+        cout << endl;
+    }
+    
+    tlm::tlm_response_status send_segments(const struct iovec* segments, size_t count, size_t length,
+                                           const AesKey& key, AesOperation operation, AesMode mode) {
+        tlm::tlm_generic_payload trans;
+        sc_time delay = sc_time(0, SC_NS);
+        
+        trans.set_command(tlm::TLM_WRITE_COMMAND);
+        trans.set_data_ptr(segments && count > 0 ? static_cast<unsigned char*>(segments[0].iov_base) : nullptr);
+        trans.set_data_length(length);
+        trans.set_streaming_width(length);
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+        
+        AesExtension* ext = new AesExtension();
+        ext->operation = operation;
+        ext->mode = mode;
+        ext->key = key;
+        trans.set_extension(ext);
+        AesScatterGatherExtension* sg = new AesScatterGatherExtension(segments, count);
+        trans.set_extension(sg);
+        
+        init_socket->b_transport(trans, delay);
+        
+        trans.release_extension(ext);
+        trans.release_extension(sg);
+        return trans.get_response_status();
+    }
+    
     void test_aes_decryption(const string& ciphertext_hex, const string& key_hex, 
                             const string& expected_plaintext_hex, AesMode mode = AesMode::NON_PIPELINED) {
         // Convert hex strings to bytes
         vector<uint8_t> ciphertext_bytes = hex_to_bytes(ciphertext_hex);
         vector<uint8_t> key_bytes = hex_to_bytes(key_hex);
         vector<uint8_t> expected_plaintext_bytes = hex_to_bytes(expected_plaintext_hex);
+        if (ciphertext_bytes.size() != AES_BLOCK_SIZE || key_bytes.size() != AES_KEY_SIZE ||
+            expected_plaintext_bytes.size() != AES_BLOCK_SIZE) {
+            SC_REPORT_ERROR("AesTestbench", "Decryption test vector is not 16-byte hex");
+            return;
+        }
         
         // Create AES block and key
         AesBlock ciphertext;
@@ -227,6 +385,45 @@ public:
     }
 };
 
+// Passes transactions through to the engine and keeps the latest time a
+// result came back, to check the replayer's own account against
+class AesCompletionProbe : public sc_module {
+public:
+    tlm_utils::simple_target_socket<AesCompletionProbe> in_socket;
+    tlm_utils::simple_initiator_socket<AesCompletionProbe> out_socket;
+    sc_time last_done;
+
+    AesCompletionProbe(sc_module_name name) : sc_module(name), in_socket("in_socket"), out_socket("out_socket") {
+        in_socket.register_b_transport(this, &AesCompletionProbe::b_transport);
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        out_socket->b_transport(trans, delay);
+        if (last_done < sc_time_stamp() + delay) {
+            last_done = sc_time_stamp() + delay;
+        }
+    }
+};
+
+// A full-sampling replay measures every unit, so its estimate must be the
+// simulated time itself, with a zero interval
+static bool check_full_sampling(const AesSampledReplayer& replayer, const AesCompletionProbe& probe,
+                                uint64_t requests, uint64_t unit_requests) {
+    AesSamplingEstimate e = replayer.estimate();
+    double exact_ns = probe.last_done.to_seconds() * 1e9;
+    bool passed = replayer.passed() && e.requests == requests && e.detailed_requests == requests &&
+                  e.units == (requests + unit_requests - 1) / unit_requests && e.total_ci_ns == 0.0 &&
+                  e.latency_ci_ns == 0.0 && fabs(e.total_ns - exact_ns) <= 1e-6 * exact_ns && !e.few_units();
+    if (!passed) {
+        cout << "Full sampling: " << e.units << " units, " << e.total_ns << " ns +- " << e.total_ci_ns
+             << ", simulated " << exact_ns << " ns" << endl;
+        SC_REPORT_ERROR("AesTestbench", "Full sampling is not exact");
+        return false;
+    }
+    cout << "Full sampling test passed: " << e.units << " units, " << e.total_ns << " ns, zero interval" << endl;
+    return true;
+}
+
 // Main function
 int sc_main(int argc, char* argv[]) {
     // Create modules
@@ -234,14 +431,44 @@ int sc_main(int argc, char* argv[]) {
     AesTop aes_top("aes_top");
     AesKeyExpansion key_expansion("key_expansion");
     AesRound aes_round("aes_round");
+    AesRound direct_round("direct_round");
     
     // Connect modules
     testbench.init_socket.bind(aes_top.top_socket);
     aes_top.key_expansion_socket.bind(key_expansion.key_socket);
     aes_top.round_socket.bind(aes_round.round_socket);
+    testbench.round_socket.bind(direct_round.round_socket);
+    
+    // A sampled replay with every unit measured, on a core of its own: 150
+    // requests of 1-24 blocks under three keys, 40 ns apart, over two
+    // passes, in units of 40 so the last one is short
+    AesWorkloadTrace trace;
+    for (uint32_t i = 0; i < 150; i++) {
+        AesWorkloadRecord r;
+        r.arrival_ps = i * 40000;
+        r.blocks = 1 + (i * 7) % 24;
+        r.key_id = i % 3;
+        r.operation = (i % 4 == 3) ? AesOperation::DECRYPT : AesOperation::ENCRYPT;
+        r.mode = (i % 2) ? AesMode::PIPELINED : AesMode::NON_PIPELINED;
+        trace.records.push_back(r);
+    }
+    AesTop replay_top("replay_top");
+    AesKeyExpansion replay_key_expansion("replay_key_expansion");
+    AesRound replay_round("replay_round");
+    AesCompletionProbe probe("probe");
+    AesSampledReplayer replayer("replayer", trace, 2, 1.0, AesSamplingConfig::full(40));
+    replayer.init_socket.bind(probe.in_socket);
+    probe.out_socket.bind(replay_top.top_socket);
+    replay_top.key_expansion_socket.bind(replay_key_expansion.key_socket);
+    replay_top.round_socket.bind(replay_round.round_socket);
     
     // Start simulation
     sc_start();
     
+    // Failures in run_tests stop the simulation, so only the replay is left
+    if (!check_full_sampling(replayer, probe, 300, 40)) {
+        return 1;
+    }
+    cout << "All tests completed successfully!" << endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef ASYNC_FIFO_MODEL_H
+#define ASYNC_FIFO_MODEL_H
+
+#include "mem_types.h"
+#include <systemc>
+#include <deque>
+
+// Counters collected by an asynchronous FIFO
+struct AsyncFifoStats {
+    uint64_t writes = 0;
+    uint64_t reads = 0;
+    uint64_t full_cycles = 0;   // Write-clock cycles a writer waited on wr_full
+    uint64_t empty_cycles = 0;  // Read-clock cycles a reader waited on rd_empty
+    size_t max_occupancy = 0;   // Highest number of entries actually stored
+    size_t max_writer_occupancy = 0;  // Highest occupancy the write side saw, counting
+                                      // freed slots still in the synchronizer
+};
+
+// Timing model of async_fifo.v. Both sides see the other side's pointer
+// through a sync_stages-deep Gray-code synchronizer, so:
+//  - an entry written on a write-clock edge becomes visible to the reader
+//    (rd_empty low) sync_stages read-clock edges later, and the reader can
+//    act on it on the following edge
+//  - a slot freed on a read-clock edge is likewise only seen as free by the
+//    writer sync_stages write-clock edges later
+// Callers are clocked threads: they call the wait_* methods on their own
+// clock edges and push/pop on the edge the RTL asserts wr_en/rd_en.
+template <typename T>
+class AsyncFifoModel : public sc_core::sc_module {
+public:
+    AsyncFifoModel(sc_core::sc_module_name name,
+                   unsigned depth,
+                   const sc_core::sc_time& wr_period,
+                   const sc_core::sc_time& rd_period,
+                   unsigned sync_stages = 2) :
+        sc_core::sc_module(name),
+        m_depth(depth),
+        m_wr_period(wr_period),
+        m_rd_period(rd_period),
+        m_sync_stages(sync_stages),
+        m_writer_occupancy(0) {
+
+        // The Gray-code pointers only work for power-of-two depths
+        if (depth == 0 || (depth & (depth - 1)) != 0) {
+            SC_REPORT_ERROR("AsyncFifoModel", "Depth must be a power of two");
+        }
+    }
+
+    // Block the calling writer until it sees wr_full low
+    void wait_writable() {
+        sc_core::sc_time start = sc_core::sc_time_stamp();
+        while (writer_sees_full()) {
+            if (!m_pending_frees.empty()) {
+                wait(m_pending_frees.front() - sc_core::sc_time_stamp());
+            } else {
+                wait(m_popped);
+            }
+        }
+        m_stats.full_cycles += mem_cycles(sc_core::sc_time_stamp() - start, m_wr_period);
+    }
+
+    // Store an entry on the current write-clock edge
+    void push(const T& item) {
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        Entry entry;
+        entry.item = item;
+        entry.ready = mem_clock_edge_after(now, m_rd_period) +
+                      m_rd_period * static_cast<double>(m_sync_stages);
+        m_entries.push_back(entry);
+
+        m_writer_occupancy++;
+        m_stats.writes++;
+        m_stats.max_writer_occupancy = std::max(m_stats.max_writer_occupancy, m_writer_occupancy);
+        m_stats.max_occupancy = std::max(m_stats.max_occupancy, m_entries.size());
+        m_pushed.notify(sc_core::SC_ZERO_TIME);
+    }
+
+    // Block the calling reader until it sees rd_empty low
+    void wait_readable() {
+        sc_core::sc_time start = sc_core::sc_time_stamp();
+        while (!readable()) {
+            if (!m_entries.empty()) {
+                wait(m_entries.front().ready - sc_core::sc_time_stamp());
+            } else {
+                wait(m_pushed);
+            }
+        }
+        m_stats.empty_cycles += mem_cycles(sc_core::sc_time_stamp() - start, m_rd_period);
+    }
+
+    // Remove the oldest entry on the current read-clock edge
+    T pop() {
+        if (!readable()) {
+            SC_REPORT_ERROR("AsyncFifoModel", "Read while empty");
+        }
+        T item = m_entries.front().item;
+        m_entries.pop_front();
+
+        m_pending_frees.push_back(mem_clock_edge_after(sc_core::sc_time_stamp(), m_wr_period) +
+                                  m_wr_period * static_cast<double>(m_sync_stages));
+        m_stats.reads++;
+        m_popped.notify(sc_core::SC_ZERO_TIME);
+        return item;
+    }
+
+    // rd_empty as seen on the current read-clock edge
+    bool readable() const {
+        return !m_entries.empty() && m_entries.front().ready <= sc_core::sc_time_stamp();
+    }
+
+    // Accessors
+    unsigned depth() const { return m_depth; }
+    size_t size() const { return m_entries.size(); }
+    const AsyncFifoStats& stats() const { return m_stats; }
+
+private:
+    struct Entry {
+        T item;
+        sc_core::sc_time ready;  // First read-clock edge that sees rd_empty low
+    };
+
+    unsigned m_depth;
+    sc_core::sc_time m_wr_period;
+    sc_core::sc_time m_rd_period;
+    unsigned m_sync_stages;
+
+    std::deque<Entry> m_entries;
+    std::deque<sc_core::sc_time> m_pending_frees;  // When freed slots reach the write side
+    size_t m_writer_occupancy;                     // Occupancy as the write side sees it
+
+    sc_core::sc_event m_pushed;
+    sc_core::sc_event m_popped;
+
+    AsyncFifoStats m_stats;
+
+    // wr_full as seen on the current write-clock edge
+    bool writer_sees_full() {
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        while (!m_pending_frees.empty() && m_pending_frees.front() <= now) {
+            m_pending_frees.pop_front();
+            m_writer_occupancy--;
+        }
+        return m_writer_occupancy >= m_depth;
+    }
+};
+
+#endif // ASYNC_FIFO_MODEL_H
@@ -0,0 +1,76 @@
+#ifndef BRAM_MODEL_H
+#define BRAM_MODEL_H
+
+#include "mem_types.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_target_socket.h>
+#include <array>
+
+// TLM model of BRAM_Module.v: 256 x 8 bits, one single-byte access per
+// transaction. The RTL raises op_done one clock after wr_en/rd_en
+// (latency_cycles = 1); larger values model a slower or pipelined memory.
+class BramModel : public sc_core::sc_module {
+public:
+    // TLM socket for the memory controller
+    tlm_utils::simple_target_socket<BramModel> bram_socket;
+
+    // Constructor
+    SC_HAS_PROCESS(BramModel);
+    BramModel(sc_core::sc_module_name name,
+              sc_core::sc_time clock_period = mem_clock_period(MEM_CTRL_CLOCK_MHZ),
+              unsigned latency_cycles = 1) :
+        sc_core::sc_module(name),
+        bram_socket("bram_socket"),
+        m_clock_period(clock_period),
+        m_latency_cycles(latency_cycles) {
+
+        if (latency_cycles == 0) {
+            SC_REPORT_ERROR("BramModel", "Latency must be at least one cycle");
+        }
+
+        // Same preload as the RTL initial block
+        for (unsigned addr = 0; addr < MEM_BRAM_DEPTH; addr++) {
+            m_mem[addr] = mem_bram_initial_value(addr);
+        }
+
+        // Register callback for incoming transactions
+        bram_socket.register_b_transport(this, &BramModel::b_transport);
+    }
+
+    // TLM blocking transport method
+    void b_transport(tlm::tlm_generic_payload& trans, sc_core::sc_time& delay) {
+        uint64_t addr = trans.get_address();
+        unsigned char* ptr = trans.get_data_ptr();
+
+        if (addr >= MEM_BRAM_DEPTH) {
+            trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.get_data_length() != 1) {
+            trans.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+            return;
+        }
+
+        if (trans.is_write()) {
+            m_mem[addr] = ptr[0];
+        } else {
+            ptr[0] = m_mem[addr];
+        }
+
+        // Time until op_done is raised
+        delay += m_clock_period * static_cast<double>(m_latency_cycles);
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+    // Accessors
+    unsigned latency_cycles() const { return m_latency_cycles; }
+    uint8_t peek(unsigned addr) const { return m_mem[addr % MEM_BRAM_DEPTH]; }
+
+private:
+    sc_core::sc_time m_clock_period;
+    unsigned m_latency_cycles;
+    std::array<uint8_t, MEM_BRAM_DEPTH> m_mem;
+};
+
+#endif // BRAM_MODEL_H
@@ -0,0 +1,156 @@
+#ifndef MEM_BURST_MASTER_H
+#define MEM_BURST_MASTER_H
+
+#include "mem_types.h"
+#include "async_fifo_model.h"
+#include "mem_load_generator.h"
+#include <systemc>
+#include <array>
+#include <deque>
+#include <random>
+
+// Deterministic on/off traffic: a burst of burst_length requests on
+// consecutive master clocks, with bursts starting at fixed intervals so
+// that the average rate is offered_ops_per_sec
+struct MemBurstProfile {
+    uint64_t num_ops = 10000;
+    unsigned burst_length = 16;
+    double offered_ops_per_sec = 8e6;
+    double read_fraction = 0.5;
+    unsigned seed = 460;
+};
+
+// Master clocked by the write-side sc_clock. Like MemLoadGenerator it never
+// waits for read data before issuing, and it checks every read against a
+// shadow copy of the BRAM. Because the arrivals are periodic rather than
+// random, a run either stalls on the command FIFO or it does not, which is
+// what FIFO sizing needs.
+class MemBurstMaster : public sc_core::sc_module {
+public:
+    sc_core::sc_in<bool> clk;
+
+    // Constructor
+    SC_HAS_PROCESS(MemBurstMaster);
+    MemBurstMaster(sc_core::sc_module_name name,
+                   const MemBurstProfile& profile,
+                   AsyncFifoModel<MemCommand>& cmd_fifo,
+                   AsyncFifoModel<MemResponse>& resp_fifo) :
+        sc_core::sc_module(name),
+        clk("clk"),
+        m_profile(profile),
+        m_cmd_fifo(cmd_fifo),
+        m_resp_fifo(resp_fifo),
+        m_rng(profile.seed),
+        m_issue_done(false),
+        m_done(false) {
+
+        for (unsigned addr = 0; addr < MEM_BRAM_DEPTH; addr++) {
+            m_shadow[addr] = mem_bram_initial_value(addr);
+        }
+
+        SC_THREAD(issue);
+        SC_THREAD(collect);
+    }
+
+    // Accessors
+    const MemBurstProfile& profile() const { return m_profile; }
+    const MemLoadStats& stats() const { return m_stats; }
+    bool done() const { return m_done; }
+    const sc_core::sc_event& done_event() const { return m_done_event; }
+
+private:
+    MemBurstProfile m_profile;
+    AsyncFifoModel<MemCommand>& m_cmd_fifo;
+    AsyncFifoModel<MemResponse>& m_resp_fifo;
+
+    std::mt19937 m_rng;
+    std::array<uint8_t, MEM_BRAM_DEPTH> m_shadow;
+    std::deque<uint8_t> m_expected;   // Predicted data of outstanding reads
+    bool m_issue_done;
+    bool m_done;
+    sc_core::sc_event m_read_issued;
+    sc_core::sc_event m_done_event;
+
+    MemLoadStats m_stats;
+
+    // Command side: one request per clock within a burst
+    void issue() {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        sc_core::sc_time interval(m_profile.burst_length / m_profile.offered_ops_per_sec, sc_core::SC_SEC);
+        sc_core::sc_time burst_start = sc_core::SC_ZERO_TIME;
+        bool on_edge = false;  // wr_en can stay high from the previous push
+
+        for (uint64_t i = 0; i < m_profile.num_ops; i++) {
+            // Idle until the burst is due; a burst that is still stalled
+            // when the next one is due delays it
+            if (i % m_profile.burst_length == 0) {
+                if (i > 0) {
+                    burst_start += interval;
+                }
+                if (sc_core::sc_time_stamp() < burst_start) {
+                    wait(burst_start - sc_core::sc_time_stamp());
+                    on_edge = false;
+                }
+            }
+
+            MemCommand cmd;
+            cmd.write = unit(m_rng) >= m_profile.read_fraction;
+            cmd.address = static_cast<uint8_t>(m_rng() % MEM_BRAM_DEPTH);
+            cmd.data = static_cast<uint8_t>(m_rng());
+            cmd.id = i;
+            cmd.arrival = std::max(burst_start, sc_core::sc_time_stamp());
+            if (i == 0) {
+                m_stats.first_arrival = cmd.arrival;
+            }
+            m_stats.last_arrival = cmd.arrival;
+
+            // wr_en goes out on a clock edge once wr_full is seen low, and
+            // the FIFO stores the word on the next edge
+            if (!on_edge) {
+                wait(clk.posedge_event());
+            }
+            m_cmd_fifo.wait_writable();
+            wait(clk.posedge_event());
+            m_cmd_fifo.push(cmd);
+            on_edge = true;
+            m_stats.issued++;
+
+            if (cmd.write) {
+                m_shadow[cmd.address] = cmd.data;
+            } else {
+                m_expected.push_back(m_shadow[cmd.address]);
+                m_read_issued.notify(sc_core::SC_ZERO_TIME);
+            }
+        }
+
+        m_issue_done = true;
+        m_read_issued.notify(sc_core::SC_ZERO_TIME);
+    }
+
+    // Response side: pop read data on the edge rd_empty is seen low
+    void collect() {
+        while (true) {
+            while (m_expected.empty()) {
+                if (m_issue_done) {
+                    m_done = true;
+                    m_done_event.notify(sc_core::SC_ZERO_TIME);
+                    return;
+                }
+                wait(m_read_issued);
+            }
+
+            wait(clk.posedge_event());
+            m_resp_fifo.wait_readable();
+            MemResponse resp = m_resp_fifo.pop();
+
+            m_stats.last_response = sc_core::sc_time_stamp();
+            m_stats.reads_checked++;
+            if (resp.data != m_expected.front()) {
+                m_stats.data_errors++;
+            }
+            m_expected.pop_front();
+        }
+    }
+};
+
+#endif // MEM_BURST_MASTER_H
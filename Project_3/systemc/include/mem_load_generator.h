@@ -0,0 +1,202 @@
+#ifndef MEM_LOAD_GENERATOR_H
+#define MEM_LOAD_GENERATOR_H
+
+#include "mem_types.h"
+#include "async_fifo_model.h"
+#include <systemc>
+#include <array>
+#include <deque>
+#include <random>
+
+// Address sequences the generator can produce
+enum class MemAddressPattern {
+    SEQUENTIAL,  // 0, 1, 2, ...
+    STRIDED,     // 0, stride, 2*stride, ... (master_module.v walks 0x10, 0x20, ...)
+    HOTSPOT,     // 90% of accesses to the first 16 addresses
+    RANDOM       // Uniform over the BRAM
+};
+
+inline const char* mem_pattern_name(MemAddressPattern pattern) {
+    switch (pattern) {
+        case MemAddressPattern::SEQUENTIAL: return "sequential";
+        case MemAddressPattern::STRIDED:    return "strided";
+        case MemAddressPattern::HOTSPOT:    return "hotspot";
+        default:                            return "random";
+    }
+}
+
+// Synthetic workload description
+struct MemLoadConfig {
+    uint64_t num_ops = 10000;
+    double offered_ops_per_sec = 5e6;   // Mean request arrival rate
+    double read_fraction = 0.5;
+    MemAddressPattern pattern = MemAddressPattern::RANDOM;
+    unsigned stride = 0x10;
+    unsigned burst_length = 1;          // Requests per burst; 1 gives Poisson arrivals
+    unsigned seed = 460;
+};
+
+// Counters collected by the load generator
+struct MemLoadStats {
+    uint64_t issued = 0;
+    uint64_t reads_checked = 0;
+    uint64_t data_errors = 0;
+    sc_core::sc_time first_arrival;
+    sc_core::sc_time last_arrival;
+    sc_core::sc_time last_response;
+};
+
+// Synthetic master in the 90 MHz domain. Unlike master_module.v, which waits
+// for every read response before issuing the next command, it keeps issuing
+// as fast as its arrival process and the command FIFO allow, so it can drive
+// the controller into saturation.
+//
+// Bursts of burst_length back-to-back requests arrive as a Poisson process
+// with the rate that gives offered_ops_per_sec on average. A shadow copy of
+// the BRAM predicts every read result, since the controller executes
+// commands in order.
+class MemLoadGenerator : public sc_core::sc_module {
+public:
+    // Constructor
+    SC_HAS_PROCESS(MemLoadGenerator);
+    MemLoadGenerator(sc_core::sc_module_name name,
+                     const MemLoadConfig& config,
+                     AsyncFifoModel<MemCommand>& cmd_fifo,
+                     AsyncFifoModel<MemResponse>& resp_fifo,
+                     sc_core::sc_time clock_period = mem_clock_period(MEM_MASTER_CLOCK_MHZ)) :
+        sc_core::sc_module(name),
+        m_config(config),
+        m_cmd_fifo(cmd_fifo),
+        m_resp_fifo(resp_fifo),
+        m_clock_period(clock_period),
+        m_rng(config.seed),
+        m_issue_done(false) {
+
+        for (unsigned addr = 0; addr < MEM_BRAM_DEPTH; addr++) {
+            m_shadow[addr] = mem_bram_initial_value(addr);
+        }
+
+        SC_THREAD(issue);
+        SC_THREAD(collect);
+    }
+
+    // Accessors
+    const MemLoadConfig& config() const { return m_config; }
+    const MemLoadStats& stats() const { return m_stats; }
+    MemLatencyStats& read_latency() { return m_read_latency; }
+
+private:
+    MemLoadConfig m_config;
+    AsyncFifoModel<MemCommand>& m_cmd_fifo;
+    AsyncFifoModel<MemResponse>& m_resp_fifo;
+    sc_core::sc_time m_clock_period;
+
+    std::mt19937 m_rng;
+    std::array<uint8_t, MEM_BRAM_DEPTH> m_shadow;
+    std::deque<uint8_t> m_expected;   // Predicted data of outstanding reads
+    bool m_issue_done;
+    sc_core::sc_event m_read_issued;
+
+    MemLoadStats m_stats;
+    MemLatencyStats m_read_latency;   // Arrival to read data popped by the master
+
+    // Command side: generate arrivals and push them into the command FIFO,
+    // at most one per clock
+    void issue() {
+        std::exponential_distribution<double> gap(m_config.offered_ops_per_sec / m_config.burst_length);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        sc_core::sc_time arrival = sc_core::SC_ZERO_TIME;
+        sc_core::sc_time next_slot = sc_core::SC_ZERO_TIME;
+        unsigned burst_left = 0;
+
+        for (uint64_t i = 0; i < m_config.num_ops; i++) {
+            // The next burst starts an exponential gap after the previous
+            // one; requests within a burst arrive on consecutive clocks
+            if (burst_left == 0) {
+                arrival += sc_core::sc_time(gap(m_rng), sc_core::SC_SEC);
+                burst_left = m_config.burst_length;
+            } else {
+                arrival += m_clock_period;
+            }
+            burst_left--;
+
+            MemCommand cmd;
+            cmd.write = unit(m_rng) >= m_config.read_fraction;
+            cmd.address = next_address(i);
+            cmd.data = static_cast<uint8_t>(m_rng());
+            cmd.id = i;
+            cmd.arrival = arrival;
+            if (i == 0) {
+                m_stats.first_arrival = arrival;
+            }
+            m_stats.last_arrival = arrival;
+
+            // cmd_fifo_wr_en is raised on the first free clock edge after
+            // the request arrives and the FIFO stores the word on the next
+            sc_core::sc_time edge = mem_clock_edge_at_or_after(arrival, m_clock_period);
+            if (edge < next_slot) {
+                edge = next_slot;
+            }
+            wait(edge - sc_core::sc_time_stamp());
+            m_cmd_fifo.wait_writable();
+            wait(m_clock_period);
+            m_cmd_fifo.push(cmd);
+            next_slot = sc_core::sc_time_stamp();
+            m_stats.issued++;
+
+            if (cmd.write) {
+                m_shadow[cmd.address] = cmd.data;
+            } else {
+                m_expected.push_back(m_shadow[cmd.address]);
+                m_read_issued.notify(sc_core::SC_ZERO_TIME);
+            }
+        }
+
+        m_issue_done = true;
+        m_read_issued.notify(sc_core::SC_ZERO_TIME);
+    }
+
+    // Response side: pop read data as soon as the master sees it and check
+    // it against the shadow memory
+    void collect() {
+        while (true) {
+            while (m_expected.empty()) {
+                if (m_issue_done) {
+                    return;
+                }
+                wait(m_read_issued);
+            }
+
+            // resp_fifo_rd_en goes out on the edge rd_empty is seen low
+            wait(mem_clock_edge_at_or_after(sc_core::sc_time_stamp(), m_clock_period) - sc_core::sc_time_stamp());
+            m_resp_fifo.wait_readable();
+            MemResponse resp = m_resp_fifo.pop();
+
+            m_read_latency.add(sc_core::sc_time_stamp() - resp.arrival);
+            m_stats.last_response = sc_core::sc_time_stamp();
+            m_stats.reads_checked++;
+            if (resp.data != m_expected.front()) {
+                m_stats.data_errors++;
+            }
+            m_expected.pop_front();
+
+            wait(m_clock_period);
+        }
+    }
+
+    uint8_t next_address(uint64_t i) {
+        switch (m_config.pattern) {
+            case MemAddressPattern::SEQUENTIAL:
+                return static_cast<uint8_t>(i);
+            case MemAddressPattern::STRIDED:
+                return static_cast<uint8_t>(i * m_config.stride);
+            case MemAddressPattern::HOTSPOT:
+                return static_cast<uint8_t>((m_rng() % 10) ? (m_rng() % 16) : (m_rng() % MEM_BRAM_DEPTH));
+            default:
+                return static_cast<uint8_t>(m_rng() % MEM_BRAM_DEPTH);
+        }
+    }
+};
+
+#endif // MEM_LOAD_GENERATOR_H
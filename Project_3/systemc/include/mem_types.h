@@ -0,0 +1,133 @@
+#ifndef MEM_TYPES_H
+#define MEM_TYPES_H
+
+#include <systemc>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Clock domains from clock_gen.v
+constexpr double MEM_MASTER_CLOCK_MHZ = 90.0;  // master_module domain
+constexpr double MEM_CTRL_CLOCK_MHZ = 65.0;    // memory_controller_interface and BRAM domain
+
+// BRAM geometry (BRAM_Module.v: 256 x 8 bits)
+constexpr unsigned MEM_BRAM_DEPTH = 256;
+
+// Command word fields, as packed into the 17-bit command FIFO entry:
+// [16] = op_type (0 = read, 1 = write), [15:8] = address, [7:0] = write data
+constexpr unsigned MEM_CMD_WIDTH = 17;
+constexpr uint32_t MEM_CMD_WRITE_BIT = 1u << 16;
+
+// A command as it travels through the command FIFO. Only the first three
+// fields exist in hardware; the rest are model-side bookkeeping used for
+// latency measurement and are never looked at by the controller FSM.
+struct MemCommand {
+    bool write = false;
+    uint8_t address = 0;
+    uint8_t data = 0;
+
+    uint64_t id = 0;              // Issue order, for matching responses
+    sc_core::sc_time arrival;     // When the load generator produced the request
+
+    uint32_t pack() const {
+        return (write ? MEM_CMD_WRITE_BIT : 0) | (static_cast<uint32_t>(address) << 8) | data;
+    }
+
+    static MemCommand unpack(uint32_t word) {
+        MemCommand cmd;
+        cmd.write = (word & MEM_CMD_WRITE_BIT) != 0;
+        cmd.address = static_cast<uint8_t>(word >> 8);
+        cmd.data = static_cast<uint8_t>(word);
+        return cmd;
+    }
+};
+
+// A read result on its way back through the response FIFO (8 bits in
+// hardware; the id and arrival time ride along for the statistics)
+struct MemResponse {
+    uint8_t data = 0;
+
+    uint64_t id = 0;
+    sc_core::sc_time arrival;
+};
+
+// Contents of BRAM_Module.v after its initial block
+inline uint8_t mem_bram_initial_value(unsigned address) {
+    switch (address) {
+        case 10:  return 0xA5;
+        case 20:  return 0x5A;
+        case 30:  return 0xF0;
+        case 40:  return 0x0F;
+        case 50:  return 0x55;
+        case 60:  return 0xAA;
+        case 70:  return 0x33;
+        case 80:  return 0xCC;
+        case 90:  return 0x66;
+        case 100: return 0x99;
+        default:  return static_cast<uint8_t>(address);
+    }
+}
+
+// Clock period of a domain given in MHz
+inline sc_core::sc_time mem_clock_period(double mhz) {
+    return sc_core::sc_time(1000.0 / mhz, sc_core::SC_NS);
+}
+
+// First rising edge of a clock (phase 0) at or after t
+inline sc_core::sc_time mem_clock_edge_at_or_after(const sc_core::sc_time& t, const sc_core::sc_time& period) {
+    uint64_t p = period.value();
+    return sc_core::sc_time::from_value((t.value() + p - 1) / p * p);
+}
+
+// First rising edge of a clock strictly after t
+inline sc_core::sc_time mem_clock_edge_after(const sc_core::sc_time& t, const sc_core::sc_time& period) {
+    uint64_t p = period.value();
+    return sc_core::sc_time::from_value((t.value() / p + 1) * p);
+}
+
+// Whole clock cycles spanned by an interval
+inline uint64_t mem_cycles(const sc_core::sc_time& span, const sc_core::sc_time& period) {
+    return static_cast<uint64_t>(span / period + 0.5);
+}
+
+// Latency samples with percentile lookup
+class MemLatencyStats {
+public:
+    void add(const sc_core::sc_time& latency) {
+        m_samples_ns.push_back(latency.to_seconds() * 1e9);
+        m_sorted = false;
+    }
+
+    size_t count() const { return m_samples_ns.size(); }
+
+    // Nearest-rank percentile in nanoseconds (p in [0, 100])
+    double percentile(double p) {
+        if (m_samples_ns.empty()) {
+            return 0.0;
+        }
+        if (!m_sorted) {
+            std::sort(m_samples_ns.begin(), m_samples_ns.end());
+            m_sorted = true;
+        }
+        size_t rank = static_cast<size_t>(p / 100.0 * m_samples_ns.size() + 0.5);
+        rank = std::min(std::max<size_t>(rank, 1), m_samples_ns.size());
+        return m_samples_ns[rank - 1];
+    }
+
+    double mean() const {
+        if (m_samples_ns.empty()) {
+            return 0.0;
+        }
+        double sum = 0.0;
+        for (double sample : m_samples_ns) {
+            sum += sample;
+        }
+        return sum / m_samples_ns.size();
+    }
+
+private:
+    std::vector<double> m_samples_ns;
+    bool m_sorted = false;
+};
+
+#endif // MEM_TYPES_H
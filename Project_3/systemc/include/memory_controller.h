@@ -0,0 +1,125 @@
+#ifndef MEMORY_CONTROLLER_H
+#define MEMORY_CONTROLLER_H
+
+#include "mem_types.h"
+#include "async_fifo_model.h"
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+
+// Counters collected by the memory controller
+struct MemControllerStats {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t busy_cycles = 0;          // From leaving IDLE until back in IDLE
+    sc_core::sc_time last_completion;  // Edge the last op_done was sampled
+
+    uint64_t ops() const { return reads + writes; }
+};
+
+// Cycle-timed model of memory_controller_interface.v. The FSM walks
+//   IDLE -> READ_CMD -> EXECUTE_READ/WRITE -> WAIT_BRAM_DONE [-> SEND_RESPONSE] -> IDLE
+// one state per clock, so with the RTL's one-cycle BRAM a write occupies
+// the controller for 5 cycles and a read for 6, and IDLE always costs a
+// cycle even when the next command is already waiting.
+//
+// Note: READ_CMD latches cmd_fifo_data on the same edge it raises
+// cmd_fifo_rd_en, and async_fifo.v registers rd_data, so the RTL decodes
+// the word popped by the previous command. The model decodes the entry it
+// pops; the timing is the same either way.
+class MemoryController : public sc_core::sc_module {
+public:
+    // TLM initiator socket towards the BRAM
+    tlm_utils::simple_initiator_socket<MemoryController> bram_socket;
+
+    // Constructor
+    SC_HAS_PROCESS(MemoryController);
+    MemoryController(sc_core::sc_module_name name,
+                     AsyncFifoModel<MemCommand>& cmd_fifo,
+                     AsyncFifoModel<MemResponse>& resp_fifo,
+                     sc_core::sc_time clock_period = mem_clock_period(MEM_CTRL_CLOCK_MHZ)) :
+        sc_core::sc_module(name),
+        bram_socket("bram_socket"),
+        m_cmd_fifo(cmd_fifo),
+        m_resp_fifo(resp_fifo),
+        m_clock_period(clock_period) {
+        SC_THREAD(run);
+    }
+
+    // Accessors
+    const sc_core::sc_time& clock_period() const { return m_clock_period; }
+    const MemControllerStats& stats() const { return m_stats; }
+    MemLatencyStats& queue_latency() { return m_queue_latency; }
+
+private:
+    AsyncFifoModel<MemCommand>& m_cmd_fifo;
+    AsyncFifoModel<MemResponse>& m_resp_fifo;
+    sc_core::sc_time m_clock_period;
+
+    MemControllerStats m_stats;
+    MemLatencyStats m_queue_latency;  // Arrival at the master to pop by the controller
+
+    // Main FSM, evaluated on rising edges of the 65 MHz clock
+    void run() {
+        while (true) {
+            // IDLE: wait for cmd_fifo_empty to drop (counted by the FIFO)
+            m_cmd_fifo.wait_readable();
+            sc_core::sc_time busy_start = sc_core::sc_time_stamp();
+            wait(m_clock_period);
+
+            // READ_CMD raises cmd_fifo_rd_en; the FIFO pops on the next edge
+            wait(m_clock_period);
+            MemCommand cmd = m_cmd_fifo.pop();
+            m_queue_latency.add(sc_core::sc_time_stamp() - cmd.arrival);
+
+            // EXECUTE_* enables the BRAM on this edge; WAIT_BRAM_DONE samples
+            // op_done one edge after the BRAM raises it
+            uint8_t data = cmd.data;
+            sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+            bram_access(cmd, data, delay);
+            wait(delay + m_clock_period);
+            m_stats.last_completion = sc_core::sc_time_stamp();
+
+            if (cmd.write) {
+                m_stats.writes++;
+                wait(m_clock_period);
+            } else {
+                // SEND_RESPONSE holds until resp_fifo_full is low (counted by
+                // the FIFO); the write lands on the edge that returns to IDLE
+                wait(m_clock_period);
+                m_resp_fifo.wait_writable();
+                wait(m_clock_period);
+
+                MemResponse resp;
+                resp.data = data;
+                resp.id = cmd.id;
+                resp.arrival = cmd.arrival;
+                m_resp_fifo.push(resp);
+                m_stats.reads++;
+            }
+
+            m_stats.busy_cycles += mem_cycles(sc_core::sc_time_stamp() - busy_start, m_clock_period);
+        }
+    }
+
+    // Single-byte BRAM access through the TLM socket
+    void bram_access(const MemCommand& cmd, uint8_t& data, sc_core::sc_time& delay) {
+        tlm::tlm_generic_payload trans;
+        trans.set_command(cmd.write ? tlm::TLM_WRITE_COMMAND : tlm::TLM_READ_COMMAND);
+        trans.set_address(cmd.address);
+        trans.set_data_ptr(&data);
+        trans.set_data_length(1);
+        trans.set_streaming_width(1);
+        trans.set_byte_enable_ptr(nullptr);
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+        bram_socket->b_transport(trans, delay);
+
+        if (trans.is_response_error()) {
+            SC_REPORT_ERROR("MemoryController", "BRAM transaction failed");
+        }
+    }
+};
+
+#endif // MEMORY_CONTROLLER_H
@@ -0,0 +1,280 @@
+#include "../include/mem_types.h"
+#include "../include/async_fifo_model.h"
+#include "../include/bram_model.h"
+#include "../include/memory_controller.h"
+#include "../include/mem_burst_master.h"
+#include <systemc>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// A pair of clock domains: master (FIFO write side) and controller
+struct ClockPair {
+    double master_mhz;
+    double ctrl_mhz;
+};
+
+// Sweep parameters, settable as key=value arguments
+struct SweepConfig {
+    MemBurstProfile profile;
+    unsigned bram_latency = 1;
+    unsigned sync_stages = 2;
+    vector<unsigned> addr_widths = {1, 2, 3, 4, 5, 6, 7, 8};   // async_fifo.v ADDR_WIDTH
+    vector<unsigned> burst_lengths = {1, 4, 16, 32, 64};
+    vector<ClockPair> clocks = {{MEM_MASTER_CLOCK_MHZ, MEM_CTRL_CLOCK_MHZ}, {150.0, 65.0}, {90.0, 130.0}};
+};
+
+// One CDC memory system; both FIFOs share ADDR_WIDTH, as in top.v
+struct CdcSystem {
+    size_t clock;
+    unsigned burst_length;
+    unsigned addr_width;
+    unique_ptr<AsyncFifoModel<MemCommand>> cmd_fifo;
+    unique_ptr<AsyncFifoModel<MemResponse>> resp_fifo;
+    unique_ptr<MemBurstMaster> master;
+    unique_ptr<MemoryController> controller;
+    unique_ptr<BramModel> bram;
+};
+
+// The clocks never stop on their own: end the simulation once every master
+// has its read data back and every controller has drained its commands
+class SweepMonitor : public sc_module {
+public:
+    SC_HAS_PROCESS(SweepMonitor);
+    SweepMonitor(sc_module_name name, const vector<CdcSystem>& systems) :
+        sc_module(name),
+        m_systems(systems) {
+        SC_THREAD(run);
+    }
+
+private:
+    const vector<CdcSystem>& m_systems;
+
+    void run() {
+        for (const CdcSystem& sys : m_systems) {
+            while (!sys.master->done()) {
+                wait(sys.master->done_event());
+            }
+            while (sys.controller->stats().ops() < sys.master->profile().num_ops) {
+                wait(sc_time(1, SC_US));
+            }
+        }
+        sc_stop();
+    }
+};
+
+static bool parse_list(const string& value, vector<unsigned>& list) {
+    list.clear();
+    string copy = value;
+    for (char* tok = strtok(&copy[0], ","); tok; tok = strtok(nullptr, ",")) {
+        list.push_back(static_cast<unsigned>(atoi(tok)));
+    }
+    return !list.empty();
+}
+
+static bool parse_args(int argc, char* argv[], SweepConfig& cfg) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+
+        if (key == "ops") {
+            cfg.profile.num_ops = strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "load") {
+            cfg.profile.offered_ops_per_sec = atof(value.c_str()) * 1e6;
+        } else if (key == "reads") {
+            cfg.profile.read_fraction = atof(value.c_str());
+        } else if (key == "seed") {
+            cfg.profile.seed = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "bursts") {
+            if (!parse_list(value, cfg.burst_lengths)) {
+                return false;
+            }
+        } else if (key == "widths") {
+            if (!parse_list(value, cfg.addr_widths)) {
+                return false;
+            }
+        } else if (key == "clocks") {
+            // Comma-separated master:controller pairs in MHz
+            cfg.clocks.clear();
+            for (char* tok = strtok(&value[0], ","); tok; tok = strtok(nullptr, ",")) {
+                char* colon = strchr(tok, ':');
+                if (!colon) {
+                    return false;
+                }
+                cfg.clocks.push_back({atof(tok), atof(colon + 1)});
+            }
+        } else if (key == "bram_latency") {
+            cfg.bram_latency = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "sync_stages") {
+            cfg.sync_stages = static_cast<unsigned>(atoi(value.c_str()));
+        } else {
+            return false;
+        }
+    }
+    for (unsigned w : cfg.addr_widths) {
+        if (w == 0 || w > 16) {
+            return false;
+        }
+    }
+    for (unsigned b : cfg.burst_lengths) {
+        if (b == 0) {
+            return false;
+        }
+    }
+    for (const ClockPair& pair : cfg.clocks) {
+        if (pair.master_mhz <= 0.0 || pair.ctrl_mhz <= 0.0) {
+            return false;
+        }
+    }
+    return cfg.profile.num_ops > 0 && cfg.profile.offered_ops_per_sec > 0.0 && !cfg.clocks.empty();
+}
+
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " [key=value ...]" << endl;
+    cout << "  ops=N             requests per configuration (default 10000)" << endl;
+    cout << "  load=F            average offered load in Mops/sec (default 8)" << endl;
+    cout << "  reads=F           read fraction (default 0.5)" << endl;
+    cout << "  bursts=A,B,...    burst lengths (default 1,4,16,32,64)" << endl;
+    cout << "  widths=A,B,...    FIFO ADDR_WIDTH values (default 1-8)" << endl;
+    cout << "  clocks=M:C,...    master:controller MHz pairs (default 90:65,150:65,90:130)" << endl;
+    cout << "  bram_latency=N sync_stages=N seed=N" << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    SweepConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // One master sc_clock per frequency ratio; every system in that column of
+    // the sweep shares it. The controller side, like in load_sweep, is timed
+    // from its period alone
+    vector<unique_ptr<sc_clock>> master_clocks;
+    vector<CdcSystem> systems;
+    for (size_t c = 0; c < cfg.clocks.size(); c++) {
+        string clock_suffix = "_" + to_string(c);
+        master_clocks.emplace_back(new sc_clock(("clk_master" + clock_suffix).c_str(),
+                                                mem_clock_period(cfg.clocks[c].master_mhz)));
+        sc_time master_period = master_clocks.back()->period();
+        sc_time ctrl_period = mem_clock_period(cfg.clocks[c].ctrl_mhz);
+
+        for (unsigned burst : cfg.burst_lengths) {
+            for (unsigned width : cfg.addr_widths) {
+                string suffix = clock_suffix + "_" + to_string(burst) + "_" + to_string(width);
+                MemBurstProfile profile = cfg.profile;
+                profile.burst_length = burst;
+                unsigned depth = 1u << width;
+
+                CdcSystem sys;
+                sys.clock = c;
+                sys.burst_length = burst;
+                sys.addr_width = width;
+                sys.cmd_fifo.reset(new AsyncFifoModel<MemCommand>(("cmd_fifo" + suffix).c_str(),
+                    depth, master_period, ctrl_period, cfg.sync_stages));
+                sys.resp_fifo.reset(new AsyncFifoModel<MemResponse>(("resp_fifo" + suffix).c_str(),
+                    depth, ctrl_period, master_period, cfg.sync_stages));
+                sys.master.reset(new MemBurstMaster(("master" + suffix).c_str(), profile,
+                    *sys.cmd_fifo, *sys.resp_fifo));
+                sys.controller.reset(new MemoryController(("mem_ctrl" + suffix).c_str(),
+                    *sys.cmd_fifo, *sys.resp_fifo, ctrl_period));
+                sys.bram.reset(new BramModel(("bram" + suffix).c_str(), ctrl_period, cfg.bram_latency));
+
+                // Connect modules
+                sys.master->clk(*master_clocks.back());
+                sys.controller->bram_socket.bind(sys.bram->bram_socket);
+
+                systems.push_back(std::move(sys));
+            }
+        }
+    }
+    SweepMonitor monitor("monitor", systems);
+
+    // Start simulation
+    sc_start();
+
+    double write_cycles = 4.0 + cfg.bram_latency;
+    double read_cycles = write_cycles + 1.0;
+    double mean_cycles = cfg.profile.read_fraction * read_cycles + (1.0 - cfg.profile.read_fraction) * write_cycles;
+
+    cout << "=== Project 3 CDC FIFO Depth Sweep ===" << endl;
+    cout << cfg.profile.num_ops << " requests per point, " << fixed << setprecision(0)
+         << cfg.profile.read_fraction * 100 << "% reads, " << setprecision(2)
+         << cfg.profile.offered_ops_per_sec / 1e6 << " Mops/sec average in periodic bursts, BRAM latency "
+         << cfg.bram_latency << ", " << cfg.sync_stages << "-stage Gray-code sync" << endl;
+    cout << "Cells: master cycles stalled on cmd FIFO wr_full (+ controller cycles on resp FIFO wr_full)" << endl;
+    cout << "Peak: highest cmd FIFO occupancy the master saw at the minimum depth" << endl;
+
+    bool all_passed = true;
+    for (size_t c = 0; c < cfg.clocks.size(); c++) {
+        const ClockPair& pair = cfg.clocks[c];
+        double bound_mops = pair.ctrl_mhz / mean_cycles;
+        cout << endl << "--- Master " << setprecision(1) << pair.master_mhz << " MHz -> controller "
+             << pair.ctrl_mhz << " MHz (ratio " << setprecision(2) << pair.master_mhz / pair.ctrl_mhz
+             << ", FSM bound " << bound_mops << " Mops/sec) ---" << endl;
+        cout << right << setw(6) << "Burst";
+        for (unsigned width : cfg.addr_widths) {
+            cout << setw(9) << ("AW=" + to_string(width));
+        }
+        cout << setw(12) << "Min depth" << setw(7) << "Peak" << setw(11) << "Sustained" << endl;
+
+        for (unsigned burst : cfg.burst_lengths) {
+            cout << setw(6) << burst;
+            unsigned min_depth = 0;
+            size_t peak = 0;
+            double sustained_mops = 0.0;
+            for (const CdcSystem& sys : systems) {
+                if (sys.clock != c || sys.burst_length != burst) {
+                    continue;
+                }
+                const MemLoadStats& load_stats = sys.master->stats();
+                const MemControllerStats& ctrl_stats = sys.controller->stats();
+                uint64_t cmd_stalls = sys.cmd_fifo->stats().full_cycles;
+                uint64_t resp_stalls = sys.resp_fifo->stats().full_cycles;
+
+                string cell = to_string(cmd_stalls);
+                if (resp_stalls > 0) {
+                    cell += "+" + to_string(resp_stalls);
+                }
+                cout << setw(9) << cell;
+
+                // The first depth with no write-side stall on either FIFO
+                if (min_depth == 0 && cmd_stalls == 0 && resp_stalls == 0) {
+                    min_depth = sys.cmd_fifo->depth();
+                    peak = sys.cmd_fifo->stats().max_writer_occupancy;
+                    sc_time end = max(ctrl_stats.last_completion, load_stats.last_response);
+                    sustained_mops = ctrl_stats.ops() / (end - load_stats.first_arrival).to_seconds() / 1e6;
+                }
+
+                all_passed = all_passed && load_stats.data_errors == 0 &&
+                             ctrl_stats.ops() == cfg.profile.num_ops &&
+                             load_stats.reads_checked == ctrl_stats.reads;
+            }
+            if (min_depth) {
+                cout << setw(12) << min_depth << setw(7) << peak << setw(11) << setprecision(2)
+                     << sustained_mops << endl;
+            } else {
+                cout << setw(12) << "none" << setw(7) << "-" << setw(11) << "-" << endl;
+            }
+        }
+        if (cfg.profile.offered_ops_per_sec / 1e6 > bound_mops) {
+            cout << "Offered load exceeds the FSM bound: every depth eventually stalls" << endl;
+        }
+    }
+
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
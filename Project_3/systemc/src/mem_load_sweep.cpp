@@ -0,0 +1,216 @@
+#include "../include/mem_types.h"
+#include "../include/async_fifo_model.h"
+#include "../include/bram_model.h"
+#include "../include/memory_controller.h"
+#include "../include/mem_load_generator.h"
+#include <systemc>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Sweep parameters, settable as key=value arguments
+struct SweepConfig {
+    MemLoadConfig load;
+    unsigned cmd_depth = 16;       // top.v: ADDR_WIDTH = 4
+    unsigned resp_depth = 16;
+    unsigned bram_latency = 1;
+    unsigned sync_stages = 2;
+    double master_mhz = MEM_MASTER_CLOCK_MHZ;
+    double ctrl_mhz = MEM_CTRL_CLOCK_MHZ;
+    vector<double> offered_mops = {1, 2, 4, 6, 8, 9, 10, 11, 12, 14, 16, 20};
+};
+
+// One complete CDC memory system: master, both FIFOs, controller and BRAM
+struct MemSystem {
+    unique_ptr<AsyncFifoModel<MemCommand>> cmd_fifo;
+    unique_ptr<AsyncFifoModel<MemResponse>> resp_fifo;
+    unique_ptr<MemLoadGenerator> generator;
+    unique_ptr<MemoryController> controller;
+    unique_ptr<BramModel> bram;
+};
+
+static bool parse_args(int argc, char* argv[], SweepConfig& cfg) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+
+        if (key == "ops") {
+            cfg.load.num_ops = strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "reads") {
+            cfg.load.read_fraction = atof(value.c_str());
+        } else if (key == "burst") {
+            cfg.load.burst_length = max(1, atoi(value.c_str()));
+        } else if (key == "stride") {
+            cfg.load.stride = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "seed") {
+            cfg.load.seed = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "pattern") {
+            bool found = false;
+            for (MemAddressPattern p : {MemAddressPattern::SEQUENTIAL, MemAddressPattern::STRIDED,
+                                        MemAddressPattern::HOTSPOT, MemAddressPattern::RANDOM}) {
+                if (value == mem_pattern_name(p)) {
+                    cfg.load.pattern = p;
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        } else if (key == "cmd_depth") {
+            cfg.cmd_depth = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "resp_depth") {
+            cfg.resp_depth = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "bram_latency") {
+            cfg.bram_latency = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "sync_stages") {
+            cfg.sync_stages = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (key == "master_mhz") {
+            cfg.master_mhz = atof(value.c_str());
+        } else if (key == "ctrl_mhz") {
+            cfg.ctrl_mhz = atof(value.c_str());
+        } else if (key == "load") {
+            // Comma-separated offered loads in Mops/sec
+            cfg.offered_mops.clear();
+            for (char* tok = strtok(&value[0], ","); tok; tok = strtok(nullptr, ",")) {
+                cfg.offered_mops.push_back(atof(tok));
+            }
+        } else {
+            return false;
+        }
+    }
+    return !cfg.offered_mops.empty();
+}
+
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " [key=value ...]" << endl;
+    cout << "  ops=N             requests per load point (default 10000)" << endl;
+    cout << "  load=A,B,...      offered loads in Mops/sec" << endl;
+    cout << "  reads=F           read fraction (default 0.5)" << endl;
+    cout << "  pattern=P         sequential | strided | hotspot | random" << endl;
+    cout << "  stride=N burst=N seed=N" << endl;
+    cout << "  cmd_depth=N resp_depth=N bram_latency=N sync_stages=N" << endl;
+    cout << "  master_mhz=F ctrl_mhz=F" << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    SweepConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sc_time master_period = mem_clock_period(cfg.master_mhz);
+    sc_time ctrl_period = mem_clock_period(cfg.ctrl_mhz);
+
+    // One independent system per offered load, all simulated together
+    vector<MemSystem> systems;
+    for (size_t i = 0; i < cfg.offered_mops.size(); i++) {
+        string suffix = "_" + to_string(i);
+        MemLoadConfig load = cfg.load;
+        load.offered_ops_per_sec = cfg.offered_mops[i] * 1e6;
+
+        MemSystem sys;
+        sys.cmd_fifo.reset(new AsyncFifoModel<MemCommand>(("cmd_fifo" + suffix).c_str(),
+            cfg.cmd_depth, master_period, ctrl_period, cfg.sync_stages));
+        sys.resp_fifo.reset(new AsyncFifoModel<MemResponse>(("resp_fifo" + suffix).c_str(),
+            cfg.resp_depth, ctrl_period, master_period, cfg.sync_stages));
+        sys.generator.reset(new MemLoadGenerator(("master" + suffix).c_str(), load,
+            *sys.cmd_fifo, *sys.resp_fifo, master_period));
+        sys.controller.reset(new MemoryController(("mem_ctrl" + suffix).c_str(),
+            *sys.cmd_fifo, *sys.resp_fifo, ctrl_period));
+        sys.bram.reset(new BramModel(("bram" + suffix).c_str(), ctrl_period, cfg.bram_latency));
+
+        // Connect modules
+        sys.controller->bram_socket.bind(sys.bram->bram_socket);
+
+        systems.push_back(std::move(sys));
+    }
+
+    // Start simulation
+    sc_start();
+
+    // Upper bound from the FSM alone: IDLE + READ_CMD + EXECUTE + BRAM
+    // latency + op_done sample, plus SEND_RESPONSE for reads
+    double write_cycles = 4.0 + cfg.bram_latency;
+    double read_cycles = write_cycles + 1.0;
+    double mean_cycles = cfg.load.read_fraction * read_cycles + (1.0 - cfg.load.read_fraction) * write_cycles;
+    double bound_mops = cfg.ctrl_mhz / mean_cycles;
+
+    cout << "=== Project 3 Memory Controller Load Sweep ===" << endl;
+    cout << "Master " << cfg.master_mhz << " MHz, controller " << cfg.ctrl_mhz << " MHz, cmd FIFO "
+         << cfg.cmd_depth << ", resp FIFO " << cfg.resp_depth << ", BRAM latency " << cfg.bram_latency
+         << ", " << cfg.sync_stages << "-stage sync" << endl;
+    cout << cfg.load.num_ops << " requests per point, " << fixed << setprecision(0)
+         << cfg.load.read_fraction * 100 << "% reads, " << mem_pattern_name(cfg.load.pattern)
+         << " addresses, burst " << cfg.load.burst_length << endl << endl;
+
+    cout << right << setw(9) << "Offered" << setw(11) << "Sustained"
+         << setw(10) << "Q p50" << setw(10) << "Q p95" << setw(10) << "Q p99" << setw(11) << "Rd p99"
+         << setw(11) << "CmdFull" << setw(11) << "CmdEmpty" << setw(11) << "RespFull"
+         << setw(8) << "MaxQ" << endl;
+    cout << right << setw(9) << "(Mops/s)" << setw(11) << "(Mops/s)"
+         << setw(10) << "(ns)" << setw(10) << "(ns)" << setw(10) << "(ns)" << setw(11) << "(ns)"
+         << setw(11) << "(mst cyc)" << setw(11) << "(ctl cyc)" << setw(11) << "(ctl cyc)"
+         << setw(8) << "" << endl;
+
+    bool all_passed = true;
+    double peak_mops = 0.0;
+    double knee_mops = 0.0;
+    for (size_t i = 0; i < systems.size(); i++) {
+        MemSystem& sys = systems[i];
+        const MemLoadStats& load_stats = sys.generator->stats();
+        const MemControllerStats& ctrl_stats = sys.controller->stats();
+
+        sc_time end = max(ctrl_stats.last_completion, load_stats.last_response);
+        double sustained_mops = ctrl_stats.ops() / (end - load_stats.first_arrival).to_seconds() / 1e6;
+        MemLatencyStats& queue = sys.controller->queue_latency();
+
+        cout << setprecision(2) << setw(9) << cfg.offered_mops[i] << setw(11) << sustained_mops
+             << setprecision(0) << setw(10) << queue.percentile(50) << setw(10) << queue.percentile(95)
+             << setw(10) << queue.percentile(99) << setw(11) << sys.generator->read_latency().percentile(99)
+             << setw(11) << sys.cmd_fifo->stats().full_cycles
+             << setw(11) << sys.cmd_fifo->stats().empty_cycles
+             << setw(11) << sys.resp_fifo->stats().full_cycles
+             << setw(8) << sys.cmd_fifo->stats().max_occupancy << endl;
+
+        // Judge against the arrival rate this run actually drew, which
+        // strays from the nominal rate for short or very bursty runs
+        double arrived_mops = cfg.load.num_ops /
+            (load_stats.last_arrival - load_stats.first_arrival).to_seconds() / 1e6;
+        peak_mops = max(peak_mops, sustained_mops);
+        if (sustained_mops >= 0.95 * arrived_mops) {
+            knee_mops = max(knee_mops, cfg.offered_mops[i]);
+        }
+        all_passed = all_passed && load_stats.data_errors == 0 &&
+                     ctrl_stats.ops() == cfg.load.num_ops &&
+                     load_stats.reads_checked == ctrl_stats.reads;
+    }
+
+    cout << endl << setprecision(2);
+    cout << "FSM bound:           " << bound_mops << " Mops/sec (" << write_cycles << "-cycle writes, "
+         << read_cycles << "-cycle reads)" << endl;
+    cout << "Peak sustained:      " << peak_mops << " Mops/sec (" << setprecision(1)
+         << 100.0 * peak_mops / bound_mops << "% of bound)" << endl;
+    if (knee_mops > 0.0) {
+        cout << "Saturation point:    " << setprecision(2) << knee_mops
+             << " Mops/sec offered (highest load sustained within 5%)" << endl;
+    } else {
+        cout << "Saturation point:    below the lowest offered load" << endl;
+    }
+    cout << "Functional check:    " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+#include "../include/mem_types.h"
+#include "../include/async_fifo_model.h"
+#include "../include/bram_model.h"
+#include "../include/memory_controller.h"
+#include "../include/mem_load_generator.h"
+#include <systemc>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string& message) {
+    if (!condition) {
+        cout << "FAILED: " << message << endl;
+        failures++;
+    }
+}
+
+// Master that plays a fixed command list. With wait_each_read it behaves
+// like master_module.v and waits for every read response before moving on;
+// otherwise a second thread only starts draining the response FIFO after
+// response_hold, to back the controller up.
+class ScriptedMaster : public sc_module {
+public:
+    SC_HAS_PROCESS(ScriptedMaster);
+    ScriptedMaster(sc_module_name name, const vector<MemCommand>& script, bool wait_each_read,
+                   AsyncFifoModel<MemCommand>& cmd_fifo, AsyncFifoModel<MemResponse>& resp_fifo,
+                   sc_time response_hold = SC_ZERO_TIME) :
+        sc_module(name),
+        m_script(script),
+        m_wait_each_read(wait_each_read),
+        m_cmd_fifo(cmd_fifo),
+        m_resp_fifo(resp_fifo),
+        m_response_hold(response_hold),
+        m_clock_period(mem_clock_period(MEM_MASTER_CLOCK_MHZ)) {
+        SC_THREAD(run);
+        if (!wait_each_read) {
+            SC_THREAD(drain);
+        }
+    }
+
+    const vector<uint8_t>& results() const { return m_results; }
+
+private:
+    vector<MemCommand> m_script;
+    bool m_wait_each_read;
+    AsyncFifoModel<MemCommand>& m_cmd_fifo;
+    AsyncFifoModel<MemResponse>& m_resp_fifo;
+    sc_time m_response_hold;
+    sc_time m_clock_period;
+    vector<uint8_t> m_results;
+
+    void run() {
+        for (MemCommand cmd : m_script) {
+            cmd.arrival = sc_time_stamp();
+            m_cmd_fifo.wait_writable();
+            wait(m_clock_period);
+            m_cmd_fifo.push(cmd);
+
+            if (!cmd.write && m_wait_each_read) {
+                receive();
+            }
+        }
+    }
+
+    void drain() {
+        size_t reads = 0;
+        for (const MemCommand& cmd : m_script) {
+            reads += cmd.write ? 0 : 1;
+        }
+
+        wait(m_response_hold);
+        wait(mem_clock_edge_at_or_after(sc_time_stamp(), m_clock_period) - sc_time_stamp());
+        for (; reads > 0; reads--) {
+            receive();
+        }
+    }
+
+    void receive() {
+        m_resp_fifo.wait_readable();
+        m_results.push_back(m_resp_fifo.pop().data);
+        wait(m_clock_period);
+    }
+};
+
+static MemCommand make_command(bool write, uint8_t address, uint8_t data = 0) {
+    MemCommand cmd;
+    cmd.write = write;
+    cmd.address = address;
+    cmd.data = data;
+    return cmd;
+}
+
+// Controller, FIFOs and BRAM with either a scripted master or a load generator
+struct TestSystem {
+    unique_ptr<AsyncFifoModel<MemCommand>> cmd_fifo;
+    unique_ptr<AsyncFifoModel<MemResponse>> resp_fifo;
+    unique_ptr<MemoryController> controller;
+    unique_ptr<BramModel> bram;
+    unique_ptr<ScriptedMaster> master;
+    unique_ptr<MemLoadGenerator> generator;
+
+    TestSystem(const string& name, unsigned cmd_depth, unsigned resp_depth, unsigned bram_latency) {
+        sc_time master_period = mem_clock_period(MEM_MASTER_CLOCK_MHZ);
+        sc_time ctrl_period = mem_clock_period(MEM_CTRL_CLOCK_MHZ);
+        cmd_fifo.reset(new AsyncFifoModel<MemCommand>((name + "_cmd_fifo").c_str(), cmd_depth, master_period, ctrl_period));
+        resp_fifo.reset(new AsyncFifoModel<MemResponse>((name + "_resp_fifo").c_str(), resp_depth, ctrl_period, master_period));
+        controller.reset(new MemoryController((name + "_mem_ctrl").c_str(), *cmd_fifo, *resp_fifo, ctrl_period));
+        bram.reset(new BramModel((name + "_bram").c_str(), ctrl_period, bram_latency));
+        controller->bram_socket.bind(bram->bram_socket);
+    }
+};
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    cout << "Starting memory controller tests..." << endl;
+
+    // master_module.v: write addr + 0x5A to 0x10, 0x20, ... then read it back
+    vector<MemCommand> master_script;
+    for (unsigned i = 0; i < 16; i++) {
+        uint8_t addr = static_cast<uint8_t>(0x10 + 0x10 * i);
+        master_script.push_back(make_command(true, addr, static_cast<uint8_t>(addr + 0x5A)));
+        master_script.push_back(make_command(false, addr));
+    }
+    TestSystem master_sys("master_pattern", 16, 16, 1);
+    master_sys.master.reset(new ScriptedMaster("master_pattern_master", master_script, true,
+                                               *master_sys.cmd_fifo, *master_sys.resp_fifo));
+
+    // Write then read of a preloaded address through a 3-cycle BRAM
+    TestSystem latency_sys("latency", 16, 16, 3);
+    latency_sys.master.reset(new ScriptedMaster("latency_master",
+        {make_command(false, 10), make_command(true, 10, 0x3C), make_command(false, 10)},
+        true, *latency_sys.cmd_fifo, *latency_sys.resp_fifo));
+
+    // 40 writes and 40 reads as fast as the master can issue them into a
+    // 4-entry command FIFO, with responses held back behind a 2-entry FIFO
+    vector<MemCommand> flood_script;
+    for (unsigned i = 0; i < 40; i++) {
+        flood_script.push_back(make_command(true, static_cast<uint8_t>(i), static_cast<uint8_t>(0xC0 ^ i)));
+    }
+    for (unsigned i = 0; i < 40; i++) {
+        flood_script.push_back(make_command(false, static_cast<uint8_t>(i)));
+    }
+    TestSystem flood_sys("flood", 4, 2, 1);
+    flood_sys.master.reset(new ScriptedMaster("flood_master", flood_script, false,
+                                              *flood_sys.cmd_fifo, *flood_sys.resp_fifo,
+                                              sc_time(5, SC_US)));
+
+    // Every address pattern through the load generator, overloaded and bursty
+    vector<unique_ptr<TestSystem>> load_systems;
+    for (MemAddressPattern pattern : {MemAddressPattern::SEQUENTIAL, MemAddressPattern::STRIDED,
+                                      MemAddressPattern::HOTSPOT, MemAddressPattern::RANDOM}) {
+        string name = string("load_") + mem_pattern_name(pattern);
+        MemLoadConfig load;
+        load.num_ops = 2000;
+        load.offered_ops_per_sec = 20e6;
+        load.read_fraction = 0.6;
+        load.pattern = pattern;
+        load.burst_length = 8;
+
+        unique_ptr<TestSystem> sys(new TestSystem(name, 8, 4, 1));
+        sys->generator.reset(new MemLoadGenerator((name + "_master").c_str(), load,
+                                                  *sys->cmd_fifo, *sys->resp_fifo));
+        load_systems.push_back(std::move(sys));
+    }
+
+    // Start simulation
+    sc_start();
+
+    // master_module pattern: data integrity and 5 + 6 cycles per pair
+    const vector<uint8_t>& master_results = master_sys.master->results();
+    check(master_results.size() == 16, "master pattern: expected 16 read responses");
+    for (size_t i = 0; i < master_results.size(); i++) {
+        uint8_t addr = static_cast<uint8_t>(0x10 + 0x10 * i);
+        check(master_results[i] == static_cast<uint8_t>(addr + 0x5A),
+              "master pattern: read " + to_string(i) + " returned " + to_string(master_results[i]));
+    }
+    check(master_sys.controller->stats().busy_cycles == 16 * (5 + 6),
+          "master pattern: busy cycles " + to_string(master_sys.controller->stats().busy_cycles));
+
+    // BRAM latency adds directly to every command
+    const vector<uint8_t>& latency_results = latency_sys.master->results();
+    check(latency_results.size() == 2 && latency_results[0] == 0xA5 && latency_results[1] == 0x3C,
+          "latency: read-after-write data");
+    check(latency_sys.controller->stats().busy_cycles == 2 * (5 + 3) + (4 + 3),
+          "latency: busy cycles " + to_string(latency_sys.controller->stats().busy_cycles));
+
+    // Backpressure on both FIFOs without losing or reordering data
+    const vector<uint8_t>& flood_results = flood_sys.master->results();
+    check(flood_results.size() == 40, "flood: expected 40 read responses");
+    for (size_t i = 0; i < flood_results.size(); i++) {
+        check(flood_results[i] == static_cast<uint8_t>(0xC0 ^ i), "flood: read " + to_string(i));
+    }
+    check(flood_sys.cmd_fifo->stats().full_cycles > 0, "flood: command FIFO never filled");
+    check(flood_sys.cmd_fifo->stats().max_occupancy <= 4, "flood: command FIFO overflowed");
+    check(flood_sys.resp_fifo->stats().full_cycles > 0, "flood: response FIFO never filled");
+    check(flood_sys.resp_fifo->stats().max_occupancy <= 2, "flood: response FIFO overflowed");
+    check(flood_sys.controller->stats().ops() == 80, "flood: not every command executed");
+
+    // Load generator: every read checked against the shadow memory
+    for (const unique_ptr<TestSystem>& sys : load_systems) {
+        const MemLoadStats& stats = sys->generator->stats();
+        string name = mem_pattern_name(sys->generator->config().pattern);
+        check(sys->controller->stats().ops() == 2000, name + ": not every command executed");
+        check(stats.reads_checked == sys->controller->stats().reads, name + ": responses missing");
+        check(stats.data_errors == 0, name + ": " + to_string(stats.data_errors) + " data errors");
+        check(sys->cmd_fifo->stats().full_cycles > 0, name + ": overload never filled the command FIFO");
+    }
+
+    if (failures == 0) {
+        cout << "All tests completed successfully!" << endl;
+        return 0;
+    }
+    cout << failures << " check(s) failed" << endl;
+    return 1;
+}
@@ -0,0 +1,257 @@
+#ifndef DATAPATH_MODEL_H
+#define DATAPATH_MODEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DATAPATH_MODEL_X86 1
+#endif
+
+// Constants for altitude correction (datapath.v K1, K2)
+constexpr int16_t DATAPATH_K1 = 3;
+constexpr int16_t DATAPATH_K2 = 5;
+
+// Kernel selection for the batch evaluator
+enum class DatapathKernel {
+    AUTO,    // Widest kernel the CPU supports
+    SCALAR,  // One result per iteration
+    SSE2,    // 8 results per iteration
+    AVX2     // 16 results per iteration
+};
+
+inline const char* datapath_kernel_name(DatapathKernel kernel) {
+    switch (kernel) {
+        case DatapathKernel::SCALAR: return "scalar";
+        case DatapathKernel::SSE2:   return "sse2";
+        case DatapathKernel::AVX2:   return "avx2";
+        default:                     return "auto";
+    }
+}
+
+inline bool datapath_kernel_supported(DatapathKernel kernel) {
+    switch (kernel) {
+        case DatapathKernel::SCALAR:
+        case DatapathKernel::AUTO:
+            return true;
+#ifdef DATAPATH_MODEL_X86
+        case DatapathKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case DatapathKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+inline DatapathKernel datapath_best_kernel() {
+    return datapath_kernel_supported(DatapathKernel::AVX2) ? DatapathKernel::AVX2 :
+           datapath_kernel_supported(DatapathKernel::SSE2) ? DatapathKernel::SSE2 : DatapathKernel::SCALAR;
+}
+
+// Single-vector reference, transcribed from the RTL: the shared multiplier
+// takes $signed 8-bit operands into a 16-bit product, and the shared adder
+// works on 16-bit words (c is sign-extended before the add).
+inline int16_t datapath_altitude(int8_t x1, int8_t x2) {
+    uint16_t term1 = static_cast<uint16_t>(x1 * DATAPATH_K1);
+    uint16_t term2 = static_cast<uint16_t>(x2 * DATAPATH_K2);
+    return static_cast<int16_t>(static_cast<uint16_t>(term1 + term2));
+}
+
+inline int16_t datapath_battery(int8_t v, int8_t t, int8_t c) {
+    uint16_t product = static_cast<uint16_t>(v * t);
+    uint16_t c_ext = static_cast<uint16_t>(static_cast<int16_t>(c));
+    return static_cast<int16_t>(static_cast<uint16_t>(product + c_ext));
+}
+
+// Structure-of-arrays batch of datapath inputs and results. Altitude and
+// battery inputs are independent; either half may be empty.
+struct DatapathBatch {
+    std::vector<int8_t> x1, x2;        // Altitude correction inputs
+    std::vector<int8_t> v, t, c;       // Battery estimation inputs
+    std::vector<int16_t> result_a;     // Altitude results
+    std::vector<int16_t> result_b;     // Battery results
+
+    void resize_altitude(size_t n) {
+        x1.resize(n);
+        x2.resize(n);
+        result_a.resize(n);
+    }
+
+    void resize_battery(size_t n) {
+        v.resize(n);
+        t.resize(n);
+        c.resize(n);
+        result_b.resize(n);
+    }
+};
+
+// Batch evaluator for both datapath equations
+class DatapathModel {
+public:
+    explicit DatapathModel(DatapathKernel kernel = DatapathKernel::AUTO, unsigned num_threads = 0) :
+        m_kernel(kernel == DatapathKernel::AUTO ? datapath_best_kernel() : kernel),
+        m_num_threads(num_threads ? num_threads : std::max(1u, std::thread::hardware_concurrency())) {
+        if (!datapath_kernel_supported(m_kernel)) {
+            m_kernel = DatapathKernel::SCALAR;
+        }
+    }
+
+    DatapathKernel kernel() const { return m_kernel; }
+    unsigned num_threads() const { return m_num_threads; }
+
+    // Evaluate n altitude corrections on the calling thread
+    void altitude(const int8_t* x1, const int8_t* x2, int16_t* result, size_t n) const {
+        switch (m_kernel) {
+#ifdef DATAPATH_MODEL_X86
+            case DatapathKernel::AVX2:
+                altitude_avx2(x1, x2, result, n);
+                break;
+            case DatapathKernel::SSE2:
+                altitude_sse2(x1, x2, result, n);
+                break;
+#endif
+            default:
+                altitude_scalar(x1, x2, result, n);
+                break;
+        }
+    }
+
+    // Evaluate n battery estimations on the calling thread
+    void battery(const int8_t* v, const int8_t* t, const int8_t* c, int16_t* result, size_t n) const {
+        switch (m_kernel) {
+#ifdef DATAPATH_MODEL_X86
+            case DatapathKernel::AVX2:
+                battery_avx2(v, t, c, result, n);
+                break;
+            case DatapathKernel::SSE2:
+                battery_sse2(v, t, c, result, n);
+                break;
+#endif
+            default:
+                battery_scalar(v, t, c, result, n);
+                break;
+        }
+    }
+
+    // Evaluate a whole batch, split across the worker threads
+    void evaluate(DatapathBatch& batch) const {
+        parallel_for(batch.result_a.size(), [&](size_t begin, size_t end) {
+            altitude(&batch.x1[begin], &batch.x2[begin], &batch.result_a[begin], end - begin);
+        });
+        parallel_for(batch.result_b.size(), [&](size_t begin, size_t end) {
+            battery(&batch.v[begin], &batch.t[begin], &batch.c[begin], &batch.result_b[begin], end - begin);
+        });
+    }
+
+    // Run body(begin, end) over [0, n) in one contiguous chunk per thread,
+    // giving each thread at least min_chunk items
+    template <typename Body>
+    void parallel_for(size_t n, Body body, size_t min_chunk = MIN_CHUNK) const {
+        if (n == 0) {
+            return;
+        }
+        unsigned threads = static_cast<unsigned>(std::min<size_t>(m_num_threads, (n + min_chunk - 1) / min_chunk));
+        if (threads <= 1) {
+            body(0, n);
+            return;
+        }
+
+        size_t chunk = (n + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin < n; begin += chunk) {
+            size_t end = std::min(n, begin + chunk);
+            workers.emplace_back(body, begin, end);
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+private:
+    // Below this many vectors per thread, spawning threads costs more than it saves
+    static constexpr size_t MIN_CHUNK = 1 << 14;
+
+    DatapathKernel m_kernel;
+    unsigned m_num_threads;
+
+    static void altitude_scalar(const int8_t* x1, const int8_t* x2, int16_t* result, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            result[i] = datapath_altitude(x1[i], x2[i]);
+        }
+    }
+
+    static void battery_scalar(const int8_t* v, const int8_t* t, const int8_t* c, int16_t* result, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            result[i] = datapath_battery(v[i], t[i], c[i]);
+        }
+    }
+
+#ifdef DATAPATH_MODEL_X86
+    // 16-bit lanes match the RTL's 16-bit product and adder exactly
+    __attribute__((target("sse2")))
+    static __m128i load_sse2(const int8_t* p) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+    }
+
+    __attribute__((target("sse2")))
+    static void altitude_sse2(const int8_t* x1, const int8_t* x2, int16_t* result, size_t n) {
+        const __m128i k1 = _mm_set1_epi16(DATAPATH_K1);
+        const __m128i k2 = _mm_set1_epi16(DATAPATH_K2);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i a = _mm_add_epi16(_mm_mullo_epi16(load_sse2(x1 + i), k1),
+                                      _mm_mullo_epi16(load_sse2(x2 + i), k2));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), a);
+        }
+        altitude_scalar(x1 + i, x2 + i, result + i, n - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void battery_sse2(const int8_t* v, const int8_t* t, const int8_t* c, int16_t* result, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i b = _mm_add_epi16(_mm_mullo_epi16(load_sse2(v + i), load_sse2(t + i)), load_sse2(c + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), b);
+        }
+        battery_scalar(v + i, t + i, c + i, result + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i load_avx2(const int8_t* p) {
+        return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    __attribute__((target("avx2")))
+    static void altitude_avx2(const int8_t* x1, const int8_t* x2, int16_t* result, size_t n) {
+        const __m256i k1 = _mm256_set1_epi16(DATAPATH_K1);
+        const __m256i k2 = _mm256_set1_epi16(DATAPATH_K2);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i a = _mm256_add_epi16(_mm256_mullo_epi16(load_avx2(x1 + i), k1),
+                                         _mm256_mullo_epi16(load_avx2(x2 + i), k2));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i), a);
+        }
+        altitude_sse2(x1 + i, x2 + i, result + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void battery_avx2(const int8_t* v, const int8_t* t, const int8_t* c, int16_t* result, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i b = _mm256_add_epi16(_mm256_mullo_epi16(load_avx2(v + i), load_avx2(t + i)),
+                                         load_avx2(c + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i), b);
+        }
+        battery_sse2(v + i, t + i, c + i, result + i, n - i);
+    }
+#endif
+};
+
+#endif // DATAPATH_MODEL_H
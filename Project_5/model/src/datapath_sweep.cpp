@@ -0,0 +1,299 @@
+#include "../include/datapath_model.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Result statistics gathered over a sweep
+struct SweepStats {
+    uint64_t vectors = 0;
+    uint64_t mismatches = 0;
+    int16_t min_result = INT16_MAX;
+    int16_t max_result = INT16_MIN;
+    uint64_t checksum = 0;
+
+    void add(const int16_t* results, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            min_result = min(min_result, results[i]);
+            max_result = max(max_result, results[i]);
+            checksum += static_cast<uint16_t>(results[i]);
+        }
+        vectors += n;
+    }
+
+    void merge(const SweepStats& other) {
+        vectors += other.vectors;
+        mismatches += other.mismatches;
+        min_result = min(min_result, other.min_result);
+        max_result = max(max_result, other.max_result);
+        checksum += other.checksum;
+    }
+};
+
+static void print_stats(const char* name, const SweepStats& stats, double seconds) {
+    cout << left << setw(10) << name << right
+         << setw(12) << stats.vectors
+         << setw(12) << stats.mismatches
+         << setw(9) << stats.min_result
+         << setw(9) << stats.max_result
+         << setw(14) << hex << stats.checksum << dec
+         << setw(12) << fixed << setprecision(1) << stats.vectors / seconds / 1e6 << endl;
+}
+
+// Exhaustive sweep: every (x1, x2) pair and every (v, t, c) triple, checked
+// against the scalar reference. With a path, the expected results are also
+// written as $readmemh images indexed by {x1, x2} and {v, t, c}.
+static int run_sweep(const DatapathModel& model, const char* expected_prefix) {
+    cout << "=== Exhaustive datapath sweep (" << datapath_kernel_name(model.kernel())
+         << ", " << model.num_threads() << " threads) ===" << endl;
+    cout << left << setw(10) << "Equation" << right << setw(12) << "Vectors" << setw(12) << "Mismatch"
+         << setw(9) << "Min" << setw(9) << "Max" << setw(14) << "Checksum" << setw(12) << "MVec/sec" << endl;
+
+    mutex merge_lock;
+    vector<int16_t> altitude_image(expected_prefix ? 1 << 16 : 0);
+    vector<int16_t> battery_image(expected_prefix ? 1 << 24 : 0);
+
+    // Altitude: one tile of all 65536 (x1, x2) pairs
+    auto start_time = chrono::high_resolution_clock::now();
+    SweepStats altitude_stats;
+    {
+        DatapathBatch batch;
+        batch.resize_altitude(1 << 16);
+        for (size_t i = 0; i < batch.x1.size(); i++) {
+            batch.x1[i] = static_cast<int8_t>(i >> 8);
+            batch.x2[i] = static_cast<int8_t>(i);
+        }
+        model.evaluate(batch);
+        for (size_t i = 0; i < batch.x1.size(); i++) {
+            if (batch.result_a[i] != datapath_altitude(batch.x1[i], batch.x2[i])) {
+                altitude_stats.mismatches++;
+            }
+        }
+        altitude_stats.add(batch.result_a.data(), batch.result_a.size());
+        if (expected_prefix) {
+            altitude_image = batch.result_a;
+        }
+    }
+    auto end_time = chrono::high_resolution_clock::now();
+    print_stats("altitude", altitude_stats, chrono::duration<double>(end_time - start_time).count());
+
+    // Battery: one 65536-vector (t, c) tile per value of v, tiles spread over threads
+    start_time = chrono::high_resolution_clock::now();
+    SweepStats battery_stats;
+    model.parallel_for(256, [&](size_t v_begin, size_t v_end) {
+        vector<int8_t> v(1 << 16), t(1 << 16), c(1 << 16);
+        vector<int16_t> result(1 << 16);
+        for (size_t i = 0; i < t.size(); i++) {
+            t[i] = static_cast<int8_t>(i >> 8);
+            c[i] = static_cast<int8_t>(i);
+        }
+
+        SweepStats local;
+        for (size_t v_value = v_begin; v_value < v_end; v_value++) {
+            fill(v.begin(), v.end(), static_cast<int8_t>(v_value));
+            model.battery(v.data(), t.data(), c.data(), result.data(), result.size());
+            for (size_t i = 0; i < result.size(); i++) {
+                if (result[i] != datapath_battery(v[i], t[i], c[i])) {
+                    local.mismatches++;
+                }
+            }
+            local.add(result.data(), result.size());
+            if (expected_prefix) {
+                copy(result.begin(), result.end(), battery_image.begin() + (v_value << 16));
+            }
+        }
+
+        lock_guard<mutex> guard(merge_lock);
+        battery_stats.merge(local);
+    }, 1);
+    end_time = chrono::high_resolution_clock::now();
+    print_stats("battery", battery_stats, chrono::duration<double>(end_time - start_time).count());
+
+    if (expected_prefix) {
+        for (int eq = 0; eq < 2; eq++) {
+            const vector<int16_t>& image = eq ? battery_image : altitude_image;
+            string path = string(expected_prefix) + (eq ? "_battery.mem" : "_altitude.mem");
+            FILE* f = fopen(path.c_str(), "w");
+            if (!f) {
+                cerr << "Failed to write " << path << endl;
+                return 1;
+            }
+            for (int16_t result : image) {
+                fprintf(f, "%04x\n", static_cast<uint16_t>(result));
+            }
+            fclose(f);
+            cout << "Wrote " << path << endl;
+        }
+    }
+
+    return (altitude_stats.mismatches + battery_stats.mismatches) == 0 ? 0 : 1;
+}
+
+// Compare mode: read a vector dump written by datapath_tb.v and check every
+// observed result against the batch evaluator. Lines look like
+//   A <x1> <x2> <result_a>
+//   B <v> <t> <c> <result_b>
+// with signed decimal fields; lines starting with '#' are comments.
+static int run_compare(const DatapathModel& model, const char* path) {
+    ifstream dump(path);
+    if (!dump) {
+        cerr << "Failed to open " << path << endl;
+        return 1;
+    }
+
+    DatapathBatch batch;
+    vector<int16_t> observed_a, observed_b;
+    vector<size_t> line_a, line_b;
+    string line;
+    size_t line_number = 0;
+    size_t malformed = 0;
+
+    while (getline(dump, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        char eq;
+        int a, b, c, result;
+        fields >> eq;
+        if (eq == 'A' && (fields >> a >> b >> result)) {
+            batch.x1.push_back(static_cast<int8_t>(a));
+            batch.x2.push_back(static_cast<int8_t>(b));
+            observed_a.push_back(static_cast<int16_t>(result));
+            line_a.push_back(line_number);
+        } else if (eq == 'B' && (fields >> a >> b >> c >> result)) {
+            batch.v.push_back(static_cast<int8_t>(a));
+            batch.t.push_back(static_cast<int8_t>(b));
+            batch.c.push_back(static_cast<int8_t>(c));
+            observed_b.push_back(static_cast<int16_t>(result));
+            line_b.push_back(line_number);
+        } else {
+            malformed++;
+        }
+    }
+
+    batch.result_a.resize(batch.x1.size());
+    batch.result_b.resize(batch.v.size());
+    model.evaluate(batch);
+
+    const size_t max_reported = 10;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < observed_a.size(); i++) {
+        if (observed_a[i] != batch.result_a[i] && mismatches++ < max_reported) {
+            cout << "Line " << line_a[i] << ": A x1=" << int(batch.x1[i]) << " x2=" << int(batch.x2[i])
+                 << " RTL=" << observed_a[i] << " model=" << batch.result_a[i] << endl;
+        }
+    }
+    for (size_t i = 0; i < observed_b.size(); i++) {
+        if (observed_b[i] != batch.result_b[i] && mismatches++ < max_reported) {
+            cout << "Line " << line_b[i] << ": B v=" << int(batch.v[i]) << " t=" << int(batch.t[i])
+                 << " c=" << int(batch.c[i]) << " RTL=" << observed_b[i] << " model=" << batch.result_b[i] << endl;
+        }
+    }
+
+    cout << "Compared " << observed_a.size() << " altitude and " << observed_b.size()
+         << " battery vectors from " << path << endl;
+    if (malformed) {
+        cout << "Skipped " << malformed << " malformed line(s)" << endl;
+    }
+    cout << "Mismatches: " << mismatches << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Benchmark mode: random SoA batch through every kernel
+static int run_bench(unsigned num_threads, size_t count) {
+    DatapathBatch batch;
+    batch.resize_altitude(count);
+    batch.resize_battery(count);
+
+    mt19937 rng(5);
+    uniform_int_distribution<int> byte(-128, 127);
+    for (size_t i = 0; i < count; i++) {
+        batch.x1[i] = static_cast<int8_t>(byte(rng));
+        batch.x2[i] = static_cast<int8_t>(byte(rng));
+        batch.v[i] = static_cast<int8_t>(byte(rng));
+        batch.t[i] = static_cast<int8_t>(byte(rng));
+        batch.c[i] = static_cast<int8_t>(byte(rng));
+    }
+
+    cout << "=== Datapath batch evaluator (" << count << " vectors per equation) ===" << endl;
+    cout << left << setw(10) << "Kernel" << right << setw(10) << "Threads" << setw(14) << "Time (ms)"
+         << setw(14) << "MVec/sec" << endl;
+
+    for (DatapathKernel kernel : {DatapathKernel::SCALAR, DatapathKernel::SSE2, DatapathKernel::AVX2}) {
+        if (!datapath_kernel_supported(kernel)) {
+            continue;
+        }
+        for (unsigned threads : {1u, num_threads}) {
+            DatapathModel model(kernel, threads);
+            auto start_time = chrono::high_resolution_clock::now();
+            model.evaluate(batch);
+            auto end_time = chrono::high_resolution_clock::now();
+            double seconds = chrono::duration<double>(end_time - start_time).count();
+
+            cout << left << setw(10) << datapath_kernel_name(kernel) << right << setw(10) << threads
+                 << setw(14) << fixed << setprecision(2) << seconds * 1e3
+                 << setw(14) << setprecision(1) << 2.0 * count / seconds / 1e6 << endl;
+            if (threads == num_threads) {
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static void usage(const char* prog) {
+    cout << "Usage:" << endl;
+    cout << "  " << prog << " sweep [expected_prefix]   exhaustive sweep of both equations" << endl;
+    cout << "  " << prog << " compare <vector_dump>     check RTL testbench results" << endl;
+    cout << "  " << prog << " bench [vectors]           benchmark kernels and threads" << endl;
+    cout << "Environment: DATAPATH_THREADS (default: all cores), DATAPATH_KERNEL (scalar|sse2|avx2)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    unsigned num_threads = 0;
+    if (const char* env = getenv("DATAPATH_THREADS")) {
+        num_threads = static_cast<unsigned>(atoi(env));
+    }
+    DatapathKernel kernel = DatapathKernel::AUTO;
+    if (const char* env = getenv("DATAPATH_KERNEL")) {
+        for (DatapathKernel k : {DatapathKernel::SCALAR, DatapathKernel::SSE2, DatapathKernel::AVX2}) {
+            if (strcmp(env, datapath_kernel_name(k)) == 0) {
+                kernel = k;
+            }
+        }
+    }
+    DatapathModel model(kernel, num_threads);
+
+    string mode = argv[1];
+    if (mode == "sweep") {
+        return run_sweep(model, argc > 2 ? argv[2] : nullptr);
+    }
+    if (mode == "compare" && argc > 2) {
+        return run_compare(model, argv[2]);
+    }
+    if (mode == "bench") {
+        size_t count = argc > 2 ? strtoull(argv[2], nullptr, 10) : (1u << 24);
+        return run_bench(model.num_threads(), count);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
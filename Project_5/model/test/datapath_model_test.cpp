@@ -0,0 +1,89 @@
+#include "../include/datapath_model.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string& message) {
+    if (!condition) {
+        cout << "FAILED: " << message << endl;
+        failures++;
+    }
+}
+
+// Vectors checked by bist.v and the hand-computed cases in datapath_tb.v
+static void test_known_vectors() {
+    // BIST: (3*3) + (4*5) = 29 and (2*5) + 16 = 26
+    check(datapath_altitude(3, 4) == 29, "BIST altitude vector");
+    check(datapath_battery(2, 5, 16) == 26, "BIST battery vector");
+
+    // datapath_tb.v test cases 2 and 3
+    check(datapath_altitude(10, 15) == 105, "datapath_tb altitude case 2");
+    check(datapath_battery(12, 8, 20) == 116, "datapath_tb battery case 2");
+    check(datapath_altitude(-5, 7) == 20, "datapath_tb altitude case 3");
+    check(datapath_battery(-3, -2, 10) == 16, "datapath_tb battery case 3");
+
+    // Extremes of the 8-bit input range
+    check(datapath_altitude(-128, -128) == -1024, "altitude minimum");
+    check(datapath_altitude(127, 127) == 1016, "altitude maximum");
+    check(datapath_battery(-128, -128, 127) == 16511, "battery maximum");
+    check(datapath_battery(-128, 127, -128) == -16384, "battery minimum");
+}
+
+// Every kernel and thread count must agree with the scalar reference
+static void test_kernels() {
+    const size_t count = 100003; // Not a multiple of any SIMD width
+
+    DatapathBatch batch;
+    batch.resize_altitude(count);
+    batch.resize_battery(count);
+
+    mt19937 rng(460);
+    uniform_int_distribution<int> byte(-128, 127);
+    for (size_t i = 0; i < count; i++) {
+        batch.x1[i] = static_cast<int8_t>(byte(rng));
+        batch.x2[i] = static_cast<int8_t>(byte(rng));
+        batch.v[i] = static_cast<int8_t>(byte(rng));
+        batch.t[i] = static_cast<int8_t>(byte(rng));
+        batch.c[i] = static_cast<int8_t>(byte(rng));
+    }
+
+    for (DatapathKernel kernel : {DatapathKernel::SCALAR, DatapathKernel::SSE2, DatapathKernel::AVX2}) {
+        if (!datapath_kernel_supported(kernel)) {
+            cout << datapath_kernel_name(kernel) << " not supported, skipped" << endl;
+            continue;
+        }
+        for (unsigned threads : {1u, 4u}) {
+            DatapathModel model(kernel, threads);
+            fill(batch.result_a.begin(), batch.result_a.end(), 0x5555);
+            fill(batch.result_b.begin(), batch.result_b.end(), 0x5555);
+            model.evaluate(batch);
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < count; i++) {
+                mismatches += batch.result_a[i] != datapath_altitude(batch.x1[i], batch.x2[i]);
+                mismatches += batch.result_b[i] != datapath_battery(batch.v[i], batch.t[i], batch.c[i]);
+            }
+            check(mismatches == 0, string(datapath_kernel_name(kernel)) + " with " +
+                  to_string(threads) + " threads: " + to_string(mismatches) + " mismatches");
+        }
+    }
+}
+
+int main() {
+    cout << "Starting datapath model tests..." << endl;
+
+    test_known_vectors();
+    test_kernels();
+
+    if (failures == 0) {
+        cout << "All tests completed successfully!" << endl;
+        return 0;
+    }
+    cout << failures << " check(s) failed" << endl;
+    return 1;
+}
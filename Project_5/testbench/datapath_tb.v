@@ -132,6 +132,20 @@ module datapath_tb;
         end
     endfunction
     
+    // Optional vector dump for the C++ golden model (model/datapath_sweep compare)
+    // Enable with the +dump_vectors plusarg
+    integer dump_file = 0;
+    integer dump_edges = 0;
+    reg dump_strobe;
+    reg [40:0] dump_in_d1, dump_in_d2;  // {sel_eq, x1, x2, v, t, c} one and two edges back
+    reg [40:0] dump_inputs;
+    initial begin
+        if ($test$plusargs("dump_vectors")) begin
+            dump_file = $fopen("datapath_vectors.txt", "w");
+            $fdisplay(dump_file, "# datapath_tb vector dump: A x1 x2 result_a | B v t c result_b");
+        end
+    end
+    
     // Check results at appropriate times
     always @(posedge clk) begin
         if (!rst) begin
@@ -148,4 +162,36 @@ module datapath_tb;
         end
     end
     
+    // Dump each result at its valid strobe: the result registers load on the
+    // edges where first_term is low, selected by sel_eq_stage2, so the result
+    // belongs to the inputs applied two edges earlier. Sampling the current
+    // inputs instead would pair them with a lagging result.
+    always @(posedge clk) begin
+        if (dump_file && !rst) begin
+            // Read before the edge's nonblocking updates land
+            dump_strobe = !uut.first_term && dump_edges >= 2;
+            dump_inputs = dump_in_d2;
+            if (dump_strobe) begin
+                #1;
+                if (dump_inputs[40] == 0)
+                    $fdisplay(dump_file, "A %0d %0d %0d", $signed(dump_inputs[39:32]),
+                              $signed(dump_inputs[31:24]), $signed(result_a));
+                else
+                    $fdisplay(dump_file, "B %0d %0d %0d %0d", $signed(dump_inputs[23:16]),
+                              $signed(dump_inputs[15:8]), $signed(dump_inputs[7:0]), $signed(result_b));
+            end
+        end
+    end
+    
+    // Input history for the dump, shifted on every edge out of reset
+    always @(posedge clk) begin
+        if (rst) begin
+            dump_edges <= 0;
+        end else begin
+            dump_in_d2 <= dump_in_d1;
+            dump_in_d1 <= {sel_eq, x1, x2, v, t, c};
+            dump_edges <= dump_edges + 1;
+        end
+    end
+    
 endmodule
@@ -0,0 +1,153 @@
+#ifndef CYCLE_SKIP_H
+#define CYCLE_SKIP_H
+
+#include <systemc.h>
+#include "timeline_trace.h"
+#include <vector>
+
+// Base class for clocked models that can run in activity-driven mode.
+//
+// An SC_CTHREAD wakes on every clock edge whether or not anything it reads
+// has changed. A CycleSkipModule instead declares the inputs its next-state
+// function depends on (depends_on), and once the model reports that further
+// edges with the current inputs would not change anything observable
+// (quiescent), the process stops listening to the clock and sleeps until one
+// of those inputs changes. It then rejoins the clock at the first edge that
+// samples the new value, and the edges slept through are handed to
+// skip_edges() in one call so the model can account for them in closed form.
+//
+// The model sees exactly the edges and input values an SC_CTHREAD on
+// clk.pos() would, so its outputs are identical; only the process
+// activations for idle edges go away. With timeline tracing on, each
+// evaluated edge is a slice on the module's track and each stretch of
+// elided edges an "idle" slice, so the two modes can be seen side by side.
+class CycleSkipModule : public sc_module {
+public:
+    sc_in<bool> clk;  // Must be bound to an sc_clock
+
+    // Activation statistics
+    unsigned long activations() const { return m_activations; }    // Times the process ran
+    unsigned long edges() const { return m_edges; }                // Clock edges accounted for
+    unsigned long elided_edges() const { return m_elided_edges; }  // Edges covered by skip_edges()
+
+protected:
+    SC_HAS_PROCESS(CycleSkipModule);
+    CycleSkipModule(sc_module_name name) :
+        sc_module(name),
+        clk("clk"),
+        m_activations(0),
+        m_edges(0),
+        m_elided_edges(0),
+        m_timeline(this->name()) {
+        SC_THREAD(run);
+    }
+
+    // Declare an input read by clock_edge(); call from the constructor
+    template <typename T>
+    void depends_on(sc_in<T>& port) {
+        m_inputs.push_back(new InputWatcher<T>(port));
+    }
+
+    // State at the first clock edge (the code before the first wait() of an
+    // SC_CTHREAD)
+    virtual void reset_state() = 0;
+
+    // One rising clock edge with the current input values
+    virtual void clock_edge() = 0;
+
+    // True if any number of further edges with the current input values
+    // would leave every output unchanged
+    virtual bool quiescent() const = 0;
+
+    // Apply n edges that were skipped while quiescent. Outputs must not
+    // change; by default the state is a fixed point and nothing happens.
+    virtual void skip_edges(unsigned long n) {
+        (void)n;
+    }
+
+    virtual ~CycleSkipModule() {
+        for (size_t i = 0; i < m_inputs.size(); i++) {
+            delete m_inputs[i];
+        }
+    }
+
+private:
+    // Type-erased handle on a declared input port
+    struct InputWatcherBase {
+        virtual ~InputWatcherBase() {}
+        virtual const sc_event& changed() const = 0;
+    };
+
+    template <typename T>
+    struct InputWatcher : InputWatcherBase {
+        sc_in<T>& port;
+        explicit InputWatcher(sc_in<T>& p) : port(p) {}
+        const sc_event& changed() const { return port.value_changed_event(); }
+    };
+
+    std::vector<InputWatcherBase*> m_inputs;
+    unsigned long m_activations;
+    unsigned long m_edges;
+    unsigned long m_elided_edges;
+    TimelineTrack m_timeline;
+
+    void run() {
+        sc_clock* clock = dynamic_cast<sc_clock*>(clk.get_interface());
+        if (!clock) {
+            SC_REPORT_ERROR("CycleSkipModule", "clk must be bound to an sc_clock");
+            return;
+        }
+        const sc_time period = clock->period();
+
+        // Ports are bound by now, so the input events can be collected
+        sc_event_or_list inputs_changed;
+        for (size_t i = 0; i < m_inputs.size(); i++) {
+            inputs_changed |= m_inputs[i]->changed();
+        }
+
+        wait(clk.posedge_event());
+        m_activations++;
+        m_edges++;
+        reset_state();
+        sc_time last_edge = sc_time_stamp();
+
+        while (true) {
+            if (!quiescent()) {
+                // Clocked mode: evaluate every edge while outputs are moving
+                wait(clk.posedge_event());
+            } else {
+                if (m_inputs.empty()) {
+                    return;  // Nothing can ever change again
+                }
+
+                // Activity-driven mode: sleep through the idle edges
+                wait(inputs_changed);
+
+                // A change in the same delta as a clock edge is sampled by
+                // that edge; a change after it waits for the next one
+                if (!clk.posedge()) {
+                    m_activations++;
+                    wait(clk.posedge_event());
+                }
+
+                unsigned long skipped = static_cast<unsigned long>((sc_time_stamp() - last_edge) / period + 0.5) - 1;
+                if (skipped > 0) {
+                    TimelineTrace::span(m_timeline.id(), "idle", last_edge + period, sc_time_stamp());
+                    skip_edges(skipped);
+                    m_edges += skipped;
+                    m_elided_edges += skipped;
+                }
+            }
+
+            m_activations++;
+            m_edges++;
+            {
+                TimelineScope scope(m_timeline, "clock_edge");
+                clock_edge();
+            }
+            last_edge = sc_time_stamp();
+        }
+    }
+};
+
+#endif // CYCLE_SKIP_H
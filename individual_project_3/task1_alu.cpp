@@ -1,4 +1,5 @@
 #include <systemc.h>
+#include "timeline_trace.h"
 
 // ALU module definition
 SC_MODULE(ALU) {
@@ -7,8 +8,13 @@ SC_MODULE(ALU) {
     sc_in<sc_uint<2>> opcode;       // Control signal
     sc_out<int> result;             // Result output
     
+    // Timeline track for this instance
+    TimelineTrack timeline;
+    
     // Process function
     void compute() {
+        TimelineScope scope(timeline, "compute");
+        
         // Perform operation based on opcode
         switch (opcode.read()) {
             case 0:  // 00 -> Addition
@@ -30,7 +36,7 @@ SC_MODULE(ALU) {
     }
     
     // Constructor
-    SC_CTOR(ALU) {
+    SC_CTOR(ALU) : timeline(name()) {
         // Register compute method and make it sensitive to all inputs
         SC_METHOD(compute);
         sensitive << a << b << opcode;
@@ -39,6 +45,9 @@ SC_MODULE(ALU) {
 
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // --trace <file> writes a Chrome/Perfetto timeline of the modules
+    TimelineTrace::configure(argc, argv);
+    
     // Create signals
     sc_signal<int> a_sig, b_sig, result_sig;
     sc_signal<sc_uint<2>> opcode_sig;
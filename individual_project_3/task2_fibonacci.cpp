@@ -1,22 +1,31 @@
 #include <systemc.h>
+#include "timeline_trace.h"
 
 // Fibonacci Sequence Generator module
 SC_MODULE(FibonacciGenerator) {
     // Output port
     sc_out<int> fib_out;
     
+    // Timeline track for this instance
+    TimelineTrack timeline;
+    
     // Process function
     void generate_sequence() {
+        // One slice over the whole sequence, with an instant per output
+        TimelineScope scope(timeline, "generate_sequence");
+        
         // Initialize first two Fibonacci numbers
         int a = 0, b = 1, c;
         
         // Output the first Fibonacci number (0)
         fib_out.write(a);
+        TimelineTrace::instant(timeline.id(), "output");
         cout << "Time: " << sc_time_stamp() << " Fibonacci: " << a << endl;
         wait(3, SC_NS);
         
         // Output the second Fibonacci number (1)
         fib_out.write(b);
+        TimelineTrace::instant(timeline.id(), "output");
         cout << "Time: " << sc_time_stamp() << " Fibonacci: " << b << endl;
         wait(3, SC_NS);
         
@@ -24,6 +33,7 @@ SC_MODULE(FibonacciGenerator) {
         for (int i = 2; i < 8; i++) {
             c = a + b;
             fib_out.write(c);
+            TimelineTrace::instant(timeline.id(), "output");
             cout << "Time: " << sc_time_stamp() << " Fibonacci: " << c << endl;
             a = b;
             b = c;
@@ -36,7 +46,7 @@ SC_MODULE(FibonacciGenerator) {
     }
     
     // Constructor
-    SC_CTOR(FibonacciGenerator) {
+    SC_CTOR(FibonacciGenerator) : timeline(name()) {
         // Register the thread process
         SC_THREAD(generate_sequence);
     }
@@ -44,6 +54,9 @@ SC_MODULE(FibonacciGenerator) {
 
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // --trace <file> writes a Chrome/Perfetto timeline of the modules
+    TimelineTrace::configure(argc, argv);
+    
     // Create signal
     sc_signal<int> fib_sig;
     
@@ -1,4 +1,7 @@
 #include <systemc.h>
+#include <cstring>
+#include "cycle_skip.h"
+#include "timeline_trace.h"
 
 // 4-bit Serial-In Parallel-Out (SIPO) Shift Register
 SC_MODULE(ShiftRegister) {
@@ -11,8 +14,17 @@ SC_MODULE(ShiftRegister) {
     // Internal register to hold the 4 bits
     sc_uint<4> reg_value;
     
+    // Number of times the process has run
+    unsigned long activations;
+    
+    // Timeline track for this instance
+    TimelineTrack timeline;
+    
     // Process function
     void shift_process() {
+        // Entered at the first clock edge and again on every reset edge
+        activations++;
+        
         // Initialize register value
         reg_value = 0;
         
@@ -20,6 +32,8 @@ SC_MODULE(ShiftRegister) {
         while (true) {
             // Wait for the positive edge of the clock
             wait();
+            activations++;
+            TimelineScope scope(timeline, "shift");
             
             // Check for reset
             if (reset.read()) {
@@ -36,7 +50,7 @@ SC_MODULE(ShiftRegister) {
     }
     
     // Constructor
-    SC_CTOR(ShiftRegister) {
+    SC_CTOR(ShiftRegister) : activations(0), timeline(name()) {
         // Register the clocked thread process
         SC_CTHREAD(shift_process, clk.pos());
         // Specify reset behavior
@@ -44,8 +58,151 @@ SC_MODULE(ShiftRegister) {
     }
 };
 
+// The same shift register in activity-driven mode. Once the register holds
+// the value the current inputs would keep shifting in (all ones, all zeros,
+// or zero under reset) and the output shows it, every further edge is a
+// no-op, so the process sleeps until reset or serial_in changes.
+class ShiftRegisterSkip : public CycleSkipModule {
+public:
+    sc_in<bool> reset;         // Reset input
+    sc_in<bool> serial_in;     // Serial input bit
+    sc_out<sc_uint<4>> parallel_out;  // 4-bit parallel output
+    
+    // Constructor
+    ShiftRegisterSkip(sc_module_name name) :
+        CycleSkipModule(name),
+        reset("reset"),
+        serial_in("serial_in"),
+        parallel_out("parallel_out") {
+        depends_on(reset);
+        depends_on(serial_in);
+    }
+    
+protected:
+    sc_uint<4> reg_value;
+    sc_uint<4> out_value;      // Last value driven onto parallel_out
+    
+    void reset_state() {
+        reg_value = 0;
+        out_value = parallel_out.read();
+    }
+    
+    void clock_edge() {
+        if (reset.read()) {
+            // The SC_CTHREAD restarts on a reset edge and never reaches
+            // its output write, so the output keeps its old value
+            reg_value = 0;
+        } else {
+            reg_value = (reg_value << 1) | serial_in.read();
+            out_value = reg_value;
+            parallel_out.write(reg_value);
+        }
+    }
+    
+    bool quiescent() const {
+        if (reset.read()) {
+            return reg_value == 0;
+        }
+        sc_uint<4> fill = serial_in.read() ? 0xF : 0x0;
+        return reg_value == fill && out_value == reg_value;
+    }
+    
+    // Skipped edges shift the fill bit into a register already full of it,
+    // so skip_edges() keeps the default no-op
+};
+
+// Stimulus segment for the cycle-skipping comparison
+struct StimulusSegment {
+    bool reset;
+    bool serial_in;
+    unsigned cycles;
+};
+
+// Drive the SC_CTHREAD model and the cycle-skipping model with the same
+// inputs, including long idle stretches, and compare their outputs cycle by
+// cycle
+static int run_skip_comparison() {
+    sc_clock clock("clock", 5, SC_NS);  // 5ns period clock
+    sc_signal<bool> reset_sig, serial_in_sig;
+    sc_signal<sc_uint<4>> cthread_out_sig, skip_out_sig;
+    
+    ShiftRegister shift_reg("shift_register");
+    shift_reg.clk(clock);
+    shift_reg.reset(reset_sig);
+    shift_reg.serial_in(serial_in_sig);
+    shift_reg.parallel_out(cthread_out_sig);
+    
+    ShiftRegisterSkip skip_reg("shift_register_skip");
+    skip_reg.clk(clock);
+    skip_reg.reset(reset_sig);
+    skip_reg.serial_in(serial_in_sig);
+    skip_reg.parallel_out(skip_out_sig);
+    
+    // The task's bit stream, then idle stretches of ones, zeros and reset
+    // separated by short bursts of activity
+    const StimulusSegment segments[] = {
+        {false, true, 1}, {false, false, 1}, {false, true, 1}, {true, true, 1},
+        {false, true, 1}, {false, false, 1}, {false, true, 1},
+        {false, true, 2000}, {true, false, 300}, {false, false, 1000},
+        {false, true, 1}, {false, true, 1}, {false, false, 3000},
+        {true, false, 500}, {true, true, 500},
+        {false, true, 2}, {false, false, 1}, {false, true, 4000},
+        {false, false, 1}, {false, true, 1}, {false, true, 1}, {false, false, 1},
+        {false, false, 2000}
+    };
+    
+    unsigned long cycles = 0;
+    unsigned long mismatches = 0;
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        reset_sig.write(segments[i].reset);
+        serial_in_sig.write(segments[i].serial_in);
+        
+        for (unsigned c = 0; c < segments[i].cycles; c++) {
+            if (c == segments[i].cycles / 2 && segments[i].cycles > 100) {
+                // A pulse on serial_in between two edges is never sampled
+                // but still wakes the cycle-skipping model
+                sc_start(1, SC_NS);
+                serial_in_sig.write(!segments[i].serial_in);
+                sc_start(2, SC_NS);
+                serial_in_sig.write(segments[i].serial_in);
+                sc_start(2, SC_NS);
+            } else {
+                sc_start(5, SC_NS);
+            }
+            cycles++;
+            
+            if (cthread_out_sig.read() != skip_out_sig.read()) {
+                if (mismatches == 0) {
+                    cout << "Mismatch at " << sc_time_stamp() << ": SC_CTHREAD " << cthread_out_sig.read()
+                         << ", cycle-skip " << skip_out_sig.read() << endl;
+                }
+                mismatches++;
+            }
+        }
+    }
+    
+    cout << "\n----- Cycle-Skipping Comparison -----\n";
+    cout << "Clock cycles:            " << cycles << endl;
+    cout << "SC_CTHREAD activations:  " << shift_reg.activations << endl;
+    cout << "Cycle-skip activations:  " << skip_reg.activations() << " (" << skip_reg.elided_edges()
+         << " idle edges elided)" << endl;
+    cout << "Output mismatches:       " << mismatches << endl;
+    cout << "Result:                  " << (mismatches == 0 ? "SUCCESS" : "FAILED") << endl;
+    
+    return mismatches == 0 ? 0 : 1;
+}
+
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // --trace <file> writes a Chrome/Perfetto timeline of the modules
+    TimelineTrace::configure(argc, argv);
+    
+    // --skip (first) compares the SC_CTHREAD model against the cycle-skipping
+    // model
+    if (argc > 1 && strcmp(argv[1], "--skip") == 0) {
+        return run_skip_comparison();
+    }
+    
     // Create signals
     sc_clock clock("clock", 5, SC_NS);  // 5ns period clock
     sc_signal<bool> reset_sig, serial_in_sig;
@@ -0,0 +1,247 @@
+#ifndef FIR_ENGINE_H
+#define FIR_ENGINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIR_ENGINE_X86 1
+#endif
+
+// Kernel selection for FirEngine::process
+enum class FirKernel {
+    AUTO,    // Widest kernel the CPU supports
+    SCALAR,  // One output sample per iteration
+    SSE2,    // 8 output samples per iteration (16-bit lanes)
+    AVX2     // 16 output samples per iteration (16-bit lanes)
+};
+
+inline const char* fir_kernel_name(FirKernel kernel) {
+    switch (kernel) {
+        case FirKernel::SCALAR: return "scalar";
+        case FirKernel::SSE2:   return "sse2";
+        case FirKernel::AVX2:   return "avx2";
+        default:                return "auto";
+    }
+}
+
+// Returns true if the kernel can run on this CPU
+inline bool fir_kernel_supported(FirKernel kernel) {
+    switch (kernel) {
+        case FirKernel::SCALAR:
+        case FirKernel::AUTO:
+            return true;
+#ifdef FIR_ENGINE_X86
+        case FirKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case FirKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Coefficient as the RTL multiplies it: 8-bit, sign-extended only when the
+// product is signed
+template <typename Sample>
+constexpr int16_t fir_coefficient(int tap) {
+    return std::is_signed<Sample>::value ?
+        static_cast<int16_t>(static_cast<int8_t>(tap)) :
+        static_cast<int16_t>(static_cast<uint8_t>(tap));
+}
+
+// Streaming FIR filter with the fixed-point semantics of project_4's RTL:
+//   acc  = sum(x[n-k] * h[k])   computed modulo 2^16 (16-bit accumulator)
+//   y[n] = acc[15:8]            upper byte written back to the BRAM
+//
+// Sample selects how the 8-bit BRAM word enters the multiply:
+//   int8_t  - signed, as in fir_pipelined.v (x registers declared signed)
+//   uint8_t - unsigned, as in fir_non_pipelined.v, where mem_data_out_a is an
+//             unsigned wire and Verilog evaluates the whole product unsigned
+//
+// Taps are 8-bit coefficients, h[0] first. Samples before the first call are
+// zero, and the last (N-1) input samples are carried across process() calls
+// so a capture can be filtered in arbitrary blocks.
+template <typename Sample, int... Taps>
+class FirEngine {
+    static_assert(std::is_same<Sample, int8_t>::value || std::is_same<Sample, uint8_t>::value,
+                  "FIR samples are 8-bit BRAM words");
+    static_assert(sizeof...(Taps) > 0, "FIR needs at least one tap");
+
+public:
+    static constexpr size_t NUM_TAPS = sizeof...(Taps);
+    static constexpr size_t HISTORY = NUM_TAPS - 1;
+
+    explicit FirEngine(FirKernel kernel = FirKernel::AUTO) {
+        select_kernel(kernel);
+        reset();
+    }
+
+    // Clear the sample history (equivalent to a reset of the x registers)
+    void reset() {
+        m_history.fill(0);
+    }
+
+    // Switch kernels; returns false (and keeps the current kernel) when the
+    // CPU cannot run the requested one
+    bool select_kernel(FirKernel kernel) {
+        if (kernel == FirKernel::AUTO) {
+            m_kernel = fir_kernel_supported(FirKernel::AVX2) ? FirKernel::AVX2 :
+                       fir_kernel_supported(FirKernel::SSE2) ? FirKernel::SSE2 : FirKernel::SCALAR;
+            return true;
+        }
+        if (!fir_kernel_supported(kernel)) {
+            return false;
+        }
+        m_kernel = kernel;
+        return true;
+    }
+
+    FirKernel kernel() const { return m_kernel; }
+
+    // Filter count samples from in into out, continuing from the previous call
+    void process(const Sample* in, int8_t* out, size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+        // Outputs whose window reaches back into the previous block
+        size_t head = (count < HISTORY) ? count : HISTORY;
+        for (size_t n = 0; n < head; n++) {
+            out[n] = output_from_history(in, n);
+        }
+
+        // Remaining outputs only read samples of this block
+        if (count > head) {
+            switch (m_kernel) {
+#ifdef FIR_ENGINE_X86
+                case FirKernel::AVX2:
+                    process_avx2(in, out, head, count);
+                    break;
+                case FirKernel::SSE2:
+                    process_sse2(in, out, head, count);
+                    break;
+#endif
+                default:
+                    process_scalar(in, out, head, count);
+                    break;
+            }
+        }
+
+        update_history(in, count);
+    }
+
+private:
+    static constexpr int16_t H[NUM_TAPS] = { fir_coefficient<Sample>(Taps)... };
+
+    FirKernel m_kernel;
+
+    // m_history[0] is the most recent sample of the previous block
+    std::array<Sample, (HISTORY > 0 ? HISTORY : 1)> m_history;
+
+    static int8_t upper_byte(uint32_t acc) {
+        return static_cast<int8_t>(static_cast<uint8_t>((acc >> 8) & 0xFF));
+    }
+
+    // Output n of a block whose window may reach back into the history
+    int8_t output_from_history(const Sample* in, size_t n) const {
+        uint32_t acc = 0;
+        for (size_t k = 0; k < NUM_TAPS; k++) {
+            Sample x = (k <= n) ? in[n - k] : m_history[k - n - 1];
+            acc += static_cast<uint32_t>(static_cast<int32_t>(x) * H[k]);
+        }
+        return upper_byte(acc);
+    }
+
+    void update_history(const Sample* in, size_t count) {
+        if (HISTORY == 0) {
+            return;
+        }
+        if (count >= HISTORY) {
+            for (size_t k = 0; k < HISTORY; k++) {
+                m_history[k] = in[count - 1 - k];
+            }
+        } else {
+            // Shift the old history back by count samples
+            for (size_t k = HISTORY; k-- > count;) {
+                m_history[k] = m_history[k - count];
+            }
+            for (size_t k = 0; k < count; k++) {
+                m_history[k] = in[count - 1 - k];
+            }
+        }
+    }
+
+    static void process_scalar(const Sample* in, int8_t* out, size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            uint32_t acc = 0;
+            for (size_t k = 0; k < NUM_TAPS; k++) {
+                acc += static_cast<uint32_t>(static_cast<int32_t>(in[n - k]) * H[k]);
+            }
+            out[n] = upper_byte(acc);
+        }
+    }
+
+#ifdef FIR_ENGINE_X86
+    // The 16-bit lanes wrap exactly like the RTL accumulator, so mullo/add
+    // give the same bits as the hardware without any widening.
+    __attribute__((target("sse2")))
+    static __m128i widen_sse2(__m128i bytes) {
+        if (std::is_signed<Sample>::value) {
+            return _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+        }
+        return _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+    }
+
+    __attribute__((target("sse2")))
+    static void process_sse2(const Sample* in, int8_t* out, size_t begin, size_t end) {
+        size_t n = begin;
+        for (; n + 8 <= end; n += 8) {
+            __m128i acc = _mm_setzero_si128();
+            for (size_t k = 0; k < NUM_TAPS; k++) {
+                __m128i x = widen_sse2(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + n - k)));
+                acc = _mm_add_epi16(acc, _mm_mullo_epi16(x, _mm_set1_epi16(H[k])));
+            }
+            __m128i y = _mm_packs_epi16(_mm_srai_epi16(acc, 8), _mm_setzero_si128());
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + n), y);
+        }
+        process_scalar(in, out, n, end);
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i widen_avx2(__m128i bytes) {
+        if (std::is_signed<Sample>::value) {
+            return _mm256_cvtepi8_epi16(bytes);
+        }
+        return _mm256_cvtepu8_epi16(bytes);
+    }
+
+    __attribute__((target("avx2")))
+    static void process_avx2(const Sample* in, int8_t* out, size_t begin, size_t end) {
+        size_t n = begin;
+        for (; n + 16 <= end; n += 16) {
+            __m256i acc = _mm256_setzero_si256();
+            for (size_t k = 0; k < NUM_TAPS; k++) {
+                __m256i x = widen_avx2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + n - k)));
+                acc = _mm256_add_epi16(acc, _mm256_mullo_epi16(x, _mm256_set1_epi16(H[k])));
+            }
+            // Arithmetic shift keeps acc[15:8] in int8 range, so the pack never saturates
+            __m256i y = _mm256_srai_epi16(acc, 8);
+            __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), packed);
+        }
+        process_sse2(in, out, n, end);
+    }
+#endif
+};
+
+// The project_4 filter (h = 1, 2, 3, 2, 1) as built by each RTL architecture
+using FirPipelinedModel = FirEngine<int8_t, 1, 2, 3, 2, 1>;
+using FirNonPipelinedModel = FirEngine<uint8_t, 1, 2, 3, 2, 1>;
+
+#endif // FIR_ENGINE_H
@@ -0,0 +1,119 @@
+#include "../include/fir_engine.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Samples per process() call when streaming a capture
+constexpr size_t BLOCK_SAMPLES = 64 * 1024;
+
+// Sample rate the pipelined RTL sustains: one sample per 100 MHz clock
+constexpr double RTL_SAMPLE_RATE = 100e6;
+
+// Same stimulus as fir_tb.v: a 40-sample-period sine scaled to +/-64
+static vector<int8_t> make_sine_capture(size_t count) {
+    vector<int8_t> samples(count);
+    const double pi = 3.14159265359;
+    for (size_t i = 0; i < count; i++) {
+        double angle = (i % 40) * (2.0 * pi / 40.0);
+        samples[i] = static_cast<int8_t>(static_cast<int>(sin(angle) * 64.0));
+    }
+    return samples;
+}
+
+// Filter a capture in BLOCK_SAMPLES blocks and return the elapsed seconds
+template <typename Engine>
+static double run_stream(Engine& engine, const vector<int8_t>& in, vector<int8_t>& out) {
+    auto start_time = chrono::high_resolution_clock::now();
+    for (size_t offset = 0; offset < in.size(); offset += BLOCK_SAMPLES) {
+        size_t count = min(BLOCK_SAMPLES, in.size() - offset);
+        engine.process(in.data() + offset, out.data() + offset, count);
+    }
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(end_time - start_time).count();
+}
+
+static bool read_capture(const string& path, vector<int8_t>& samples) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    samples.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    size_t got = fread(samples.data(), 1, samples.size(), f);
+    fclose(f);
+    return got == samples.size();
+}
+
+static bool write_capture(const string& path, const vector<int8_t>& samples) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    size_t put = fwrite(samples.data(), 1, samples.size(), f);
+    fclose(f);
+    return put == samples.size();
+}
+
+int main(int argc, char* argv[]) {
+    // Usage: fir_stream [input.raw [output.raw]]
+    // Input and output are raw signed 8-bit samples. Without an input file a
+    // 16M-sample sine capture is generated.
+    vector<int8_t> capture;
+    if (argc > 1) {
+        if (!read_capture(argv[1], capture)) {
+            cerr << "Failed to read capture " << argv[1] << endl;
+            return 1;
+        }
+    } else {
+        capture = make_sine_capture(16 * 1024 * 1024);
+    }
+
+    cout << "=== Project 4 FIR Golden Model (h = 1, 2, 3, 2, 1) ===" << endl;
+    cout << "Samples: " << capture.size() << ", block size: " << BLOCK_SAMPLES << endl;
+    cout << left << setw(10) << "Kernel" << right << setw(14) << "Time (ms)"
+         << setw(16) << "MSamples/sec" << setw(14) << "x real-time" << endl;
+
+    vector<int8_t> reference(capture.size());
+    vector<int8_t> filtered(capture.size());
+    bool all_match = true;
+
+    for (FirKernel kernel : {FirKernel::SCALAR, FirKernel::SSE2, FirKernel::AVX2}) {
+        if (!fir_kernel_supported(kernel)) {
+            cout << left << setw(10) << fir_kernel_name(kernel) << right << setw(14) << "unsupported" << endl;
+            continue;
+        }
+
+        FirPipelinedModel engine(kernel);
+        vector<int8_t>& out = (kernel == FirKernel::SCALAR) ? reference : filtered;
+        double seconds = run_stream(engine, capture, out);
+
+        if (kernel != FirKernel::SCALAR && memcmp(reference.data(), filtered.data(), capture.size()) != 0) {
+            all_match = false;
+        }
+
+        double rate = capture.size() / seconds;
+        cout << left << setw(10) << fir_kernel_name(kernel) << right << fixed
+             << setw(14) << setprecision(2) << seconds * 1e3
+             << setw(16) << setprecision(1) << rate / 1e6
+             << setw(13) << setprecision(2) << rate / RTL_SAMPLE_RATE << "x" << endl;
+    }
+
+    cout << "Kernels bit-exact with scalar reference: " << (all_match ? "YES" : "NO") << endl;
+
+    if (argc > 2 && !write_capture(argv[2], reference)) {
+        cerr << "Failed to write " << argv[2] << endl;
+        return 1;
+    }
+
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#ifndef FIR_BRAM_MODEL_H
+#define FIR_BRAM_MODEL_H
+
+#include "fir_types.h"
+#include <systemc>
+#include <vector>
+
+// Counters collected by the BRAM
+struct FirBramStats {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t port_conflicts = 0;    // Accesses refused because the port was already used this edge
+    uint64_t collisions = 0;        // Read and write of the same address on the same edge
+};
+
+// Model of bram_memory.v: two ports, each good for one access per clock
+// edge. The filters call read/write on the edge they drive the port. A
+// second access to a port on the same edge is refused, so the caller has
+// to stall; that is where the port conflicts in a shared-port
+// configuration come from.
+//
+// A read returns the word as it was before any write on the same edge
+// (read-first, as bram_memory.v does with its non-blocking writes), and
+// the caller may only use it read_latency edges later.
+//
+// Note: bram_memory.v registers the address and then the data, so its
+// real read latency is two edges. Both RTL filters use mem_data_out_a one
+// edge after driving the address, which is the read_latency = 1 the
+// models default to. That reproduces the logged cycle counts; the
+// filters' stale reads are not modeled (see the README).
+class FirBramModel : public sc_core::sc_module {
+public:
+    FirBramModel(sc_core::sc_module_name name,
+                 unsigned depth = FIR_BRAM_DEPTH,
+                 unsigned read_latency = 1,
+                 sc_core::sc_time clock_period = fir_clock_period(FIR_CLOCK_MHZ)) :
+        sc_core::sc_module(name),
+        m_mem(depth, 0),
+        m_read_latency(read_latency),
+        m_clock_period(clock_period) {
+
+        if (read_latency == 0) {
+            SC_REPORT_ERROR("FirBramModel", "Read latency must be at least one cycle");
+        }
+        m_port_edge[FIR_PORT_A] = m_port_edge[FIR_PORT_B] = sc_core::sc_time::from_value(~0ull);
+        m_read.edge = m_write.edge = m_port_edge[FIR_PORT_A];
+    }
+
+    // Read on the current edge. Returns false, and does nothing, if the
+    // port was already used on this edge. ready is the edge from which the
+    // data may be used.
+    bool read(unsigned port, unsigned addr, uint8_t& data, sc_core::sc_time& ready) {
+        if (!claim(port)) {
+            return false;
+        }
+        check_address(addr);
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        data = m_mem[addr];
+        if (m_write.edge == now && m_write.addr == addr) {
+            data = m_write.old_data;
+            m_stats.collisions++;
+        }
+        m_read.edge = now;
+        m_read.addr = addr;
+        ready = now + m_clock_period * static_cast<double>(m_read_latency);
+        m_stats.reads++;
+        return true;
+    }
+
+    // Write on the current edge; false if the port is taken
+    bool write(unsigned port, unsigned addr, uint8_t data) {
+        if (!claim(port)) {
+            return false;
+        }
+        check_address(addr);
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        if (m_read.edge == now && m_read.addr == addr) {
+            m_stats.collisions++;
+        }
+        m_write.edge = now;
+        m_write.addr = addr;
+        m_write.old_data = m_mem[addr];
+        m_mem[addr] = data;
+        m_stats.writes++;
+        return true;
+    }
+
+    // Testbench access outside simulated time (the fir_tb.v preload)
+    void poke(unsigned addr, uint8_t data) { check_address(addr); m_mem[addr] = data; }
+    uint8_t peek(unsigned addr) const { return m_mem[addr % m_mem.size()]; }
+
+    // Accessors
+    unsigned depth() const { return static_cast<unsigned>(m_mem.size()); }
+    unsigned read_latency() const { return m_read_latency; }
+    const sc_core::sc_time& clock_period() const { return m_clock_period; }
+    const FirBramStats& stats() const { return m_stats; }
+
+private:
+    struct Access {
+        sc_core::sc_time edge;
+        unsigned addr = 0;
+        uint8_t old_data = 0;
+    };
+
+    std::vector<uint8_t> m_mem;
+    unsigned m_read_latency;
+    sc_core::sc_time m_clock_period;
+    sc_core::sc_time m_port_edge[2];    // Last edge each port was used on
+    Access m_read;                      // Last read and write, for collisions
+    Access m_write;
+    FirBramStats m_stats;
+
+    bool claim(unsigned port) {
+        sc_core::sc_time now = sc_core::sc_time_stamp();
+        if (m_port_edge[port] == now) {
+            m_stats.port_conflicts++;
+            return false;
+        }
+        m_port_edge[port] = now;
+        return true;
+    }
+
+    void check_address(unsigned addr) const {
+        if (addr >= m_mem.size()) {
+            SC_REPORT_ERROR("FirBramModel", "Address out of range");
+        }
+    }
+};
+
+#endif // FIR_BRAM_MODEL_H
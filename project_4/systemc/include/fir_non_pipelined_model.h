@@ -0,0 +1,118 @@
+#ifndef FIR_NON_PIPELINED_MODEL_H
+#define FIR_NON_PIPELINED_MODEL_H
+
+#include "fir_types.h"
+#include "fir_bram_model.h"
+#include <systemc>
+
+// Cycle model of fir_non_pipelined.v, generalized to any number of taps.
+// Every sample walks
+//   LOAD_X0 -> COMPUTE_X0 -> ... -> LOAD_X(T-1) -> COMPUTE_X(T-1) -> WRITE_RESULT -> CHECK_DONE
+// one state per clock. COMPUTE_Xk runs read_latency edges after its LOAD,
+// so a sample costs T * (read_latency + 1) + 2 cycles: 12 for the RTL's five
+// taps, and 241 cycles for fir_tb.v's 20 samples once the start edge is
+// counted.
+//
+// LOAD_Xk for n < k reads address 0 like the RTL, but the model adds zero
+// for it where the RTL multiplies whatever comes back.
+class FirNonPipelinedCycleModel : public sc_core::sc_module {
+public:
+    // Constructor
+    SC_HAS_PROCESS(FirNonPipelinedCycleModel);
+    FirNonPipelinedCycleModel(sc_core::sc_module_name name,
+                              FirBramModel& bram,
+                              const FirCoreConfig& config = FirCoreConfig()) :
+        sc_core::sc_module(name),
+        m_bram(bram),
+        m_config(config),
+        m_clock_period(bram.clock_period()),
+        m_input_addr(0),
+        m_output_addr(0),
+        m_sample_count(0),
+        m_done(false) {
+
+        if (config.coefficients.empty()) {
+            SC_REPORT_ERROR("FirNonPipelinedCycleModel", "At least one tap is needed");
+        }
+        SC_THREAD(run);
+    }
+
+    // Pulse start on the current edge
+    void start(unsigned input_addr, unsigned output_addr, unsigned sample_count) {
+        m_input_addr = input_addr;
+        m_output_addr = output_addr;
+        m_sample_count = sample_count;
+        m_done = false;
+        m_start_event.notify(sc_core::SC_ZERO_TIME);
+    }
+
+    // Accessors
+    bool done() const { return m_done; }
+    const sc_core::sc_event& done_event() const { return m_done_event; }
+    const FirCoreConfig& config() const { return m_config; }
+    const FirRunStats& stats() const { return m_stats; }
+
+private:
+    FirBramModel& m_bram;
+    FirCoreConfig m_config;
+    sc_core::sc_time m_clock_period;
+    unsigned m_input_addr;
+    unsigned m_output_addr;
+    unsigned m_sample_count;
+    bool m_done;
+    sc_core::sc_event m_start_event;
+    sc_core::sc_event m_done_event;
+    FirRunStats m_stats;
+
+    void run() {
+        while (true) {
+            // IDLE samples start on this edge
+            wait(m_start_event);
+            m_stats = FirRunStats();
+            m_stats.samples = m_sample_count;
+            m_stats.start = sc_core::sc_time_stamp();
+            wait(m_clock_period);
+
+            for (unsigned n = 0; n < m_sample_count; n++) {
+                uint16_t acc = 0;
+                for (unsigned k = 0; k < m_config.taps(); k++) {
+                    // LOAD_Xk drives mem_addr_a, waiting out a busy port
+                    unsigned addr = n >= k ? m_input_addr + n - k : 0;
+                    uint8_t data = 0;
+                    sc_core::sc_time ready;
+                    while (!m_bram.read(m_config.read_port(), addr, data, ready)) {
+                        m_stats.read_stalls++;
+                        wait(m_clock_period);
+                    }
+                    m_stats.reads++;
+
+                    // COMPUTE_Xk once mem_data_out_a holds the word
+                    wait(ready - sc_core::sc_time_stamp());
+                    if (n >= k) {
+                        acc = static_cast<uint16_t>(acc + static_cast<int8_t>(data) * m_config.coefficients[k]);
+                    }
+                    wait(m_clock_period);
+                }
+
+                // WRITE_RESULT stores accumulator[15:8]
+                while (!m_bram.write(m_config.write_port(), m_output_addr + n, static_cast<uint8_t>(acc >> 8))) {
+                    wait(m_clock_period);
+                }
+                m_stats.writes++;
+                wait(m_clock_period);
+
+                // CHECK_DONE raises done after the last sample
+                if (n + 1 < m_sample_count) {
+                    wait(m_clock_period);
+                }
+            }
+
+            m_stats.finish = sc_core::sc_time_stamp();
+            m_stats.cycles = fir_cycles(m_stats.finish - m_stats.start, m_clock_period) + 1;
+            m_done = true;
+            m_done_event.notify(sc_core::SC_ZERO_TIME);
+        }
+    }
+};
+
+#endif // FIR_NON_PIPELINED_MODEL_H
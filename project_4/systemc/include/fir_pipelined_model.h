@@ -0,0 +1,153 @@
+#ifndef FIR_PIPELINED_MODEL_H
+#define FIR_PIPELINED_MODEL_H
+
+#include "fir_types.h"
+#include "fir_bram_model.h"
+#include <systemc>
+#include <deque>
+#include <vector>
+
+// Cycle model of fir_pipelined.v, generalized to any number of taps and
+// pipeline registers. On every edge, in this order:
+//  - the output stage writes the result that has reached it
+//  - a word that has come back from the BRAM shifts into the tap window,
+//    and its result starts down pipeline_depth registers (sum_s2 and
+//    result_s3 in the RTL)
+//  - the input stage reads the next sample
+// A sample is therefore written read_latency + pipeline_depth edges after
+// its read. fir_pipelined.v spends one edge in PIPELINE_FILL before it
+// reads and one in DONE after the last write, so a run of N samples takes
+// N + read_latency + pipeline_depth + 3 cycles: 26 for fir_tb.v.
+//
+// With FirPortMap::SHARED the output write takes port A first and the
+// read that wanted the same edge stalls, so the filter settles at one
+// sample every two cycles.
+class FirPipelinedCycleModel : public sc_core::sc_module {
+public:
+    // Constructor
+    SC_HAS_PROCESS(FirPipelinedCycleModel);
+    FirPipelinedCycleModel(sc_core::sc_module_name name,
+                           FirBramModel& bram,
+                           const FirCoreConfig& config = FirCoreConfig()) :
+        sc_core::sc_module(name),
+        m_bram(bram),
+        m_config(config),
+        m_clock_period(bram.clock_period()),
+        m_input_addr(0),
+        m_output_addr(0),
+        m_sample_count(0),
+        m_done(false) {
+
+        if (config.coefficients.empty()) {
+            SC_REPORT_ERROR("FirPipelinedCycleModel", "At least one tap is needed");
+        }
+        if (config.pipeline_depth == 0) {
+            SC_REPORT_ERROR("FirPipelinedCycleModel", "Pipeline depth must be at least one register");
+        }
+        SC_THREAD(run);
+    }
+
+    // Pulse start on the current edge
+    void start(unsigned input_addr, unsigned output_addr, unsigned sample_count) {
+        m_input_addr = input_addr;
+        m_output_addr = output_addr;
+        m_sample_count = sample_count;
+        m_done = false;
+        m_start_event.notify(sc_core::SC_ZERO_TIME);
+    }
+
+    // Accessors
+    bool done() const { return m_done; }
+    const sc_core::sc_event& done_event() const { return m_done_event; }
+    const FirCoreConfig& config() const { return m_config; }
+    const FirRunStats& stats() const { return m_stats; }
+
+private:
+    // A word on its way back from the BRAM
+    struct InFlightRead {
+        sc_core::sc_time ready;
+        uint8_t data;
+    };
+
+    // A result moving through the pipeline registers
+    struct InFlightResult {
+        sc_core::sc_time due;
+        uint8_t data;
+    };
+
+    FirBramModel& m_bram;
+    FirCoreConfig m_config;
+    sc_core::sc_time m_clock_period;
+    unsigned m_input_addr;
+    unsigned m_output_addr;
+    unsigned m_sample_count;
+    bool m_done;
+    sc_core::sc_event m_start_event;
+    sc_core::sc_event m_done_event;
+    FirRunStats m_stats;
+
+    void run() {
+        while (true) {
+            // IDLE samples start; PIPELINE_FILL raises pipeline_active
+            wait(m_start_event);
+            m_stats = FirRunStats();
+            m_stats.samples = m_sample_count;
+            m_stats.start = sc_core::sc_time_stamp();
+            wait(m_clock_period);
+            wait(m_clock_period);
+
+            std::vector<int8_t> window(m_config.taps(), 0);    // x[n], x[n-1], ...
+            std::deque<InFlightRead> reads;
+            std::deque<InFlightResult> results;
+            unsigned next_read = 0;
+            unsigned written = 0;
+            sc_core::sc_time pipeline_delay = m_clock_period * static_cast<double>(m_config.pipeline_depth);
+
+            while (written < m_sample_count) {
+                sc_core::sc_time now = sc_core::sc_time_stamp();
+
+                // Output stage
+                if (!results.empty() && results.front().due <= now &&
+                    m_bram.write(m_config.write_port(), m_output_addr + written, results.front().data)) {
+                    results.pop_front();
+                    written++;
+                    m_stats.writes++;
+                }
+
+                // Shift register and MAC
+                while (!reads.empty() && reads.front().ready <= now) {
+                    window.pop_back();
+                    window.insert(window.begin(), static_cast<int8_t>(reads.front().data));
+                    reads.pop_front();
+                    uint16_t acc = 0;
+                    for (unsigned k = 0; k < m_config.taps(); k++) {
+                        acc = static_cast<uint16_t>(acc + window[k] * m_config.coefficients[k]);
+                    }
+                    results.push_back({now + pipeline_delay, static_cast<uint8_t>(acc >> 8)});
+                }
+
+                // Input stage
+                if (next_read < m_sample_count) {
+                    InFlightRead read;
+                    if (m_bram.read(m_config.read_port(), m_input_addr + next_read, read.data, read.ready)) {
+                        reads.push_back(read);
+                        next_read++;
+                        m_stats.reads++;
+                    } else {
+                        m_stats.read_stalls++;
+                    }
+                }
+
+                wait(m_clock_period);
+            }
+
+            // DONE raises done
+            m_stats.finish = sc_core::sc_time_stamp();
+            m_stats.cycles = fir_cycles(m_stats.finish - m_stats.start, m_clock_period) + 1;
+            m_done = true;
+            m_done_event.notify(sc_core::SC_ZERO_TIME);
+        }
+    }
+};
+
+#endif // FIR_PIPELINED_MODEL_H
@@ -0,0 +1,96 @@
+#ifndef FIR_TYPES_H
+#define FIR_TYPES_H
+
+#include <systemc>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// fir_tb.v drives a 10 ns clock
+constexpr double FIR_CLOCK_MHZ = 100.0;
+
+// BRAM geometry (bram_memory.v: 1024 x 8 bits, 10-bit addresses)
+constexpr unsigned FIR_BRAM_DEPTH = 1024;
+
+// Run set up by fir_top.v and fir_tb.v
+constexpr unsigned FIR_INPUT_ADDR = 0;
+constexpr unsigned FIR_OUTPUT_ADDR = 32;
+constexpr unsigned FIR_SAMPLE_COUNT = 20;
+
+// fir_non_pipelined.v and fir_pipelined.v: h = 1, 2, 3, 2, 1
+constexpr unsigned FIR_TAPS = 5;
+
+// BRAM ports, as wired in fir_top.v
+constexpr unsigned FIR_PORT_A = 0;
+constexpr unsigned FIR_PORT_B = 1;
+
+// Which BRAM port each kind of access uses
+enum class FirPortMap {
+    DUAL,      // fir_top.v: input reads on port A, output writes on port B
+    SHARED     // Reads and writes share port A; port B belongs to someone else
+};
+
+inline const char* fir_port_map_name(FirPortMap ports) {
+    return ports == FirPortMap::DUAL ? "dual" : "shared";
+}
+
+// Triangular coefficients 1, 2, ..., 2, 1, which give fir_top.v's
+// 1, 2, 3, 2, 1 for five taps. Capped to stay a positive int8.
+inline std::vector<int8_t> fir_default_coefficients(unsigned taps) {
+    std::vector<int8_t> coefficients(taps);
+    for (unsigned k = 0; k < taps; k++) {
+        coefficients[k] = static_cast<int8_t>(std::min(std::min(k + 1, taps - k), 127u));
+    }
+    return coefficients;
+}
+
+// Parameters common to both filter models. The defaults are the RTL's.
+struct FirCoreConfig {
+    std::vector<int8_t> coefficients = fir_default_coefficients(FIR_TAPS);
+    unsigned read_latency = 1;      // Cycles from driving mem_addr_a to using mem_data_out_a
+    unsigned pipeline_depth = 2;    // Pipelined only: registers from the tap window to the write
+    FirPortMap ports = FirPortMap::DUAL;
+
+    unsigned taps() const { return static_cast<unsigned>(coefficients.size()); }
+    unsigned read_port() const { return FIR_PORT_A; }
+    unsigned write_port() const { return ports == FirPortMap::DUAL ? FIR_PORT_B : FIR_PORT_A; }
+};
+
+// Counters collected over one start/done run
+struct FirRunStats {
+    uint64_t samples = 0;
+    uint64_t cycles = 0;            // As fir_top.v counts them: the start edge through done
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t read_stalls = 0;       // Cycles a read waited because its port was taken
+    sc_core::sc_time start;
+    sc_core::sc_time finish;
+
+    double cycles_per_sample() const { return samples ? static_cast<double>(cycles) / samples : 0.0; }
+};
+
+// Intended filter arithmetic: signed samples and coefficients, a wrapping
+// 16-bit accumulator, bits [15:8] kept, x[n-k] = 0 before the first sample
+inline std::vector<int8_t> fir_reference(const std::vector<int8_t>& samples, const std::vector<int8_t>& coefficients) {
+    std::vector<int8_t> out(samples.size());
+    for (size_t n = 0; n < samples.size(); n++) {
+        uint16_t acc = 0;
+        for (size_t k = 0; k < coefficients.size() && k <= n; k++) {
+            acc = static_cast<uint16_t>(acc + samples[n - k] * coefficients[k]);
+        }
+        out[n] = static_cast<int8_t>(acc >> 8);
+    }
+    return out;
+}
+
+// Clock period for a frequency in MHz
+inline sc_core::sc_time fir_clock_period(double mhz) {
+    return sc_core::sc_time(1000.0 / mhz, sc_core::SC_NS);
+}
+
+// Whole clock cycles spanned by an interval
+inline uint64_t fir_cycles(const sc_core::sc_time& span, const sc_core::sc_time& period) {
+    return static_cast<uint64_t>(span / period + 0.5);
+}
+
+#endif // FIR_TYPES_H
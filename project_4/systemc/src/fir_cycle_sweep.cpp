@@ -0,0 +1,227 @@
+#include "../include/fir_types.h"
+#include "../include/fir_bram_model.h"
+#include "../include/fir_non_pipelined_model.h"
+#include "../include/fir_pipelined_model.h"
+#include <systemc>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+// Sweep parameters, settable as key=value arguments
+struct SweepConfig {
+    vector<unsigned> taps = {5, 8, 16, 32, 64};
+    vector<unsigned> latencies = {1, 2, 4};     // BRAM read latency in cycles
+    vector<unsigned> depths = {2};              // Pipelined register depth
+    vector<unsigned> sample_counts = {20, 1000};
+    vector<FirPortMap> port_maps = {FirPortMap::DUAL, FirPortMap::SHARED};
+    unsigned seed = 460;
+};
+
+// One configuration: each filter gets its own BRAM holding the same input
+struct FirSystem {
+    FirCoreConfig config;
+    unsigned samples;
+    unsigned input_addr;
+    unsigned output_addr;
+    vector<int8_t> input;
+    unique_ptr<FirBramModel> np_bram;
+    unique_ptr<FirBramModel> p_bram;
+    unique_ptr<FirNonPipelinedCycleModel> non_pipelined;
+    unique_ptr<FirPipelinedCycleModel> pipelined;
+};
+
+// Pulses start on every filter at time zero
+class SweepDriver : public sc_module {
+public:
+    SC_HAS_PROCESS(SweepDriver);
+    SweepDriver(sc_module_name name, vector<FirSystem>& systems) :
+        sc_module(name),
+        m_systems(systems) {
+        SC_THREAD(run);
+    }
+
+private:
+    vector<FirSystem>& m_systems;
+
+    void run() {
+        for (FirSystem& sys : m_systems) {
+            sys.non_pipelined->start(sys.input_addr, sys.output_addr, sys.samples);
+            sys.pipelined->start(sys.input_addr, sys.output_addr, sys.samples);
+        }
+    }
+};
+
+static bool parse_list(const string& value, vector<unsigned>& list) {
+    list.clear();
+    string copy = value;
+    for (char* tok = strtok(&copy[0], ","); tok; tok = strtok(nullptr, ",")) {
+        list.push_back(static_cast<unsigned>(atoi(tok)));
+    }
+    return !list.empty();
+}
+
+static bool parse_args(int argc, char* argv[], SweepConfig& cfg) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+
+        if (key == "taps") {
+            if (!parse_list(value, cfg.taps)) {
+                return false;
+            }
+        } else if (key == "latency") {
+            if (!parse_list(value, cfg.latencies)) {
+                return false;
+            }
+        } else if (key == "depth") {
+            if (!parse_list(value, cfg.depths)) {
+                return false;
+            }
+        } else if (key == "samples") {
+            if (!parse_list(value, cfg.sample_counts)) {
+                return false;
+            }
+        } else if (key == "ports") {
+            cfg.port_maps.clear();
+            for (char* tok = strtok(&value[0], ","); tok; tok = strtok(nullptr, ",")) {
+                if (strcmp(tok, "dual") == 0) {
+                    cfg.port_maps.push_back(FirPortMap::DUAL);
+                } else if (strcmp(tok, "shared") == 0) {
+                    cfg.port_maps.push_back(FirPortMap::SHARED);
+                } else {
+                    return false;
+                }
+            }
+        } else if (key == "seed") {
+            cfg.seed = static_cast<unsigned>(atoi(value.c_str()));
+        } else {
+            return false;
+        }
+    }
+    for (const vector<unsigned>* list : {&cfg.taps, &cfg.latencies, &cfg.depths, &cfg.sample_counts}) {
+        for (unsigned v : *list) {
+            if (v == 0) {
+                return false;
+            }
+        }
+    }
+    return !cfg.port_maps.empty();
+}
+
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " [key=value ...]" << endl;
+    cout << "  taps=A,B,...      filter lengths (default 5,8,16,32,64)" << endl;
+    cout << "  latency=A,B,...   BRAM read latency in cycles (default 1,2,4)" << endl;
+    cout << "  depth=A,B,...     pipelined filter register depth (default 2)" << endl;
+    cout << "  samples=A,B,...   samples per run (default 20,1000)" << endl;
+    cout << "  ports=dual,shared BRAM port assignment (default both)" << endl;
+    cout << "  seed=N" << endl;
+}
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    SweepConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Input and output regions as in fir_top.v when they fit in its BRAM
+    mt19937 rng(cfg.seed);
+    vector<FirSystem> systems;
+    for (unsigned samples : cfg.sample_counts) {
+        for (FirPortMap ports : cfg.port_maps) {
+            for (unsigned taps : cfg.taps) {
+                for (unsigned latency : cfg.latencies) {
+                    for (unsigned depth : cfg.depths) {
+                        string suffix = "_" + to_string(systems.size());
+                        FirSystem sys;
+                        sys.config.coefficients = fir_default_coefficients(taps);
+                        sys.config.read_latency = latency;
+                        sys.config.pipeline_depth = depth;
+                        sys.config.ports = ports;
+                        sys.samples = samples;
+                        sys.input_addr = FIR_INPUT_ADDR;
+                        sys.output_addr = max(FIR_OUTPUT_ADDR, samples);
+                        unsigned bram_depth = max(FIR_BRAM_DEPTH, sys.output_addr + samples);
+
+                        sys.np_bram.reset(new FirBramModel(("np_bram" + suffix).c_str(), bram_depth, latency));
+                        sys.p_bram.reset(new FirBramModel(("p_bram" + suffix).c_str(), bram_depth, latency));
+                        for (unsigned i = 0; i < samples; i++) {
+                            sys.input.push_back(static_cast<int8_t>(rng()));
+                            sys.np_bram->poke(sys.input_addr + i, static_cast<uint8_t>(sys.input.back()));
+                            sys.p_bram->poke(sys.input_addr + i, static_cast<uint8_t>(sys.input.back()));
+                        }
+                        sys.non_pipelined.reset(new FirNonPipelinedCycleModel(("non_pipelined" + suffix).c_str(),
+                            *sys.np_bram, sys.config));
+                        sys.pipelined.reset(new FirPipelinedCycleModel(("pipelined" + suffix).c_str(),
+                            *sys.p_bram, sys.config));
+                        systems.push_back(std::move(sys));
+                    }
+                }
+            }
+        }
+    }
+    SweepDriver driver("driver", systems);
+
+    // Start simulation
+    sc_start();
+
+    cout << "=== project_4 FIR Cycle Sweep ===" << endl;
+    cout << fixed << setprecision(0) << FIR_CLOCK_MHZ << " MHz clock, random int8 input, triangular coefficients"
+         << endl;
+    cout << "Ports: dual = reads on A, writes on B (fir_top.v); shared = both on port A" << endl;
+    cout << "Stalls: pipelined reads that lost their port to an output write" << endl;
+
+    bool all_passed = true;
+    for (unsigned samples : cfg.sample_counts) {
+        cout << endl << "--- " << samples << " samples ---" << endl;
+        cout << right << setw(5) << "Taps" << setw(5) << "Lat" << setw(7) << "Depth" << setw(8) << "Ports"
+             << setw(12) << "NP cycles" << setw(9) << "NP c/s" << setw(11) << "P cycles" << setw(8) << "P c/s"
+             << setw(8) << "Stalls" << setw(10) << "Speedup" << endl;
+        for (const FirSystem& sys : systems) {
+            if (sys.samples != samples) {
+                continue;
+            }
+            const FirRunStats& np = sys.non_pipelined->stats();
+            const FirRunStats& p = sys.pipelined->stats();
+
+            // Both filters must have finished with the reference output
+            vector<int8_t> expected = fir_reference(sys.input, sys.config.coefficients);
+            bool passed = sys.non_pipelined->done() && sys.pipelined->done();
+            for (unsigned i = 0; i < samples && passed; i++) {
+                passed = static_cast<int8_t>(sys.np_bram->peek(sys.output_addr + i)) == expected[i] &&
+                         static_cast<int8_t>(sys.p_bram->peek(sys.output_addr + i)) == expected[i];
+            }
+            all_passed = all_passed && passed;
+
+            cout << setw(5) << sys.config.taps() << setw(5) << sys.config.read_latency << setw(7)
+                 << sys.config.pipeline_depth << setw(8) << fir_port_map_name(sys.config.ports) << setw(12)
+                 << np.cycles << setw(9) << setprecision(2) << np.cycles_per_sample() << setw(11) << p.cycles
+                 << setw(8) << p.cycles_per_sample() << setw(8) << p.read_stalls << setw(9)
+                 << static_cast<double>(np.cycles) / p.cycles << "x" << (passed ? "" : "  MISMATCH") << endl;
+
+            // The configuration fir_tb.v measures: 241 and 26 cycles
+            if (samples == FIR_SAMPLE_COUNT && sys.config.taps() == FIR_TAPS && sys.config.read_latency == 1 &&
+                sys.config.pipeline_depth == 2 && sys.config.ports == FirPortMap::DUAL) {
+                all_passed = all_passed && np.cycles == 241 && p.cycles == 26;
+            }
+        }
+    }
+
+    cout << endl << "Functional check: " << (all_passed ? "SUCCESS" : "FAILED") << endl;
+    return all_passed ? 0 : 1;
+}
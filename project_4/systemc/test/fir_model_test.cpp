@@ -0,0 +1,262 @@
+#include "../include/fir_types.h"
+#include "../include/fir_bram_model.h"
+#include "../include/fir_non_pipelined_model.h"
+#include "../include/fir_pipelined_model.h"
+#include "../../model/include/fir_engine.h"
+#include <systemc>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sc_core;
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string& message) {
+    if (!condition) {
+        cout << "FAILED: " << message << endl;
+        failures++;
+    }
+}
+
+// One filter run: a BRAM with the input preloaded and one of each model
+// on it. The two models get separate BRAMs so they can run at once.
+struct FirCase {
+    string name;
+    FirCoreConfig config;
+    unsigned samples;
+    unsigned input_addr;
+    unsigned output_addr;
+    vector<int8_t> input;
+    unique_ptr<FirBramModel> np_bram;
+    unique_ptr<FirBramModel> p_bram;
+    unique_ptr<FirNonPipelinedCycleModel> non_pipelined;
+    unique_ptr<FirPipelinedCycleModel> pipelined;
+
+    vector<int8_t> output(const FirBramModel& bram) const {
+        vector<int8_t> out;
+        for (unsigned i = 0; i < samples; i++) {
+            out.push_back(static_cast<int8_t>(bram.peek(output_addr + i)));
+        }
+        return out;
+    }
+};
+
+static mt19937 rng(460);
+
+static FirCase make_case(const string& name, const FirCoreConfig& config, unsigned samples,
+                         unsigned input_addr = FIR_INPUT_ADDR, unsigned output_addr = 0) {
+    // Output after the input unless placed explicitly, at 32 as in fir_top.v when that fits
+    if (output_addr == 0) {
+        output_addr = max(FIR_OUTPUT_ADDR, input_addr + samples);
+    }
+    FirCase c;
+    c.name = name;
+    c.config = config;
+    c.samples = samples;
+    c.input_addr = input_addr;
+    c.output_addr = output_addr;
+    unsigned depth = max(FIR_BRAM_DEPTH, max(input_addr, output_addr) + samples);
+    c.np_bram.reset(new FirBramModel(("np_bram_" + name).c_str(), depth, config.read_latency));
+    c.p_bram.reset(new FirBramModel(("p_bram_" + name).c_str(), depth, config.read_latency));
+    for (unsigned i = 0; i < samples; i++) {
+        c.input.push_back(static_cast<int8_t>(rng()));
+        c.np_bram->poke(input_addr + i, static_cast<uint8_t>(c.input.back()));
+        c.p_bram->poke(input_addr + i, static_cast<uint8_t>(c.input.back()));
+    }
+    c.non_pipelined.reset(new FirNonPipelinedCycleModel(("non_pipelined_" + name).c_str(), *c.np_bram, config));
+    c.pipelined.reset(new FirPipelinedCycleModel(("pipelined_" + name).c_str(), *c.p_bram, config));
+    return c;
+}
+
+// Starts every case at time zero and the first one a second time once it
+// has finished, to check that a run leaves the FSMs ready for the next
+class CaseDriver : public sc_module {
+public:
+    SC_HAS_PROCESS(CaseDriver);
+    CaseDriver(sc_module_name name, vector<FirCase>& cases) :
+        sc_module(name),
+        m_cases(cases) {
+        SC_THREAD(run);
+    }
+
+    FirRunStats first_np;
+    FirRunStats first_p;
+
+private:
+    vector<FirCase>& m_cases;
+
+    void run() {
+        for (FirCase& c : m_cases) {
+            c.non_pipelined->start(c.input_addr, c.output_addr, c.samples);
+            c.pipelined->start(c.input_addr, c.output_addr, c.samples);
+        }
+
+        FirCase& rerun = m_cases.front();
+        wait_done(rerun, rerun.non_pipelined->done(), rerun.non_pipelined->done_event());
+        wait_done(rerun, rerun.pipelined->done(), rerun.pipelined->done_event());
+        first_np = rerun.non_pipelined->stats();
+        first_p = rerun.pipelined->stats();
+        rerun.non_pipelined->start(rerun.input_addr, rerun.output_addr, rerun.samples);
+        rerun.pipelined->start(rerun.input_addr, rerun.output_addr, rerun.samples);
+    }
+
+    // Wait for done, then for the next clock edge
+    void wait_done(const FirCase& c, bool done, const sc_event& done_event) {
+        if (!done) {
+            wait(done_event);
+        }
+        wait(c.np_bram->clock_period());
+    }
+};
+
+// Drives the two BRAM ports directly: one access per port per edge, read
+// data as it was before a write on the same edge
+class BramProbe : public sc_module {
+public:
+    SC_HAS_PROCESS(BramProbe);
+    BramProbe(sc_module_name name) :
+        sc_module(name),
+        bram("probe_bram", 16, 2) {
+        SC_THREAD(run);
+    }
+
+    FirBramModel bram;
+
+private:
+    void run() {
+        sc_time period = bram.clock_period();
+        uint8_t data = 0;
+        sc_time ready;
+        bram.poke(3, 0x11);
+
+        check(bram.write(FIR_PORT_B, 3, 0x22), "probe: write on port B");
+        check(!bram.write(FIR_PORT_B, 4, 0x33), "probe: second access to port B on one edge is refused");
+        check(bram.read(FIR_PORT_A, 3, data, ready), "probe: read on port A beside a write on port B");
+        check(data == 0x11, "probe: same-edge read returns the old word");
+        check(ready == sc_time_stamp() + 2 * period, "probe: read data is ready after the read latency");
+        check(!bram.read(FIR_PORT_A, 5, data, ready), "probe: second read on port A is refused");
+
+        wait(period);
+        check(bram.read(FIR_PORT_A, 3, data, ready) && data == 0x22, "probe: the write lands for the next edge");
+        check(bram.peek(4) == 0, "probe: refused write has no effect");
+
+        const FirBramStats& stats = bram.stats();
+        check(stats.reads == 2 && stats.writes == 1, "probe: access counts");
+        check(stats.port_conflicts == 2, "probe: refused accesses are counted as port conflicts");
+        check(stats.collisions == 1, "probe: same-address read and write are counted as a collision");
+    }
+};
+
+// Main function
+int sc_main(int argc, char* argv[]) {
+    vector<FirCase> cases;
+
+    // fir_top.v as fir_tb.v runs it
+    cases.push_back(make_case("rtl", FirCoreConfig(), FIR_SAMPLE_COUNT));
+
+    // Grid of taps, read latencies and pipeline depths for the closed forms
+    for (unsigned taps : {1u, 3u, 7u}) {
+        for (unsigned latency : {1u, 2u, 3u}) {
+            for (unsigned depth : {1u, 3u}) {
+                for (unsigned samples : {1u, 9u, 50u}) {
+                    FirCoreConfig config;
+                    config.coefficients = fir_default_coefficients(taps);
+                    config.read_latency = latency;
+                    config.pipeline_depth = depth;
+                    string name = "t" + to_string(taps) + "_l" + to_string(latency) + "_d" + to_string(depth) +
+                                  "_n" + to_string(samples);
+                    cases.push_back(make_case(name, config, samples));
+                }
+            }
+        }
+    }
+
+    // Reads and writes on one port
+    FirCoreConfig shared;
+    shared.ports = FirPortMap::SHARED;
+    size_t shared_index = cases.size();
+    cases.push_back(make_case("shared", shared, 200));
+
+    // Output written over the input
+    size_t in_place_index = cases.size();
+    cases.push_back(make_case("in_place", FirCoreConfig(), 40, 100, 100));
+
+    CaseDriver driver("driver", cases);
+    BramProbe probe("probe");
+
+    // Start simulation
+    sc_start();
+
+    // Every case finishes with the reference output (the in-place case is checked below)
+    for (size_t i = 0; i < cases.size(); i++) {
+        const FirCase& c = cases[i];
+        check(c.non_pipelined->done() && c.pipelined->done(), c.name + ": both filters raise done");
+        if (i == in_place_index) {
+            continue;
+        }
+        vector<int8_t> expected = fir_reference(c.input, c.config.coefficients);
+        check(c.output(*c.np_bram) == expected, c.name + ": non-pipelined output matches the reference");
+        check(c.output(*c.p_bram) == expected, c.name + ": pipelined output matches the reference");
+    }
+
+    // fir_tb.console.log: 241 and 26 cycles for 20 samples
+    const FirCase& rtl = cases.front();
+    check(driver.first_np.cycles == 241, "rtl: non-pipelined takes 241 cycles, got " + to_string(driver.first_np.cycles));
+    check(driver.first_p.cycles == 26, "rtl: pipelined takes 26 cycles, got " + to_string(driver.first_p.cycles));
+    check(driver.first_np.reads == 100 && driver.first_p.reads == 20, "rtl: one read per tap versus one per sample");
+    check(rtl.non_pipelined->stats().cycles == 241 && rtl.pipelined->stats().cycles == 26,
+          "rtl: a second run takes as long as the first");
+    check(rtl.pipelined->stats().start > driver.first_p.finish, "rtl: second run starts after the first");
+
+    // Cross-check the five-tap results with the golden model
+    FirPipelinedModel golden(FirKernel::SCALAR);
+    vector<int8_t> golden_out(rtl.samples);
+    golden.process(rtl.input.data(), golden_out.data(), rtl.samples);
+    check(rtl.output(*rtl.p_bram) == golden_out, "rtl: pipelined output matches FirPipelinedModel");
+
+    // Closed forms with separate read and write ports
+    for (const FirCase& c : cases) {
+        if (c.config.ports != FirPortMap::DUAL || &c == &cases[in_place_index]) {
+            continue;
+        }
+        uint64_t n = c.samples;
+        uint64_t np_expected = 1 + n * (c.config.taps() * (c.config.read_latency + 1) + 2);
+        uint64_t p_expected = n + c.config.read_latency + c.config.pipeline_depth + 3;
+        check(c.non_pipelined->stats().cycles == np_expected,
+              c.name + ": non-pipelined cycles " + to_string(c.non_pipelined->stats().cycles) +
+              ", expected " + to_string(np_expected));
+        check(c.pipelined->stats().cycles == p_expected,
+              c.name + ": pipelined cycles " + to_string(c.pipelined->stats().cycles) +
+              ", expected " + to_string(p_expected));
+        check(c.pipelined->stats().read_stalls == 0 && c.p_bram->stats().port_conflicts == 0,
+              c.name + ": no port conflicts with separate ports");
+    }
+
+    // A shared port leaves the non-pipelined FSM alone (it never reads and
+    // writes on one edge) and halves the pipelined filter's throughput
+    const FirCase& sc = cases[shared_index];
+    check(sc.non_pipelined->stats().cycles == 1 + 200 * 12 && sc.non_pipelined->stats().read_stalls == 0,
+          "shared: non-pipelined timing unchanged");
+    check(sc.pipelined->stats().read_stalls > 190, "shared: pipelined reads stall behind writes");
+    check(sc.pipelined->stats().cycles >= 2 * 200 && sc.pipelined->stats().cycles <= 2 * 200 + 6,
+          "shared: pipelined settles at two cycles per sample, got " + to_string(sc.pipelined->stats().cycles));
+
+    // In place, the pipelined filter still has the old samples in its tap
+    // window; the non-pipelined one reads back its own results
+    const FirCase& ip = cases[in_place_index];
+    vector<int8_t> ip_expected = fir_reference(ip.input, ip.config.coefficients);
+    check(ip.output(*ip.p_bram) == ip_expected, "in_place: pipelined output matches the reference");
+    check(ip.output(*ip.np_bram) != ip_expected, "in_place: non-pipelined output is corrupted by its own writes");
+    check(ip.p_bram->stats().collisions == 0, "in_place: pipelined writes trail its reads");
+
+    if (failures == 0) {
+        cout << "All FIR model checks passed" << endl;
+        return 0;
+    }
+    cout << failures << " check(s) failed" << endl;
+    return 1;
+}